@@ -0,0 +1,473 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Microbenchmarks of the buffer pool, the file and the page, printed as one
+// JSON document so that runs of different releases can be compared.
+//
+// Usage: badgerdb_bench [key=value...] [benchmark...]
+//   frames=N   frames of the pool (default 1024)
+//   pages=N    pages of the test file (default 8192)
+//   ops=N      operations per benchmark (default 1000000)
+//   threads=N  most threads of the scaling benchmark (default 8)
+//   skew=S     Zipf exponent of the point reads (default 0.99)
+//   benchmarks: hit_path cold_scan zipf_reads write_eviction
+//               allocate_growth record_churn thread_scaling (default all)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "metrics.h"
+#include "page.h"
+
+using namespace badgerdb;
+
+namespace {
+
+struct Config {
+  std::uint32_t frames = 1024;
+  std::uint32_t pages = 8192;
+  std::uint64_t ops = 1000000;
+  unsigned threads = 8;
+  double skew = 0.99;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(const Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * Collects the fields of one JSON object, in order.
+ */
+class JsonObject {
+ public:
+  JsonObject& field(const char* key, const std::string& value) {
+    add(key, "\"" + value + "\"");
+    return *this;
+  }
+  JsonObject& field(const char* key, const char* value) {
+    return field(key, std::string(value));
+  }
+  JsonObject& field(const char* key, const double value) {
+    char text[64];
+    std::snprintf(text, sizeof(text), "%.6g", value);
+    add(key, text);
+    return *this;
+  }
+  JsonObject& field(const char* key, const std::uint64_t value) {
+    add(key, std::to_string(value));
+    return *this;
+  }
+  JsonObject& raw(const char* key, const std::string& json) {
+    add(key, json);
+    return *this;
+  }
+  std::string str() const {
+    return "{" + body + "}";
+  }
+
+ private:
+  void add(const char* key, const std::string& value) {
+    if (!body.empty()) {
+      body += ", ";
+    }
+    body += "\"" + std::string(key) + "\": " + value;
+  }
+  std::string body;
+};
+
+std::string latencyJson(const LatencySnapshot& latency) {
+  return JsonObject()
+      .field("mean_ns", latency.mean())
+      .field("p50_ns", latency.percentile(0.50))
+      .field("p99_ns", latency.percentile(0.99))
+      .field("p999_ns", latency.percentile(0.999))
+      .field("max_ns", latency.max)
+      .str();
+}
+
+std::string statsJson(const BufStats& stats) {
+  return JsonObject()
+      .field("hits", stats.hits)
+      .field("misses", stats.misses)
+      .field("hit_ratio", stats.hitRatio())
+      .field("disk_reads", stats.diskreads)
+      .field("disk_writes", stats.diskwrites)
+      .field("evictions", stats.evictions)
+      .str();
+}
+
+/**
+ * Creates a file of the given number of pages under a fresh name.
+ */
+File makeFile(const std::string& name, const std::uint32_t pages) {
+  if (File::exists(name)) {
+    File::remove(name);
+  }
+  File file = File::create(name);
+  for (std::uint32_t i = 0; i < pages; i++) {
+    file.allocatePage();
+  }
+  return file;
+}
+
+/**
+ * Closes and removes a file made by makeFile().
+ */
+void dropFile(File& file) {
+  const std::string name = file.filename();
+  file.close();
+  File::remove(name);
+}
+
+/**
+ * Draws page numbers from 1 to n with Zipfian skew, page 1 the most popular.
+ */
+class Zipf {
+ public:
+  Zipf(const std::uint32_t n, const double skew) : cdf(n) {
+    double sum = 0;
+    for (std::uint32_t i = 0; i < n; i++) {
+      sum += 1.0 / std::pow(i + 1.0, skew);
+      cdf[i] = sum;
+    }
+    for (double& c : cdf) {
+      c /= sum;
+    }
+  }
+  PageId operator()(std::mt19937_64& random) {
+    const double u = std::uniform_real_distribution<double>(0, 1)(random);
+    return static_cast<PageId>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin()) + 1;
+  }
+
+ private:
+  std::vector<double> cdf;
+};
+
+/**
+ * readPage() and unPinPage() of one resident page, timed one pair at a time.
+ */
+std::string hitPath(const Config& config) {
+  File file = makeFile("bench_hit.db", 1);
+  BufMgr* pool = new BufMgr(config.frames);
+  Page* page;
+  pool->readPage(&file, 1, page);
+  pool->unPinPage(&file, 1, false);
+  LatencyHistogram latency;
+  const Clock::time_point start = Clock::now();
+  for (std::uint64_t i = 0; i < config.ops; i++) {
+    const Clock::time_point before = Clock::now();
+    pool->readPage(&file, 1, page);
+    pool->unPinPage(&file, 1, false);
+    latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - before).count());
+  }
+  const double seconds = secondsSince(start);
+  pool->flushFile(&file);
+  delete pool;
+  dropFile(file);
+  return JsonObject()
+      .field("name", "hit_path")
+      .field("ops", config.ops)
+      .field("seconds", seconds)
+      .field("ops_per_sec", config.ops / seconds)
+      .raw("latency", latencyJson(latency.snapshot()))
+      .str();
+}
+
+/**
+ * One pass over a file not in the pool, in page order.
+ */
+std::string coldScan(const Config& config) {
+  File file = makeFile("bench_scan.db", config.pages);
+  BufMgr* pool = new BufMgr(config.frames);
+  Page* page;
+  const Clock::time_point start = Clock::now();
+  for (PageId pageNo = 1; pageNo <= config.pages; pageNo++) {
+    pool->readPage(&file, pageNo, page);
+    pool->unPinPage(&file, pageNo, false);
+  }
+  const double seconds = secondsSince(start);
+  const BufStats stats = pool->getBufStats();
+  pool->flushFile(&file);
+  delete pool;
+  dropFile(file);
+  return JsonObject()
+      .field("name", "cold_scan")
+      .field("pages", std::uint64_t(config.pages))
+      .field("seconds", seconds)
+      .field("pages_per_sec", config.pages / seconds)
+      .field("mb_per_sec", config.pages * double(Page::SIZE) / seconds / 1e6)
+      .raw("stats", statsJson(stats))
+      .str();
+}
+
+/**
+ * Random point reads, skewed towards a few hot pages.
+ */
+std::string zipfReads(const Config& config) {
+  File file = makeFile("bench_zipf.db", config.pages);
+  BufMgr* pool = new BufMgr(config.frames);
+  Zipf zipf(config.pages, config.skew);
+  std::mt19937_64 random(42);
+  Page* page;
+  const Clock::time_point start = Clock::now();
+  for (std::uint64_t i = 0; i < config.ops; i++) {
+    const PageId pageNo = zipf(random);
+    pool->readPage(&file, pageNo, page);
+    pool->unPinPage(&file, pageNo, false);
+  }
+  const double seconds = secondsSince(start);
+  const BufStats stats = pool->getBufStats();
+  pool->flushFile(&file);
+  delete pool;
+  dropFile(file);
+  return JsonObject()
+      .field("name", "zipf_reads")
+      .field("skew", config.skew)
+      .field("ops", config.ops)
+      .field("seconds", seconds)
+      .field("ops_per_sec", config.ops / seconds)
+      .raw("miss_latency", latencyJson(stats.misslatency))
+      .raw("stats", statsJson(stats))
+      .str();
+}
+
+/**
+ * Uniform random updates of a file eight times the pool, so that most
+ * evictions write a dirty page back.
+ */
+std::string writeEviction(const Config& config) {
+  const std::uint32_t pages = config.frames * 8;
+  File file = makeFile("bench_write.db", pages);
+  BufMgr* pool = new BufMgr(config.frames);
+  std::mt19937_64 random(42);
+  std::uniform_int_distribution<PageId> any(1, pages);
+  const std::uint64_t ops = std::min<std::uint64_t>(config.ops, 100000);
+  Page* page;
+  const Clock::time_point start = Clock::now();
+  for (std::uint64_t i = 0; i < ops; i++) {
+    const PageId pageNo = any(random);
+    pool->readPage(&file, pageNo, page);
+    pool->unPinPage(&file, pageNo, true);
+  }
+  const double seconds = secondsSince(start);
+  const BufStats stats = pool->getBufStats();
+  pool->flushFile(&file);
+  delete pool;
+  dropFile(file);
+  return JsonObject()
+      .field("name", "write_eviction")
+      .field("ops", ops)
+      .field("seconds", seconds)
+      .field("ops_per_sec", ops / seconds)
+      .field("dirty_evictions", stats.dirtyevictions)
+      .raw("stats", statsJson(stats))
+      .str();
+}
+
+/**
+ * File::allocatePage() timed in steps as the file grows.
+ */
+std::string allocateGrowth(const Config& config) {
+  const std::string name = "bench_alloc.db";
+  if (File::exists(name)) {
+    File::remove(name);
+  }
+  File file = File::create(name);
+  const std::uint32_t step = std::max<std::uint32_t>(config.pages / 8, 1);
+  std::string steps;
+  for (std::uint32_t size = 0; size < config.pages; size += step) {
+    Page page;
+    const Clock::time_point start = Clock::now();
+    for (std::uint32_t i = 0; i < step; i++) {
+      file.allocatePage(page);
+    }
+    const double seconds = secondsSince(start);
+    steps += (steps.empty() ? "" : ", ") + JsonObject()
+        .field("file_pages", std::uint64_t(size + step))
+        .field("ns_per_alloc", seconds * 1e9 / step)
+        .str();
+  }
+  file.close();
+  File::remove(name);
+  return JsonObject()
+      .field("name", "allocate_growth")
+      .raw("steps", "[" + steps + "]")
+      .str();
+}
+
+/**
+ * Inserts and deletes of records of random sizes on one page, keeping it
+ * about half full.
+ */
+std::string recordChurn(const Config& config) {
+  Page page;
+  std::mt19937_64 random(42);
+  std::uniform_int_distribution<std::size_t> length(16, 256);
+  const std::string bytes(256, 'r');
+  std::vector<RecordId> live;
+  std::uint64_t inserts = 0;
+  std::uint64_t deletes = 0;
+  const Clock::time_point start = Clock::now();
+  for (std::uint64_t i = 0; i < config.ops; i++) {
+    const std::string_view record(bytes.data(), length(random));
+    if (page.getFreeSpace() > Page::DATA_SIZE / 2 && page.hasSpaceForRecord(record)) {
+      live.push_back(page.insertRecord(record));
+      inserts++;
+    } else {
+      const std::size_t victim = random() % live.size();
+      page.deleteRecord(live[victim]);
+      live[victim] = live.back();
+      live.pop_back();
+      deletes++;
+    }
+  }
+  const double seconds = secondsSince(start);
+  return JsonObject()
+      .field("name", "record_churn")
+      .field("ops", config.ops)
+      .field("inserts", inserts)
+      .field("deletes", deletes)
+      .field("seconds", seconds)
+      .field("ops_per_sec", config.ops / seconds)
+      .str();
+}
+
+/**
+ * Hit path throughput of 1, 2, 4 ... threads reading pages of a shared
+ * resident set.
+ */
+std::string threadScaling(const Config& config) {
+  const std::uint32_t pages = std::min<std::uint32_t>(config.frames / 2, 256);
+  File file = makeFile("bench_threads.db", pages);
+  BufMgr* pool = new BufMgr(config.frames);
+  Page* page;
+  for (PageId pageNo = 1; pageNo <= pages; pageNo++) {
+    pool->readPage(&file, pageNo, page);
+    pool->unPinPage(&file, pageNo, false);
+  }
+  std::string runs;
+  double single = 0;
+  for (unsigned threads = 1; threads <= config.threads; threads *= 2) {
+    const std::uint64_t perThread = config.ops / threads;
+    std::vector<std::thread> workers;
+    const Clock::time_point start = Clock::now();
+    for (unsigned t = 0; t < threads; t++) {
+      workers.push_back(std::thread([pool, &file, pages, perThread, t]() {
+        std::mt19937_64 random(t);
+        std::uniform_int_distribution<PageId> any(1, pages);
+        Page* hit;
+        for (std::uint64_t i = 0; i < perThread; i++) {
+          const PageId pageNo = any(random);
+          pool->readPage(&file, pageNo, hit);
+          pool->unPinPage(&file, pageNo, false);
+        }
+      }));
+    }
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+    const double rate = perThread * threads / secondsSince(start);
+    if (threads == 1) {
+      single = rate;
+    }
+    runs += (runs.empty() ? "" : ", ") + JsonObject()
+        .field("threads", std::uint64_t(threads))
+        .field("ops_per_sec", rate)
+        .field("speedup", rate / single)
+        .str();
+  }
+  const BufStats stats = pool->getBufStats();
+  pool->flushFile(&file);
+  delete pool;
+  dropFile(file);
+  return JsonObject()
+      .field("name", "thread_scaling")
+      .field("pin_waits", stats.pinwaits)
+      .field("shared_reads", stats.sharedreads)
+      .raw("runs", "[" + runs + "]")
+      .str();
+}
+
+struct Benchmark {
+  const char* name;
+  std::string (*run)(const Config&);
+};
+
+const Benchmark benchmarks[] = {{"hit_path", hitPath},
+                                {"cold_scan", coldScan},
+                                {"zipf_reads", zipfReads},
+                                {"write_eviction", writeEviction},
+                                {"allocate_growth", allocateGrowth},
+                                {"record_churn", recordChurn},
+                                {"thread_scaling", threadScaling}};
+
+}
+
+int main(int argc, char* argv[]) {
+  Config config;
+  std::vector<std::string> wanted;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = std::strchr(arg, '=');
+    if (value == NULL) {
+      wanted.push_back(arg);
+      continue;
+    }
+    const std::string key(arg, value - arg);
+    value++;
+    if (key == "frames") {
+      config.frames = std::max(std::atoi(value), 2);
+    } else if (key == "pages") {
+      config.pages = std::max(std::atoi(value), 1);
+    } else if (key == "ops") {
+      config.ops = std::max(std::atoll(value), 1LL);
+    } else if (key == "threads") {
+      config.threads = std::max(std::atoi(value), 1);
+    } else if (key == "skew") {
+      config.skew = std::atof(value);
+    } else {
+      std::fprintf(stderr, "unknown parameter %s\n", key.c_str());
+      return 2;
+    }
+  }
+
+  std::string results;
+  for (const Benchmark& benchmark : benchmarks) {
+    if (!wanted.empty() &&
+        std::find(wanted.begin(), wanted.end(), benchmark.name) == wanted.end()) {
+      continue;
+    }
+    results += (results.empty() ? "\n    " : ",\n    ") + benchmark.run(config);
+  }
+  const std::string configJson = JsonObject()
+      .field("frames", std::uint64_t(config.frames))
+      .field("pages", std::uint64_t(config.pages))
+      .field("ops", config.ops)
+      .field("threads", std::uint64_t(config.threads))
+      .field("skew", config.skew)
+      .field("page_size", std::uint64_t(Page::SIZE))
+      .str();
+  std::printf("{\n  \"suite\": \"badgerdb_bench\",\n  \"config\": %s,\n"
+              "  \"results\": [%s\n  ]\n}\n", configJson.c_str(), results.c_str());
+  return 0;
+}
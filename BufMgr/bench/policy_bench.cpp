@@ -0,0 +1,106 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Compares the hit ratios of the replacement policies on a trace mixing point
+// lookups on a hot set with large sequential scans.
+//
+// Usage: policy_bench [frames [pages [rounds]]]
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+struct Policy {
+  const char* name;
+  ReplacementType type;
+};
+
+/**
+ * Builds the trace: each round is a burst of lookups, 90% of them on a hot set
+ * of a tenth of the file and the rest anywhere, followed by a scan of a third
+ * of the file.  The same seed gives every policy the same trace.
+ */
+std::vector<PageId> makeTrace(PageId pages, PageId frames, int rounds) {
+  std::mt19937 random(42);
+  const PageId hot = std::max<PageId>(pages / 10, 1);
+  std::uniform_int_distribution<PageId> hot_page(1, hot);
+  std::uniform_int_distribution<PageId> any_page(1, pages);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::vector<PageId> trace;
+  PageId scan_start = hot + 1;
+  for (int round = 0; round < rounds; round++) {
+    for (PageId i = 0; i < 4 * frames; i++) {
+      trace.push_back(percent(random) < 90 ? hot_page(random) : any_page(random));
+    }
+    for (PageId i = 0; i < pages / 3; i++) {
+      trace.push_back(scan_start);
+      scan_start = scan_start % pages + 1;
+    }
+  }
+  return trace;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const PageId frames = argc > 1 ? std::atoi(argv[1]) : 100;
+  const PageId pages = argc > 2 ? std::atoi(argv[2]) : 1000;
+  const int rounds = argc > 3 ? std::atoi(argv[3]) : 20;
+  const std::string filename = "policy_bench.db";
+
+  if (File::exists(filename)) {
+    File::remove(filename);
+  }
+  {
+    File file = File::create(filename);
+    for (PageId i = 0; i < pages; i++) {
+      file.allocatePage();
+    }
+  }
+
+  const std::vector<PageId> trace = makeTrace(pages, frames, rounds);
+  const Policy policies[] = {{"clock", ReplacementType::CLOCK},
+                             {"lru-2", ReplacementType::LRU_K},
+                             {"2q", ReplacementType::TWO_Q},
+                             {"arc", ReplacementType::ARC}};
+
+  std::printf("%u frames, %u pages, %zu references\n", frames, pages, trace.size());
+  std::printf("%-8s %10s %10s %9s\n", "policy", "hits", "misses", "hit ratio");
+  for (const Policy& policy : policies) {
+    File file = File::open(filename);
+    BufMgrOptions options;
+    options.replacement = policy.type;
+    BufMgr* bufMgr = new BufMgr(frames, options);
+    Page* page;
+    for (PageId pageNo : trace) {
+      bufMgr->readPage(&file, pageNo, page);
+      bufMgr->unPinPage(&file, pageNo, false);
+    }
+    const BufStats stats = bufMgr->getBufStats();
+    std::printf("%-8s %10llu %10llu %8.2f%%\n", policy.name,
+                (unsigned long long) stats.hits, (unsigned long long) stats.misses,
+                100.0 * stats.hitRatio());
+    bufMgr->flushFile(&file);
+    delete bufMgr;
+  }
+
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Replays a trace recorded with BufMgrOptions::traceFile against pools of the
+// given sizes, one line per size, so that the lines trace a miss ratio curve.
+//
+// Usage: trace_replay trace [policy [frames...]]
+//   policy is one of clock, lru-2, 2q and arc; the default is clock
+//   frames default to 64 128 256 512 1024
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "traceReplay.h"
+#include "exceptions/badgerdb_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+struct Policy {
+  const char* name;
+  ReplacementType type;
+};
+
+const Policy policies[] = {{"clock", ReplacementType::CLOCK},
+                           {"lru-2", ReplacementType::LRU_K},
+                           {"2q", ReplacementType::TWO_Q},
+                           {"arc", ReplacementType::ARC}};
+
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s trace [policy [frames...]]\n", argv[0]);
+    return 2;
+  }
+  BufMgrOptions options;
+  const char* policyName = argc > 2 ? argv[2] : "clock";
+  bool known = false;
+  for (const Policy& policy : policies) {
+    if (std::strcmp(policy.name, policyName) == 0) {
+      options.replacement = policy.type;
+      known = true;
+    }
+  }
+  if (!known) {
+    std::fprintf(stderr, "unknown policy %s\n", policyName);
+    return 2;
+  }
+  std::vector<std::uint32_t> sizes;
+  for (int i = 3; i < argc; i++) {
+    sizes.push_back(std::atoi(argv[i]));
+  }
+  if (sizes.empty()) {
+    sizes = {64, 128, 256, 512, 1024};
+  }
+
+  try {
+    const std::vector<TraceRecord> trace = TraceRecorder::read(argv[1]);
+    const TraceReplay replay(trace, "trace_replay.db");
+    std::printf("%s, %s, %zu records\n", argv[1], policyName, trace.size());
+    std::printf("%8s %10s %10s %9s %10s %10s %9s %12s\n", "frames", "hits", "misses",
+                "hit ratio", "reads", "writes", "skipped", "ops/s");
+    for (std::uint32_t frames : sizes) {
+      const ReplayResult result = replay.run(frames, options);
+      std::printf("%8u %10llu %10llu %8.2f%% %10llu %10llu %9llu %12.0f\n", frames,
+                  (unsigned long long) result.stats.hits,
+                  (unsigned long long) result.stats.misses,
+                  100.0 * result.stats.hitRatio(),
+                  (unsigned long long) result.stats.diskreads,
+                  (unsigned long long) result.stats.diskwrites,
+                  (unsigned long long) result.skipped,
+                  result.seconds > 0 ? result.operations / result.seconds : 0.0);
+    }
+  } catch (const BadgerDbException& e) {
+    std::fprintf(stderr, "%s\n", e.message().c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "arcPolicy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ArcPolicy::ArcPolicy(const std::uint32_t bufs)
+	: c(bufs), p(0), lists(bufs, LISTS), pages(bufs), unread(bufs, false), limit(bufs)
+{
+  for (FrameId i = 0; i < bufs; i++) {
+    lists.pushBack(FREE, i);
+  }
+}
+
+bool ArcPolicy::evictFrom(const int list, GhostList& ghost, const FrameClaim& claim,
+                          FrameId& frame)
+{
+  for (const FrameId candidate : lists.frames(list)) {
+    if (claim(candidate, false)) {
+      lists.erase(candidate);
+      if (list != FREE) {
+        ghost.push(pages[candidate]);
+        if (ghost.size() > c) {
+          ghost.popOldest();
+        }
+      }
+      frame = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ArcPolicy::evict(const FrameClaim& claim, FrameId& frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  if (evictFrom(FREE, b1, claim, frame)) {
+    return true;
+  }
+  // REPLACE: take from T1 while it is larger than its target
+  if (lists.size(T1) > 0 && (lists.size(T1) > p || lists.size(T2) == 0)) {
+    return evictFrom(T1, b1, claim, frame) || evictFrom(T2, b2, claim, frame);
+  }
+  return evictFrom(T2, b2, claim, frame) || evictFrom(T1, b1, claim, frame);
+}
+
+void ArcPolicy::installed(const FrameId frame, const File* file, const PageId pageNo,
+                          const bool cold)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  const PageKey key(file->id(), pageNo);
+  pages[frame] = key;
+  unread[frame] = cold;
+  if (!cold && b1.contains(key)) {
+    // recency would have kept it: favour T1
+    p = std::min(c, p + std::max<std::size_t>(b2.size() / b1.size(), 1));
+    b1.erase(key);
+    lists.pushBack(T2, frame);
+    return;
+  }
+  if (!cold && b2.contains(key)) {
+    // frequency would have kept it: favour T2
+    const std::size_t delta = std::max<std::size_t>(b1.size() / b2.size(), 1);
+    p = p > delta ? p - delta : 0;
+    b2.erase(key);
+    lists.pushBack(T2, frame);
+    return;
+  }
+  // A new page: keep the directory within c pages per side and 2c in total
+  if (lists.size(T1) + b1.size() >= c && b1.size() > 0) {
+    b1.popOldest();
+  }
+  while (lists.size(T1) + lists.size(T2) + b1.size() + b2.size() >= 2 * c && b2.size() > 0) {
+    b2.popOldest();
+  }
+  if (cold) {
+    lists.pushFront(T1, frame);
+  } else {
+    lists.pushBack(T1, frame);
+  }
+}
+
+void ArcPolicy::accessed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  touch(frame);
+}
+
+void ArcPolicy::accessedAll(const std::vector<FrameId>& frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  for (FrameId frame : frames) {
+    touch(frame);
+  }
+}
+
+void ArcPolicy::touch(const FrameId frame)
+{
+  if (unread[frame]) {
+    // the first reference to a read-ahead page only makes it a regular newcomer
+    unread[frame] = false;
+    if (lists.listOf(frame) == T1) {
+      lists.pushBack(T1, frame);
+    }
+    return;
+  }
+  const int list = lists.listOf(frame);
+  if (list == T1 || list == T2) {
+    lists.pushBack(T2, frame);
+  }
+}
+
+void ArcPolicy::removed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  if (frame < limit) {
+    lists.pushBack(FREE, frame);
+  } else {
+    lists.erase(frame);
+  }
+}
+
+void ArcPolicy::resize(const std::uint32_t frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  lists.resize(frames);
+  if (frames > pages.size()) {
+    pages.resize(frames);
+    unread.resize(frames, false);
+  }
+  for (FrameId i = frames; i < limit; i++) {
+    if (lists.listOf(i) == FREE) {
+      lists.erase(i);
+    }
+  }
+  for (FrameId i = limit; i < frames; i++) {
+    if (lists.listOf(i) == FrameLists::NONE) {
+      lists.pushBack(FREE, i);
+    }
+  }
+  limit = frames;
+  // the directory shrinks with the cache, from the oldest ghosts
+  c = frames;
+  p = std::min(p, c);
+  while (b1.size() > c) {
+    b1.popOldest();
+  }
+  while (b2.size() > c) {
+    b2.popOldest();
+  }
+}
+
+void ArcPolicy::victimOrder(std::vector<FrameId>& frames) const
+{
+  std::lock_guard<std::mutex> guard(latch);
+  const int order[] = {FREE, T1, T2};
+  for (const int list : order) {
+    frames.insert(frames.end(), lists.frames(list).begin(), lists.frames(list).end());
+  }
+}
+
+}
@@ -0,0 +1,110 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "replacementPolicy.h"
+
+namespace badgerdb {
+
+/**
+* @brief Adaptive Replacement Cache of Megiddo and Modha
+*
+* Resident pages are split between T1, pages seen once recently, and T2, pages
+* seen at least twice; ghost lists B1 and B2 remember pages recently evicted
+* from each.  A miss on a page remembered in B1 grows the target size p of T1,
+* one remembered in B2 shrinks it, so the split adapts between recency and
+* frequency.  A scan only churns T1.  All decisions are serialized by one
+* latch.
+*/
+class ArcPolicy : public ReplacementPolicy
+{
+ public:
+	/**
+   * Constructor of ArcPolicy class
+   *
+   * @param bufs   Number of frames in the buffer pool
+	 */
+  explicit ArcPolicy(const std::uint32_t bufs);
+
+  bool evict(const FrameClaim& claim, FrameId& frame) override;
+  void installed(const FrameId frame, const File* file, const PageId pageNo,
+                 const bool cold) override;
+  void accessed(const FrameId frame) override;
+  void accessedAll(const std::vector<FrameId>& frames) override;
+  void removed(const FrameId frame) override;
+  void victimOrder(std::vector<FrameId>& frames) const override;
+  void resize(const std::uint32_t frames) override;
+
+ private:
+	/**
+   * Record a hit on a frame.  Caller holds the latch.
+	 */
+  void touch(const FrameId frame);
+
+	/**
+   * Ids of the frame lists
+	 */
+  enum { FREE, T1, T2, LISTS };
+
+	/**
+   * Offer the frames of one list to <claim>, least recently used first, and
+   * remember the evicted page in <ghost>.  Caller holds the latch.
+   *
+   * @return  True if a frame was claimed; it is then in no list.
+	 */
+  bool evictFrom(const int list, GhostList& ghost, const FrameClaim& claim, FrameId& frame);
+
+	/**
+   * Protects all other members
+	 */
+  mutable std::mutex latch;
+
+	/**
+   * Number of frames
+	 */
+  std::size_t c;
+
+	/**
+   * Target size of T1
+	 */
+  std::size_t p;
+
+	/**
+   * Free, T1 and T2 frames
+	 */
+  FrameLists lists;
+
+	/**
+   * Page held by each frame
+	 */
+  std::vector<PageKey> pages;
+
+	/**
+   * True for read-ahead frames not referenced since they were installed
+	 */
+  std::vector<bool> unread;
+
+	/**
+   * Number of frames in the pool; frames above are not put in the free list
+	 */
+  std::uint32_t limit;
+
+	/**
+   * Pages recently evicted from T1 and T2
+	 */
+  GhostList b1;
+  GhostList b2;
+};
+
+}
@@ -0,0 +1,537 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "btreeIndex.h"
+#include "exceptions/index_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+const PageId BTreeIndex::META_PAGE;
+
+namespace {
+
+/**
+ * Kinds of BTREE page
+ */
+const std::uint32_t META = 1;
+const std::uint32_t LEAF = 2;
+const std::uint32_t INTERNAL = 3;
+
+/**
+ * Marks the root pointer of an index, "BTRE"
+ */
+const std::uint32_t MAGIC = 0x45525442;
+
+/**
+ * Fewest keys a node may be given, so that a split leaves both halves some
+ */
+const std::uint32_t MIN_KEYS = 3;
+
+/**
+ * Start of the data area of a node
+ */
+struct NodeHeader {
+  std::uint32_t kind;
+  std::uint32_t count;
+  PageId next;
+  std::uint32_t level;
+};
+
+/**
+ * Data area of the root pointer
+ */
+struct Meta {
+  std::uint32_t kind;
+  std::uint32_t magic;
+  PageId root;
+  std::uint32_t levels;
+  std::uint64_t entries;
+  std::uint32_t leaf_keys;
+  std::uint32_t inner_keys;
+};
+
+/**
+ * A record ID as a leaf stores it, without padding
+ */
+struct StoredRid {
+  PageId page_number;
+  std::uint32_t slot_number;
+};
+
+/**
+ * Keys a leaf or internal node has room for.  The arrays are placed for
+ * these, whatever the index's own limits.
+ */
+const std::uint32_t LEAF_MAX = static_cast<std::uint32_t>(
+    (Page::DATA_SIZE - sizeof(NodeHeader)) / (sizeof(std::int64_t) + sizeof(StoredRid)));
+const std::uint32_t INNER_MAX = static_cast<std::uint32_t>(
+    (Page::DATA_SIZE - sizeof(NodeHeader) - sizeof(PageId)) /
+    (sizeof(std::int64_t) + sizeof(PageId)));
+
+static_assert(LEAF_MAX >= MIN_KEYS && INNER_MAX >= MIN_KEYS,
+              "A B+-tree node must hold a few keys");
+
+NodeHeader& nodeOf(char* data) {
+  return *reinterpret_cast<NodeHeader*>(data);
+}
+
+const NodeHeader& nodeOf(const char* data) {
+  return *reinterpret_cast<const NodeHeader*>(data);
+}
+
+Meta& metaOf(char* data) {
+  return *reinterpret_cast<Meta*>(data);
+}
+
+std::int64_t* keysOf(char* data) {
+  return reinterpret_cast<std::int64_t*>(data + sizeof(NodeHeader));
+}
+
+const std::int64_t* keysOf(const char* data) {
+  return reinterpret_cast<const std::int64_t*>(data + sizeof(NodeHeader));
+}
+
+StoredRid* ridsOf(char* data) {
+  return reinterpret_cast<StoredRid*>(data + sizeof(NodeHeader) +
+                                      LEAF_MAX * sizeof(std::int64_t));
+}
+
+PageId* childrenOf(char* data) {
+  return reinterpret_cast<PageId*>(data + sizeof(NodeHeader) +
+                                   INNER_MAX * sizeof(std::int64_t));
+}
+
+std::uint32_t capKeys(const std::uint32_t maxKeys, const std::uint32_t room) {
+  if (maxKeys == 0) {
+    return room;
+  }
+  return std::min(std::max(maxKeys, MIN_KEYS), room);
+}
+
+/**
+ * Number of nodes of at most <per> entries that <total> take.  The entries
+ * are then spread evenly, the first <total % nodes> nodes taking one more.
+ */
+std::uint64_t nodesFor(const std::uint64_t total, const std::uint64_t per) {
+  return (total + per - 1) / per;
+}
+
+}
+
+BTreeIndex::BTreeIndex(BufMgr* bufMgr, File* file, const std::uint32_t maxKeys)
+	: bufMgr(bufMgr),
+	  file(file),
+	  root(Page::INVALID_NUMBER),
+	  levels(0),
+	  entries(0),
+	  leafKeys(0),
+	  innerKeys(0)
+{
+  if (file->numPages() <= 1) {
+    leafKeys = capKeys(maxKeys, LEAF_MAX);
+    innerKeys = capKeys(maxKeys, INNER_MAX);
+    PageId metaNo;
+    {
+      PageGuard meta = bufMgr->allocPage(file, metaNo);
+      meta->initializeAs(BTREE);
+      metaOf(meta->data_).kind = META;
+      metaOf(meta->data_).magic = MAGIC;
+      meta.markDirty();
+    }
+    if (metaNo != META_PAGE) {
+      throw IndexException(file->filename(), "the root pointer is not page 1");
+    }
+    allocNode(0, root);
+    levels = 1;
+    writeMeta();
+    return;
+  }
+
+  PageGuard meta;
+  try {
+    meta = bufMgr->readPage(file, META_PAGE);
+  } catch (const InvalidPageException&) {
+    throw IndexException(file->filename(), "the file holds no index");
+  }
+  const Meta& stored = metaOf(meta->data_);
+  if (meta->header_->page_type != BTREE || stored.kind != META ||
+      stored.magic != MAGIC) {
+    throw IndexException(file->filename(), "the file holds no index");
+  }
+  root = stored.root;
+  levels = stored.levels;
+  entries = stored.entries;
+  leafKeys = stored.leaf_keys;
+  innerKeys = stored.inner_keys;
+}
+
+bool BTreeIndex::lookup(const std::int64_t key, RecordId& rid)
+{
+  PageGuard leaf = findLeaf(key);
+  char* data = leaf->data_;
+  const std::uint32_t count = nodeOf(data).count;
+  const std::int64_t* keys = keysOf(data);
+  const std::int64_t* pos = std::lower_bound(keys, keys + count, key);
+  if (pos == keys + count || *pos != key) {
+    return false;
+  }
+  const StoredRid& stored = ridsOf(data)[pos - keys];
+  rid.page_number = stored.page_number;
+  rid.slot_number = static_cast<SlotId>(stored.slot_number);
+  return true;
+}
+
+bool BTreeIndex::insert(const std::int64_t key, const RecordId& rid)
+{
+  Split split;
+  if (!insertInto(root, key, rid, split)) {
+    return false;
+  }
+  if (split.happened) {
+    PageId newRoot;
+    PageGuard node = allocNode(levels, newRoot);
+    char* data = node->data_;
+    nodeOf(data).count = 1;
+    keysOf(data)[0] = split.key;
+    childrenOf(data)[0] = root;
+    childrenOf(data)[1] = split.right;
+    root = newRoot;
+    levels++;
+  }
+  entries++;
+  writeMeta();
+  return true;
+}
+
+bool BTreeIndex::insertInto(const PageId node, const std::int64_t key,
+                            const RecordId& rid, Split& split)
+{
+  split.happened = false;
+  PageGuard page = bufMgr->readPage(file, node);
+  char* data = page->data_;
+  NodeHeader& header = nodeOf(data);
+  std::int64_t* keys = keysOf(data);
+  const std::uint32_t count = header.count;
+
+  if (header.kind == LEAF) {
+    const std::uint32_t pos = static_cast<std::uint32_t>(
+        std::lower_bound(keys, keys + count, key) - keys);
+    if (pos < count && keys[pos] == key) {
+      return false;
+    }
+    StoredRid* rids = ridsOf(data);
+    const StoredRid stored = {rid.page_number, rid.slot_number};
+    page.markDirty();
+    if (count < leafKeys) {
+      std::memmove(keys + pos + 1, keys + pos, (count - pos) * sizeof(std::int64_t));
+      std::memmove(rids + pos + 1, rids + pos, (count - pos) * sizeof(StoredRid));
+      keys[pos] = key;
+      rids[pos] = stored;
+      header.count++;
+      return true;
+    }
+
+    // the left half keeps the lower keys, the new key included if it is one
+    PageId rightNo;
+    PageGuard right = allocNode(0, rightNo);
+    char* rightData = right->data_;
+    std::int64_t* rightKeys = keysOf(rightData);
+    StoredRid* rightRids = ridsOf(rightData);
+    const std::uint32_t total = count + 1;
+    const std::uint32_t left = (total + 1) / 2;
+    for (std::uint32_t i = total; i-- > left;) {
+      const std::uint32_t from = i > pos ? i - 1 : i;
+      rightKeys[i - left] = i == pos ? key : keys[from];
+      rightRids[i - left] = i == pos ? stored : rids[from];
+    }
+    if (pos < left) {
+      std::memmove(keys + pos + 1, keys + pos, (left - 1 - pos) * sizeof(std::int64_t));
+      std::memmove(rids + pos + 1, rids + pos, (left - 1 - pos) * sizeof(StoredRid));
+      keys[pos] = key;
+      rids[pos] = stored;
+    }
+    header.count = left;
+    nodeOf(rightData).count = total - left;
+    nodeOf(rightData).next = header.next;
+    header.next = rightNo;
+    split.happened = true;
+    split.key = rightKeys[0];
+    split.right = rightNo;
+    return true;
+  }
+
+  const std::uint32_t pos = static_cast<std::uint32_t>(
+      std::upper_bound(keys, keys + count, key) - keys);
+  PageId* children = childrenOf(data);
+  Split below;
+  if (!insertInto(children[pos], key, rid, below)) {
+    return false;
+  }
+  if (!below.happened) {
+    return true;
+  }
+  page.markDirty();
+  if (count < innerKeys) {
+    std::memmove(keys + pos + 1, keys + pos, (count - pos) * sizeof(std::int64_t));
+    std::memmove(children + pos + 2, children + pos + 1, (count - pos) * sizeof(PageId));
+    keys[pos] = below.key;
+    children[pos + 1] = below.right;
+    header.count++;
+    return true;
+  }
+
+  // gather the count + 1 keys and count + 2 children, then keep the keys
+  // below the middle one, push the middle one up and move the rest right
+  std::vector<std::int64_t> allKeys(keys, keys + count);
+  std::vector<PageId> allChildren(children, children + count + 1);
+  allKeys.insert(allKeys.begin() + pos, below.key);
+  allChildren.insert(allChildren.begin() + pos + 1, below.right);
+  const std::uint32_t total = count + 1;
+  const std::uint32_t middle = total / 2;
+
+  PageId rightNo;
+  PageGuard right = allocNode(header.level, rightNo);
+  char* rightData = right->data_;
+  std::copy(allKeys.begin() + middle + 1, allKeys.end(), keysOf(rightData));
+  std::copy(allChildren.begin() + middle + 1, allChildren.end(), childrenOf(rightData));
+  nodeOf(rightData).count = total - middle - 1;
+  std::copy(allKeys.begin(), allKeys.begin() + middle, keys);
+  std::copy(allChildren.begin(), allChildren.begin() + middle + 1, children);
+  header.count = middle;
+  split.happened = true;
+  split.key = allKeys[middle];
+  split.right = rightNo;
+  return true;
+}
+
+bool BTreeIndex::remove(const std::int64_t key)
+{
+  {
+    PageGuard leaf = findLeaf(key);
+    char* data = leaf->data_;
+    NodeHeader& header = nodeOf(data);
+    std::int64_t* keys = keysOf(data);
+    const std::uint32_t pos = static_cast<std::uint32_t>(
+        std::lower_bound(keys, keys + header.count, key) - keys);
+    if (pos == header.count || keys[pos] != key) {
+      return false;
+    }
+    StoredRid* rids = ridsOf(data);
+    std::memmove(keys + pos, keys + pos + 1, (header.count - pos - 1) * sizeof(std::int64_t));
+    std::memmove(rids + pos, rids + pos + 1, (header.count - pos - 1) * sizeof(StoredRid));
+    header.count--;
+    leaf.markDirty();
+  }
+  entries--;
+  writeMeta();
+  return true;
+}
+
+std::uint64_t BTreeIndex::scan(const std::int64_t low, const std::int64_t high,
+                               const Visitor& visitor)
+{
+  std::uint64_t visited = 0;
+  if (low > high) {
+    return visited;
+  }
+  PageGuard leaf = findLeaf(low);
+  std::uint32_t pos = static_cast<std::uint32_t>(
+      std::lower_bound(keysOf(leaf->data_), keysOf(leaf->data_) + nodeOf(leaf->data_).count,
+                       low) - keysOf(leaf->data_));
+  for (;;) {
+    char* data = leaf->data_;
+    const NodeHeader& header = nodeOf(data);
+    const std::int64_t* keys = keysOf(data);
+    const StoredRid* rids = ridsOf(data);
+    for (; pos < header.count; pos++) {
+      if (keys[pos] > high) {
+        return visited;
+      }
+      visited++;
+      const RecordId rid = {rids[pos].page_number,
+                            static_cast<SlotId>(rids[pos].slot_number)};
+      if (!visitor(keys[pos], rid)) {
+        return visited;
+      }
+    }
+    if (header.next == Page::INVALID_NUMBER) {
+      return visited;
+    }
+    leaf = bufMgr->readPage(file, header.next);
+    pos = 0;
+  }
+}
+
+void BTreeIndex::bulkLoad(const std::vector<std::pair<std::int64_t, RecordId> >& entries,
+                          const double fill)
+{
+  if (this->entries != 0 || levels != 1) {
+    throw IndexException(file->filename(), "bulk load into an index that is not empty");
+  }
+  for (std::size_t i = 1; i < entries.size(); i++) {
+    if (entries[i - 1].first >= entries[i].first) {
+      throw IndexException(file->filename(),
+                           "bulk load of keys that are not strictly increasing");
+    }
+  }
+  if (entries.empty()) {
+    return;
+  }
+  const double share = std::min(std::max(fill, 0.0), 1.0);
+
+  // leaves, the first one being the empty root; <level> holds the first key
+  // and page of each node of the level just built
+  std::vector<std::pair<std::int64_t, PageId> > level;
+  {
+    const std::uint64_t per = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(std::floor(leafKeys * share)));
+    const std::uint64_t nodes = nodesFor(entries.size(), per);
+    PageGuard previous;
+    std::size_t next = 0;
+    for (std::uint64_t n = 0; n < nodes; n++) {
+      const std::size_t count = entries.size() / nodes + (n < entries.size() % nodes);
+      PageId pageNo = root;
+      PageGuard leaf;
+      if (n == 0) {
+        leaf = bufMgr->readPage(file, root);
+        leaf.markDirty();
+      } else {
+        leaf = allocNode(0, pageNo);
+      }
+      char* data = leaf->data_;
+      nodeOf(data).count = static_cast<std::uint32_t>(count);
+      for (std::size_t i = 0; i < count; i++) {
+        keysOf(data)[i] = entries[next + i].first;
+        ridsOf(data)[i].page_number = entries[next + i].second.page_number;
+        ridsOf(data)[i].slot_number = entries[next + i].second.slot_number;
+      }
+      level.push_back(std::make_pair(entries[next].first, pageNo));
+      next += count;
+      if (previous) {
+        nodeOf(previous->data_).next = pageNo;
+      }
+      previous = std::move(leaf);
+    }
+  }
+
+  // internal levels, until one node is left; with at least three children
+  // a node, spreading them evenly leaves every node two or more
+  std::uint32_t height = 1;
+  const std::uint64_t per = std::min<std::uint64_t>(
+      innerKeys + 1,
+      std::max<std::uint64_t>(3, static_cast<std::uint64_t>(std::floor(innerKeys * share)) + 1));
+  while (level.size() > 1) {
+    std::vector<std::pair<std::int64_t, PageId> > above;
+    const std::uint64_t nodes = nodesFor(level.size(), per);
+    std::size_t next = 0;
+    for (std::uint64_t n = 0; n < nodes; n++) {
+      const std::size_t count = level.size() / nodes + (n < level.size() % nodes);
+      PageId pageNo;
+      PageGuard node = allocNode(height, pageNo);
+      char* data = node->data_;
+      nodeOf(data).count = static_cast<std::uint32_t>(count - 1);
+      for (std::size_t i = 0; i < count; i++) {
+        childrenOf(data)[i] = level[next + i].second;
+        if (i > 0) {
+          keysOf(data)[i - 1] = level[next + i].first;
+        }
+      }
+      above.push_back(std::make_pair(level[next].first, pageNo));
+      next += count;
+    }
+    level.swap(above);
+    height++;
+  }
+  root = level[0].second;
+  levels = height;
+  this->entries = entries.size();
+  writeMeta();
+}
+
+bool BTreeIndex::isConsistent(const Page& page)
+{
+  if (page.header_->page_type != BTREE || page.header_->num_slots != 0 ||
+      page.header_->free_space_upper_bound != 0) {
+    return false;
+  }
+  const char* data = page.data_;
+  const NodeHeader& header = nodeOf(data);
+  if (header.kind == META) {
+    const Meta& meta = *reinterpret_cast<const Meta*>(data);
+    return meta.magic == MAGIC && meta.levels > 0 &&
+           meta.leaf_keys >= MIN_KEYS && meta.leaf_keys <= LEAF_MAX &&
+           meta.inner_keys >= MIN_KEYS && meta.inner_keys <= INNER_MAX;
+  }
+  if (header.kind == LEAF) {
+    if (header.level != 0 || header.count > LEAF_MAX) {
+      return false;
+    }
+  } else if (header.kind == INTERNAL) {
+    if (header.level == 0 || header.count > INNER_MAX) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  const std::int64_t* keys = keysOf(data);
+  for (std::uint32_t i = 1; i < header.count; i++) {
+    if (keys[i - 1] >= keys[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+PageGuard BTreeIndex::findLeaf(const std::int64_t key)
+{
+  PageGuard node = bufMgr->readPage(file, root);
+  while (nodeOf(node->data_).kind == INTERNAL) {
+    char* data = node->data_;
+    const std::int64_t* keys = keysOf(data);
+    const std::uint32_t pos = static_cast<std::uint32_t>(
+        std::upper_bound(keys, keys + nodeOf(data).count, key) - keys);
+    const PageId child = childrenOf(data)[pos];
+    node.release();
+    node = bufMgr->readPage(file, child);
+  }
+  return node;
+}
+
+PageGuard BTreeIndex::allocNode(const std::uint32_t level, PageId& pageNo)
+{
+  PageGuard node = bufMgr->allocPage(file, pageNo);
+  node->initializeAs(BTREE);
+  NodeHeader& header = nodeOf(node->data_);
+  header.kind = level == 0 ? LEAF : INTERNAL;
+  header.count = 0;
+  header.next = Page::INVALID_NUMBER;
+  header.level = level;
+  node.markDirty();
+  return node;
+}
+
+void BTreeIndex::writeMeta()
+{
+  PageGuard page = bufMgr->readPage(file, META_PAGE);
+  Meta& meta = metaOf(page->data_);
+  meta.root = root;
+  meta.levels = levels;
+  meta.entries = entries;
+  meta.leaf_keys = leafKeys;
+  meta.inner_keys = innerKeys;
+  page.markDirty();
+}
+
+}
@@ -0,0 +1,211 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+* @brief B+-tree index from 64 bit signed keys to RecordIds, stored in the
+* pages of its own file and read through a buffer pool
+*
+* Page 1 of the index file is the root pointer: the root's page number, the
+* height of the tree and the number of nodes' keys it may hold.  Every other
+* page is a node, of page type BTREE.  A node keeps its keys in one sorted
+* array and its children or record IDs in another, so that a search is a
+* binary search over contiguous keys.  Leaves are linked from left to right
+* for range scans.  Internal node i's child holds the keys from key i - 1 up
+* to but not including key i.
+*
+* Keys are unique.  Deleting a key leaves its leaf in place, even when empty,
+* so a tree keeps the height it grew to; bulkLoad() into a new file builds a
+* compact one.  An insert keeps every node on its way down pinned, the
+* height of the tree at most; other operations pin one node at a time.
+*
+* Not threadsafe.
+*/
+class BTreeIndex
+{
+ public:
+	/**
+   * Receives an entry of a range scan, in key order; returns false to stop
+   * the scan.
+	 */
+  typedef std::function<bool(std::int64_t key, const RecordId& rid)> Visitor;
+
+	/**
+   * Page number of the root pointer
+	 */
+  static const PageId META_PAGE = 1;
+
+	/**
+   * Opens the index in a file, or starts an empty one if the file has no
+   * pages.
+   *
+   * @param bufMgr   Pool to read and write the index's pages through
+   * @param file     Index file, open for as long as the index is used, and
+   *                 flushed with BufMgr::flushFile() before it is closed
+   * @param maxKeys  Most keys a node holds, for a new index; 0 for as many as
+   *                 fit a page.  An existing index keeps its own.
+   * @throws  IndexException If the file has pages but no index
+	 */
+  BTreeIndex(BufMgr* bufMgr, File* file, const std::uint32_t maxKeys = 0);
+
+	/**
+   * Finds the record ID of a key.
+   *
+   * @param key  The key
+   * @param rid  Set to the key's record ID if it is there
+   * @return  Whether the key is in the index
+	 */
+  bool lookup(const std::int64_t key, RecordId& rid);
+
+	/**
+   * Adds a key, splitting the nodes it does not fit on.
+   *
+   * @param key  The key
+   * @param rid  Its record ID
+   * @return  False, leaving the index as it was, if the key is already there
+	 */
+  bool insert(const std::int64_t key, const RecordId& rid);
+
+	/**
+   * Removes a key.
+   *
+   * @param key  The key
+   * @return  Whether the key was there
+	 */
+  bool remove(const std::int64_t key);
+
+	/**
+   * Visits the keys from <low> to <high>, both included, in order.
+   *
+   * @param low      Smallest key visited
+   * @param high     Largest key visited
+   * @param visitor  Receives each entry
+   * @return  Number of entries visited
+	 */
+  std::uint64_t scan(const std::int64_t low, const std::int64_t high,
+                     const Visitor& visitor);
+
+	/**
+   * Fills an empty index from entries sorted by key, packing the leaves and
+   * then each level of internal nodes left to right, each node as full as
+   * <fill> allows.
+   *
+   * @param entries  Keys and record IDs, in strictly increasing key order
+   * @param fill     Share of each node to fill, from just above 0 to 1; the
+   *                 room left is for later inserts
+   * @throws  IndexException If the index is not empty, or has grown past a
+   *          single leaf, or the keys are not in strictly increasing order;
+   *          nothing is loaded then
+	 */
+  void bulkLoad(const std::vector<std::pair<std::int64_t, RecordId> >& entries,
+                const double fill = 1.0);
+
+	/**
+   * @return  Number of keys
+	 */
+  std::uint64_t size() const { return entries; }
+
+	/**
+   * @return  Number of levels of nodes, 1 for a tree that is a single leaf
+	 */
+  std::uint32_t height() const { return levels; }
+
+	/**
+   * Returns true if a page is a B+-tree node or root pointer whose counts
+   * and keys are in order, so that reading it stays within the page.
+   *
+   * @param page  The page
+	 */
+  static bool isConsistent(const Page& page);
+
+ private:
+	/**
+   * A node that split: the first key of the new right node, and its page
+	 */
+  struct Split
+  {
+    bool happened;
+    std::int64_t key;
+    PageId right;
+  };
+
+	/**
+   * Inserts into the subtree under a node.
+   *
+   * @return  False if the key is already there
+	 */
+  bool insertInto(const PageId node, const std::int64_t key, const RecordId& rid,
+                  Split& split);
+
+	/**
+   * Returns the leaf a key belongs in, pinned.
+	 */
+  PageGuard findLeaf(const std::int64_t key);
+
+	/**
+   * Allocates and pins an empty node, marked dirty.
+   *
+   * @param level   0 for a leaf, the height above the leaves otherwise
+   * @param pageNo  Set to the node's page number
+	 */
+  PageGuard allocNode(const std::uint32_t level, PageId& pageNo);
+
+	/**
+   * Writes the root, height and key count to the root pointer page.
+	 */
+  void writeMeta();
+
+	/**
+   * Pool the pages are read through
+	 */
+  BufMgr* bufMgr;
+
+	/**
+   * Index file
+	 */
+  File* file;
+
+	/**
+   * Page number of the root
+	 */
+  PageId root;
+
+	/**
+   * Levels of nodes
+	 */
+  std::uint32_t levels;
+
+	/**
+   * Number of keys
+	 */
+  std::uint64_t entries;
+
+	/**
+   * Most keys of a leaf
+	 */
+  std::uint32_t leafKeys;
+
+	/**
+   * Most keys of an internal node
+	 */
+  std::uint32_t innerKeys;
+};
+
+}
@@ -12,50 +12,87 @@
 #include <iostream>
 #include "buffer.h"
 #include "bufHashTbl.h"
-#include "exceptions/hash_already_present_exception.h"
-#include "exceptions/hash_not_found_exception.h"
 #include "exceptions/hash_table_exception.h"
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+std::uint64_t BufHashTbl::hash(const FileId fileId, const PageId pageNo)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
+  // the file identifier spread far apart, offset by the page number
+  return (std::uint64_t) fileId * 0x9e3779b1ULL + pageNo;
 }
 
-BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+BufHashTbl::BufHashTbl(int htSize, int shards)
+	: numShards(shards < htSize ? shards : htSize)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  if (numShards < 1)
+    numShards = 1;
+  // allocate an array of pointers to hashBuckets for every shard
+  const std::uint32_t perShard = htSize / numShards + 1;
+  this->shards = new Shard[numShards];
+  for (int i = 0; i < numShards; i++) {
+    this->shards[i].buckets = new hashBucket* [perShard]();
+    this->shards[i].size = perShard;
+    this->shards[i].count = 0;
+  }
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
+  for (int i = 0; i < numShards; i++) {
+    Shard& shard = shards[i];
+    for (std::uint32_t b = 0; b < shard.size; b++) {
+      while (shard.buckets[b]) {
+        hashBucket* tmpBuf = shard.buckets[b];
+        shard.buckets[b] = tmpBuf->next;
+        delete tmpBuf;
+      }
+    }
+    delete [] shard.buckets;
+  }
+  delete [] shards;
+}
+
+void BufHashTbl::grow(Shard& shard, const std::uint32_t size)
+{
+  hashBucket** old = shard.buckets;
+  const std::uint32_t oldSize = shard.size;
+  shard.buckets = new hashBucket* [size]();
+  shard.size = size;
+  // the nodes are relinked, not copied
+  for (std::uint32_t b = 0; b < oldSize; b++) {
+    while (old[b]) {
+      hashBucket* tmpBuc = old[b];
+      old[b] = tmpBuc->next;
+      hashBucket*& chain = chainFor(shard, hash(tmpBuc->fileId, tmpBuc->pageNo));
+      tmpBuc->next = chain;
+      chain = tmpBuc;
     }
   }
-  delete [] ht;
+  delete [] old;
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+void BufHashTbl::reserve(const std::uint32_t entries)
 {
-  int index = hash(file, pageNo);
+  // six buckets for every five entries, as the table is first sized
+  const std::uint32_t wanted = (std::uint32_t) ((std::uint64_t) entries * 6 / 5 / numShards) + 1;
+  for (int i = 0; i < numShards; i++) {
+    std::lock_guard<std::mutex> guard(shards[i].latch);
+    if (shards[i].size < wanted)
+      grow(shards[i], wanted);
+  }
+}
 
-  hashBucket* tmpBuc = ht[index];
+bool BufHashTbl::tryInsert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  const std::uint64_t h = hash(file->id(), pageNo);
+  Shard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+
+  hashBucket* tmpBuc = chainFor(shard, h);
   while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
+    if (tmpBuc->fileId == file->id() && tmpBuc->pageNo == pageNo)
+      return false;
     tmpBuc = tmpBuc->next;
   }
 
@@ -63,46 +100,57 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
   if (!tmpBuc)
   	throw HashTableException();
 
-  tmpBuc->file = (File*) file;
+  tmpBuc->fileId = file->id();
   tmpBuc->pageNo = pageNo;
   tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+  if (shard.count + 1 > shard.size)
+    grow(shard, 2 * shard.size);
+  hashBucket*& chain = chainFor(shard, h);
+  tmpBuc->next = chain;
+  chain = tmpBuc;
+  shard.count++;
+  return true;
 }
 
-void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+bool BufHashTbl::tryLookup(const File* file, const PageId pageNo, FrameId &frameNo) 
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
+  const std::uint64_t h = hash(file->id(), pageNo);
+  Shard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  hashBucket* tmpBuc = chainFor(shard, h);
   while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+    if (tmpBuc->fileId == file->id() && tmpBuc->pageNo == pageNo)
     {
       frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+      return true;
     }
     tmpBuc = tmpBuc->next;
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
 }
 
-void BufHashTbl::remove(const File* file, const PageId pageNo) {
+bool BufHashTbl::tryRemove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
+  const std::uint64_t h = hash(file->id(), pageNo);
+  Shard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  hashBucket*& chain = chainFor(shard, h);
+  hashBucket* tmpBuc = chain;
   hashBucket* prevBuc = NULL;
 
   while (tmpBuc)
 	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+    if (tmpBuc->fileId == file->id() && tmpBuc->pageNo == pageNo)
 		{
       if(prevBuc) 
 				prevBuc->next = tmpBuc->next;
       else
-				ht[index] = tmpBuc->next;
+				chain = tmpBuc->next;
 
       delete tmpBuc;
-      return;
+      shard.count--;
+      return true;
     }
 		else
 		{
@@ -111,7 +159,24 @@ void BufHashTbl::remove(const File* file, const PageId pageNo) {
     }
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
+}
+
+bool BufHashTbl::tryReplace(const File* file, const PageId pageNo, const FrameId from,
+                            const FrameId to)
+{
+  const std::uint64_t h = hash(file->id(), pageNo);
+  Shard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  for (hashBucket* tmpBuc = chainFor(shard, h); tmpBuc; tmpBuc = tmpBuc->next) {
+    if (tmpBuc->fileId == file->id() && tmpBuc->pageNo == pageNo) {
+      if (tmpBuc->frameNo != from)
+        return false;
+      tmpBuc->frameNo = to;
+      return true;
+    }
+  }
+  return false;
 }
 
 }
@@ -10,7 +10,11 @@
 
 #pragma once
 
+#include <cstdint>
+#include <mutex>
+
 #include "file.h"
+#include "pageTable.h"
 
 namespace badgerdb {
 
@@ -19,9 +23,9 @@ namespace badgerdb {
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
+	 * identifier of the file the page belongs to, see File::id()
 	 */
-	File *file;
+	FileId fileId;
 
 	/**
 	 * page number within a file
@@ -43,50 +47,92 @@ struct hashBucket {
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
-* @warning This class is not threadsafe.
+* The table is partitioned into shards, a page belonging to shard
+* hash % numShards.  Each shard has its own bucket array and latch, so
+* operations on pages that hash to different shards never contend with each
+* other.  A shard doubles its bucket array when it holds more entries than
+* buckets.  Every public method is atomic with respect to the others.
 */
-class BufHashTbl
+class BufHashTbl : public PageTable
 {
  private:
 	/**
-	 *	Size of Hash Table
+	 * Bucket array and latch of one partition of the table
+	 */
+  struct Shard {
+    std::mutex latch;
+    hashBucket** buckets;
+    std::uint32_t size;
+    std::uint32_t count;
+  };
+
+	/**
+	 * Number of shards the buckets are partitioned into
 	 */
-  int HTSIZE;
+  int numShards;
+
 	/**
-	 * Actual Hash table object
+	 * The shards themselves
 	 */
-  hashBucket**  ht;
+  Shard* shards;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * returns hash value computed using file and pageNo; the shard is the
+	 * value modulo numShards and the bucket the rest modulo the shard's size
 	 *
-	 * @param file   	File object
+	 * @param fileId 	Identifier of the file
 	 * @param pageNo  Page number in the file
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  std::uint64_t hash(const FileId fileId, const PageId pageNo);
+
+	/**
+	 * Returns the shard owning the given hash value
+	 */
+  Shard& shardFor(const std::uint64_t h) { return shards[h % numShards]; }
+
+	/**
+	 * Returns the chain of a hash value within its shard.  The caller must hold
+	 * the shard's latch.
+	 */
+  hashBucket*& chainFor(Shard& shard, const std::uint64_t h)
+  {
+    return shard.buckets[(h / numShards) % shard.size];
+  }
+
+	/**
+	 * Rehashes the chains of a shard into a bucket array of the given size.
+	 * The caller must hold the shard's latch.
+	 *
+	 * @param shard  	Shard to grow
+	 * @param size  	New number of buckets
+	 */
+  void grow(Shard& shard, const std::uint32_t size);
 
  public:
 	/**
    * Constructor of BufHashTbl class
+   *
+   * @param htSize  Number of buckets to start with, over all shards
+   * @param shards  Number of independently latched shards
 	 */
-	BufHashTbl(const int htSize);  // constructor
+	BufHashTbl(const int htSize, const int shards = 64);  // constructor
 
 	/**
    * Destructor of BufHashTbl class
 	 */
-  ~BufHashTbl(); // destructor
+  ~BufHashTbl() override; // destructor
 	
 	/**
-   * Insert entry into hash table mapping (file, pageNo) to frameNo.
+   * Insert entry into hash table mapping (file, pageNo) to frameNo unless the
+   * page already has an entry.  Never throws on a duplicate.
 	 *
 	 * @param file   	File object
 	 * @param pageNo 	Page number in the file
 	 * @param frameNo Frame number assigned to that page of the file
-   * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as running of memory
+   * @return  			False if the page already exists in the hash table.
 	 */
-  void insert(const File* file, const PageId pageNo, const FrameId frameNo);
+  bool tryInsert(const File* file, const PageId pageNo, const FrameId frameNo) override;
 
 	/**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
@@ -94,19 +140,33 @@ class BufHashTbl
 	 *
 	 * @param file  	File object
 	 * @param pageNo	Page number in the file
-	 * @param frameNo Frame number reference
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+	 * @param frameNo Frame number reference, only written when found
+   * @return  			True if the page entry is in the hash table.
 	 */
-  void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
+  bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo) override;
 
 	/**
-   * Delete entry (file,pageNo) from hash table.
+   * Delete entry (file,pageNo) from hash table if present.
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+   * @return  			True if an entry was removed.
 	 */
-  void remove(const File* file, const PageId pageNo);  
+  bool tryRemove(const File* file, const PageId pageNo) override;
+
+	/**
+   * Point the entry of (file, pageNo) at frame <to> if it is at <from>.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param from    Frame the entry must be at
+	 * @param to      Frame it is moved to
+   * @return  			False if the page has no entry at <from>.
+	 */
+  bool tryReplace(const File* file, const PageId pageNo, const FrameId from,
+                  const FrameId to) override;
+
+  void reserve(const std::uint32_t entries) override;
 };
 
 }
@@ -0,0 +1,160 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <thread>
+
+#include "bufPoolSet.h"
+#include "numaPlacement.h"
+
+namespace badgerdb {
+
+BufPoolSet::BufPoolSet(const std::uint32_t instances, const std::uint32_t frames,
+                       const BufMgrOptions& options)
+{
+  const std::uint32_t count = std::max<std::uint32_t>(instances, 1);
+  const int machineNodes = numaNodes();
+  pools.resize(count, NULL);
+  nodes.resize(count, -1);
+  std::exception_ptr error;
+  for (std::uint32_t n = 0; n < count && !error; n++) {
+    BufMgrOptions own = options;
+    if (options.numaNode < 0 && machineNodes > 1) {
+      own.numaNode = static_cast<int>(n % machineNodes);
+    }
+    if (!options.logFile.empty()) {
+      own.logFile = options.logFile + "." + std::to_string(n);
+    }
+    if (!options.traceFile.empty()) {
+      own.traceFile = options.traceFile + "." + std::to_string(n);
+    }
+    nodes[n] = own.numaNode;
+    // built on the node, the instance's descriptors and tables are local too
+    std::thread builder([&, n, own]() {
+      if (own.numaNode >= 0) {
+        runOnNode(own.numaNode);
+      }
+      try {
+        pools[n] = new BufMgr(frames, own);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    });
+    builder.join();
+  }
+  if (error) {
+    for (BufMgr* pool : pools) {
+      delete pool;
+    }
+    std::rethrow_exception(error);
+  }
+}
+
+BufPoolSet::~BufPoolSet()
+{
+  for (BufMgr* pool : pools) {
+    delete pool;
+  }
+}
+
+std::uint32_t BufPoolSet::instanceOf(const File* file, const PageId pageNo) const
+{
+  std::uint64_t key = (std::uint64_t(file->id()) << 32) | pageNo;
+  // Fibonacci hashing spreads runs of page numbers over the instances
+  key *= 0x9E3779B97F4A7C15ULL;
+  return static_cast<std::uint32_t>((key >> 32) % pools.size());
+}
+
+bool BufPoolSet::bindThread(const std::uint32_t n) const
+{
+  return runOnNode(nodes[n]);
+}
+
+void BufPoolSet::readPage(File* file, const PageId pageNo, Page*& page)
+{
+  pools[instanceOf(file, pageNo)]->readPage(file, pageNo, page);
+}
+
+PageGuard BufPoolSet::readPage(File* file, const PageId pageNo)
+{
+  return pools[instanceOf(file, pageNo)]->readPage(file, pageNo);
+}
+
+PageGuard BufPoolSet::readPageForUpdate(File* file, const PageId pageNo)
+{
+  return pools[instanceOf(file, pageNo)]->readPageForUpdate(file, pageNo);
+}
+
+void BufPoolSet::unPinPage(File* file, const PageId pageNo, const bool dirty)
+{
+  pools[instanceOf(file, pageNo)]->unPinPage(file, pageNo, dirty);
+}
+
+void BufPoolSet::allocPage(File* file, PageId& pageNo, Page*& page)
+{
+  // the page number picks the pool, so the page is set up outside it first;
+  // as with BufMgr::allocPage() the frame is its only copy until written back
+  Page image;
+  pageNo = file->allocateUnwritten(image);
+  try {
+    pools[instanceOf(file, pageNo)]->installPage(file, pageNo, image, page);
+  } catch (...) {
+    file->deletePage(pageNo);
+    throw;
+  }
+}
+
+PageGuard BufPoolSet::allocPage(File* file, PageId& pageNo)
+{
+  Page* page;
+  allocPage(file, pageNo, page);
+  BufMgr* pool = pools[instanceOf(file, pageNo)];
+  return PageGuard(pool, file, pageNo, static_cast<FrameId>(page - pool->bufPool), page);
+}
+
+void BufPoolSet::disposePage(File* file, const PageId pageNo)
+{
+  pools[instanceOf(file, pageNo)]->disposePage(file, pageNo);
+}
+
+void BufPoolSet::flushFile(const File* file)
+{
+  std::exception_ptr error;
+  for (BufMgr* pool : pools) {
+    try {
+      pool->flushFile(file);
+    } catch (...) {
+      if (!error) error = std::current_exception();
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+BufStats BufPoolSet::getBufStats()
+{
+  BufStats stats;
+  for (BufMgr* pool : pools) {
+    stats.merge(pool->getBufStats());
+  }
+  return stats;
+}
+
+void BufPoolSet::clearBufStats()
+{
+  for (BufMgr* pool : pools) {
+    pool->clearBufStats();
+  }
+}
+
+}
@@ -0,0 +1,191 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+* @brief Several buffer pools sharing the work of one, each on a NUMA node
+*
+* Every instance is a BufMgr of its own, with its frames, descriptors, page
+* table and replacement policy, so instances never contend with each other.
+* A page always goes to the instance its (file, page number) hashes to.
+* Each instance is constructed on a thread bound to its node, so that its
+* memory is first touched there, and its frame arena is placed on the node
+* (BufMgrOptions::numaNode).  Threads working mostly on one instance's pages
+* can be bound to its node with bindThread().
+*/
+class BufPoolSet
+{
+ public:
+	/**
+   * Constructs the instances.  Unless options.numaNode picks one node for
+   * all of them, instance i is placed on node i modulo the number of nodes;
+   * on a machine with one node placement is left to the kernel.  A log or
+   * trace file named in the options gets one file per instance, named after
+   * it with ".<instance>" appended.
+   *
+   * @param instances  Number of instances, at least 1
+   * @param frames     Number of frames of each instance
+   * @param options    Options of every instance
+	 */
+  BufPoolSet(const std::uint32_t instances, const std::uint32_t frames,
+             const BufMgrOptions& options = BufMgrOptions());
+
+	/**
+   * Destroys the instances.  Files must have been flushed, as for a BufMgr.
+	 */
+  ~BufPoolSet();
+
+  BufPoolSet(const BufPoolSet&) = delete;
+  BufPoolSet& operator=(const BufPoolSet&) = delete;
+
+	/**
+   * @return  Number of instances
+	 */
+  std::uint32_t size() const { return static_cast<std::uint32_t>(pools.size()); }
+
+	/**
+   * @param n  Instance number
+   * @return  The instance
+	 */
+  BufMgr& instance(const std::uint32_t n) { return *pools[n]; }
+
+	/**
+   * @param n  Instance number
+   * @return  Node the instance was placed on, or -1 if it was not placed
+	 */
+  int nodeOf(const std::uint32_t n) const { return nodes[n]; }
+
+	/**
+   * Returns the instance that holds a page whenever it is in a pool.
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file
+   * @return  Instance number
+	 */
+  std::uint32_t instanceOf(const File* file, const PageId pageNo) const;
+
+	/**
+   * Restricts the calling thread to the CPUs of an instance's node.
+   *
+   * @param n  Instance number
+   * @return  True if the thread's affinity was changed
+	 */
+  bool bindThread(const std::uint32_t n) const;
+
+	/**
+   * Reads a page into its instance, see BufMgr::readPage().
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @param page  	Set to the Page object of the page
+	 */
+  void readPage(File* file, const PageId pageNo, Page*& page);
+
+	/**
+   * Reads a page into its instance, see BufMgr::readPage().
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @return  Guard holding the pin on the page
+	 */
+  PageGuard readPage(File* file, const PageId pageNo);
+
+	/**
+   * Reads a page to change it in its instance, see
+   * BufMgr::readPageForUpdate().
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @return  Guard holding the pin on the page, or on a private copy
+	 */
+  PageGuard readPageForUpdate(File* file, const PageId pageNo);
+
+	/**
+   * Unpins a page in its instance, see BufMgr::unPinPage().
+   *
+   * @param file   	File object
+   * @param pageNo  Page number
+   * @param dirty		True if the page needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not pinned
+	 */
+  void unPinPage(File* file, const PageId pageNo, const bool dirty);
+
+	/**
+   * Allocates a new page in the file and puts it into the instance its page
+   * number belongs to, see BufMgr::allocPage().  The page number is only
+   * known once the file has allocated the page, so the file initializes it
+   * outside the pools, without writing it, and it is then copied into a
+   * frame, which is the page's only copy until written back.
+   *
+   * @param file   	File object
+   * @param pageNo  Set to the number assigned to the page in the file
+   * @param page  	Set to the Page object of the page
+   * @throws  BufferExceededException If the instance has no unpinned frame;
+   *          the page is deleted from the file again
+	 */
+  void allocPage(File* file, PageId& pageNo, Page*& page);
+
+	/**
+   * Allocates a new page as allocPage() does, returning a guard that unpins
+   * it when it goes away.
+   *
+   * @param file   	File object
+   * @param pageNo  Set to the number assigned to the page in the file
+   * @return  Guard holding the pin on the page
+	 */
+  PageGuard allocPage(File* file, PageId& pageNo);
+
+	/**
+   * Deletes a page from its instance and the file, see BufMgr::disposePage().
+   *
+   * @param file   	File object
+   * @param pageNo  Page number
+	 */
+  void disposePage(File* file, const PageId pageNo);
+
+	/**
+   * Writes out and drops the file's pages from every instance, see
+   * BufMgr::flushFile().
+   *
+   * @param file   	File object
+	 */
+  void flushFile(const File* file);
+
+	/**
+   * Returns the statistics of all instances added together.
+	 */
+  BufStats getBufStats();
+
+	/**
+   * Clears the statistics of every instance.
+	 */
+  void clearBufStats();
+
+ private:
+	/**
+   * The instances
+	 */
+  std::vector<BufMgr*> pools;
+
+	/**
+   * Node of each instance, -1 if it was not placed
+	 */
+  std::vector<int> nodes;
+};
+
+}
@@ -8,144 +8,659 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <iostream>
 #include <stdlib.h>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
 #include "buffer.h"
+#include "file_iterator.h"
+#include "page_iterator.h"
+#include "bufHashTbl.h"
+#include "openHashTbl.h"
+#include "lruKPolicy.h"
+#include "twoQPolicy.h"
+#include "arcPolicy.h"
+#include "numaPlacement.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
-#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/io_exception.h"
+#include "exceptions/partition_exception.h"
 
 namespace badgerdb { 
 
+const FrameId BufDesc::NO_FRAME;
+const std::uint32_t BufMgr::RESIZE_CHUNK;
+const std::uint32_t BufMgr::WARM_RUN_PAGES;
+const std::uint32_t BufMgr::MAX_PARTITIONS;
+
 /**
   * Constructor of BufMgr class
   */
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) { // numBufs = bufs
+BufMgr::BufMgr(std::uint32_t bufs, const BufMgrOptions& options)
+	: numBufs(bufs), // numBufs = bufs
+	  maxBufs(std::max(bufs, options.maxBufs)),
+	  numaNode(options.numaNode),
+	  copyOnWrite(options.copyOnWrite),
+	  readAheadPages(options.readAheadPages) {
 
-	bufDescTable = new BufDesc[bufs];
+  // descriptors and pages exist for every frame the pool may grow to
+	bufDescTable = new BufDesc[maxBufs];
 
-  for (FrameId i = 0; i < bufs; i++)
+  for (FrameId i = 0; i < maxBufs; i++)
   {
   	bufDescTable[i].frameNo = i;
   	bufDescTable[i].valid = false;
   }
 
-  bufPool = new Page[bufs];
+  // the default partition holds every file and bounds nothing
+  partitions[0].name = "default";
+  partitions[0].minFrames = 0;
+  partitions[0].maxFrames = UINT32_MAX;
+  partitions[0].frames = 0;
+  numPartitions = 1;
+
+  // Carve the frames out of one anonymous mapping, which is page-aligned; the
+  // part beyond bufs is only reserved
+  arenaBytes = (std::size_t) maxBufs * Page::SIZE;
+  frameArena = static_cast<char*>(MAP_FAILED);
+#ifdef MAP_HUGETLB
+  if (options.hugePages) {
+    frameArena = static_cast<char*>(mmap(NULL, arenaBytes, PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0));
+  }
+#endif
+  if (frameArena == MAP_FAILED) {
+    frameArena = static_cast<char*>(mmap(NULL, arenaBytes, PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+    if (frameArena == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (options.hugePages) {
+      madvise(frameArena, arenaBytes, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  if (numaNode >= 0) {
+    placeOnNode(frameArena, (std::size_t) bufs * Page::SIZE, numaNode);
+  }
+
+  bufPool = static_cast<Page*>(::operator new(sizeof(Page) * maxBufs));
+  for (FrameId i = 0; i < maxBufs; i++)
+  {
+    new (&bufPool[i]) Page(frameArena + (std::size_t) i * Page::SIZE);
+  }
+
+  if (options.pageTable == PageTableType::OPEN_ADDRESSING) {
+    hashTable = new OpenHashTbl (bufs);  // allocate the flat page table
+  } else {
+	  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
+    hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  }
+
+  switch (options.replacement) {
+  case ReplacementType::LRU_K:
+    replacer = new LruKPolicy(bufs, options.lruK);
+    break;
+  case ReplacementType::TWO_Q:
+    replacer = new TwoQPolicy(bufs);
+    break;
+  case ReplacementType::ARC:
+    replacer = new ArcPolicy(bufs);
+    break;
+  default:
+    replacer = new ClockPolicy(bufs);
+    break;
+  }
+
+  ioEngine = NULL;
+  if (options.ioQueueDepth > 0) {
+    ioEngine = IoEngine::create(options.ioQueueDepth).release();
+  }
+
+  dirtyFrames = 0;
+  dirtyHighWatermark = options.dirtyHighWatermark;
+  dirtyLowWatermark = options.dirtyLowWatermark;
+  dirtyHigh = (std::uint32_t) (dirtyHighWatermark * bufs);
+  dirtyLow = (std::uint32_t) (dirtyLowWatermark * bufs);
+  writerBatchPages = std::max(options.writerBatchPages, 1u);
+  writerIntervalMs = options.writerIntervalMs;
+  // recover before anything can read the files
+  wal = NULL;
+  if (!options.logFile.empty()) {
+    wal = new LogManager(options.logFile);
+  }
+  tracer = NULL;
+  if (!options.traceFile.empty()) {
+    tracer = new TraceRecorder(options.traceFile, options.traceRecords);
+  }
+  ssdCache = NULL;
+  if (!options.ssdCacheFile.empty() && options.ssdCachePages > 0) {
+    ssdCache = new SsdCache(options.ssdCacheFile, options.ssdCachePages);
+  }
 
-	int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  writerStop = false;
+  if (options.backgroundWriter) {
+    bgWriter = std::thread(&BufMgr::runWriter, this);
+  }
 
-  clockHand = bufs - 1;
+  warmFile = options.warmFile;
+  warmDumpIntervalMs = options.warmDumpIntervalMs;
+  warmDumpStop = false;
+  warmed = 0;
+  warmStop = false;
+  if (!warmFile.empty() && warmDumpIntervalMs > 0) {
+    warmDumper = std::thread(&BufMgr::runWarmDumper, this);
+  }
 }
 
 /**
   * Destructor of BufMgr class
   */
 BufMgr::~BufMgr() {
-	delete [] bufPool;
+  warmStop = true;
+  if (warmer.joinable()) {
+    warmer.join();
+  }
+  if (warmDumper.joinable()) {
+    {
+      std::lock_guard<std::mutex> wake(warmDumpLatch);
+      warmDumpStop = true;
+    }
+    warmDumpWake.notify_one();
+    warmDumper.join();
+  }
+  // the list for the next pool, if one is kept
+  try {
+    dumpResident();
+  } catch (const IoException&) {
+  }
+  if (bgWriter.joinable()) {
+    {
+      std::lock_guard<std::mutex> wake(writerWakeLatch);
+      writerStop = true;
+    }
+    writerWake.notify_one();
+    bgWriter.join();
+  }
+  delete ioEngine;
+  delete wal;
+  delete tracer;
+  delete ssdCache;
+  for (FrameId i = 0; i < maxBufs; i++)
+  {
+    bufPool[i].~Page();
+  }
+	::operator delete(bufPool);
+  munmap(frameArena, arenaBytes);
+  for (std::map<FileId, FreeSpace*>::iterator it = freeSpace.begin();
+       it != freeSpace.end(); ++it)
+  {
+    delete it->second;
+  }
+	delete [] bufDescTable;
+	delete hashTable;
+	delete replacer;
 }
 
 /**
-  * Advance clock to next frame in the buffer pool
+  * Allocate a free frame.  
+  *
+  * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+  * @throws BufferExceededException If no such buffer is found which can be allocated
   */
-void BufMgr::advanceClock()
+void BufMgr::allocBuf(FrameId & frame, const File* file) 
 {
-	clockHand++;
-	clockHand = clockHand % (this->numBufs);
+  // the policy offers candidates until one of them can be claimed
+  std::uint64_t offered = 0;
+  bool claimed = false;
+  // with partitions, first only the victims the quotas allow
+  if (file != NULL && numPartitions.load(std::memory_order_acquire) > 1) {
+    const Partition* quota = &partitions[partitionOf(file)];
+    claimed = replacer->evict([this, &offered, quota](FrameId candidate, bool secondChance) {
+          offered++;
+          return claimFrame(candidate, secondChance, quota);
+        }, frame);
+  }
+  if (!claimed) {
+    claimed = replacer->evict([this, &offered](FrameId candidate, bool secondChance) {
+          offered++;
+          return claimFrame(candidate, secondChance);
+        }, frame);
+  }
+  bufStats.victimsearches.add();
+  bufStats.sweepsteps.add(offered);
+  if (!claimed) {
+    // no frame could be claimed: every frame is pinned i.e. the buffer is full
+    throw BufferExceededException();
+  }
 }
 
 /**
-  * Allocate a free frame.  
+  * Take a frame as victim for allocBuf(): evict its page, if any, and reserve it.
   *
-  * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
-  * @throws BufferExceededException If no such buffer is found which can be allocated
+  * @param frame   	Frame offered by the replacement policy
+  * @param secondChance  Refuse the frame, clearing its reference bit, if the bit is set
+  * @param quota   Partition the frame is for, NULL to take any frame
+  * @return  True if the frame is now empty and reserved for the caller
   */
-void BufMgr::allocBuf(FrameId & frame) 
+bool BufMgr::claimFrame(const FrameId frame, const bool secondChance,
+                        const Partition* quota)
 {
-  advanceClock();
-  // Check the first frame
-	FrameId initial = clockHand;
-  // If the frame is not valid, it is free
-  if(!bufDescTable[clockHand].valid) {
-      // return the frame's ID
-			frame = bufDescTable[clockHand].frameNo;
-      return;
+  BufDesc& desc = bufDescTable[frame];
+  // Frames beyond a pool being shrunk are no longer handed out
+  if (frame >= numBufs.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  // Most frames the sweep passes are refused on the state word alone: pinned
+  // frames, including those reserved by another allocBuf() that have not been
+  // Set() yet, without touching the latch
+  if ((desc.state.load(std::memory_order_acquire) & BufDesc::STATE_PINS) != 0) {
+    return false;
+  }
+  // A frame whose latch is held is being pinned or evicted by someone else
+  std::unique_lock<std::mutex> latch(desc.latch, std::try_to_lock);
+  if (!latch.owns_lock()) {
+    return false;
+  }
+  // the word may be stale by now; an unpinned frame is frozen so that no
+  // optimistic pin slips in before it is emptied
+  if (!desc.freeze()) {
+    return false;
+  }
+  // resize() may have shrunk the pool since the first check.  It stores the
+  // new size before latching the frames above it, so a claim still seeing
+  // the old size here reserves the frame before resize() gets to it, and
+  // resize() then waits for the frame to be unpinned
+  if (frame >= numBufs.load(std::memory_order_seq_cst)) {
+    desc.thaw();
+    return false;
+  }
+  // If it has has been referenced recently, clear its referenced bit and move on
+  if (secondChance && desc.valid && desc.refbit()) {
+    desc.setRefbit(false);
+    desc.thaw();
+    return false;
+  }
+  if (quota != NULL && !quotaAllows(desc, *quota)) {
+    desc.thaw();
+    return false;
+  }
+  if (desc.valid) {
+    try {
+      evictFrame(frame);
+    } catch (...) {
+      // a failed write-back leaves the page in the frame, still dirty
+      desc.thaw();
+      throw;
+    }
+  } else {
+    clearFrame(frame);
+  }
+  // the next page goes into the frame's own bytes unless it is mapped too
+  if (desc.mapped) {
+    viewFrame(frame, frameArena + (std::size_t) frame * Page::SIZE);
+  }
+  // reserve the frame until the caller Set()s it
+  desc.setPins(1);
+  desc.publish();
+  return true;
+}
+
+/**
+  * Decide whether the quotas let a partition take a frame.
+  *
+  * @param desc    The frame, whose latch the caller holds
+  * @param quota   Partition the frame is for
+  * @return  True if the frame may be taken
+  */
+bool BufMgr::quotaAllows(const BufDesc& desc, const Partition& quota) const
+{
+  // a partition at its maximum only recycles its own frames
+  const bool full = quota.frames.load(std::memory_order_relaxed) >=
+                    quota.maxFrames.load(std::memory_order_relaxed);
+  if (!desc.valid) {
+    return !full;
+  }
+  const Partition& owner = partitions[desc.partition];
+  if (&owner == &quota) {
+    return true;
+  }
+  // nor does it take other partitions' pages, which are kept down to their
+  // minimum
+  return !full && owner.frames.load(std::memory_order_relaxed) >
+                  owner.minFrames.load(std::memory_order_relaxed);
+}
+
+/**
+  * Find the partition of a file's pages.
+  *
+  * @param file   File object
+  * @return  Index of the partition in partitions
+  */
+std::uint32_t BufMgr::partitionOf(const File* file)
+{
+  std::lock_guard<std::mutex> latch(fileFramesLatch);
+  std::map<FileId, FileUsage>::const_iterator usage = fileUsage.find(file->id());
+  if (usage != fileUsage.end() && !usage->second.filename.empty()) {
+    return usage->second.partition;
   }
-  // If the frame is valid but is not being used and was not recently referenced
-  else if(bufDescTable[clockHand].pinCnt ==0 && !bufDescTable[clockHand].refbit) {
-    // if frame dirty write back to disk
-    if(bufDescTable[clockHand].dirty){
-      // get the dirty frame's page
-      Page & newPage = bufPool[clockHand];
-      // write the page to the appropriate page on disk
-      bufDescTable[clockHand].file->writePage(newPage);
-      bufStats.diskwrites++;
-      // remove entry from the hashtable
-      hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-      // invoke the Clear() method of BufDesc for the page frame
-      bufDescTable[clockHand].Clear();
-    }
-    // the frame has been chosen to be replaced, return it's ID
-    frame = bufDescTable[clockHand].frameNo;
+  std::map<std::string, std::uint32_t>::const_iterator assigned =
+      filePartitions.find(file->filename());
+  return assigned == filePartitions.end() ? 0 : assigned->second;
+}
+
+/**
+  * Write back the page of a frame if dirty, and empty the frame.
+  *
+  * @param frame   	Valid, unpinned frame whose latch the caller holds
+  */
+void BufMgr::evictFrame(const FrameId frame)
+{
+  BufDesc& desc = bufDescTable[frame];
+  // a retired version is out of the page table, and superseded on disk by
+  // the current one
+  if (desc.retired) {
+    markClean(desc);
+    clearFrame(frame);
     return;
   }
-	advanceClock();
-  // Number of rotations the clock has made to limit the search
-  int rotations = 0;
- // If the first frame is not free, check the rest of the buffer pool
-	while(rotations < 2) {   
-    // If we have reached the initial frame, we have made one rotation
-    if(initial == clockHand){
-      rotations++;
-    }
-    // If the frame is not valid, it is free
-	  if(!bufDescTable[clockHand].valid) {
-      // return the frame's ID
-			frame = bufDescTable[clockHand].frameNo;
-      break;
+  // if frame dirty write back to disk; only this frame's latch is held
+  if (desc.dirty) {
+    forceLog(bufPool[frame]);
+    desc.file->writePage(bufPool[frame]);
+    countWrites(desc.fileId, 1);
+    bufStats.dirtyevictions.add();
+    markClean(desc);
+  }
+  // demote the page, now as on disk, before it leaves the page table, so that
+  // a reader missing it in the pool finds it in the second tier
+  if (ssdCache != NULL && !desc.mapped) {
+    try {
+      ssdCache->offer(desc.file.get(), desc.pageNo, frameArena + (std::size_t) frame * Page::SIZE,
+                      desc.hits.load(std::memory_order_relaxed) > 0);
+    } catch (const IoException&) {
+      // the page is still in its file
+    }
+  }
+  // remove the old page's entry from the hashtable, clean or dirty
+  hashTable->remove(desc.file.get(), desc.pageNo);
+  bufStats.evictions.add();
+  clearFrame(frame);
+}
+
+/**
+  * Return a frame reserved by allocBuf() to the pool without using it.
+  *
+  * @param frame   	Frame ID of the reserved frame
+  */
+void BufMgr::releaseBuf(const FrameId frame)
+{
+  {
+    std::lock_guard<std::mutex> latch(bufDescTable[frame].latch);
+    clearFrame(frame);
+  }
+  replacer->removed(frame);
+}
+
+/**
+  * Point the Page of a reserved frame at the given bytes.
+  *
+  * @param frame   	Frame ID of the reserved frame
+  * @param bytes   	Start of the bytes the page lives in
+  */
+void BufMgr::viewFrame(const FrameId frame, char* bytes)
+{
+  // a view owns nothing, so it is simply rebuilt over the new bytes
+  bufPool[frame].~Page();
+  new (&bufPool[frame]) Page(bytes);
+  bufDescTable[frame].mapped = bytes != frameArena + (std::size_t) frame * Page::SIZE;
+}
+
+/**
+  * Set() a reserved frame and link it into its file's list of frames.
+  *
+  * @param frame   	Frame ID of the frame
+  * @param file   	File object
+  * @param pageNo   Page number in the file
+  * @param read     True if the page was read from disk into the frame
+  */
+void BufMgr::setFrame(const FrameId frame, File* file, const PageId pageNo,
+                      const bool read)
+{
+  BufDesc& desc = bufDescTable[frame];
+  desc.Set(file, pageNo);
+  // the frame's copy supersedes any in the second tier
+  if (ssdCache != NULL) {
+    ssdCache->erase(file, pageNo);
+  }
+  std::lock_guard<std::mutex> latch(fileFramesLatch);
+  FileUsage& usage = fileUsage[desc.fileId];
+  if (usage.filename.empty()) {
+    usage.filename = file->filename();
+    std::map<std::string, std::uint32_t>::const_iterator assigned =
+        filePartitions.find(usage.filename);
+    usage.partition = assigned == filePartitions.end() ? 0 : assigned->second;
+  }
+  desc.partition = usage.partition;
+  partitions[desc.partition].frames.fetch_add(1, std::memory_order_relaxed);
+  if (read) {
+    usage.stats.reads++;
+  }
+  std::map<FileId, FrameId>::iterator head =
+      fileFrames.insert(std::make_pair(desc.fileId, BufDesc::NO_FRAME)).first;
+  desc.filePrev = BufDesc::NO_FRAME;
+  desc.fileNext = head->second;
+  if (head->second != BufDesc::NO_FRAME) {
+    bufDescTable[head->second].filePrev = frame;
+  }
+  head->second = frame;
+}
+
+/**
+  * Clear() a frame and unlink it from its file's list of frames.
+  *
+  * @param frame   	Frame ID of the frame
+  */
+void BufMgr::clearFrame(const FrameId frame)
+{
+  BufDesc& desc = bufDescTable[frame];
+  if (desc.valid) {
+    std::lock_guard<std::mutex> latch(fileFramesLatch);
+    fileUsage[desc.fileId].stats.hits += desc.hits.exchange(0, std::memory_order_relaxed);
+    partitions[desc.partition].frames.fetch_sub(1, std::memory_order_relaxed);
+    if (desc.filePrev != BufDesc::NO_FRAME) {
+      bufDescTable[desc.filePrev].fileNext = desc.fileNext;
+    } else if (desc.fileNext != BufDesc::NO_FRAME) {
+      fileFrames[desc.fileId] = desc.fileNext;
+    } else {
+      fileFrames.erase(desc.fileId);
+    }
+    if (desc.fileNext != BufDesc::NO_FRAME) {
+      bufDescTable[desc.fileNext].filePrev = desc.filePrev;
+    }
+    desc.fileNext = desc.filePrev = BufDesc::NO_FRAME;
+  }
+  desc.Clear();
+}
+
+/**
+  * Count pages written back from the pool, also in the file's usage.
+  *
+  * @param fileId   	Identifier of the file written
+  * @param pages   	Number of pages written
+  */
+void BufMgr::countWrites(const FileId fileId, const std::uint64_t pages)
+{
+  bufStats.diskwrites.add(pages);
+  std::lock_guard<std::mutex> latch(fileFramesLatch);
+  fileUsage[fileId].stats.writes += pages;
+}
+
+/**
+  * Clear the dirty bit of a frame.  Caller holds the frame latch.
+  */
+void BufMgr::markClean(BufDesc& desc)
+{
+  if (desc.dirty) {
+    desc.dirty = false;
+    dirtyFrames--;
+  }
+  desc.publish();
+}
+
+/**
+  * Set the dirty bit of a frame, waking the background writer when the dirty
+  * ratio crosses the high watermark.  Caller holds the frame latch.
+  */
+void BufMgr::markDirty(BufDesc& desc)
+{
+  if (!desc.dirty) {
+    desc.dirty = true;
+    if (++dirtyFrames == dirtyHigh && bgWriter.joinable()) {
+      writerWake.notify_one();
     }
-    // If the frame is valid, it could still be chosen to be replaced
-    // If it has has been referenced recently, it should not be replaced
-    if(bufDescTable[clockHand].refbit) {
-      // Clear its referenced bit and move on
-      bufDescTable[clockHand].refbit = false;
-      advanceClock();
+  }
+  desc.publish();
+}
+
+/**
+  * Body of the background writer thread.
+  */
+void BufMgr::runWriter()
+{
+  std::unique_lock<std::mutex> wake(writerWakeLatch);
+  while (!writerStop) {
+    writerWake.wait_for(wake, std::chrono::milliseconds(writerIntervalMs));
+    if (writerStop || dirtyFrames < dirtyHigh) {
       continue;
     }
-    // Otherwise if it is being used it cannot be replaced
-    if(bufDescTable[clockHand].pinCnt > 0) {
-      advanceClock();
+    wake.unlock();
+    // write back until the low watermark, or until nothing is writable
+    while (dirtyFrames > dirtyLow && writeBackBatch() > 0) {
+    }
+    wake.lock();
+  }
+}
+
+/**
+  * Write back one batch of dirty, unpinned frames next in line for eviction.
+  *
+  * @return  Number of frames written
+  */
+std::uint32_t BufMgr::writeBackBatch()
+{
+  std::lock_guard<std::mutex> writer(writerLatch);
+  // frames taken for writing; each is pinned and already marked clean, so a
+  // page dirtied again during the write stays dirty
+  std::vector<FrameId> frames;
+  // next victims first
+  std::vector<FrameId> order;
+  replacer->victimOrder(order);
+  for (std::size_t k = 0; k < order.size() && frames.size() < writerBatchPages; k++) {
+    const FrameId hand = order[k];
+    BufDesc& desc = bufDescTable[hand];
+    std::unique_lock<std::mutex> latch(desc.latch, std::try_to_lock);
+    if (!latch.owns_lock() || !desc.valid || !desc.dirty || desc.pins() > 0) {
       continue;
     }
-    // Otherwise it can be replaced
-    if(bufDescTable[clockHand].pinCnt ==0 && !bufDescTable[clockHand].refbit) {
-      // if frame dirty write back to disk
-      if(bufDescTable[clockHand].dirty){
-        // get the dirty frame's page
-        Page & newPage = bufPool[clockHand];
-        // write the page to the appropriate page on disk
-        bufDescTable[clockHand].file->writePage(newPage);
-        bufStats.diskwrites++;
-        // remove entry from the hashtable
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-        // invoke the Clear() method of BufDesc for the page frame
-        bufDescTable[clockHand].Clear();
-      }
-      // the frame has been chosen to be replaced, return it's ID
-      frame = bufDescTable[clockHand].frameNo;
-      break;
-    }   
+    desc.addPins(1);
+    markClean(desc);
+    frames.push_back(hand);
   }
-  // If the clock has done two full rotations without finding a free frame the buffer is full
-  if(rotations>2) {
-    std:: cout << " ERROR clockhand: " << clockHand << "\n";
-    throw BufferExceededException();
+  if (frames.empty()) {
+    return 0;
+  }
+
+  // pinned frames keep their identity, so they can be sorted without latches
+  std::sort(frames.begin(), frames.end(), [this](FrameId a, FrameId b) {
+    const BufDesc& x = bufDescTable[a];
+    const BufDesc& y = bufDescTable[b];
+    return x.fileId != y.fileId ? x.fileId < y.fileId : x.pageNo < y.pageNo;
+  });
+  std::vector<bool> written(frames.size(), true);
+  // one log flush covers the whole batch
+  Lsn newest = 0;
+  for (std::size_t k = 0; k < frames.size(); k++) {
+    newest = std::max(newest, bufPool[frames[k]].lsn());
+  }
+  bool logged = true;
+  if (wal != NULL) {
+    try{
+      wal->flush(newest);
+    }
+    catch(...){
+      logged = false;
+    }
+  }
+  if (!logged) {
+    written.assign(frames.size(), false);
+  } else if (ioEngine == NULL) {
+    for (std::size_t k = 0; k < frames.size(); k++) {
+      try{
+        bufDescTable[frames[k]].file->writePage(bufPool[frames[k]]);
+      }
+      catch(...){
+        written[k] = false;
+      }
+    }
+  } else {
+    std::vector<std::promise<void> > done(frames.size());
+    std::vector<IoRequest> batch;
+    for (std::size_t k = 0; k < frames.size(); k++) {
+      std::promise<void>* promise = &done[k];
+      try{
+        batch.push_back(bufDescTable[frames[k]].file->writePageRequest(bufPool[frames[k]],
+            [promise](std::exception_ptr e) {
+              if (e) {
+                promise->set_exception(e);
+              } else {
+                promise->set_value();
+              }
+            }));
+      }
+      catch(...){
+        promise->set_exception(std::current_exception());
+      }
+    }
+    ioEngine->submit(batch);
+    for (std::size_t k = 0; k < frames.size(); k++) {
+      try{
+        done[k].get_future().get();
+      }
+      catch(...){
+        written[k] = false;
+      }
+    }
   }
 
+  for (std::size_t k = 0; k < frames.size(); k++) {
+    BufDesc& desc = bufDescTable[frames[k]];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    desc.dropPins(1);
+    desc.publish();
+    if (written[k]) {
+      countWrites(desc.fileId, 1);
+      bufStats.backgroundwrites.add();
+    } else if (!desc.retired) {
+      // leave it to eviction or flushFile() to report the error
+      markDirty(desc);
+    }
+    // a newer version may have been installed during the write
+    if (reclaimRetired(frames[k])) {
+      replacer->removed(frames[k]);
+    }
+  }
+  return frames.size();
 }
 
 /**
@@ -159,171 +674,2288 @@ void BufMgr::allocBuf(FrameId & frame)
   */
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
-  // Desired frame number  
-  FrameId frame;
-  try{
-    hashTable->lookup(file, pageNo, frame);
+  if (tracer != NULL) {
+    tracer->record(TraceOp::READ, file->id(), pageNo);
   }
-  // Page is not in the buffer pool
-  catch(HashNotFoundException & e){
+  fetchPage(file, pageNo, page);
+}
+
+/**
+  * Reads a page as readPage() does, without tracing the call.
+  *
+  * @param file   	File object
+  * @param pageNo  Page number in the file to be read
+  * @param page  	Set to the page in its frame
+  */
+void BufMgr::fetchPage(File* file, const PageId pageNo, Page*& page)
+{
+  for (;;) {
+    // Desired frame number  
+    FrameId frame;
+    // Page is in the buffer pool
+    if (readHit(file, pageNo, frame)) {
+      // return a pointer to the frame containing the page
+      page = &bufPool[frame];
+      return;
+    }
+    // Page is not in the buffer pool
+    const std::chrono::steady_clock::time_point missed =
+        std::chrono::steady_clock::now();
     // Call allocBuf() to allocate a buffer frame
-    allocBuf(frame); 
-    // Call the method file->readPage() to read the page from disk into the buffer pool frame
-    Page p = file->readPage(pageNo);
-    bufStats.diskreads++;
-    // If page is valid insert it into the hashtable
-    bufPool[frame] = p;     
-    hashTable->insert(file, pageNo, frame);
-    // invoke Set() on the frame to set it up properly
-    bufDescTable[frame].Set(file, pageNo);
+    allocBuf(frame, file); 
+    // For a mapped file use the page where it is, and an evicted page may
+    // still be in the second tier; neither takes a read worth sharing
+    bool demoted = file->isMapped();
+    try{
+      if (file->isMapped()) {
+        viewFrame(frame, file->mappedPage(pageNo));
+      } else if (ssdCache != NULL) {
+        try {
+          demoted = ssdCache->take(file, pageNo,
+                                   frameArena + (std::size_t) frame * Page::SIZE);
+        } catch (const IoException&) {
+        }
+      }
+    }
+    catch(...){
+      releaseBuf(frame);
+      throw;
+    }
+    // Publish the frame, as loading unless it is filled already; if another
+    // thread asked for the same page in the meantime its frame wins, ours
+    // goes back to the pool and the next round waits for its read
+    if (!publishFrame(file, pageNo, frame, !demoted, false)) {
+      continue;
+    }
+    if (!demoted) {
+      // Call the method file->readPage() to read the page from disk into the
+      // buffer pool frame
+      try{
+        file->readPage(pageNo, bufPool[frame]);
+      }
+      catch(...){
+        finishLoad(frame, false);
+        throw;
+      }
+      finishLoad(frame, true);
+      bufStats.diskreads.add();
+    }
+    countMiss(missed);
     // Return a pointer to the frame containing the page via the page parameter.
     page = &bufPool[frame];
+    if (readAheadPages > 0) {
+      noteRead(file, pageNo);
+    }
     return;
   }
-  // Page is in the buffer pool
-  // set the appropriate refbit
-  bufDescTable[frame].refbit = true;
-  // increment the pinCnt for the page
-  bufDescTable[frame].pinCnt++;
-  // return a pointer to the frame containing the page
-  page = &bufPool[frame];
-  bufStats.accesses++;
 }
 
 /**
-  * Unpin a page from memory since it is no longer required for it to remain in memory.
+  * Pin a page if it is in the buffer pool, counting the readPage() hit and
+  * telling the replacement policy.
   *
-  * @param file   File object
-  * @param PageNo  Page number
-  * @param dirty	True if the page to be unpinned needs to be marked dirty	
-  * @throws  PageNotPinnedException If the page is not already pinned
+  * @param file   	File object
+  * @param pageNo  Page number in the file
+  * @param frame   Set to the page's frame if it is in the pool
+  * @param wait    Whether to wait for the page if it is being read; if not,
+  *                such a page is not pinned
+  * @return  True if the page was in the pool and is now pinned
   */
-void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
+bool BufMgr::readHit(File* file, const PageId pageNo, FrameId& frame, const bool wait)
 {
-  FrameId frame;
-  // Check if the page that we want to unpin is in the buffer pool
-  try{
-    hashTable->lookup(file, pageNo, frame);
+  bool prefetched;
+  if (!pinResident(file, pageNo, 1, frame, prefetched, wait)) {
+    return false;
   }
-  // Page is not in the buffer pool
-  catch(HashNotFoundException & e){
-    return;
+  bufStats.accesses.add();
+  bufStats.hits.add();
+  replacer->accessed(frame);
+  // a scan reaching read-ahead pages keeps the window moving
+  if (prefetched && readAheadPages > 0) {
+    noteRead(file, pageNo);
   }
-  // if pinCount is already zero it cannot be decremented any more, throw error
-  if(bufDescTable[frame].pinCnt == 0){
-    throw PageNotPinnedException(file->filename(), pageNo, frame);
+  return true;
+}
+
+/**
+  * Set() a frame reserved by allocBuf() for a page and publish it in the
+  * page table, pinned.
+  *
+  * @param file     File object
+  * @param pageNo   Page number of the frame
+  * @param frame    The reserved frame
+  * @param loading  True if the page is yet to be read into the frame; the
+  *                 reader calls finishLoad() once it has been
+  * @param prefetched  True to publish the page cold, as a read ahead
+  * @return  False if the page was in the page table already; the frame has
+  *          gone back to the pool then
+  */
+bool BufMgr::publishFrame(File* file, const PageId pageNo, const FrameId frame,
+                          const bool loading, const bool prefetched)
+{
+  BufDesc& desc = bufDescTable[frame];
+  // invoke Set() on the frame to set it up properly
+  {
+    std::lock_guard<std::mutex> latch(desc.latch);
+    setFrame(frame, file, pageNo, true);
+    desc.loading = loading;
+    if (prefetched) {
+      desc.setRefbit(false);
+      desc.prefetched = true;
+    }
   }
-  else{
-    bufDescTable[frame].pinCnt--;
+  if (!hashTable->tryInsert(file, pageNo, frame)) {
+    releaseBuf(frame);
+    return false;
   }
-  // if dirty is true set the dirty bit of the page/frame
-  if(dirty == true){
-    bufDescTable[frame].dirty = true;
+  // only now may optimistic pins find the frame, once loaded and pinned
+  {
+    std::lock_guard<std::mutex> latch(desc.latch);
+    desc.publish();
   }
+  replacer->installed(frame, file, pageNo, prefetched);
+  return true;
 }
 
 /**
-  * Writes out all dirty pages of the file to disk.
-  * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
-  * Otherwise Error returned.
+  * End the read of a page into a frame published as loading, waking those
+  * waiting for it.  A frame whose read failed leaves the page table and goes
+  * back to the pool, and its waiters look the page up again.
   *
-  * @param file   	File object
-  * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
-  * @throws BadBufferException If any frame allocated to the file is found to be invalid
+  * @param frame    The frame
+  * @param loaded   True if the read succeeded
   */
-void BufMgr::flushFile(const File* file) 
-{ 
-  BufDesc* tmpbuf;
-   // scan bufTable for pages belonging to the file
-  for (std::uint32_t i = 0; i < numBufs; i++)
-	{
-  	tmpbuf = &(bufDescTable[i]);
-    if(tmpbuf->file == nullptr){
-      continue;
-    }
-		if(tmpbuf->file->filename() == file->filename()){
-      // if an invalid page belonging to the file is encountered throw the exception
-      if(tmpbuf->pageNo == 0){
-        throw BadBufferException(i, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
-      }
-      PageId pageNo = tmpbuf->pageNo;
-      if(tmpbuf->pinCnt > 0){
-        throw PagePinnedException(file->filename(), pageNo, i);
-      } 
-      // if the page is dirty
-      if(tmpbuf->dirty == true){
-        // get the frame's page
-        Page & newPage = bufPool[i];
-        // write the page to the appropriate page on disk
-        bufDescTable[i].file->writePage(newPage);
-        bufStats.diskwrites++;
-      }
-      // remove the page from the hashtable
-      hashTable->remove(file, pageNo);
-      // invoke the Clear() method of BufDesc for the page frame
-      bufDescTable[i].Clear();
+void BufMgr::finishLoad(const FrameId frame, const bool loaded)
+{
+  BufDesc& desc = bufDescTable[frame];
+  // the frame is pinned by its reader, so its page stays put until then
+  if (!loaded) {
+    hashTable->tryRemove(desc.file.get(), desc.pageNo);
+  }
+  std::vector<std::function<void()> > waiting;
+  {
+    std::lock_guard<std::mutex> latch(desc.latch);
+    desc.loading = false;
+    waiting.swap(desc.waiters);
+    if (!loaded) {
+      clearFrame(frame);
     }
+    desc.publish();
+    desc.loaded.notify_all();
+  }
+  if (!loaded) {
+    replacer->removed(frame);
+  }
+  for (std::function<void()>& resume : waiting) {
+    resume();
   }
-  bufStats.accesses++;
 }
 
 /**
- * allocates a new page for a file and adds it to the buffer
- * returns the page number of the newly allocated page
- * @param file   pointer to file to allocate a new page for
- * @param pageNo page number of newly allocated page
- * @param page   allocated page
- */
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
+  * Arrange to be called back when a page being read into the pool has been
+  * read, without waiting for it.
+  *
+  * @param file     File object
+  * @param pageNo   Page number in the file
+  * @param resume   Called once the read is over, successful or not; it must
+  *                 not block
+  * @return  False, without calling resume, if the page is not being read
+  */
+bool BufMgr::awaitLoad(File* file, const PageId pageNo, std::function<void()> resume)
 {
-  // the frame the Page will be allocated in
-	FrameId newFrame;
-  // the new Page to be added to the buffer
-	Page newPage = file->allocatePage();
-  // find a free frame for the page
-  allocBuf(newFrame);  
-  // insert the page into the frame
-  bufPool[newFrame] = newPage; 
-  // return the new page
-  page = &bufPool[newFrame];
-  // return the new page number
-  pageNo = page->page_number(); 
-  // insert the Page into the hash table
-	hashTable->insert(file, pageNo, newFrame);
-  // initiate the frame
-  bufDescTable[newFrame].Set(file, pageNo);
-  bufStats.accesses++;
+  FrameId frame;
+  if (!hashTable->tryLookup(file, pageNo, frame)) {
+    return false;
+  }
+  BufDesc& desc = bufDescTable[frame];
+  std::lock_guard<std::mutex> latch(desc.latch);
+  if (!desc.valid || desc.fileId != file->id() || desc.pageNo != pageNo || !desc.loading) {
+    return false;
+  }
+  desc.waiters.push_back(std::move(resume));
+  bufStats.sharedreads.add();
+  return true;
 }
 
 /**
-  * Delete page from file and also from buffer pool if present.
-  * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
+  * Count a readPage() miss and how long it took.
+  *
+  * @param missed   When the miss was seen
+  */
+void BufMgr::countMiss(const std::chrono::steady_clock::time_point missed)
+{
+  bufStats.accesses.add();
+  bufStats.misses.add();
+  bufStats.misslatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - missed).count());
+}
+
+/**
+  * Reads the given page and returns a guard holding the pin on it.
   *
   * @param file   	File object
-  * @param PageNo  Page number
+  * @param pageNo  Page number in the file to be read
+  * @return  Guard holding the pin on the page
+  */
+PageGuard BufMgr::readPage(File* file, const PageId pageNo)
+{
+  Page* page;
+  readPage(file, pageNo, page);
+  return PageGuard(this, file, pageNo, static_cast<FrameId>(page - bufPool), page);
+}
+
+/**
+  * Reads the given page to change it, in copy-on-write mode into a private
+  * copy.
+  *
+  * @param file   	File object
+  * @param pageNo  Page number in the file to be read
+  * @return  Guard holding the pin on the page, or on the private copy
+  * @throws BufferExceededException If no frame is free for the copy
+  */
+PageGuard BufMgr::readPageForUpdate(File* file, const PageId pageNo)
+{
+  if (!copyOnWrite || file->isMapped()) {
+    return readPage(file, pageNo);
+  }
+  for (;;) {
+    Page* page;
+    readPage(file, pageNo, page);
+    const FrameId current = static_cast<FrameId>(page - bufPool);
+    BufDesc& desc = bufDescTable[current];
+    // one writer per page: wait for another's copy to be installed or dropped
+    bool retired;
+    {
+      std::unique_lock<std::mutex> latch(desc.latch);
+      desc.loaded.wait(latch, [&desc] { return desc.copyFrame == BufDesc::NO_FRAME; });
+      retired = desc.retired;
+    }
+    FrameId copy = BufDesc::NO_FRAME;
+    if (!retired) {
+      try {
+        allocBuf(copy, file);
+      } catch (...) {
+        releaseFrame(file, current, false);
+        throw;
+      }
+      std::lock_guard<std::mutex> latch(desc.latch);
+      if (desc.copyFrame == BufDesc::NO_FRAME && !desc.retired) {
+        // readers only ever read the version, so it is copied as it is.  The
+        // writer keeps its pin on it, which keeps it in the page table until
+        // the copy is installed.
+        std::copy(frameArena + (std::size_t) current * Page::SIZE,
+                  frameArena + (std::size_t) (current + 1) * Page::SIZE,
+                  frameArena + (std::size_t) copy * Page::SIZE);
+        desc.copyFrame = copy;
+        BufDesc& copyDesc = bufDescTable[copy];
+        std::lock_guard<std::mutex> copyLatch(copyDesc.latch);
+        setFrame(copy, file, pageNo, false);
+        copyDesc.versionOf = current;
+        bufStats.pagecopies.add();
+        return PageGuard(this, file, pageNo, copy, &bufPool[copy]);
+      }
+    }
+    // another writer came first; start again from the version it leaves
+    if (copy != BufDesc::NO_FRAME) {
+      releaseBuf(copy);
+    }
+    releaseFrame(file, current, false);
+  }
+}
+
+/**
+  * Pin a page if it is in the buffer pool, as a readPage() hit.  The caller
+  * counts the hit and tells the replacement policy.
+  *
+  * @param file   	File object
+  * @param pageNo  Page number in the file
+  * @param count   Number of pins to add
+  * @param frame   Set to the page's frame if it is in the pool
+  * @param prefetched  Set to whether the page was read ahead and not pinned since
+  * @param wait    Whether to wait for the page if it is being read; if not,
+  *                such a page is not pinned
+  * @return  True if the page was in the pool and is now pinned
+  */
+bool BufMgr::pinResident(File* file, const PageId pageNo, const int count,
+                         FrameId& frame, bool& prefetched, const bool wait)
+{
+  for (;;) {
+    if (!hashTable->tryLookup(file, pageNo, frame)) {
+      return false;
+    }
+    BufDesc& desc = bufDescTable[frame];
+    // a page just sitting in the frame is pinned without the latch
+    if (desc.pinOptimistic(file->id(), pageNo, count)) {
+      prefetched = false;
+      return true;
+    }
+    std::unique_lock<std::mutex> latch(desc.latch, std::try_to_lock);
+    if (!latch.owns_lock()) {
+      bufStats.pinwaits.add();
+      latch.lock();
+    }
+    // share the read of a page another thread is reading
+    if (desc.loading && desc.fileId == file->id() && desc.pageNo == pageNo) {
+      if (!wait) {
+        return false;
+      }
+      bufStats.sharedreads.add();
+      desc.loaded.wait(latch, [&desc, file, pageNo] {
+        return !desc.loading || desc.fileId != file->id() || desc.pageNo != pageNo;
+      });
+    }
+    // The frame may have been evicted between the lookup and the latch, or
+    // its read failed
+    if (!desc.valid || desc.fileId != file->id() || desc.pageNo != pageNo) {
+      return false;
+    }
+    // a newer version was installed since the lookup; pin that one
+    if (desc.retired) {
+      continue;
+    }
+    desc.hits.fetch_add(count, std::memory_order_relaxed);
+    // set the appropriate refbit; a prefetched page only becomes hot now
+    desc.setRefbit(true);
+    prefetched = desc.prefetched;
+    desc.prefetched = false;
+    // increment the pinCnt for the page
+    desc.addPins(count);
+    desc.publish();
+    return true;
+  }
+}
+
+/**
+  * Reads several pages of a file into frames and pins them.
+  *
+  * @param file   	File object
+  * @param pageNos  Page numbers in the file to be read
+  * @param pages  	Set to the Page object of each page, in the order of pageNos
+  */
+void BufMgr::readPages(File* file, std::span<const PageId> pageNos,
+                       std::vector<Page*>& pages)
+{
+  if (tracer != NULL) {
+    for (PageId pageNo : pageNos) {
+      tracer->record(TraceOp::READ, file->id(), pageNo);
+    }
+  }
+  // the requests in page order, remembering where each came from
+  std::vector<std::pair<PageId, std::size_t> > order(pageNos.size());
+  for (std::size_t i = 0; i < pageNos.size(); i++) {
+    order[i] = std::make_pair(pageNos[i], i);
+  }
+  if (!std::is_sorted(order.begin(), order.end())) {
+    std::sort(order.begin(), order.end());
+  }
+  // each distinct page once, with how often it is wanted
+  std::vector<Wanted> wanted;
+  wanted.reserve(order.size());
+  for (std::size_t j = 0; j < order.size(); j++) {
+    if (wanted.empty() || wanted.back().pageNo != order[j].first) {
+      Wanted page;
+      page.pageNo = order[j].first;
+      page.count = 0;
+      page.pinned = false;
+      page.loading = false;
+      page.lost = false;
+      wanted.push_back(page);
+    }
+    wanted.back().count++;
+  }
+
+  // pin the pages in the pool and reserve a frame for each of the others
+  std::vector<std::size_t> missing;
+  std::vector<FrameId> hit;
+  std::uint64_t hits = 0;
+  std::size_t done = 0;
+  try {
+    for (; done < wanted.size(); done++) {
+      bool prefetched;
+      Wanted& page = wanted[done];
+      page.pinned = pinResident(file, page.pageNo, page.count, page.frame, prefetched);
+      if (page.pinned) {
+        hit.push_back(page.frame);
+        hits += page.count;
+      } else {
+        allocBuf(page.frame, file);
+        missing.push_back(done);
+      }
+    }
+
+    // publish the frames as loading before reading, so that readers of the
+    // same pages wait for these reads rather than issuing their own
+    for (std::size_t k : missing) {
+      Wanted& page = wanted[k];
+      if (file->isMapped()) {
+        viewFrame(page.frame, file->mappedPage(page.pageNo));
+      }
+      if (!publishFrame(file, page.pageNo, page.frame, !file->isMapped(), false)) {
+        page.lost = true;
+        continue;
+      }
+      if (page.count > 1) {
+        std::lock_guard<std::mutex> latch(bufDescTable[page.frame].latch);
+        bufDescTable[page.frame].addPins(page.count - 1);
+        bufDescTable[page.frame].publish();
+      }
+      page.pinned = file->isMapped();
+      page.loading = !file->isMapped();
+      bufStats.accesses.add(page.count);
+      bufStats.misses.add(page.count);
+    }
+
+    // read them, one run of consecutive page numbers at a time
+    std::vector<Page*> run;
+    for (std::size_t first = 0; first < missing.size();) {
+      if (!wanted[missing[first]].loading) {
+        first++;
+        continue;
+      }
+      const std::chrono::steady_clock::time_point missed =
+          std::chrono::steady_clock::now();
+      std::size_t last = first + 1;
+      while (last < missing.size() && wanted[missing[last]].loading &&
+             wanted[missing[last]].pageNo == wanted[missing[last - 1]].pageNo + 1) {
+        last++;
+      }
+      run.clear();
+      for (std::size_t k = first; k < last; k++) {
+        run.push_back(&bufPool[wanted[missing[k]].frame]);
+      }
+      file->readPages(wanted[missing[first]].pageNo, run);
+      for (std::size_t k = first; k < last; k++) {
+        Wanted& page = wanted[missing[k]];
+        finishLoad(page.frame, true);
+        page.loading = false;
+        page.pinned = true;
+      }
+      bufStats.diskreads.add(last - first);
+      bufStats.misslatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - missed).count());
+      first = last;
+    }
+  }
+  catch(...){
+    bufStats.accesses.add(hits);
+    bufStats.hits.add(hits);
+    for (std::size_t k = 0; k < done; k++) {
+      if (wanted[k].pinned) {
+        // by frame: a newer version of the page may be installed by now
+        for (int c = 0; c < wanted[k].count; c++) {
+          releaseFrame(file, wanted[k].frame, false);
+        }
+      } else if (wanted[k].loading) {
+        // its waiters look the page up again
+        finishLoad(wanted[k].frame, false);
+      } else if (!wanted[k].lost) {
+        releaseBuf(wanted[k].frame);
+      }
+    }
+    throw;
+  }
+
+  // one update of the counters and the policy for all the hits
+  bufStats.accesses.add(hits);
+  bufStats.hits.add(hits);
+  replacer->accessedAll(hit);
+
+  // pin the frames of the pages other threads published first, the reads
+  // being traced already
+  for (std::size_t k : missing) {
+    Wanted& page = wanted[k];
+    if (!page.lost) {
+      continue;
+    }
+    std::vector<FrameId> held;
+    try {
+      Page* winner;
+      for (int n = 0; n < page.count; n++) {
+        fetchPage(file, page.pageNo, winner);
+        held.push_back(static_cast<FrameId>(winner - bufPool));
+      }
+    } catch (...) {
+      // e.g. the winner's read failed: give back every pin taken so far
+      for (FrameId frame : held) {
+        releaseFrame(file, frame, false);
+      }
+      for (const Wanted& other : wanted) {
+        for (int c = 0; other.pinned && c < other.count; c++) {
+          releaseFrame(file, other.frame, false);
+        }
+      }
+      throw;
+    }
+    page.frame = held.back();
+    page.pinned = true;
+  }
+
+  pages.resize(pageNos.size());
+  std::size_t j = 0;
+  for (const Wanted& page : wanted) {
+    for (int n = 0; n < page.count; n++, j++) {
+      pages[order[j].second] = &bufPool[page.frame];
+    }
+  }
+}
+
+/**
+  * Record that a page was read from disk or from a prefetched frame, and
+  * read ahead if the file is being read in consecutive page order.
+  *
+  * @param file   	File object
+  * @param pageNo  Page number just read
+  */
+void BufMgr::noteRead(File* file, const PageId pageNo)
+{
+  PageId from = 0;
+  PageId to = 0;
+  {
+    std::lock_guard<std::mutex> latch(readAheadLatch);
+    ReadAhead& state = readAhead[file->id()];
+    const bool sequential = state.last != Page::INVALID_NUMBER && pageNo == state.last + 1;
+    state.last = pageNo;
+    // Top the window up once half of it has been consumed, so each read ahead
+    // is a batch of at least half a window
+    if (sequential && (state.next == Page::INVALID_NUMBER ||
+                       state.next <= pageNo + readAheadPages / 2)) {
+      from = std::max(state.next, pageNo + 1);
+      to = pageNo + 1 + readAheadPages;
+      state.next = to;
+    }
+  }
+  if (from < to) {
+    prefetch(file, from, to - from);
+  }
+}
+
+/**
+  * Starts loading a range of pages into unpinned frames.
+  *
+  * @param file   	File object
+  * @param first   First page number to load
+  * @param count   Number of consecutive pages to load
+  */
+void BufMgr::prefetch(File* file, const PageId first, const std::uint32_t count)
+{
+  // the mapping reads a mapped file ahead by itself
+  if (file->isMapped()) {
+    return;
+  }
+  std::vector<IoRequest> batch;
+  for (PageId pageNo = first; pageNo - first < count; pageNo++)
+  {
+    FrameId frame;
+    if (hashTable->tryLookup(file, pageNo, frame)) {
+      continue;
+    }
+    // a hint must not fail: stop when the pool is full of pinned pages
+    try{
+      allocBuf(frame, file);
+    }
+    catch(BufferExceededException&){
+      break;
+    }
+    if (ioEngine == NULL) {
+      // a readPage() of the page meanwhile waits for this read
+      if (!publishFrame(file, pageNo, frame, true, true)) {
+        continue;
+      }
+      try{
+        file->readPage(pageNo, bufPool[frame]);
+      }
+      catch(InvalidPageException&){
+        finishLoad(frame, false);
+        break;
+      }
+      catch(...){
+        finishLoad(frame, false);
+        throw;
+      }
+      finishPrefetch(frame, nullptr);
+      continue;
+    }
+    // past the end of the file the request cannot even be built
+    try{
+      IoRequest request = file->readPageRequest(pageNo, bufPool[frame],
+          [this, frame](std::exception_ptr error) {
+            finishPrefetch(frame, error);
+          });
+      if (!publishFrame(file, pageNo, frame, true, true)) {
+        continue;
+      }
+      batch.push_back(std::move(request));
+    }
+    catch(InvalidPageException&){
+      releaseBuf(frame);
+      break;
+    }
+    catch(...){
+      releaseBuf(frame);
+      ioEngine->submit(batch);
+      throw;
+    }
+  }
+  if (!batch.empty()) {
+    ioEngine->submit(batch);
+  }
+}
+
+/**
+  * End a read ahead into a frame published as loading, leaving the page
+  * unpinned and cold if it was read.
+  *
+  * @param frame    The frame
+  * @param error    Null if the read succeeded
+  */
+void BufMgr::finishPrefetch(const FrameId frame, std::exception_ptr error)
+{
+  // failed reads, e.g. of pages not in use, just give the frame back
+  finishLoad(frame, !error);
+  if (error) {
+    return;
+  }
+  BufDesc& desc = bufDescTable[frame];
+  {
+    std::lock_guard<std::mutex> latch(desc.latch);
+    desc.dropPins(1);
+    desc.publish();
+  }
+  bufStats.diskreads.add();
+  bufStats.prefetches.add();
+}
+
+/**
+  * Unpin a page from memory since it is no longer required for it to remain in memory.
+  *
+  * @param file   File object
+  * @param PageNo  Page number
+  * @param dirty	True if the page to be unpinned needs to be marked dirty	
+  * @throws  PageNotPinnedException If the page is not already pinned
+  */
+void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
+{
+  if (tracer != NULL) {
+    tracer->record(TraceOp::UNPIN, file->id(), pageNo, dirty);
+  }
+  unPinFrame(file, pageNo, 1, dirty);
+}
+
+/**
+  * Unpin several pages of a file.
+  *
+  * @param file   File object
+  * @param pageNos  Page numbers
+  * @param dirty	True if the pages need to be marked dirty
+  * @throws  PageNotPinnedException If a page is not pinned as often as it is
+  *          listed; the other pages are unpinned all the same
+  */
+void BufMgr::unPinPages(File* file, std::span<const PageId> pageNos, const bool dirty)
+{
+  if (tracer != NULL) {
+    for (PageId pageNo : pageNos) {
+      tracer->record(TraceOp::UNPIN, file->id(), pageNo, dirty);
+    }
+  }
+  std::vector<PageId> sorted(pageNos.begin(), pageNos.end());
+  if (!std::is_sorted(sorted.begin(), sorted.end())) {
+    std::sort(sorted.begin(), sorted.end());
+  }
+  std::exception_ptr error;
+  for (std::size_t first = 0; first < sorted.size();) {
+    std::size_t last = first + 1;
+    while (last < sorted.size() && sorted[last] == sorted[first]) {
+      last++;
+    }
+    try {
+      unPinFrame(file, sorted[first], static_cast<int>(last - first), dirty);
+    }
+    catch(...){
+      if (!error) error = std::current_exception();
+    }
+    first = last;
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+  * Unpin pages returned by readPages(), without looking them up.
+  *
+  * @param file   File object
+  * @param pages  Pages to unpin, each as often as it was pinned
+  * @param dirty	True if the pages need to be marked dirty
+  * @throws  PageNotPinnedException If a page is not pinned; the others are
+  *          unpinned all the same
+  * @throws  BadBufferException If a page is not in a frame of the pool
+  */
+void BufMgr::unPinPages(File* file, std::span<Page* const> pages, const bool dirty)
+{
+  std::exception_ptr error;
+  for (Page* page : pages) {
+    if (page < bufPool || page >= bufPool + maxBufs) {
+      if (!error) error = std::make_exception_ptr(
+          BadBufferException(maxBufs, false, false, false));
+      continue;
+    }
+    try {
+      releaseFrame(file, static_cast<FrameId>(page - bufPool), dirty);
+    } catch (...) {
+      if (!error) error = std::current_exception();
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+  * Unpin a frame known to hold a page of the file.
+  *
+  * @param file    File object
+  * @param frame   Frame holding the page
+  * @param dirty   True if the page needs to be marked dirty
+  */
+void BufMgr::releaseFrame(File* file, const FrameId frame, const bool dirty)
+{
+  BufDesc& desc = bufDescTable[frame];
+  // the pin holder is the only one to see a private copy, so the field
+  // holds still without the latch
+  if (desc.versionOf != BufDesc::NO_FRAME) {
+    installCopy(file, frame, dirty);
+    return;
+  }
+  bool reclaimed;
+  {
+    std::lock_guard<std::mutex> latch(desc.latch);
+    if (tracer != NULL) {
+      tracer->record(TraceOp::UNPIN, file->id(), desc.pageNo, dirty);
+    }
+    if (!desc.valid || desc.fileId != file->id() || desc.pins() == 0) {
+      throw PageNotPinnedException(file->filename(), desc.pageNo, frame);
+    }
+    desc.dropPins(1);
+    desc.publish();
+    // the last reader of a retired version lets it go
+    reclaimed = reclaimRetired(frame);
+    if (!reclaimed && dirty && !desc.mapped && !desc.retired) {
+      if (wal != NULL) {
+        wal->append(*file, bufPool[frame]);
+      }
+      // changed in place
+      desc.installed = false;
+      markDirty(desc);
+    }
+  }
+  if (reclaimed) {
+    replacer->removed(frame);
+  }
+}
+
+/**
+  * Install or drop a writer's private copy of a page.
+  *
+  * @param file    File object
+  * @param copy    Frame holding the copy
+  * @param dirty   True if the copy was changed
+  */
+void BufMgr::installCopy(File* file, const FrameId copy, const bool dirty)
+{
+  BufDesc& desc = bufDescTable[copy];
+  const FrameId current = desc.versionOf;
+  BufDesc& old = bufDescTable[current];
+  const PageId pageNo = desc.pageNo;
+  std::exception_ptr error;
+  bool installed = false;
+  bool reclaimed = false;
+  {
+    std::lock_guard<std::mutex> oldLatch(old.latch);
+    std::lock_guard<std::mutex> latch(desc.latch);
+    if (tracer != NULL) {
+      tracer->record(TraceOp::UNPIN, file->id(), pageNo, dirty);
+    }
+    if (!desc.valid || desc.fileId != file->id() || desc.pins() == 0) {
+      throw PageNotPinnedException(file->filename(), pageNo, copy);
+    }
+    // the new image is logged before anyone can see it
+    if (dirty && wal != NULL) {
+      try {
+        wal->append(*file, bufPool[copy]);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+    installed = dirty && !error;
+    desc.versionOf = BufDesc::NO_FRAME;
+    old.copyFrame = BufDesc::NO_FRAME;
+    if (installed) {
+      // the writer's pin on the old version kept it in the page table
+      hashTable->tryReplace(file, pageNo, current, copy);
+      desc.dropPins(1);
+      markDirty(desc);
+      desc.installed = true;
+      // the copy holds the changes the old version had too
+      old.retired = true;
+      markClean(old);
+    } else {
+      clearFrame(copy);
+    }
+    // the writer's pin on the old version goes, and readers done with a
+    // retired version let it go
+    old.dropPins(1);
+    old.publish();
+    reclaimed = reclaimRetired(current);
+    // a writer waiting for this one goes on
+    old.loaded.notify_all();
+  }
+  if (installed) {
+    replacer->installed(copy, file, pageNo, false);
+  } else {
+    replacer->removed(copy);
+  }
+  if (reclaimed) {
+    replacer->removed(current);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+  * Whether flushFile() may write a pinned frame and leave it in the pool.
+  * Caller holds the frame latch.
+  *
+  * @param desc   Descriptor of the pinned frame
+  * @return  True with copy-on-write if the page is clean or installed from a
+  *          private copy
+  */
+bool BufMgr::stablePinned(const BufDesc& desc) const
+{
+  return copyOnWrite && (!desc.dirty || desc.installed);
+}
+
+/**
+  * Empty a retired frame nobody pins any more.  Caller holds the frame latch.
+  *
+  * @param frame   Frame to empty
+  * @return  True if the frame was emptied
+  */
+bool BufMgr::reclaimRetired(const FrameId frame)
+{
+  BufDesc& desc = bufDescTable[frame];
+  // a retired frame is out of the page table, so no pin can come back
+  if (!desc.retired || !desc.freeze()) {
+    return false;
+  }
+  markClean(desc);
+  clearFrame(frame);
+  return true;
+}
+
+/**
+  * Unpin a page if it is in the buffer pool.
+  *
+  * @param file   File object
+  * @param pageNo  Page number
+  * @param count   Number of pins to remove
+  * @param dirty	True if the page needs to be marked dirty
+  * @throws  PageNotPinnedException If the page has fewer pins than count; none
+  *          are removed then
+  */
+void BufMgr::unPinFrame(File* file, const PageId pageNo, const int count, const bool dirty)
+{
+  FrameId frame;
+  // Check if the page that we want to unpin is in the buffer pool
+  if (!hashTable->tryLookup(file, pageNo, frame)) {
+    return;
+  }
+  BufDesc& desc = bufDescTable[frame];
+  std::unique_lock<std::mutex> latch(desc.latch);
+  // An unpinned page may have been evicted after the lookup
+  if (!desc.valid || desc.fileId != file->id() || desc.pageNo != pageNo) {
+    return;
+  }
+  // if pinCount is already zero it cannot be decremented any more, throw error
+  if(desc.pins() < count){
+    throw PageNotPinnedException(file->filename(), pageNo, frame);
+  }
+  else{
+    desc.dropPins(count);
+    desc.publish();
+  }
+  // a version retired since the lookup goes with its last pin
+  if(reclaimRetired(frame)){
+    latch.unlock();
+    replacer->removed(frame);
+    return;
+  }
+  // if dirty is true set the dirty bit of the page/frame; a page in the
+  // mapping of a mapped file cannot have been modified
+  if(dirty == true && !desc.mapped && !desc.retired){
+    // log the new image before the page can be written back
+    if(wal != NULL){
+      wal->append(*file, bufPool[frame]);
+    }
+    // changed in place
+    desc.installed = false;
+    markDirty(desc);
+  }
+}
+
+/**
+  * Enforce the write-ahead rule for a page about to be written back.
+  *
+  * @param page  Page about to be written
+  */
+void BufMgr::forceLog(const Page& page)
+{
+  if(wal != NULL){
+    wal->flush(page.lsn());
+  }
+}
+
+/**
+  * Make every logged change durable.
+  */
+void BufMgr::flushLog()
+{
+  if(wal != NULL){
+    wal->flush(wal->lastLsn());
+  }
+}
+
+/**
+  * Write back all dirty pages, sync the logged files and empty the log.
+  */
+void BufMgr::checkpoint()
+{
+  if(wal == NULL){
+    return;
+  }
+  if(ioEngine != NULL){
+    ioEngine->drain();
+  }
+  std::lock_guard<std::mutex> writer(writerLatch);
+  checkpointLocked();
+}
+
+/**
+  * Checkpoint with writerLatch already held.
+  */
+void BufMgr::checkpointLocked()
+{
+  if(wal == NULL){
+    return;
+  }
+  flushLog();
+  bool clean = true;
+  for (std::uint32_t i = 0; i < maxBufs; i++)
+  {
+    BufDesc& desc = bufDescTable[i];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    if(!desc.valid || !desc.dirty){
+      continue;
+    }
+    // with private copies for writers, installed versions do not change
+    if(desc.pins() > 0 && !desc.installed){
+      clean = false;
+      continue;
+    }
+    forceLog(bufPool[i]);
+    desc.file->writePage(bufPool[i]);
+    countWrites(desc.fileId, 1);
+    markClean(desc);
+  }
+  if(!clean){
+    return;
+  }
+  // pages written back earlier, by eviction, are only in the OS cache
+  const std::set<std::string> logged = wal->loggedFiles();
+  for (std::set<std::string>::const_iterator it = logged.begin();
+       it != logged.end(); ++it)
+  {
+    if(File::exists(*it)){
+      File::open(*it).sync();
+    }
+  }
+  wal->truncate();
+}
+
+/**
+  * Writes out all dirty pages of the file to disk.
+  * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
+  * Otherwise Error returned.
+  *
+  * @param file   	File object
+  * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
+  * @throws BadBufferException If any frame allocated to the file is found to be invalid
+  */
+void BufMgr::flushFile(const File* file) 
+{ 
+  BufDesc* tmpbuf;
+  // let outstanding read-aheads land in their frames first
+  if(ioEngine != NULL){
+    ioEngine->drain();
+  }
+  {
+    std::lock_guard<std::mutex> latch(readAheadLatch);
+    readAhead.erase(file->id());
+  }
+  // a warm-up loading the file stops after its current run
+  {
+    std::lock_guard<std::mutex> latch(warmingLatch);
+    warming.erase(file->id());
+  }
+  // the background writer pins the frames it writes; keep it out meanwhile
+  std::lock_guard<std::mutex> writer(writerLatch);
+  // the frames holding pages of the file, from its list
+  std::vector<FrameId> listed;
+  {
+    std::lock_guard<std::mutex> latch(fileFramesLatch);
+    std::map<FileId, FrameId>::iterator head = fileFrames.find(file->id());
+    for (FrameId i = head == fileFrames.end() ? BufDesc::NO_FRAME : head->second;
+         i != BufDesc::NO_FRAME; i = bufDescTable[i].fileNext)
+    {
+      listed.push_back(i);
+    }
+  }
+  // check them all before touching any, so an exception leaves the pool
+  // unchanged, and note their pages
+  std::vector<std::pair<PageId, FrameId> > frames;
+  std::vector<std::pair<PageId, bool> > dropped;
+  for (std::size_t k = 0; k < listed.size(); k++)
+	{
+  	tmpbuf = &(bufDescTable[listed[k]]);
+    std::lock_guard<std::mutex> latch(tmpbuf->latch);
+    if(!tmpbuf->valid || tmpbuf->fileId != file->id()){
+      continue;
+    }
+    // if an invalid page belonging to the file is encountered throw the exception
+    if(tmpbuf->pageNo == 0){
+      throw BadBufferException(listed[k], tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit());
+    }
+    // retired versions go with their last reader, and private copies are
+    // their writer's
+    if(tmpbuf->retired || tmpbuf->versionOf != BufDesc::NO_FRAME){
+      continue;
+    }
+    // with copy-on-write, pinned pages nobody changes in place are written
+    // all the same
+    if(tmpbuf->pins() > 0 && !stablePinned(*tmpbuf)){
+      throw PagePinnedException(file->filename(), tmpbuf->pageNo, listed[k]);
+    } 
+    frames.push_back(std::make_pair(tmpbuf->pageNo, listed[k]));
+    dropped.push_back(std::make_pair(tmpbuf->pageNo, tmpbuf->refbit()));
+  }
+  // in page order, so that consecutive dirty pages go out as sequential runs
+  std::sort(frames.begin(), frames.end());
+  if (!warmFile.empty()) {
+    std::lock_guard<std::mutex> latch(retiredLatch);
+    retired[file->filename()].swap(dropped);
+  }
+
+  // dirty frames being written, each kept reserved by a pin
+  std::vector<FrameId> writing;
+  std::vector<IoRequest> batch;
+  std::vector<std::promise<void> > done(frames.size());
+  std::exception_ptr error;
+  for (std::size_t k = 0; k < frames.size(); k++)
+  {
+    const FrameId frame = frames[k].second;
+    tmpbuf = &(bufDescTable[frame]);
+    std::lock_guard<std::mutex> latch(tmpbuf->latch);
+    // skip frames that changed hands since the scan
+    if(!tmpbuf->valid || tmpbuf->fileId != file->id() || tmpbuf->retired ||
+       tmpbuf->pageNo != frames[k].first ||
+       (tmpbuf->pins() > 0 && !stablePinned(*tmpbuf))){
+      continue;
+    }
+    // if the page is dirty write it to the appropriate page on disk
+    if(tmpbuf->dirty == true){
+      Page & newPage = bufPool[frame];
+      try{
+        forceLog(newPage);
+        if(ioEngine != NULL){
+          std::promise<void>* promise = &done[writing.size()];
+          batch.push_back(tmpbuf->file->writePageRequest(newPage,
+              [promise](std::exception_ptr e) {
+                if (e) {
+                  promise->set_exception(e);
+                } else {
+                  promise->set_value();
+                }
+              }));
+        }
+      }
+      catch(...){
+        if (!error) error = std::current_exception();
+        continue;
+      }
+      tmpbuf->addPins(1);
+      // a page dirtied again during the write stays dirty
+      markClean(*tmpbuf);
+      writing.push_back(frame);
+      continue;
+    }
+    // an optimistic pin may have come in since the check
+    if(!tmpbuf->freeze()){
+      continue;
+    }
+    // remove the page from the hashtable
+    hashTable->remove(tmpbuf->file.get(), tmpbuf->pageNo);
+    // invoke the Clear() method of BufDesc for the page frame
+    clearFrame(frame);
+    replacer->removed(frame);
+  }
+
+  if(ioEngine == NULL){
+    // the pinned pages cannot change identity, so no latch is needed to
+    // write them; each run of consecutive pages is a single write
+    for (std::size_t first = 0; first < writing.size();)
+    {
+      std::size_t last = first + 1;
+      while(last < writing.size() &&
+            bufDescTable[writing[last]].pageNo == bufDescTable[writing[last - 1]].pageNo + 1){
+        last++;
+      }
+      std::vector<const Page*> run;
+      for (std::size_t k = first; k < last; k++)
+      {
+        run.push_back(&bufPool[writing[k]]);
+      }
+      try{
+        bufDescTable[writing[first]].file->writePages(run);
+        for (std::size_t k = first; k < last; k++)
+        {
+          done[k].set_value();
+        }
+      }
+      catch(...){
+        if (!error) error = std::current_exception();
+        for (std::size_t k = first; k < last; k++)
+        {
+          done[k].set_exception(std::current_exception());
+        }
+      }
+      first = last;
+    }
+  }
+  if(!batch.empty()){
+    ioEngine->submit(batch);
+  }
+  for (std::size_t k = 0; k < writing.size(); k++)
+  {
+    bool written = true;
+    try{
+      done[k].get_future().get();
+    }
+    catch(...){
+      if (!error) error = std::current_exception();
+      written = false;
+    }
+    tmpbuf = &(bufDescTable[writing[k]]);
+    std::lock_guard<std::mutex> latch(tmpbuf->latch);
+    tmpbuf->dropPins(1);
+    tmpbuf->publish();
+    if(written){
+      countWrites(tmpbuf->fileId, 1);
+    }
+    // a writer may have installed a newer version during the write
+    if(tmpbuf->retired){
+      if(reclaimRetired(writing[k])){
+        replacer->removed(writing[k]);
+      }
+      continue;
+    }
+    if(!written){
+      markDirty(*tmpbuf);
+      continue;
+    }
+    if(!tmpbuf->dirty && tmpbuf->freeze()){
+      hashTable->remove(tmpbuf->file.get(), tmpbuf->pageNo);
+      clearFrame(writing[k]);
+      replacer->removed(writing[k]);
+    }
+  }
+  // once flushed the file may be changed behind the pool's back; a flush
+  // refused for a pinned page has kept its second-tier pages
+  if (ssdCache != NULL) {
+    ssdCache->eraseFile(file);
+  }
+  // write back the free-space map; it is reopened on the next use of the file
+  FreeSpace* space = NULL;
+  {
+    std::lock_guard<std::mutex> latch(freeSpaceLatch);
+    std::map<FileId, FreeSpace*>::iterator it = freeSpace.find(file->id());
+    if(it != freeSpace.end()){
+      space = it->second;
+      freeSpace.erase(it);
+    }
+  }
+  delete space;
+  if(error){
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+  * Write back the dirty pages of a file, keeping them in the pool.  The
+  * caller holds writerLatch.
+  *
+  * @param file   	File object
+  * @return  The frames holding pages of the file, with their page numbers
+  * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+  */
+std::vector<std::pair<PageId, FrameId> > BufMgr::writeBackFile(const File* file)
+{
+  std::vector<FrameId> listed;
+  {
+    std::lock_guard<std::mutex> latch(fileFramesLatch);
+    std::map<FileId, FrameId>::iterator head = fileFrames.find(file->id());
+    for (FrameId i = head == fileFrames.end() ? BufDesc::NO_FRAME : head->second;
+         i != BufDesc::NO_FRAME; i = bufDescTable[i].fileNext)
+    {
+      listed.push_back(i);
+    }
+  }
+  // check them all before writing any
+  std::vector<std::pair<PageId, FrameId> > frames;
+  for (std::size_t k = 0; k < listed.size(); k++)
+  {
+    BufDesc& desc = bufDescTable[listed[k]];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    if(!desc.valid || desc.fileId != file->id()){
+      continue;
+    }
+    if(desc.pins() > 0){
+      throw PagePinnedException(file->filename(), desc.pageNo, listed[k]);
+    }
+    frames.push_back(std::make_pair(desc.pageNo, listed[k]));
+  }
+  std::sort(frames.begin(), frames.end());
+  for (std::size_t k = 0; k < frames.size(); k++)
+  {
+    const FrameId frame = frames[k].second;
+    BufDesc& desc = bufDescTable[frame];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    if(!desc.valid || desc.fileId != file->id() || !desc.dirty){
+      continue;
+    }
+    forceLog(bufPool[frame]);
+    desc.file->writePage(bufPool[frame]);
+    countWrites(desc.fileId, 1);
+    markClean(desc);
+  }
+  return frames;
+}
+
+/**
+  * Defragments a file, moving records off half empty pages and pages down
+  * into the free ones, and renumbers the frames of the pages moved.
+  *
+  * @param file   	File object
+  * @param merge   Whether to move records off half empty pages
+  * @return  The pages and records moved
+  * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+  */
+DefragResult BufMgr::defragment(File* file, const bool merge)
+{
+  DefragResult result;
+  result.pagesBefore = file->numPages();
+  // let outstanding read-aheads land in their frames first, and start no more
+  if(ioEngine != NULL){
+    ioEngine->drain();
+  }
+  {
+    std::lock_guard<std::mutex> latch(readAheadLatch);
+    readAhead.erase(file->id());
+  }
+  {
+    std::lock_guard<std::mutex> latch(warmingLatch);
+    warming.erase(file->id());
+  }
+  // the free-space map, if the file has one, follows the records and pages
+  FreeSpace* space = NULL;
+  if(File::exists(FreeSpaceMap::mapName(file->filename()))){
+    space = freeSpaceOf(file);
+  }
+  // the scans below read the file, so it must hold what the pool does
+  {
+    std::lock_guard<std::mutex> writer(writerLatch);
+    writeBackFile(file);
+  }
+
+  if(merge){
+    // the pages at least half empty, in page order
+    std::vector<PageId> sparse;
+    for (FileIterator iter = file->begin(); iter != file->end(); ++iter)
+    {
+      const Page& page = *iter;
+      if(page.type() == SLOTTED && page.getFreeSpace() >= Page::DATA_SIZE / 2){
+        sparse.push_back(page.page_number());
+      }
+    }
+    // empty the last of them onto the first, for as long as they fit
+    std::size_t first = 0;
+    std::size_t last = sparse.size();
+    Page* target = NULL;
+    bool filled = false;
+    while(first + 1 < last){
+      const PageId source = sparse[last - 1];
+      Page* page;
+      readPage(file, source, page);
+      std::vector<RecordId> moved;
+      bool emptied = true;
+      for (PageIterator iter = page->begin(); iter != page->end(); ++iter)
+      {
+        const std::string_view record = iter.record();
+        while(first + 1 < last){
+          if(target == NULL){
+            readPage(file, sparse[first], target);
+            filled = false;
+          }
+          if(target->hasSpaceForRecord(record)){
+            break;
+          }
+          // full: on to the next page
+          if(space != NULL){
+            std::lock_guard<std::mutex> placing(space->latch);
+            space->map.update(sparse[first], target->getFreeSpace());
+          }
+          releaseFrame(file, static_cast<FrameId>(target - bufPool), filled);
+          target = NULL;
+          first++;
+        }
+        if(target == NULL){
+          emptied = false;
+          break;
+        }
+        result.records.push_back(std::make_pair(iter.recordId(),
+                                                target->insertRecord(record)));
+        moved.push_back(iter.recordId());
+        filled = true;
+      }
+      if(!emptied){
+        // what did not fit stays; no page before it has room left
+        page->deleteRecords(moved);
+        if(space != NULL){
+          std::lock_guard<std::mutex> placing(space->latch);
+          space->map.update(source, page->getFreeSpace());
+        }
+        releaseFrame(file, static_cast<FrameId>(page - bufPool), !moved.empty());
+        break;
+      }
+      releaseFrame(file, static_cast<FrameId>(page - bufPool), false);
+      disposePage(file, source);
+      last--;
+    }
+    if(target != NULL){
+      if(space != NULL){
+        std::lock_guard<std::mutex> placing(space->latch);
+        space->map.update(sparse[first], target->getFreeSpace());
+      }
+      releaseFrame(file, static_cast<FrameId>(target - bufPool), filled);
+    }
+  }
+
+  std::map<PageId, PageId> renumbered;
+  {
+    std::lock_guard<std::mutex> writer(writerLatch);
+    // the file is moved as on disk, which the pool matches once written back
+    const std::vector<std::pair<PageId, FrameId> > frames = writeBackFile(file);
+    result.pages = file->compact();
+    renumbered.insert(result.pages.begin(), result.pages.end());
+    for (std::size_t k = 0; k < frames.size(); k++)
+    {
+      std::map<PageId, PageId>::const_iterator to = renumbered.find(frames[k].first);
+      if(to == renumbered.end()){
+        continue;
+      }
+      const FrameId frame = frames[k].second;
+      BufDesc& desc = bufDescTable[frame];
+      std::lock_guard<std::mutex> latch(desc.latch);
+      // the frame may have been evicted meanwhile, which is as good
+      if(!desc.valid || desc.fileId != file->id() || desc.pageNo != to->first ||
+         !desc.freeze()){
+        continue;
+      }
+      // the frame keeps its place with the policy; a ghost of the old number
+      // is harmless
+      hashTable->remove(file, to->first);
+      desc.Renumber(to->second);
+      bufPool[frame].set_page_number(to->second);
+      hashTable->insert(file, to->second, frame);
+      desc.publish();
+    }
+    // pages in the second tier may be under numbers that moved or are gone
+    if(ssdCache != NULL){
+      ssdCache->eraseFile(file);
+    }
+    // logged images of pages under their old numbers, including those the
+    // merge logged, must not be replayed over the moved pages or past the
+    // new end of the file
+    checkpointLocked();
+  }
+  if(space != NULL){
+    std::lock_guard<std::mutex> placing(space->latch);
+    for (std::size_t k = 0; k < result.pages.size(); k++)
+    {
+      space->map.move(result.pages[k].first, result.pages[k].second);
+    }
+  }
+  // the records moved are where their pages went
+  for (std::size_t k = 0; k < result.records.size(); k++)
+  {
+    std::map<PageId, PageId>::const_iterator to =
+        renumbered.find(result.records[k].second.page_number);
+    if(to != renumbered.end()){
+      result.records[k].second.page_number = to->second;
+    }
+  }
+  result.pagesAfter = file->numPages();
+  return result;
+}
+
+/**
+ * allocates a new page for a file and adds it to the buffer
+ * returns the page number of the newly allocated page
+ * @param file   pointer to file to allocate a new page for
+ * @param pageNo page number of newly allocated page
+ * @param page   allocated page
+ */
+void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
+{
+  // the frame the Page will be allocated in
+	FrameId newFrame;
+  // find a free frame for the page
+  allocBuf(newFrame, file);  
+  // allocate the new page in the file, initializing it directly in the frame;
+  // the frame is its only copy until written back, so no empty page is
+  // written now
+  try{
+    pageNo = file->allocateUnwritten(bufPool[newFrame]);
+  }
+  catch(...){
+    releaseBuf(newFrame);
+    throw;
+  }
+  // return the new page
+  page = &bufPool[newFrame];
+  installNew(file, pageNo, newFrame);
+  BufDesc& desc = bufDescTable[newFrame];
+  std::lock_guard<std::mutex> latch(desc.latch);
+  markDirty(desc);
+}
+
+/**
+ * puts a page just allocated in the file into a frame, without reading it
+ * @param file   pointer to file the page was allocated in
+ * @param pageNo page number of the page
+ * @param image  contents of the page as allocated
+ * @param page   the page in its frame
+ */
+void BufMgr::installPage(File* file, const PageId pageNo, const Page& image, Page*& page)
+{
+  FrameId newFrame;
+  allocBuf(newFrame, file);
+  bufPool[newFrame] = image;
+  page = &bufPool[newFrame];
+  installNew(file, pageNo, newFrame);
+  // the page is not on disk yet
+  BufDesc& desc = bufDescTable[newFrame];
+  std::lock_guard<std::mutex> latch(desc.latch);
+  markDirty(desc);
+}
+
+/**
+ * publishes a reserved frame holding a newly allocated page
+ * @param file   pointer to file of the page
+ * @param pageNo page number of the page
+ * @param frame  the frame holding it
+ */
+void BufMgr::installNew(File* file, const PageId pageNo, const FrameId frame)
+{
+  // initiate the frame
+  {
+    std::lock_guard<std::mutex> latch(bufDescTable[frame].latch);
+    setFrame(frame, file, pageNo, false);
+  }
+  // insert the Page into the hash table
+	hashTable->insert(file, pageNo, frame);
+  {
+    std::lock_guard<std::mutex> latch(bufDescTable[frame].latch);
+    bufDescTable[frame].publish();
+  }
+  replacer->installed(frame, file, pageNo, false);
+  bufStats.accesses.add();
+  if (tracer != NULL) {
+    tracer->record(TraceOp::ALLOC, file->id(), pageNo);
+  }
+}
+
+/**
+ * allocates a new page for a file and returns a guard holding the pin on it
+ * @param file   pointer to file to allocate a new page for
+ * @param pageNo page number of newly allocated page
+ * @return guard holding the pin on the allocated page
+ */
+PageGuard BufMgr::allocPage(File* file, PageId& pageNo)
+{
+  Page* page;
+  allocPage(file, pageNo, page);
+  return PageGuard(this, file, pageNo, static_cast<FrameId>(page - bufPool), page);
+}
+
+/**
+  * Delete page from file and also from buffer pool if present.
+  * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
+  *
+  * @param file   	File object
+  * @param PageNo  Page number
 */
 void BufMgr::disposePage(File* file, const PageId PageNo)
 { 
+  if (tracer != NULL) {
+    tracer->record(TraceOp::DISPOSE, file->id(), PageNo);
+  }
   FrameId frame;     
-  try{ 
-    hashTable->lookup(file, PageNo, frame);
+  // a read ahead of the page could otherwise bring it back after deletion
+  if (ioEngine != NULL) {
+    ioEngine->drain();
   }
-  // Page is not in the buffer pool
-  catch(HashNotFoundException & e){
-    // deletes a particular page from file
-    file->deletePage(PageNo);
-    return;
-  } 
+  std::unique_lock<std::mutex> writer(writerLatch);
   // if the page to be deleted is allocated a frame in the buffer pool
   // frame is freed  
   // and correspondingly entry from hash table is also removed.
-  hashTable->remove(file,PageNo);
-  bufDescTable[frame].Clear();  
+  if (hashTable->tryLookup(file, PageNo, frame)) {
+    BufDesc& desc = bufDescTable[frame];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    if (desc.valid && desc.fileId == file->id() && desc.pageNo == PageNo) {
+      hashTable->remove(file,PageNo);
+      markClean(desc);
+      clearFrame(frame);
+      replacer->removed(frame);
+    }
+  }
+  if (ssdCache != NULL) {
+    ssdCache->erase(file, PageNo);
+  }
   // deletes a particular page from file
   file->deletePage(PageNo); 
+  writer.unlock();
+  // a deleted page has no space to offer
+  std::lock_guard<std::mutex> latch(freeSpaceLatch);
+  std::map<FileId, FreeSpace*>::iterator it = freeSpace.find(file->id());
+  if (it != freeSpace.end()) {
+    std::lock_guard<std::mutex> placing(it->second->latch);
+    it->second->map.update(PageNo, 0);
+  }
+}
+
+/**
+  * Return the free-space map of a file, opening it on first use.
+  *
+  * @param file   	File object
+  * @return  The file's map and placement latch
+  */
+BufMgr::FreeSpace* BufMgr::freeSpaceOf(const File* file)
+{
+  std::lock_guard<std::mutex> latch(freeSpaceLatch);
+  FreeSpace*& space = freeSpace[file->id()];
+  if(space == NULL){
+    try{
+      space = new FreeSpace(file->filename());
+    }
+    catch(...){
+      freeSpace.erase(file->id());
+      throw;
+    }
+  }
+  return space;
+}
+
+/**
+  * Inserts a record into a page of the file with enough free space.
+  *
+  * @param file   	File object
+  * @param record  Record data
+  * @return  ID of the inserted record
+  */
+RecordId BufMgr::insertRecord(File* file, std::string_view record)
+{
+  FreeSpace* space = freeSpaceOf(file);
+  std::lock_guard<std::mutex> placing(space->latch);
+  // a page with a free slot needs less, but the map cannot tell
+  const std::size_t needed = record.length() + sizeof(PageSlot);
+  PageId pageNo;
+  // the guard gives the pin back by frame, as a newer version of the page
+  // may be installed meanwhile
+  PageGuard page;
+  for(;;){
+    pageNo = space->map.findPage(needed);
+    if(pageNo == Page::INVALID_NUMBER){
+      page = allocPage(file, pageNo);
+      break;
+    }
+    try{
+      page = readPage(file, pageNo);
+    }
+    catch(InvalidPageException&){
+      // the page was deleted behind the map's back
+      space->map.update(pageNo, 0);
+      continue;
+    }
+    if(page->hasSpaceForRecord(record)){
+      break;
+    }
+    // the map was stale; with the real free space the page no longer qualifies
+    space->map.update(pageNo, page->getFreeSpace());
+    page.release();
+  }
+  RecordId rid;
+  try{
+    rid = page->insertRecord(record);
+  }
+  catch(...){
+    space->map.update(pageNo, page->getFreeSpace());
+    page.markDirty();
+    page.release();
+    throw;
+  }
+  space->map.update(pageNo, page->getFreeSpace());
+  page.markDirty();
+  page.release();
+  return rid;
+}
+
+/**
+  * Deletes a record and records the freed space.
+  *
+  * @param file   	File object
+  * @param rid     ID of the record to delete
+  */
+void BufMgr::deleteRecord(File* file, const RecordId& rid)
+{
+  FreeSpace* space = freeSpaceOf(file);
+  std::lock_guard<std::mutex> placing(space->latch);
+  PageGuard page = readPage(file, rid.page_number);
+  page->deleteRecord(rid);
+  space->map.update(rid.page_number, page->getFreeSpace());
+  page.markDirty();
+  page.release();
+}
+
+/**
+  * Loads records into newly allocated, packed pages.
+  *
+  * @param file   	File object
+  * @param records  Records to load
+  * @return  IDs of the records
+  */
+std::vector<RecordId> BufMgr::bulkLoad(File* file, const std::vector<std::string_view>& records)
+{
+  std::vector<RecordId> rids;
+  rids.reserve(records.size());
+  // pages stay pinned until their batch is written; leave frames for others
+  const std::size_t batchPages =
+      std::max<std::size_t>(1, std::min<std::size_t>(writerBatchPages, numBufs / 2));
+  std::vector<Page*> batch;
+  std::size_t next = 0;
+  try{
+    while(next < records.size()){
+      PageId pageNo;
+      Page* page;
+      allocPage(file, pageNo, page);
+      const std::size_t placed = page->insertRecords(records, next, rids);
+      if(placed == 0){
+        const std::size_t available = page->getFreeSpace();
+        releaseFrame(file, static_cast<FrameId>(page - bufPool), false);
+        disposePage(file, pageNo);
+        writeLoaded(file, batch);
+        throw InsufficientSpaceException(pageNo, records[next].length(), available);
+      }
+      next += placed;
+      batch.push_back(page);
+      if(batch.size() == batchPages){
+        writeLoaded(file, batch);
+      }
+    }
+    writeLoaded(file, batch);
+  }
+  catch(...){
+    // pages filled but not written are still good; eviction writes them
+    unPinPages(file, batch, true);
+    throw;
+  }
+  return rids;
+}
+
+/**
+  * Write out and unpin a batch of pages filled by bulkLoad().
+  *
+  * @param file   	File object
+  * @param batch   Pinned pages to write
+  */
+void BufMgr::writeLoaded(File* file, std::vector<Page*>& batch)
+{
+  if(batch.empty()){
+    return;
+  }
+  std::vector<const Page*> pages(batch.begin(), batch.end());
+  // the whole batch is logged with one sync before any page is written
+  if(wal != NULL){
+    for(Page* page : batch){
+      wal->append(*file, *page);
+    }
+    wal->flush(wal->lastLsn());
+  }
+  file->writePages(pages);
+  countWrites(file->id(), batch.size());
+  // the pages were dirty from their allocation; they are on disk now
+  for(Page* page : batch){
+    BufDesc& desc = bufDescTable[page - bufPool];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    markClean(desc);
+  }
+
+  FreeSpace* space = NULL;
+  {
+    std::lock_guard<std::mutex> latch(freeSpaceLatch);
+    std::map<FileId, FreeSpace*>::iterator it = freeSpace.find(file->id());
+    if(it != freeSpace.end()){
+      space = it->second;
+    }
+  }
+  if(space != NULL){
+    std::lock_guard<std::mutex> placing(space->latch);
+    for(Page* page : batch){
+      space->map.update(page->page_number(), page->getFreeSpace());
+    }
+  }
+  // the batch is the caller's to unpin no more, even if this throws
+  std::vector<Page*> written;
+  written.swap(batch);
+  unPinPages(file, written, false);
+}
+
+
+void BufStats::merge(const BufStats& other)
+{
+  accesses += other.accesses;
+  hits += other.hits;
+  misses += other.misses;
+  diskreads += other.diskreads;
+  diskwrites += other.diskwrites;
+  prefetches += other.prefetches;
+  backgroundwrites += other.backgroundwrites;
+  evictions += other.evictions;
+  dirtyevictions += other.dirtyevictions;
+  victimsearches += other.victimsearches;
+  sweepsteps += other.sweepsteps;
+  pinwaits += other.pinwaits;
+  sharedreads += other.sharedreads;
+  pagecopies += other.pagecopies;
+  ssd.hits += other.ssd.hits;
+  ssd.misses += other.ssd.misses;
+  ssd.admissions += other.ssd.admissions;
+  ssd.rejections += other.ssd.rejections;
+  misslatency.merge(other.misslatency);
+  for (std::map<std::string, FileStats>::const_iterator it = other.files.begin();
+       it != other.files.end(); ++it)
+  {
+    FileStats& file = files[it->first];
+    file.hits += it->second.hits;
+    file.reads += it->second.reads;
+    file.writes += it->second.writes;
+  }
+  for (std::map<std::string, PartitionStats>::const_iterator it = other.partitions.begin();
+       it != other.partitions.end(); ++it)
+  {
+    PartitionStats& partition = partitions[it->first];
+    partition.frames += it->second.frames;
+    partition.minFrames += it->second.minFrames;
+    partition.maxFrames += it->second.maxFrames;
+    partition.hits += it->second.hits;
+    partition.reads += it->second.reads;
+    partition.writes += it->second.writes;
+  }
+}
+
+void BufMgr::setPartition(const std::string& name, const std::uint32_t minFrames,
+                          const std::uint32_t maxFrames)
+{
+  if (name == partitions[0].name) {
+    throw PartitionException(name, "the default partition has no bounds");
+  }
+  if (maxFrames == 0 || minFrames > maxFrames) {
+    throw PartitionException(name, "bounds out of order");
+  }
+  std::lock_guard<std::mutex> latch(fileFramesLatch);
+  const std::uint32_t count = numPartitions.load(std::memory_order_relaxed);
+  std::uint32_t index = count;
+  std::uint64_t reserved = minFrames;
+  for (std::uint32_t i = 1; i < count; i++) {
+    if (partitions[i].name == name) {
+      index = i;
+    } else {
+      reserved += partitions[i].minFrames.load(std::memory_order_relaxed);
+    }
+  }
+  if (reserved > numBufs.load(std::memory_order_relaxed)) {
+    throw PartitionException(name, "minimums exceed the pool");
+  }
+  if (index == MAX_PARTITIONS) {
+    throw PartitionException(name, "too many partitions");
+  }
+  Partition& partition = partitions[index];
+  partition.minFrames.store(minFrames, std::memory_order_relaxed);
+  partition.maxFrames.store(maxFrames, std::memory_order_relaxed);
+  if (index == count) {
+    partition.name = name;
+    partition.frames.store(0, std::memory_order_relaxed);
+    numPartitions.store(count + 1, std::memory_order_release);
+  }
+}
+
+void BufMgr::assignPartition(const std::string& filename, const std::string& partition)
+{
+  std::lock_guard<std::mutex> latch(fileFramesLatch);
+  const std::uint32_t count = numPartitions.load(std::memory_order_relaxed);
+  std::uint32_t index = 0;
+  while (index < count && partitions[index].name != partition) {
+    index++;
+  }
+  if (index == count) {
+    throw PartitionException(partition, "no such partition");
+  }
+  filePartitions[filename] = index;
+  // open files of that name take their next pages into it
+  for (std::map<FileId, FileUsage>::iterator it = fileUsage.begin(); it != fileUsage.end(); ++it)
+  {
+    if (it->second.filename == filename) {
+      it->second.partition = index;
+    }
+  }
+}
+
+BufStats BufMgr::getBufStats()
+{
+  BufStats stats;
+  stats.accesses = bufStats.accesses.value();
+  stats.hits = bufStats.hits.value();
+  stats.misses = bufStats.misses.value();
+  stats.diskreads = bufStats.diskreads.value();
+  stats.diskwrites = bufStats.diskwrites.value();
+  stats.prefetches = bufStats.prefetches.value();
+  stats.backgroundwrites = bufStats.backgroundwrites.value();
+  stats.evictions = bufStats.evictions.value();
+  stats.dirtyevictions = bufStats.dirtyevictions.value();
+  stats.victimsearches = bufStats.victimsearches.value();
+  stats.sweepsteps = bufStats.sweepsteps.value();
+  stats.pinwaits = bufStats.pinwaits.value();
+  stats.sharedreads = bufStats.sharedreads.value();
+  stats.pagecopies = bufStats.pagecopies.value();
+  stats.misslatency = bufStats.misslatency.snapshot();
+  if (ssdCache != NULL) {
+    stats.ssd = ssdCache->stats();
+  }
+
+  std::lock_guard<std::mutex> latch(fileFramesLatch);
+  for (std::map<FileId, FileUsage>::const_iterator it = fileUsage.begin();
+       it != fileUsage.end(); ++it)
+  {
+    // a name opened again under a new identifier adds to the same entry
+    FileStats& file = stats.files[it->second.filename];
+    PartitionStats& partition = stats.partitions[partitions[it->second.partition].name];
+    const std::uint64_t hits = file.hits;
+    file.hits += it->second.stats.hits;
+    file.reads += it->second.stats.reads;
+    file.writes += it->second.stats.writes;
+    std::map<FileId, FrameId>::const_iterator head = fileFrames.find(it->first);
+    for (FrameId frame = head == fileFrames.end() ? BufDesc::NO_FRAME : head->second;
+         frame != BufDesc::NO_FRAME; frame = bufDescTable[frame].fileNext)
+    {
+      file.hits += bufDescTable[frame].hits.load(std::memory_order_relaxed);
+    }
+    partition.hits += file.hits - hits;
+    partition.reads += it->second.stats.reads;
+    partition.writes += it->second.stats.writes;
+  }
+  for (std::uint32_t i = 0; i < numPartitions.load(std::memory_order_relaxed); i++) {
+    PartitionStats& partition = stats.partitions[partitions[i].name];
+    partition.frames = partitions[i].frames.load(std::memory_order_relaxed);
+    partition.minFrames = partitions[i].minFrames.load(std::memory_order_relaxed);
+    partition.maxFrames = partitions[i].maxFrames.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+void BufMgr::clearBufStats()
+{
+  bufStats.clear();
+  if (ssdCache != NULL) {
+    ssdCache->clearStats();
+  }
+  std::lock_guard<std::mutex> latch(fileFramesLatch);
+  // files with pages in the pool keep their entry, and with it their name
+  for (std::map<FileId, FileUsage>::iterator it = fileUsage.begin(); it != fileUsage.end();)
+  {
+    std::map<FileId, FrameId>::const_iterator head = fileFrames.find(it->first);
+    if (head == fileFrames.end()) {
+      fileUsage.erase(it++);
+      continue;
+    }
+    it->second.stats = FileStats();
+    for (FrameId frame = head->second; frame != BufDesc::NO_FRAME;
+         frame = bufDescTable[frame].fileNext)
+    {
+      bufDescTable[frame].hits.store(0, std::memory_order_relaxed);
+    }
+    ++it;
+  }
+}
+
+/**
+  * Lists the pages in the pool, and those flushFile() dropped.
+  *
+  * @return  The list, hottest first
+  */
+ResidentList BufMgr::residentPages()
+{
+  ResidentList list;
+  std::vector<ResidentPage> cold;
+  std::set<std::pair<std::uint32_t, PageId> > listed;
+  for (FrameId frame = 0; frame < maxBufs; frame++) {
+    BufDesc& desc = bufDescTable[frame];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    // one frame per page: neither retired versions nor private copies
+    if (!desc.valid || desc.retired || desc.versionOf != BufDesc::NO_FRAME) {
+      continue;
+    }
+    ResidentPage page;
+    page.file = list.fileIndex(desc.file->filename());
+    page.pageNo = desc.pageNo;
+    page.referenced = desc.refbit();
+    listed.insert(std::make_pair(page.file, page.pageNo));
+    (page.referenced ? list.pages : cold).push_back(page);
+  }
+  list.pages.insert(list.pages.end(), cold.begin(), cold.end());
+  {
+    std::lock_guard<std::mutex> latch(retiredLatch);
+    for (std::map<std::string, std::vector<std::pair<PageId, bool> > >::const_iterator it =
+             retired.begin(); it != retired.end(); ++it)
+    {
+      const std::uint32_t file = list.fileIndex(it->first);
+      for (const std::pair<PageId, bool>& dropped : it->second) {
+        if (listed.insert(std::make_pair(file, dropped.first)).second) {
+          ResidentPage page;
+          page.file = file;
+          page.pageNo = dropped.first;
+          page.referenced = dropped.second;
+          list.pages.push_back(page);
+        }
+      }
+    }
+  }
+  if (list.pages.size() > numBufs) {
+    list.pages.resize(numBufs);
+  }
+  return list;
+}
+
+/**
+  * Writes the page list to the warm file.
+  */
+void BufMgr::dumpResident()
+{
+  if (warmFile.empty()) {
+    return;
+  }
+  residentPages().write(warmFile);
+}
+
+/**
+  * Writes the page list every warmDumpIntervalMs until the pool goes.
+  */
+void BufMgr::runWarmDumper()
+{
+  std::unique_lock<std::mutex> wake(warmDumpLatch);
+  while (!warmDumpStop) {
+    warmDumpWake.wait_for(wake, std::chrono::milliseconds(warmDumpIntervalMs));
+    if (warmDumpStop) {
+      break;
+    }
+    wake.unlock();
+    // a failed write is retried at the next interval
+    try {
+      dumpResident();
+    } catch (const IoException&) {
+    }
+    wake.lock();
+  }
+}
+
+/**
+  * Starts loading the pages of the warm file in the background.
+  *
+  * @param files  Open files to load the pages of
+  */
+void BufMgr::warmUp(const std::vector<File*>& files)
+{
+  waitWarmUp();
+  if (warmFile.empty() || !File::exists(warmFile)) {
+    return;
+  }
+  const ResidentList list = ResidentList::read(warmFile);
+  {
+    std::lock_guard<std::mutex> latch(warmingLatch);
+    warming.clear();
+    for (std::size_t i = 0; i < files.size(); i++) {
+      warming.insert(files[i]->id());
+    }
+  }
+  warmed = 0;
+  warmStop = false;
+  warmer = std::thread(&BufMgr::runWarmUp, this, list, files);
+}
+
+/**
+  * Waits for the warm-up thread.
+  *
+  * @return  Pages loaded by the last warm-up
+  */
+std::uint64_t BufMgr::waitWarmUp()
+{
+  if (warmer.joinable()) {
+    warmer.join();
+  }
+  return warmed;
+}
+
+/**
+  * Loads the listed pages of the given files, a run of consecutive pages at a
+  * time.
+  *
+  * @param list   Pages to load
+  * @param files  The open files to load them from
+  */
+void BufMgr::runWarmUp(const ResidentList list, const std::vector<File*> files)
+{
+  // the listed pages of each open file, in page order
+  std::vector<std::vector<std::pair<PageId, bool> > > wanted(list.files.size());
+  std::vector<File*> opened(list.files.size(), NULL);
+  for (std::size_t i = 0; i < list.files.size(); i++) {
+    for (File* file : files) {
+      if (file->filename() == list.files[i] && !file->isMapped()) {
+        opened[i] = file;
+      }
+    }
+  }
+  for (const ResidentPage& page : list.pages) {
+    if (opened[page.file] != NULL) {
+      wanted[page.file].push_back(std::make_pair(page.pageNo, page.referenced));
+    }
+  }
+  const std::uint64_t budget = numBufs;
+  try {
+    for (std::size_t i = 0; i < wanted.size(); i++) {
+      File* const file = opened[i];
+      std::sort(wanted[i].begin(), wanted[i].end());
+      for (std::size_t next = 0; next < wanted[i].size() && !warmStop && warmed < budget;) {
+        std::lock_guard<std::mutex> loading(warmingLatch);
+        if (warming.count(file->id()) == 0) {
+          break;
+        }
+        // the next run of consecutive pages not in the pool, with a frame each
+        std::vector<std::pair<PageId, bool> > run;
+        std::vector<FrameId> frames;
+        // the frames before frames[offered] were offered to the page table,
+        // and of those, the ones before frames[settled] are settled: in the
+        // pool unpinned, or back in it
+        std::vector<bool> published;
+        std::size_t offered = 0;
+        std::size_t settled = 0;
+        try {
+          for (; next < wanted[i].size() && run.size() < WARM_RUN_PAGES &&
+                 warmed + run.size() < budget; next++)
+          {
+            const PageId pageNo = wanted[i][next].first;
+            if (!run.empty() && pageNo != run.back().first + 1) {
+              break;
+            }
+            FrameId frame;
+            if (hashTable->tryLookup(file, pageNo, frame)) {
+              if (run.empty()) {
+                continue;
+              }
+              break;
+            }
+            try {
+              allocBuf(frame, file);
+            } catch (const BufferExceededException&) {
+              warmStop = true;
+              break;
+            }
+            run.push_back(wanted[i][next]);
+            frames.push_back(frame);
+          }
+          if (run.empty()) {
+            continue;
+          }
+          // publish the frames as loading first, so that a readPage() of one
+          // of the pages meanwhile waits for this read; a page another thread
+          // published first is read into a scratch page, keeping the run whole
+          Page scratch;
+          std::vector<Page*> pages;
+          for (; offered < frames.size(); offered++) {
+            published.push_back(publishFrame(file, run[offered].first, frames[offered],
+                                             true, true));
+            pages.push_back(published.back() ? &bufPool[frames[offered]] : &scratch);
+          }
+          // pages deleted since the list was written fail the run; read the
+          // others one at a time then
+          std::vector<bool> read(run.size(), true);
+          try {
+            file->readPages(run.front().first, pages);
+          } catch (const BadgerDbException&) {
+            for (std::size_t k = 0; k < run.size(); k++) {
+              try {
+                file->readPage(run[k].first, *pages[k]);
+              } catch (const BadgerDbException&) {
+                read[k] = false;
+              }
+            }
+          }
+          for (std::size_t k = 0; k < run.size(); k++) {
+            settled = k + 1;
+            if (!published[k]) {
+              continue;
+            }
+            if (!read[k]) {
+              finishLoad(frames[k], false);
+              continue;
+            }
+            finishPrefetch(frames[k], nullptr);
+            warmed++;
+            if (!run[k].second) {
+              continue;
+            }
+            // a referenced page comes back referenced, not as a read-ahead
+            BufDesc& desc = bufDescTable[frames[k]];
+            {
+              std::lock_guard<std::mutex> latch(desc.latch);
+              if (!desc.valid || desc.fileId != file->id() || desc.pageNo != run[k].first) {
+                continue;
+              }
+              desc.setRefbit(true);
+              desc.prefetched = false;
+              desc.publish();
+            }
+            replacer->accessed(frames[k]);
+          }
+        } catch (...) {
+          // e.g. an eviction's write-back failed: no reserved frame stays pinned
+          for (std::size_t k = settled; k < frames.size(); k++) {
+            if (k >= offered) {
+              releaseBuf(frames[k]);
+            } else if (published[k]) {
+              finishLoad(frames[k], false);
+            }
+          }
+          throw;
+        }
+      }
+    }
+  } catch (const BadgerDbException&) {
+    // loading is only a hint
+  }
 }
 
+/**
+  * Empty the frames a shrinking resize() no longer hands out.
+  *
+  * @param from   First frame to empty
+  * @param to     One past the last frame to empty
+  */
+void BufMgr::drainFrames(const FrameId from, const FrameId to)
+{
+  for (FrameId frame = from; frame < to; frame++) {
+    BufDesc& desc = bufDescTable[frame];
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> latch(desc.latch);
+        // also covers frames reserved by allocBuf() before the shrink
+        if (desc.freeze()) {
+          if (desc.valid) {
+            try {
+              evictFrame(frame);
+            } catch (...) {
+              desc.thaw();
+              throw;
+            }
+          } else {
+            desc.thaw();
+          }
+          if (desc.mapped) {
+            viewFrame(frame, frameArena + (std::size_t) frame * Page::SIZE);
+          }
+          break;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    replacer->removed(frame);
+  }
+}
 
+/**
+  * Changes the number of frames of the pool while it is in use.
+  *
+  * @param bufs   New number of frames
+  */
+void BufMgr::resize(const std::uint32_t bufs)
+{
+  if (bufs == 0 || bufs > maxBufs) {
+    throw BufferExceededException();
+  }
+  std::lock_guard<std::mutex> resizing(resizeLatch);
+  const std::uint32_t old = numBufs.load();
+  if (bufs > old) {
+    for (FrameId next = old; next < bufs;) {
+      const FrameId end = std::min(bufs, next + RESIZE_CHUNK);
+      const std::size_t bytes = (std::size_t) (end - next) * Page::SIZE;
+      char* const chunk = frameArena + (std::size_t) next * Page::SIZE;
+      if (numaNode >= 0) {
+        placeOnNode(chunk, bytes, numaNode);
+      }
+      // the page table makes room before the first page can arrive
+      hashTable->reserve(end);
+      replacer->resize(end);
+      numBufs.store(end);
+      next = end;
+    }
+  } else if (bufs < old) {
+    // no frame above the new size is claimed from here on
+    numBufs.store(bufs);
+    replacer->resize(bufs);
+    try {
+      drainFrames(bufs, old);
+    } catch (...) {
+      // back to the old size, so that no frame is left holding a page above
+      // it; those already emptied are simply free again
+      replacer->resize(old);
+      numBufs.store(old);
+      throw;
+    }
+#ifdef MADV_DONTNEED
+    madvise(frameArena + (std::size_t) bufs * Page::SIZE,
+            (std::size_t) (old - bufs) * Page::SIZE, MADV_DONTNEED);
+#endif
+  }
+  dirtyHigh = (std::uint32_t) (dirtyHighWatermark * bufs);
+  dirtyLow = (std::uint32_t) (dirtyLowWatermark * bufs);
+}
 
 /**
   * Print member variable values. 
@@ -336,6 +2968,7 @@ void BufMgr::printSelf(void)
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	tmpbuf = &(bufDescTable[i]);
+  	std::lock_guard<std::mutex> latch(tmpbuf->latch);
 		std::cout << "FrameNo:" << i << " ";
 		tmpbuf->Print();
 
@@ -344,7 +2977,6 @@ void BufMgr::printSelf(void)
   }
 
 	std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
-  std:: cout << "Clock hand: " << clockHand <<"\n";
 }
 
 }
@@ -11,207 +11,1613 @@
 */
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "file.h"
-#include "bufHashTbl.h"
+#include "freeSpaceMap.h"
+#include "logManager.h"
+#include "metrics.h"
+#include "pageGuard.h"
+#include "pageTable.h"
+#include "replacementPolicy.h"
+#include "residentList.h"
+#include "ssdCache.h"
+#include "traceRecorder.h"
+
+namespace badgerdb {
+
+/**
+* forward declaration of BufMgr class
+*/
+class BufMgr;
+class PageRead;
+
+/**
+* @brief Class for maintaining information about buffer pool frames
+*
+* Every field of a descriptor is protected by its latch.  A frame with a
+* non-zero pin count is never chosen as a victim, so holding a pin is enough to
+* keep the frame's contents in place once the latch has been released.
+*
+* The pin count and reference bit live in one atomic state word, together
+* with copies of the valid and dirty bits republished under the latch after
+* each change and a version bumped whenever the frame changes page.  The
+* victim sweep reads the word without the latch to pass over pinned frames in
+* a single load, and only latches a frame it may evict.  A readPage() hit pins
+* the frame without the latch, by a compare-and-swap of the word that fails if
+* the version moved, see pinOptimistic(); the latch holder freezes the word
+* before taking an unpinned page out of the frame, so that no such pin slips
+* in meanwhile.
+*/
+class BufDesc {
+
+	friend class BufMgr;
+
+ private:
+	/**
+   * Marks the end of a list of frames
+	 */
+  static const FrameId NO_FRAME = UINT32_MAX;
+
+	/**
+   * Shared handle on the file to which corresponding frame is assigned, see
+   * File::shared(); it outlives the File object the page was read through
+	 */
+  std::shared_ptr<File> file;
+
+	/**
+   * Identifier of that file, see File::id()
+	 */
+  FileId fileId;
+
+	/**
+   * Partition the page is counted in, see BufMgr::setPartition(); set with
+   * the page by BufMgr::setFrame()
+	 */
+  std::uint32_t partition;
+
+	/**
+   * Next and previous frame holding a page of the same file; valid frames
+   * are linked into their file's list, protected by BufMgr::fileFramesLatch
+	 */
+  FrameId fileNext;
+  FrameId filePrev;
+
+	/**
+   * Page within file to which corresponding frame is assigned
+	 */
+  PageId pageNo;
+
+	/**
+   * Frame number of the frame, in the buffer pool, being used
+	 */
+  FrameId	frameNo;
+
+	/**
+   * True if page is dirty;  false otherwise
+	 */
+  bool dirty;
+
+	/**
+   * True if page is valid
+	 */
+  bool valid;
+
+	/**
+   * True if the page was read ahead and has not been pinned since.  Such a
+   * frame has no reference bit, and the replacement policy treats it as cold.
+	 */
+  bool prefetched;
+
+	/**
+   * True if the frame's Page in bufPool is a view into the mapping of a
+   * mapped file rather than over the frame's own bytes.  Kept by Clear() and
+   * Set(); only BufMgr::viewFrame() changes it.
+	 */
+  bool mapped;
+
+	/**
+   * True while a page is being read into the frame.  The frame is valid, in
+   * the page table and pinned by its reader from before the read is issued,
+   * so that others asking for the page wait for that read, on <loaded> or
+   * in <waiters>, instead of reading it into a frame of their own.
+	 */
+  bool loading;
+
+	/**
+   * Signalled, with the latch held, when <loading> is cleared
+	 */
+  std::condition_variable loaded;
+
+	/**
+   * Called, without the latch, when <loading> is cleared; see
+   * BufMgr::awaitLoad()
+	 */
+  std::vector<std::function<void()> > waiters;
+
+	/**
+   * True while the latch holder is taking the unpinned page out of the frame:
+   * the state word refuses optimistic pins.  Set by freeze().
+	 */
+  bool frozen;
+
+	/**
+   * In copy-on-write mode, the frame holding the private copy of this
+   * frame's page a writer is changing, NO_FRAME if none; see
+   * BufMgr::readPageForUpdate()
+	 */
+  FrameId copyFrame;
+
+	/**
+   * For a private copy, the frame holding the version it was copied from;
+   * NO_FRAME for any other frame
+	 */
+  FrameId versionOf;
+
+	/**
+   * True once a newer version of the page was installed in the page table in
+   * place of this frame: the frame refuses new pins and is emptied when the
+   * last reader still on it unpins it
+	 */
+  bool retired;
+
+	/**
+   * True while the frame holds the version installCopy() put in it, so that
+   * nobody changes it in place: checkpoint() and flushFile() write it even
+   * while it is pinned.  Cleared when the page is unpinned dirty.
+	 */
+  bool installed;
+
+	/**
+   * Number of readPage() hits on the page since it was Set() or the
+   * statistics were cleared.  Atomic so that optimistic pins and
+   * getBufStats() change and read it without the latch.
+	 */
+  std::atomic<std::uint64_t> hits;
+
+	/**
+   * Bits of the state word: the pin count in the low bits, then the flags,
+   * then the version in the high half.  STATE_SLOW refuses optimistic pins:
+   * the frame is not valid, or is loading, read ahead, frozen or retired.
+	 */
+  static const std::uint64_t STATE_PINS = (1u << 28) - 1;
+  static const std::uint64_t STATE_REF = 1u << 28;
+  static const std::uint64_t STATE_DIRTY = 1u << 29;
+  static const std::uint64_t STATE_VALID = 1u << 30;
+  static const std::uint64_t STATE_SLOW = 1u << 31;
+  static const std::uint64_t STATE_VERSION = std::uint64_t(1) << 32;
+
+	/**
+   * The pin count and reference bit, which this word holds alone, and
+   * valid, dirty and whether optimistic pins are refused as of the last
+   * publish().
+	 */
+  std::atomic<std::uint64_t> state;
+
+	/**
+   * File identifier and page of the frame as of its last Set(), for
+   * optimistic pins to check before the version confirms them
+	 */
+  std::atomic<FileId> tagFile;
+  std::atomic<PageId> tagPage;
+
+	/**
+   * Latch protecting the descriptor fields of this frame
+	 */
+  std::mutex latch;
+
+	/**
+   * Refresh the flags of the state word from the fields, keeping the pins
+   * and reference bit; called with the latch held after any of them
+   * changed.
+   *
+   * @param moved  True if the frame changed page, which bumps the version.
+   *               Optimistic pins are then refused until the next publish(),
+   *               made once the page is in the page table.
+	 */
+  void publish(const bool moved = false)
+	{
+    std::uint64_t flags = 0;
+    if (valid) flags |= STATE_VALID;
+    if (dirty) flags |= STATE_DIRTY;
+    if (!valid || loading || prefetched || frozen || retired || moved) flags |= STATE_SLOW;
+    std::uint64_t word = state.load(std::memory_order_relaxed);
+    std::uint64_t next;
+    do {
+      next = (word & (STATE_PINS | STATE_REF | ~(STATE_VERSION - 1))) | flags;
+      if (moved) next += STATE_VERSION;
+    } while (!state.compare_exchange_weak(word, next, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+  }
+
+	/**
+   * @return  Number of pins
+	 */
+  int pins() const
+	{
+    return static_cast<int>(state.load(std::memory_order_acquire) & STATE_PINS);
+  }
+
+	/**
+   * Add pins; called with the latch held.
+	 */
+  void addPins(const int count)
+	{
+    state.fetch_add(static_cast<std::uint64_t>(count), std::memory_order_acq_rel);
+  }
+
+	/**
+   * Remove pins, of which there are at least <count>; called with the latch
+   * held.
+	 */
+  void dropPins(const int count)
+	{
+    state.fetch_sub(static_cast<std::uint64_t>(count), std::memory_order_acq_rel);
+  }
+
+	/**
+   * Set the pin count of a frame nobody else can pin; called with the latch
+   * held.
+	 */
+  void setPins(const int count)
+	{
+    std::uint64_t word = state.load(std::memory_order_relaxed);
+    while (!state.compare_exchange_weak(word, (word & ~STATE_PINS) | static_cast<std::uint64_t>(count),
+                                        std::memory_order_acq_rel, std::memory_order_relaxed)) {
+    }
+  }
+
+	/**
+   * @return  Whether the frame has been referenced recently
+	 */
+  bool refbit() const
+	{
+    return (state.load(std::memory_order_acquire) & STATE_REF) != 0;
+  }
+
+	/**
+   * Set or clear the reference bit.
+	 */
+  void setRefbit(const bool ref)
+	{
+    if (ref) {
+      state.fetch_or(STATE_REF, std::memory_order_acq_rel);
+    } else {
+      state.fetch_and(~STATE_REF, std::memory_order_acq_rel);
+    }
+  }
+
+	/**
+   * Refuse optimistic pins from here on if the frame has no pins, so that the
+   * latch holder may take its page out.  Called with the latch held; Clear()
+   * or thaw() lifts it.
+   *
+   * @return  False, changing nothing, if the frame is pinned
+	 */
+  bool freeze()
+	{
+    std::uint64_t word = state.load(std::memory_order_relaxed);
+    do {
+      if ((word & STATE_PINS) != 0) {
+        return false;
+      }
+    } while (!state.compare_exchange_weak(word, word | STATE_SLOW, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+    frozen = true;
+    return true;
+  }
+
+	/**
+   * Lifts a freeze() that did not lead to the page leaving the frame.
+	 */
+  void thaw()
+	{
+    frozen = false;
+    publish();
+  }
+
+	/**
+   * Pin the frame without the latch if it holds a page in the plain state:
+   * valid, fully read, not read ahead and not frozen.  The version read with
+   * the tag must still be there when the pin is added, so a frame evicted
+   * and reused meanwhile is never pinned.
+   *
+   * @param id       Identifier of the page's file
+   * @param pageNum  Page number in the file
+   * @param count    Number of pins to add
+   * @return  False if the frame does not hold the page or is not in the plain
+   *          state; nothing is changed then
+	 */
+  bool pinOptimistic(const FileId id, const PageId pageNum, const int count)
+	{
+    std::uint64_t word = state.load(std::memory_order_acquire);
+    for (;;) {
+      if ((word & (STATE_VALID | STATE_SLOW)) != STATE_VALID ||
+          tagFile.load(std::memory_order_relaxed) != id ||
+          tagPage.load(std::memory_order_relaxed) != pageNum) {
+        return false;
+      }
+      if (state.compare_exchange_weak(word, (word | STATE_REF) + static_cast<std::uint64_t>(count),
+                                      std::memory_order_acq_rel, std::memory_order_acquire)) {
+        hits.fetch_add(count, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+
+	/**
+   * Initialize buffer frame for a new user
+	 */
+  void Clear()
+	{
+		file.reset();
+    fileId = 0;
+		pageNo = Page::INVALID_NUMBER;
+    dirty = false;
+		valid = false;
+    prefetched = false;
+    loading = false;
+    frozen = false;
+    copyFrame = NO_FRAME;
+    versionOf = NO_FRAME;
+    retired = false;
+    installed = false;
+    state.fetch_and(~(STATE_PINS | STATE_REF), std::memory_order_acq_rel);
+    publish(true);
+  };
+
+	/**
+	 * Set values of member variables corresponding to assignment of frame to a page in the file. Called when a frame
+	 * in buffer pool is allocated to any page in the file through readPage() or allocPage()
+	 *
+	 * @param filePtr	File object
+	 * @param pageNum	Page number in the file
+	 */
+  void Set(File* filePtr, PageId pageNum)
+	{
+		file = filePtr->shared();
+    fileId = filePtr->id();
+    pageNo = pageNum;
+    dirty = false;
+    valid = true;
+    prefetched = false;
+    loading = false;
+    frozen = false;
+    copyFrame = NO_FRAME;
+    versionOf = NO_FRAME;
+    retired = false;
+    installed = false;
+    tagFile.store(fileId, std::memory_order_relaxed);
+    tagPage.store(pageNum, std::memory_order_relaxed);
+    setPins(1);
+    setRefbit(true);
+    publish(true);
+  }
+
+	/**
+   * Give the page of a frozen frame the number it was moved to in its file,
+   * keeping its contents and state.  Optimistic pins are refused until the
+   * next publish(), made once the new number is in the page table.
+   *
+   * @param pageNum	New page number
+	 */
+  void Renumber(PageId pageNum)
+	{
+    pageNo = pageNum;
+    frozen = false;
+    tagPage.store(pageNum, std::memory_order_relaxed);
+    publish(true);
+  }
+
+  void Print()
+	{
+		if(file)
+		{
+			std::cout << "file:" << file->filename() << " ";
+			std::cout << "pageNo:" << pageNo << " ";
+		}
+		else
+			std::cout << "file:NULL ";
+
+		std::cout << "valid:" << valid << " ";
+		std::cout << "pinCnt:" << pins() << " ";
+		std::cout << "dirty:" << dirty << " ";
+		std::cout << "refbit:" << refbit() << "\n";
+  }
+
+	/**
+   * Constructor of BufDesc class
+	 */
+  BufDesc()
+    : partition(0), fileNext(NO_FRAME), filePrev(NO_FRAME), mapped(false), hits(0), state(0),
+      tagFile(0), tagPage(Page::INVALID_NUMBER)
+	{
+  	Clear();
+  }
+};
+
+
+/**
+* @brief Buffer pool usage of one file, see BufStats::files
+*/
+struct FileStats
+{
+	/**
+   * Number of readPage() calls that found the page in the pool
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Number of pages read from disk, including read ahead
+	 */
+  std::uint64_t reads;
+
+	/**
+   * Number of pages written back to disk
+	 */
+  std::uint64_t writes;
+
+  FileStats() : hits(0), reads(0), writes(0) {}
+};
+
+
+/**
+* @brief Buffer pool usage of one partition, see BufStats::partitions and
+* BufMgr::setPartition()
+*/
+struct PartitionStats
+{
+	/**
+   * Number of frames holding pages of the partition's files
+	 */
+  std::uint64_t frames;
+
+	/**
+   * Frames reserved for the partition, and the most it replaces others' pages
+   * to take
+	 */
+  std::uint64_t minFrames;
+  std::uint64_t maxFrames;
+
+	/**
+   * Hits, reads and writes of the partition's files, as in FileStats
+	 */
+  std::uint64_t hits;
+  std::uint64_t reads;
+  std::uint64_t writes;
+
+  PartitionStats() : frames(0), minFrames(0), maxFrames(0), hits(0), reads(0), writes(0) {}
+};
+
+
+/**
+* @brief What BufMgr::defragment() moved, each as (old, new)
+*/
+struct DefragResult
+{
+	/**
+   * Pages given lower numbers, in the order moved
+	 */
+  std::vector<std::pair<PageId, PageId> > pages;
+
+	/**
+   * Records moved off pages that were emptied, with their final IDs
+	 */
+  std::vector<std::pair<RecordId, RecordId> > records;
+
+	/**
+   * Pages the file had before and after, as File::numPages()
+	 */
+  PageId pagesBefore;
+  PageId pagesAfter;
+
+  DefragResult() : pagesBefore(0), pagesAfter(0) {}
+};
+
+
+/**
+* @brief Snapshot of the statistics of buffer usage, see BufMgr::getBufStats()
+*/
+struct BufStats
+{
+	/**
+   * Total number of page requests: readPage() and allocPage() calls
+	 */
+  std::uint64_t accesses;
+
+	/**
+   * Number of readPage() calls that found the page in the pool
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Number of readPage() calls that had to read the page
+	 */
+  std::uint64_t misses;
+
+	/**
+   * Number of pages read from disk (including allocs)
+	 */
+  std::uint64_t diskreads;
+
+	/**
+   * Number of pages written back to disk
+	 */
+  std::uint64_t diskwrites;
+
+	/**
+   * Number of pages read ahead by prefetch(), also counted in diskreads
+	 */
+  std::uint64_t prefetches;
+
+	/**
+   * Number of pages written back by the background writer, also counted in
+   * diskwrites
+	 */
+  std::uint64_t backgroundwrites;
+
+	/**
+   * Number of pages evicted to make room for another
+	 */
+  std::uint64_t evictions;
+
+	/**
+   * Number of evicted pages that were dirty and written back first, also
+   * counted in diskwrites
+	 */
+  std::uint64_t dirtyevictions;
+
+	/**
+   * Number of searches for a victim frame
+	 */
+  std::uint64_t victimsearches;
+
+	/**
+   * Number of frames the replacement policy offered during those searches;
+   * divided by victimsearches this is the mean clock sweep length
+	 */
+  std::uint64_t sweepsteps;
+
+	/**
+   * Number of times readPage() had to wait for a frame's latch to pin a page
+	 */
+  std::uint64_t pinwaits;
+
+	/**
+   * Number of readPage() calls that found their page being read by another
+   * and waited for that read instead of reading it again; also counted as
+   * hits
+	 */
+  std::uint64_t sharedreads;
+
+	/**
+   * Number of private copies of pages readPageForUpdate() made for writers
+   * in copy-on-write mode, see BufMgrOptions::copyOnWrite
+	 */
+  std::uint64_t pagecopies;
+
+	/**
+   * Counters of the second-tier cache, see BufMgrOptions::ssdCacheFile; zero
+   * without one.  ssd.hits are also counted in misses but not in diskreads.
+	 */
+  SsdCacheStats ssd;
+
+	/**
+   * Time readPage() took to serve each miss, from lookup to pinned frame
+	 */
+  LatencySnapshot misslatency;
+
+	/**
+   * Usage of every file with pages in the pool since the statistics were
+   * cleared, by file name
+	 */
+  std::map<std::string, FileStats> files;
+
+	/**
+   * Usage of every partition, the default one included, by partition name
+	 */
+  std::map<std::string, PartitionStats> partitions;
+
+	/**
+   * Returns the fraction of readPage() calls that were hits; zero if there
+   * were none.
+	 */
+  double hitRatio() const
+  {
+    return hits + misses == 0 ? 0.0 : double(hits) / double(hits + misses);
+  }
+
+	/**
+   * Adds the statistics of another pool to these, e.g. to total those of
+   * the instances of a BufPoolSet.
+   *
+   * @param other  Statistics to add
+	 */
+  void merge(const BufStats& other);
+
+	/**
+   * Constructor of BufStats class
+	 */
+  BufStats()
+    : accesses(0), hits(0), misses(0), diskreads(0), diskwrites(0),
+      prefetches(0), backgroundwrites(0), evictions(0), dirtyevictions(0),
+      victimsearches(0), sweepsteps(0), pinwaits(0), sharedreads(0), pagecopies(0), ssd()
+  {
+  }
+};
+
+
+/**
+* @brief Live counters behind BufStats
+*
+* Counters bumped on the hit path are sharded so that threads hitting in the
+* pool do not contend on them; see ShardedCounter.
+*/
+struct BufCounters
+{
+  ShardedCounter accesses;
+  ShardedCounter hits;
+  ShardedCounter misses;
+  ShardedCounter diskreads;
+  ShardedCounter diskwrites;
+  ShardedCounter prefetches;
+  ShardedCounter backgroundwrites;
+  ShardedCounter evictions;
+  ShardedCounter dirtyevictions;
+  ShardedCounter victimsearches;
+  ShardedCounter sweepsteps;
+  ShardedCounter pinwaits;
+  ShardedCounter sharedreads;
+  ShardedCounter pagecopies;
+  LatencyHistogram misslatency;
+
+	/**
+   * Clear all values
+	 */
+  void clear()
+  {
+    accesses.clear();
+    hits.clear();
+    misses.clear();
+    diskreads.clear();
+    diskwrites.clear();
+    prefetches.clear();
+    backgroundwrites.clear();
+    evictions.clear();
+    dirtyevictions.clear();
+    victimsearches.clear();
+    sweepsteps.clear();
+    pinwaits.clear();
+    sharedreads.clear();
+    pagecopies.clear();
+    misslatency.clear();
+  }
+};
+
+
+/**
+* @brief Kinds of page table a BufMgr can be built with
+*/
+enum class PageTableType {
+	/**
+   * BufHashTbl: buckets of separately allocated chain nodes
+	 */
+  CHAINED,
+
+	/**
+   * OpenHashTbl: flat linear probing table with no per-entry allocation,
+   * whose lookups take no latch unless they race a removal
+	 */
+  OPEN_ADDRESSING
+};
+
+
+/**
+* @brief Replacement policies a BufMgr can be built with
+*/
+enum class ReplacementType {
+	/**
+   * ClockPolicy: one reference bit per frame, lock free
+	 */
+  CLOCK,
+
+	/**
+   * LruKPolicy: oldest K-th most recent reference first
+	 */
+  LRU_K,
+
+	/**
+   * TwoQPolicy: FIFO for new pages, LRU for pages seen again
+	 */
+  TWO_Q,
+
+	/**
+   * ArcPolicy: adaptive split between recency and frequency
+	 */
+  ARC
+};
+
+
+/**
+* @brief Construction-time options of a BufMgr
+*/
+struct BufMgrOptions
+{
+	/**
+   * Implementation of the (File, page) to frame table
+	 */
+  PageTableType pageTable = PageTableType::CHAINED;
+
+	/**
+   * Replacement policy.  The LRU variants resist large scans better than the
+   * clock but serialize replacement decisions through one latch.
+	 */
+  ReplacementType replacement = ReplacementType::CLOCK;
+
+	/**
+   * Number of references remembered per page by LRU_K
+	 */
+  unsigned lruK = 2;
+
+	/**
+   * Back the frame arena with huge pages where the platform supports it.
+   * Falls back to normal pages if no huge pages are available.
+	 */
+  bool hugePages = false;
+
+	/**
+   * NUMA node to place the frame arena on, or -1 to leave the frames where
+   * the threads first touching them run.  The arena is faulted in on the
+   * node when the pool is constructed.
+	 */
+  int numaNode = -1;
+
+	/**
+   * Largest number of frames resize() can grow the pool to, or 0 for the
+   * number it is constructed with.  Address space for these frames is
+   * reserved up front, along with their descriptors; memory for the bytes of
+   * a frame is only committed once the frame is in use.
+	 */
+  std::uint32_t maxBufs = 0;
+
+	/**
+   * Maximum number of asynchronous page writes and reads in flight.  Zero
+   * keeps all I/O synchronous; otherwise the pool owns an IoEngine and
+   * submits batches to it, e.g. when flushing a file.
+	 */
+  unsigned ioQueueDepth = 0;
+
+	/**
+   * Number of pages to read ahead once readPage() sees a file being read in
+   * consecutive page order.  Zero disables automatic read-ahead; prefetch()
+   * can still be called explicitly.
+	 */
+  std::uint32_t readAheadPages = 0;
+
+	/**
+   * Run a background writer thread that writes back dirty, unpinned frames
+   * that are next in line for eviction, so that eviction mostly finds clean
+   * victims
+	 */
+  bool backgroundWriter = false;
+
+	/**
+   * Fraction of frames that may be dirty before the background writer starts
+   * a round of write-back
+	 */
+  double dirtyHighWatermark = 0.5;
+
+	/**
+   * Fraction of frames dirty at which the background writer stops writing
+	 */
+  double dirtyLowWatermark = 0.25;
+
+	/**
+   * Maximum number of frames the background writer writes in one batch
+	 */
+  unsigned writerBatchPages = 32;
+
+	/**
+   * Interval in milliseconds at which the background writer checks the dirty
+   * ratio when nothing wakes it
+	 */
+  unsigned writerIntervalMs = 100;
+
+	/**
+   * Name of the write-ahead log, or empty for none.  With a log, every page
+   * unpinned dirty is logged, no dirty page is written before its log record
+   * is durable, and the log is replayed when the pool is constructed.
+	 */
+  std::string logFile;
+
+	/**
+   * Name of a file to trace readPage(), allocPage(), unPinPage() and
+   * disposePage() calls to, or empty for no tracing; see TraceRecorder.  An
+   * existing file of that name is replaced.
+	 */
+  std::string traceFile;
+
+	/**
+   * Number of the most recent calls the trace file keeps
+	 */
+  std::uint64_t traceRecords = 1 << 20;
+
+	/**
+   * Name of a file to list the pool's pages in, or empty for none; see
+   * BufMgr::dumpResident() and BufMgr::warmUp().  The list is written every
+   * warmDumpIntervalMs and when the pool is destroyed.
+	 */
+  std::string warmFile;
+
+	/**
+   * Interval in milliseconds at which the page list is written, or zero to
+   * write it only when the pool is destroyed or dumpResident() is called
+	 */
+  unsigned warmDumpIntervalMs = 60000;
+
+	/**
+   * Name of a file, best on a fast local device, to keep pages evicted from
+   * the pool in, or empty for none; see SsdCache.  readPage() looks there
+   * before reading a page from its file.  The file is replaced, and removed
+   * when the pool is destroyed.
+	 */
+  std::string ssdCacheFile;
+
+	/**
+   * Number of pages the second-tier cache holds
+	 */
+  std::uint32_t ssdCachePages = 0;
+
+	/**
+   * Give each writer a private copy of the page it changes, see
+   * readPageForUpdate(), so that readers never wait for writers nor writers
+   * for readers.  checkpoint() and flushFile() then write pinned versions
+   * installed from such copies too, as nobody changes those; a page changed
+   * in place, as allocPage() gives it or as unpinned dirty, is still only
+   * written once it is unpinned.  Pins must be given
+   * back by frame, with a PageGuard or unPinPages() of Page pointers, since
+   * a page number may name a newer version than the one pinned.
+	 */
+  bool copyOnWrite = false;
+};
+
+
+/**
+* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file
+*
+* All public methods may be called concurrently.  There is no pool-wide lock:
+* the page table is partitioned into independently latched shards, each frame
+* is protected by the latch in its BufDesc, and the replacement policy does its
+* own synchronization (the default clock advances its hand atomically).
+* Latches are always acquired in the order policy, frame (the current version
+* of a page before a writer's private copy of it), page table shard, file,
+* and the policy only ever try-locks frames, so a dirty victim is written
+* back while holding no other latch of the pool than its own frame latch and
+* that of the policy, if it has one.
+*
+* With a write-ahead log (BufMgrOptions::logFile), unPinPage() with the dirty
+* flag set logs an image of the page; the image becomes durable with
+* flushLog() or when the page is written back, whichever comes first.
+*/
+class BufMgr
+{
+  friend class PageGuard;
+  friend class BufPoolSet;
+  friend class PageRead;
+
+ private:
+	/**
+   * Number of frames in the buffer pool
+	 */
+  std::atomic<std::uint32_t> numBufs;
+
+	/**
+   * Number of frames reserved for the pool to grow to, see
+   * BufMgrOptions::maxBufs
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * Number of frames resize() adds before publishing them
+	 */
+  static const std::uint32_t RESIZE_CHUNK = 1024;
+
+	/**
+   * Serializes resize() calls
+	 */
+  std::mutex resizeLatch;
+
+	/**
+   * Node the frame arena is placed on, -1 for none
+	 */
+  int numaNode;
+
+	/**
+   * Hash table mapping (File, page) to frame
+	 */
+  PageTable *hashTable;
+
+	/**
+   * Policy choosing the victim frame when a frame is needed
+	 */
+  ReplacementPolicy *replacer;
+
+	/**
+   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+	 */
+  BufDesc *bufDescTable;
+
+	/**
+   * Maintains Buffer pool usage statistics
+	 */
+  BufCounters bufStats;
+
+	/**
+   * One contiguous, page-aligned region holding the bytes of every frame;
+   * frame i occupies Page::SIZE bytes at offset i * Page::SIZE.
+	 */
+  char* frameArena;
+
+	/**
+   * Size of frameArena in bytes, as mapped
+	 */
+  std::size_t arenaBytes;
+
+	/**
+   * Engine for batched asynchronous I/O, or NULL if all I/O is synchronous
+	 */
+  IoEngine* ioEngine;
+
+	/**
+   * @brief Sequential access detector state of one file
+	 */
+  struct ReadAhead {
+    /**
+     * Page most recently read from disk or from a prefetched frame
+     */
+    PageId last = Page::INVALID_NUMBER;
+
+    /**
+     * First page not yet requested by read-ahead
+     */
+    PageId next = Page::INVALID_NUMBER;
+  };
+
+	/**
+   * Whether writers get private copies of pages, see
+   * BufMgrOptions::copyOnWrite
+	 */
+  bool copyOnWrite;
+
+	/**
+   * Pages to read ahead on a sequential pattern; zero if disabled
+	 */
+  std::uint32_t readAheadPages;
+
+	/**
+   * Read-ahead state per file identifier, protected by readAheadLatch
+	 */
+  std::map<FileId, ReadAhead> readAhead;
+
+	/**
+   * Latch protecting readAhead
+	 */
+  std::mutex readAheadLatch;
+
+	/**
+   * Number of frames with the dirty bit set
+	 */
+  std::atomic<std::uint32_t> dirtyFrames;
+
+	/**
+   * Dirty frame counts at which the background writer starts and stops
+	 */
+  std::atomic<std::uint32_t> dirtyHigh;
+  std::atomic<std::uint32_t> dirtyLow;
+
+	/**
+   * Fractions of the frames dirtyHigh and dirtyLow are, as the pool resizes
+	 */
+  double dirtyHighWatermark;
+  double dirtyLowWatermark;
+
+	/**
+   * Maximum frames per background write-back batch
+	 */
+  std::uint32_t writerBatchPages;
+
+	/**
+   * Milliseconds between dirty ratio checks of the background writer
+	 */
+  unsigned writerIntervalMs;
+
+	/**
+   * The background writer thread; not joinable if there is none
+	 */
+  std::thread bgWriter;
+
+	/**
+   * First frame of the list of frames holding pages of each file, see
+   * BufDesc::fileNext; protected by fileFramesLatch
+	 */
+  std::map<FileId, FrameId> fileFrames;
+
+	/**
+   * Latch protecting fileFrames and the frame lists.  Taken after frame
+   * latches.
+	 */
+  std::mutex fileFramesLatch;
+
+	/**
+   * @brief Usage counted for one file, see BufStats::files
+	 */
+  struct FileUsage {
+    std::string filename;
+    FileStats stats;
+    std::uint32_t partition = 0;
+  };
+
+	/**
+   * @brief A partition of the pool, see setPartition().  The bounds and count
+   * are read without a latch by claimFrame(); the name is protected by
+   * fileFramesLatch.
+	 */
+  struct Partition {
+    std::string name;
+    std::atomic<std::uint32_t> minFrames;
+    std::atomic<std::uint32_t> maxFrames;
+    std::atomic<std::uint32_t> frames;
+  };
+
+	/**
+   * Most partitions of a pool, the default one included
+	 */
+  static const std::uint32_t MAX_PARTITIONS = 16;
+
+	/**
+   * The partitions; the first numPartitions are in use, and the first of all
+   * is the default one, with no bounds, holding the files not assigned to
+   * another
+	 */
+  Partition partitions[MAX_PARTITIONS];
+  std::atomic<std::uint32_t> numPartitions;
+
+	/**
+   * Partition of each file assigned one, by file name.  Protected by
+   * fileFramesLatch.
+	 */
+  std::map<std::string, std::uint32_t> filePartitions;
+
+	/**
+   * Usage of every file that had pages in the pool since the statistics were
+   * cleared.  Hits of resident frames are still in BufDesc::hits.  Protected
+   * by fileFramesLatch.
+	 */
+  std::map<FileId, FileUsage> fileUsage;
+
+	/**
+   * Held by the background writer for the duration of a batch.  flushFile()
+   * and disposePage() take it so they never see the writer's pins.
+	 */
+  std::mutex writerLatch;
+
+	/**
+   * Wakes the background writer; writerStop asks it to exit
+	 */
+  std::mutex writerWakeLatch;
+  std::condition_variable writerWake;
+  bool writerStop;
+
+	/**
+   * Page list file, see BufMgrOptions::warmFile
+	 */
+  std::string warmFile;
+
+	/**
+   * Milliseconds between writes of the page list, zero for none
+	 */
+  unsigned warmDumpIntervalMs;
+
+	/**
+   * Thread writing the page list periodically, and how it is stopped
+	 */
+  std::thread warmDumper;
+  std::mutex warmDumpLatch;
+  std::condition_variable warmDumpWake;
+  bool warmDumpStop;
+
+	/**
+   * Pages flushFile() dropped, by file name, with their reference bits, so
+   * that the list written at shutdown still has the pages of files flushed
+   * before it
+	 */
+  std::map<std::string, std::vector<std::pair<PageId, bool> > > retired;
+
+	/**
+   * Latch protecting retired
+	 */
+  std::mutex retiredLatch;
+
+	/**
+   * Thread running warmUp(), and the number of pages it has loaded
+	 */
+  std::thread warmer;
+  std::atomic<std::uint64_t> warmed;
+
+	/**
+   * Files warmUp() is still loading; flushFile() takes its file out.  The
+   * warm-up thread holds the latch while it loads a run of pages.
+	 */
+  std::set<FileId> warming;
+  std::mutex warmingLatch;
+
+	/**
+   * Set to make the warm-up thread stop early
+	 */
+  std::atomic<bool> warmStop;
+
+	/**
+   * Largest number of consecutive pages warmUp() reads at once
+	 */
+  static const std::uint32_t WARM_RUN_PAGES = 64;
+
+	/**
+   * @brief Free-space map of one file and the latch serializing record
+   * placement in that file
+	 */
+  struct FreeSpace {
+    explicit FreeSpace(const std::string& filename) : map(filename) {}
+
+    FreeSpaceMap map;
+    std::mutex latch;
+  };
+
+	/**
+   * Free-space maps, by file identifier, of the files records were placed in
+   * through insertRecord() or deleteRecord(), protected by freeSpaceLatch
+	 */
+  std::map<FileId, FreeSpace*> freeSpace;
+
+	/**
+   * Latch protecting freeSpace
+	 */
+  std::mutex freeSpaceLatch;
+
+	/**
+	 * Return the free-space map of a file, opening it on first use.
+	 *
+	 * @param file   	File object
+	 * @return  The file's map and placement latch
+	 */
+  FreeSpace* freeSpaceOf(const File* file);
+
+	/**
+	 * Write back the dirty pages of a file, keeping them in the pool.  The
+	 * caller holds writerLatch.
+	 *
+	 * @param file   	File object
+	 * @return  The frames holding pages of the file, with their page numbers
+   * @throws  PagePinnedException If any page of the file is pinned; no page
+   *          is written then
+	 */
+  std::vector<std::pair<PageId, FrameId> > writeBackFile(const File* file);
+
+	/**
+   * Write-ahead log, or NULL if pages are written without logging
+	 */
+  LogManager* wal;
+
+	/**
+   * Recorder of the calls made to the pool, or NULL if they are not traced
+	 */
+  TraceRecorder* tracer;
+
+	/**
+   * Second tier of evicted pages, or NULL if there is none
+	 */
+  SsdCache* ssdCache;
+
+	/**
+	 * Enforce the write-ahead rule before a page is written back: make the log
+	 * durable up to the page's LSN.
+	 *
+	 * @param page  Page about to be written
+	 */
+  void forceLog(const Page& page);
+
+	/**
+	 * checkpoint(), for a caller already holding writerLatch.
+	 */
+  void checkpointLocked();
+
+	/**
+	 * Allocate a free frame.  The returned frame is cleared and reserved for the
+	 * caller by a pin count of one, so no other thread can pick it as a victim
+	 * before the caller either calls Set() on it or releases it with Clear().
+	 *
+	 * Once partitions are set up, a first sweep only takes victims the
+	 * partition quotas allow, see quotaAllows(); if none is found, a second
+	 * sweep takes any unpinned frame as before.
+	 *
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param file    	File whose page goes into the frame, deciding its partition
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  void allocBuf(FrameId & frame, const File* file = NULL);
 
-namespace badgerdb {
+	/**
+	 * Take a frame as victim for allocBuf(): write back and evict its page, if
+	 * any, and reserve the frame.  Called by the replacement policy.
+	 *
+	 * @param frame   	Frame offered by the replacement policy
+	 * @param secondChance  Refuse the frame, clearing its reference bit, if the bit is set
+	 * @param quota   	Partition the frame is for, to refuse frames its quota
+	 *                	does not allow; NULL to take any frame
+	 * @return  True if the frame is now empty and reserved for the caller
+	 */
+  bool claimFrame(const FrameId frame, const bool secondChance,
+                  const Partition* quota = NULL);
 
-/**
-* forward declaration of BufMgr class
-*/
-class BufMgr;
+	/**
+	 * Returns whether a partition may take a frame: a partition at its maximum
+	 * only replaces its own pages, and no partition takes a page from another
+	 * at or below its minimum.  The caller holds the frame's latch.
+	 *
+	 * @param desc    	The frame
+	 * @param quota   	Partition the frame is for
+	 */
+  bool quotaAllows(const BufDesc& desc, const Partition& quota) const;
 
-/**
-* @brief Class for maintaining information about buffer pool frames
-*/
-class BufDesc {
+	/**
+	 * Returns the partition of a file's pages.
+	 */
+  std::uint32_t partitionOf(const File* file);
 
-	friend class BufMgr;
+	/**
+	 * Return a frame reserved by allocBuf() to the pool without using it.
+	 *
+	 * @param frame   	Frame ID of the reserved frame
+	 */
+  void releaseBuf(const FrameId frame);
 
- private:
 	/**
-   * Pointer to file to which corresponding frame is assigned
+	 * Point the Page of a reserved frame at the given bytes: a page in the
+	 * mapping of a mapped file, or the frame's own bytes in the frame arena.
+	 *
+	 * @param frame   	Frame ID of the reserved frame
+	 * @param bytes   	Start of the Page::SIZE bytes the page lives in
 	 */
-  File* file;
+  void viewFrame(const FrameId frame, char* bytes);
 
 	/**
-   * Page within file to which corresponding frame is assigned
+	 * Set() a reserved frame to a page and link it into its file's list of
+	 * frames.  Caller holds the frame latch.
+	 *
+	 * @param frame   	Frame ID of the frame
+	 * @param file   	File object
+	 * @param pageNo   Page number in the file
+	 * @param read     True if the page was read from disk into the frame
 	 */
-  PageId pageNo;
+  void setFrame(const FrameId frame, File* file, const PageId pageNo,
+                const bool read);
 
 	/**
-   * Frame number of the frame, in the buffer pool, being used
+	 * Clear() a frame, unlinking it from its file's list of frames if it
+	 * holds a page.  Caller holds the frame latch.
+	 *
+	 * @param frame   	Frame ID of the frame
 	 */
-  FrameId	frameNo;
+  void clearFrame(const FrameId frame);
 
 	/**
-   * Number of times this page has been pinned
+   * @brief A distinct page requested from readPages()
 	 */
-  int pinCnt;
+  struct Wanted {
+    PageId pageNo;
+    int count;
+    FrameId frame;
+    // in the pool and pinned count times
+    bool pinned;
+    // published as loading, pinned count times, and not read yet
+    bool loading;
+    // another thread published the page first; frame went back to the pool
+    bool lost;
+  };
 
 	/**
-   * True if page is dirty;  false otherwise
+	 * Reads a page as readPage() does, without tracing the call.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param page  	Set to the page in its frame
 	 */
-  bool dirty;
+  void fetchPage(File* file, const PageId pageNo, Page*& page);
 
 	/**
-   * True if page is valid
+	 * Pin a page if it is in the buffer pool, as a readPage() hit: the hit is
+	 * counted and the replacement policy told.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   Set to the page's frame if it is in the pool
+	 * @param wait    Whether to wait for the page if it is being read; if not,
+	 *                such a page is not pinned
+	 * @return  True if the page was in the pool and is now pinned
 	 */
-  bool valid;
+  bool readHit(File* file, const PageId pageNo, FrameId& frame, const bool wait = true);
 
 	/**
-   * Has this buffer frame been reference recently
+	 * Set() a frame reserved by allocBuf() for a page and publish it in the
+	 * page table, pinned once.
+	 *
+	 * @param file     File object
+	 * @param pageNo   Page number of the frame
+	 * @param frame    The reserved frame
+	 * @param loading  True if the page is yet to be read into the frame; the
+	 *                 reader calls finishLoad() once it has been
+	 * @param prefetched  True to publish the page cold, as a read ahead
+	 * @return  False if the page was in the page table already; the frame has
+	 *          gone back to the pool then
 	 */
-  bool refbit;
+  bool publishFrame(File* file, const PageId pageNo, const FrameId frame,
+                    const bool loading, const bool prefetched);
 
 	/**
-   * Initialize buffer frame for a new user
+	 * End the read of a page into a frame published as loading, waking those
+	 * waiting for it.  The reader keeps its pin.  A frame whose read failed
+	 * leaves the page table and goes back to the pool, and its waiters look
+	 * the page up again.
+	 *
+	 * @param frame    The frame
+	 * @param loaded   True if the read succeeded
 	 */
-  void Clear()
-	{
-    pinCnt = 0;
-		file = NULL;
-		pageNo = Page::INVALID_NUMBER;
-    dirty = false;
-    refbit = false;
-		valid = false;
-  };
+  void finishLoad(const FrameId frame, const bool loaded);
 
 	/**
-	 * Set values of member variables corresponding to assignment of frame to a page in the file. Called when a frame
-	 * in buffer pool is allocated to any page in the file through readPage() or allocPage()
+	 * Arrange to be called back when a page being read into the pool has been
+	 * read, without waiting for it.
 	 *
-	 * @param filePtr	File object
-	 * @param pageNum	Page number in the file
+	 * @param file     File object
+	 * @param pageNo   Page number in the file
+	 * @param resume   Called once the read is over, successful or not, on the
+	 *                 thread that read it; it must not block
+	 * @return  False, without calling resume, if the page is not being read
 	 */
-  void Set(File* filePtr, PageId pageNum)
-	{
-		file = filePtr;
-    pageNo = pageNum;
-    pinCnt = 1;
-    dirty = false;
-    valid = true;
-    refbit = true;
-  }
+  bool awaitLoad(File* file, const PageId pageNo, std::function<void()> resume);
 
-  void Print()
-	{
-		if(file)
-		{
-			std::cout << "file:" << file->filename() << " ";
-			std::cout << "pageNo:" << pageNo << " ";
-		}
-		else
-			std::cout << "file:NULL ";
+	/**
+	 * Count a readPage() miss and how long it took.
+	 *
+	 * @param missed   When the miss was seen
+	 */
+  void countMiss(const std::chrono::steady_clock::time_point missed);
 
-		std::cout << "valid:" << valid << " ";
-		std::cout << "pinCnt:" << pinCnt << " ";
-		std::cout << "dirty:" << dirty << " ";
-		std::cout << "refbit:" << refbit << "\n";
-  }
+	/**
+	 * Pin a page if it is in the buffer pool, counting readPage() hits.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param count   Number of pins to add
+	 * @param frame   Set to the page's frame if it is in the pool
+	 * @param prefetched  Set to whether the page was read ahead and not pinned since
+	 * @param wait    Whether to wait for the page if it is being read; if not,
+	 *                such a page is not pinned
+	 * @return  True if the page was in the pool and is now pinned
+	 */
+  bool pinResident(File* file, const PageId pageNo, const int count,
+                   FrameId& frame, bool& prefetched, const bool wait = true);
 
 	/**
-   * Constructor of BufDesc class
+	 * Give back a writer's pin on its private copy of a page, see
+	 * readPageForUpdate().  A dirty copy replaces the version it was copied
+	 * from in the page table, and that version is retired; a clean one goes
+	 * back to the pool.
+	 *
+	 * @param file    File object
+	 * @param copy    Frame holding the copy
+	 * @param dirty   True if the copy was changed
+	 * @throws  PageNotPinnedException If the frame does not hold a pinned page
+	 *          of the file
+	 * @throws  IoException If logging the copy fails; it is dropped then
 	 */
-  BufDesc()
-	{
-  	Clear();
-  }
-};
+  void installCopy(File* file, const FrameId copy, const bool dirty);
 
+	/**
+	 * Whether flushFile() may write a pinned frame and leave it in the pool:
+	 * with copy-on-write, if the page is clean or a version installed from a
+	 * private copy, so that nobody changes it in place.  Caller holds the
+	 * frame latch.
+	 *
+	 * @param desc   Descriptor of the pinned frame
+	 * @return  True if the frame may be written while pinned
+	 */
+  bool stablePinned(const BufDesc& desc) const;
 
-/**
-* @brief Class to maintain statistics of buffer usage
-*/
-struct BufStats
-{
 	/**
-   * Total number of accesses to buffer pool
+	 * Empty a retired frame if nobody pins it any more.  Caller holds the
+	 * frame latch, and tells the replacement policy once it has let go.
+	 *
+	 * @param frame   Frame to empty
+	 * @return  True if the frame was emptied
 	 */
-  int accesses;
+  bool reclaimRetired(const FrameId frame);
 
 	/**
-   * Number of pages read from disk (including allocs)
+	 * Remove pins from a page if it is in the buffer pool, see unPinPage().
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number
+	 * @param count   Number of pins to remove
+	 * @param dirty		True if the page needs to be marked dirty
+	 * @throws  PageNotPinnedException If the page has fewer pins than count
 	 */
-  int diskreads;
+  void unPinFrame(File* file, const PageId pageNo, const int count, const bool dirty);
 
 	/**
-   * Number of pages written back to disk
+	 * Unpin a frame known to hold a page of the file, without a lookup.
+	 *
+	 * @param file    File object
+	 * @param frame   Frame holding the page
+	 * @param dirty   True if the page needs to be marked dirty
+	 * @throws  PageNotPinnedException If the frame does not hold a pinned page
+	 *          of the file
 	 */
-  int diskwrites;
+  void releaseFrame(File* file, const FrameId frame, const bool dirty);
 
 	/**
-   * Clear all values
+	 * Puts a page just allocated unwritten in the file into a frame, pinned
+	 * and dirty, as allocPage() would have; see BufPoolSet::allocPage().
+	 *
+	 * @param file    File object
+	 * @param pageNo  Page number the file assigned
+	 * @param image   The page as allocated
+	 * @param page    Set to the page in its frame
 	 */
-  void clear()
-  {
-		accesses = diskreads = diskwrites = 0;
-  }
+  void installPage(File* file, const PageId pageNo, const Page& image, Page*& page);
 
 	/**
-   * Constructor of BufStats class
+	 * Publishes a reserved frame holding a newly allocated page.
+	 *
+	 * @param file    File object
+	 * @param pageNo  Page number of the page
+	 * @param frame   Frame holding the page, pinned once
 	 */
-  BufStats()
-  {
-		clear();
-  }
-};
+  void installNew(File* file, const PageId pageNo, const FrameId frame);
 
+	/**
+	 * Write back the page of a frame if it is dirty and empty the frame.  The
+	 * caller holds the frame's latch, and the frame is valid and unpinned.
+	 *
+	 * @param frame   Frame to empty
+	 */
+  void evictFrame(const FrameId frame);
 
-/**
-* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file
-*/
-class BufMgr
-{
- private:
 	/**
-   * Current position of clockhand in our buffer pool
+	 * Empty the frames a shrinking resize() no longer hands out, waiting for
+	 * pinned ones to be unpinned.  The caller holds resizeLatch.
+	 *
+	 * @param from    First frame to empty
+	 * @param to      One past the last frame to empty
+	 * @throws  IoException If a dirty page cannot be written back; frames
+	 *          from that one on keep their pages
 	 */
-  FrameId clockHand;
+  void drainFrames(const FrameId from, const FrameId to);
 
 	/**
-   * Number of frames in the buffer pool
+	 * Count pages written back from the pool, also in the file's usage.
+	 *
+	 * @param fileId   	Identifier of the file written
+	 * @param pages   	Number of pages written
 	 */
-  std::uint32_t numBufs;
+  void countWrites(const FileId fileId, const std::uint64_t pages);
 
 	/**
-   * Hash table mapping (File, page) to frame
+	 * Record that a page was read from disk or from a prefetched frame, and
+	 * read ahead if the file is being read in consecutive page order.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number just read
 	 */
-  BufHashTbl *hashTable;
+  void noteRead(File* file, const PageId pageNo);
 
 	/**
-   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+	 * Clear the dirty bit of a frame and keep the dirty frame count.  Caller
+	 * holds the frame latch.
+	 *
+	 * @param desc  Descriptor of the frame
 	 */
-  BufDesc *bufDescTable;
+  void markClean(BufDesc& desc);
 
 	/**
-   * Maintains Buffer pool usage statistics
+	 * Write out and unpin the pinned pages filled by bulkLoad(), and empty the
+	 * batch.  If the write fails the batch is left as it was; once written,
+	 * it is emptied before the pages are unpinned, so that a failed unpin
+	 * leaves the caller nothing to unpin again.
+	 *
+	 * @param file   	File object
+	 * @param batch   Pages to write, in page number order
+	 */
+  void writeLoaded(File* file, std::vector<Page*>& batch);
+
+	/**
+	 * Set the dirty bit of a frame and keep the dirty frame count, waking the
+	 * background writer at the high watermark.  Caller holds the frame latch.
+	 *
+	 * @param desc  Descriptor of the frame
 	 */
-  BufStats bufStats;
+  void markDirty(BufDesc& desc);
 
 	/**
-   * Advance clock to next frame in the buffer pool
+	 * Body of the background writer thread.
 	 */
-  void advanceClock();
+  void runWriter();
 
 	/**
-	 * Allocate a free frame.
+	 * Write back one batch of dirty, unpinned frames next in line for eviction,
+	 * in file and page number order.
 	 *
-	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
-	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 * @return  Number of frames written
+	 */
+  std::uint32_t writeBackBatch();
+
+	/**
+	 * Lists the pages in the pool, referenced ones first, followed by those
+	 * flushFile() dropped that are not back, at most as many as there are
+	 * frames.
+	 *
+	 * @return  The list
+	 */
+  ResidentList residentPages();
+
+	/**
+	 * Body of the thread writing the page list periodically.
+	 */
+  void runWarmDumper();
+
+	/**
+	 * Body of the warm-up thread.
+	 *
+	 * @param list   Pages to load
+	 * @param files  The open files to load them from
+	 */
+  void runWarmUp(const ResidentList list, const std::vector<File*> files);
+
+	/**
+	 * End a read ahead into a frame published as loading by publishFrame(),
+	 * leaving the page unpinned and cold if it was read.
+	 *
+	 * @param frame    The frame
+	 * @param error    Null if the read succeeded
 	 */
-  void allocBuf(FrameId & frame);
+  void finishPrefetch(const FrameId frame, std::exception_ptr error);
 
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated.  Each Page is a view
+   * over its frame's bytes in the frame arena.
 	 */
   Page* bufPool;
 
 	/**
    * Constructor of BufMgr class
+   *
+   * @param bufs     Number of frames in the buffer pool
+   * @param options  Construction-time options, e.g. which page table to use
 	 */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs, const BufMgrOptions& options = BufMgrOptions());
 
 	/**
    * Destructor of BufMgr class
@@ -222,6 +1628,9 @@ class BufMgr
 	 * Reads the given page from the file into a frame and returns the pointer to page.
 	 * If the requested page is already present in the buffer pool pointer to that frame is returned
 	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 * For a mapped file (see StorageType::MAPPED) the frame's page is a view of
+	 * the page in the mapping instead of a copy; it must not be modified, and
+	 * the file must be flushed with flushFile() before it is closed.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
@@ -229,8 +1638,89 @@ class BufMgr
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Reads the given page as readPage() does, returning a guard that unpins
+	 * it when it goes away.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @return  Guard holding the pin on the page
+	 */
+  PageGuard readPage(File* file, const PageId pageNo);
+
+	/**
+	 * Reads the given page to change it, returning a guard that unpins it
+	 * when it goes away; call markDirty() on the guard once the change is
+	 * complete.  Without BufMgrOptions::copyOnWrite, and for a mapped file,
+	 * this is readPage().  With it, the guard is on a private copy of the
+	 * page in a frame of its own.  Releasing the guard dirty installs the
+	 * copy in the page table as the page's current version, and releasing it
+	 * clean drops it.  Until then readers get the version the copy was made
+	 * from; those still pinning that version once the copy is installed read
+	 * it to the end, and its frame is reused after the last unpins it.  A
+	 * second writer of the page waits for the first to release its guard, so
+	 * a thread must not update a page it is updating already.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @return  Guard holding the pin on the page, or on the private copy
+	 * @throws BufferExceededException If no frame is free for the copy
+	 */
+  PageGuard readPageForUpdate(File* file, const PageId pageNo);
+
+	/**
+	 * Reads the given page as readPage() does, for a coroutine Task to await:
+	 * `PageGuard guard = co_await bufMgr->readPageAsync(file, pageNo)`.  A hit
+	 * completes without suspending the task.  A miss suspends it, submits the
+	 * read to the pool's IoEngine and has the task's TaskExecutor resume it
+	 * once the frame is filled, so the thread goes on with other tasks.  A pool
+	 * without an IoEngine (BufMgrOptions::ioQueueDepth), and a mapped file,
+	 * read on the calling thread instead.  Include taskExecutor.h to use it.
+	 *
+	 * @param file   	File object, open until the read completes
+	 * @param pageNo  Page number in the file to be read
+	 * @return  The read to await, giving a guard holding the pin on the page
+	 *          or throwing what readPage() would
+	 */
+  PageRead readPageAsync(File* file, const PageId pageNo);
+
+	/**
+	 * Reads several pages of a file into frames and pins them, as readPage()
+	 * for each would, but looking up and reading each distinct page once, in
+	 * page order: all pages missing from the pool get a frame first, and each
+	 * run of consecutive missing pages is then read with a single read of the
+	 * file.  A page listed n times is pinned n times.  Read-ahead does not
+	 * follow these reads.
+	 *
+	 * @param file   	File object
+	 * @param pageNos  Page numbers in the file to be read, in any order
+	 * @param pages  	Set to the Page object of each page, in the order of pageNos
+	 * @throws  BufferExceededException If the missing pages do not all fit in
+	 *          the pool; no page is pinned then, as after any other error
+	 */
+  void readPages(File* file, std::span<const PageId> pageNos,
+                 std::vector<Page*>& pages);
+
+	/**
+	 * Starts loading a range of pages into unpinned frames, so that later
+	 * readPage() calls for them hit.  Pages already in the pool are skipped.
+	 * This is only a hint: it stops early, without an error, at the end of the
+	 * file or when no frame is free.  The reads are asynchronous if the pool has
+	 * an IoEngine (BufMgrOptions::ioQueueDepth) and synchronous otherwise.  The
+	 * file must stay open until the reads complete; flushFile() waits for them.
+	 * Mapped files are skipped, since their pages are not copied into frames
+	 * and the mapping reads ahead on its own.
+	 *
+	 * @param file   	File object
+	 * @param first   First page number to load
+	 * @param count   Number of consecutive pages to load
+	 */
+  void prefetch(File* file, const PageId first, const std::uint32_t count);
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
+	 * With BufMgrOptions::copyOnWrite the page number may name a newer version
+	 * than the one pinned; give pins back by frame then, as the pool does.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number
@@ -239,9 +1729,38 @@ class BufMgr
 	 */
   void unPinPage(File* file, const PageId PageNo, const bool dirty);
 
+	/**
+	 * Unpin several pages of a file, as unPinPage() for each would; a page
+	 * listed n times is unpinned n times.  Pairs with readPages().
+	 *
+	 * @param file   	File object
+	 * @param pageNos  Page numbers, in any order
+	 * @param dirty		True if the pages need to be marked dirty
+	 * @throws  PageNotPinnedException If a page is not pinned as often as it is
+	 *          listed; the other pages are unpinned all the same
+	 */
+  void unPinPages(File* file, std::span<const PageId> pageNos, const bool dirty);
+
+	/**
+	 * Unpin pages returned by readPages(), as unPinPages() with their page
+	 * numbers would, but finding each frame from its Page object instead of
+	 * looking the page up in the page table.  A page listed n times is
+	 * unpinned n times.
+	 *
+	 * @param file   	File object
+	 * @param pages  	Pages returned by readPages() (or readPage()) for the file
+	 * @param dirty		True if the pages need to be marked dirty
+	 * @throws  PageNotPinnedException If a page is not pinned; the other pages
+	 *          are unpinned all the same
+	 * @throws  BadBufferException If a page is not one of the pool's frames
+	 */
+  void unPinPages(File* file, std::span<Page* const> pages, const bool dirty);
+
 	/**
 	 * Allocates a new, empty page in the file and returns the Page object.
 	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 * The page is only written when its frame is written back, so it starts
+	 * out dirty.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
@@ -250,16 +1769,195 @@ class BufMgr
   void allocPage(File* file, PageId &PageNo, Page*& page);
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Allocates a new page as allocPage() does, returning a guard that unpins
+	 * it when it goes away.  The page is only written when its frame is
+	 * written back, so it starts out dirty; markDirty() on the guard still
+	 * logs it with a write-ahead log.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Set to the number assigned to the page in the file
+	 * @return  Guard holding the pin on the page
+	 */
+  PageGuard allocPage(File* file, PageId& pageNo);
+
+	/**
+	 * Inserts a record into some page of the file with room for it, chosen by
+	 * the file's free-space map without reading the pages that are full, or
+	 * into a newly allocated page if none has room.  Records placed in a file
+	 * this way are serialized with each other, but not with other changes to
+	 * the same pages.
+	 *
+	 * @param file   	File object
+	 * @param record  Record data
+	 * @return  ID of the inserted record
+   * @throws  InsufficientSpaceException If the record does not fit on an empty page
+	 */
+  RecordId insertRecord(File* file, std::string_view record);
+
+	/**
+	 * Loads records into newly allocated pages of the file, packing each page
+	 * as full as the records in order allow.  Filled pages are kept pinned and
+	 * written out together, a batch of up to BufMgrOptions::writerBatchPages
+	 * (at most half the pool) at a time, in runs of consecutive pages; they
+	 * stay in the pool clean.  The pages are reported to the file's free-space
+	 * map if one is open.
+	 *
+	 * @param file   	File object
+	 * @param records  Records to load, in order
+	 * @return  IDs of the records, in the same order
+	 * @throws  InsufficientSpaceException If a record does not fit on an empty
+	 *          page; the records before it are loaded
+	 */
+  std::vector<RecordId> bulkLoad(File* file, const std::vector<std::string_view>& records);
+
+	/**
+	 * Deletes a record from its page and records the space freed in the file's
+	 * free-space map.
+	 *
+	 * @param file   	File object
+	 * @param rid     ID of the record to delete
+   * @throws  InvalidRecordException If the record does not exist
+	 */
+  void deleteRecord(File* file, const RecordId& rid);
+
+	/**
+	 * Writes the list of the pages in the pool to BufMgrOptions::warmFile now.
+	 * Does nothing without a warm file.
+	 *
+	 * @throws  IoException If the list cannot be written
+	 */
+  void dumpResident();
+
+	/**
+	 * Starts loading the pages listed in BufMgrOptions::warmFile, as written
+	 * by an earlier pool, in a background thread, and returns.  Pages of each
+	 * file are read in page order, runs of consecutive pages with one read,
+	 * and arrive unpinned as read-ahead pages do; those that had been
+	 * referenced arrive referenced.  Listed files not among <files> are
+	 * skipped, and loading stops once it has loaded as many pages as the pool
+	 * has frames, or when no frame can be claimed.  readPage() may be called
+	 * throughout.  flushFile() stops the loading of its file.  Does nothing
+	 * without a warm file or if it does not exist.
+	 *
+	 * @param files  Open files to load the pages of
+	 */
+  void warmUp(const std::vector<File*>& files);
+
+	/**
+	 * Waits for the thread started by warmUp() to finish.
+	 *
+	 * @return  Number of pages loaded by the last warm-up
+	 */
+  std::uint64_t waitWarmUp();
+
+	/**
+	 * Makes every change to a page unpinned dirty so far durable in the
+	 * write-ahead log.  Concurrent callers share log syncs.  Does nothing
+	 * without a log.
+	 */
+  void flushLog();
+
+	/**
+	 * Writes back every dirty page, syncs the files with pages in the log and
+	 * empties the log.  The log is kept if a dirty page is pinned, unless
+	 * it is a version installed from a writer's private copy
+	 * (BufMgrOptions::copyOnWrite): nobody changes those, so they are written
+	 * all the same.  Pages must not be changed concurrently otherwise.  Does
+	 * nothing without a log.
+	 */
+  void checkpoint();
+
+	/**
+	 * Writes out all dirty pages of the file to disk, along with its free-space map.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
-	 * Otherwise Error returned.
+	 * Otherwise Error returned.  With BufMgrOptions::copyOnWrite pinned pages
+	 * that are clean or installed from a writer's private copy are written
+	 * too and stay in the pool, and writers' private copies are left to be
+	 * installed or dropped.
 	 *
 	 * @param file   	File object
-   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+   * @throws  PagePinnedException If any page of the file is pinned in the
+   *          buffer pool, or with copy-on-write, if a page changed in place
+   *          is pinned
    * @throws BadBufferException If any frame allocated to the file is found to be invalid
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Defragments a file: moves the records of pages at least half empty onto
+	 * earlier such pages, freeing those emptied, then moves the last pages
+	 * into the first free ones until no free page is left between pages in
+	 * use, and shortens the file.  Scans of the file then read one contiguous
+	 * run of pages.  Frames holding moved pages stay in the pool under their
+	 * new numbers.  The IDs of moved records change, so indexes on them must
+	 * be updated from the result.  The file's pages are written back first;
+	 * with a log, the pool checkpoints once the pages are moved, so that no
+	 * logged image of a page outlives its move.  The file must not be used concurrently.
+	 *
+	 * @param file   	File object
+	 * @param merge   Whether to move records off half empty pages; pages are
+	 *                only renumbered otherwise
+	 * @return  The pages and records moved
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+   *          when it starts; nothing has been moved then
+	 */
+  DefragResult defragment(File* file, const bool merge = true);
+
+	/**
+	 * Creates a named partition of the pool, or changes its bounds.  Every
+	 * file is in the default partition unless assigned another with
+	 * assignPartition().  When a page is read or allocated, a partition holding
+	 * maxFrames frames replaces one of its own pages, e.g. to confine the
+	 * files of a large scan to a small ring of frames; and no partition
+	 * holding minFrames frames or fewer loses a page to another.  Bounds are
+	 * soft: when the quotas leave no victim, any unpinned frame is taken.
+	 *
+	 * @param name       Name of the partition, other than "default"
+	 * @param minFrames  Frames kept for the partition's pages
+	 * @param maxFrames  Most frames the partition takes from others, at least
+	 *                   1 and minFrames
+	 * @throws  PartitionException If the bounds are out of order, the minimums
+	 *          of all partitions would exceed the pool, or there are
+	 *          MAX_PARTITIONS partitions already
+	 */
+  void setPartition(const std::string& name, const std::uint32_t minFrames,
+                    const std::uint32_t maxFrames = UINT32_MAX);
+
+	/**
+	 * Assigns a file to a partition, from its next page read into the pool;
+	 * pages already in the pool count in their partition until they leave.
+	 *
+	 * @param filename   Name of the file
+	 * @param partition  Name of the partition, "default" for the default one
+	 * @throws  PartitionException If there is no such partition
+	 */
+  void assignPartition(const std::string& filename, const std::string& partition);
+
+	/**
+	 * Changes the number of frames of the pool while it is in use.  Growing
+	 * adds frames RESIZE_CHUNK at a time, making room in the page table for
+	 * each chunk before its frames can be used.  Shrinking stops handing out
+	 * the frames at the top of the range, then writes back and drops their
+	 * pages one frame at a time, waiting for those that are pinned to be
+	 * unpinned, and gives their memory back.  Threads keep reading pages
+	 * throughout; pages beyond the new size are read again into frames below
+	 * it.
+	 *
+	 * @param bufs   New number of frames, at least 1
+	 * @throws  BufferExceededException If bufs is more than the frames
+	 *          reserved with BufMgrOptions::maxBufs, or zero
+	 * @throws  IoException If a dirty page above the new size cannot be
+	 *          written back.  The pool goes back to its old size, with the
+	 *          frames already emptied free again, so resize() can simply be
+	 *          called again.
+	 */
+  void resize(const std::uint32_t bufs);
+
+	/**
+	 * @return  Number of frames in the pool
+	 */
+  std::uint32_t size() const { return numBufs.load(std::memory_order_relaxed); }
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -275,12 +1973,11 @@ class BufMgr
   void  printSelf();
 
 	/**
-   * Get buffer pool usage statistics
+   * Get a snapshot of the buffer pool usage statistics.  Counters are read one
+   * after the other while the pool keeps running, so they need not agree
+   * exactly with each other.
 	 */
-  BufStats & getBufStats()
-  {
-		return bufStats;
-  }
+  BufStats getBufStats();
 
   /**
    * Get valid bit of the frame
@@ -307,14 +2004,14 @@ class BufMgr
    * Get pincount of the frame
 	 */
   int getPinCnt(int frame){
-    return bufDescTable[frame].pinCnt;
+    return bufDescTable[frame].pins();
   }
 
   /**
    * Get referenced bit of the frame
 	 */
   bool getRefBit(int frame){
-    return bufDescTable[frame].refbit;
+    return bufDescTable[frame].refbit();
   }
 
   /**
@@ -323,13 +2020,17 @@ class BufMgr
   bool getDirtyBit(int frame){
     return bufDescTable[frame].dirty;
   }
+
+  /**
+   * Get whether the frame is frozen for eviction
+	 */
+  bool getFrameFrozen(int frame){
+    return bufDescTable[frame].frozen;
+  }
 	/**
    * Clear buffer pool usage statistics
 	 */
-  void clearBufStats()
-  {
-		bufStats.clear();
-  }
+  void clearBufStats();
 
 };
 
@@ -0,0 +1,203 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define BADGERDB_CRC32C_SSE42 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define BADGERDB_CRC32C_ARMV8 1
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Reflected CRC-32C polynomial.
+ */
+const std::uint32_t POLYNOMIAL = 0x82f63b78;
+
+/**
+ * Table for the byte-at-a-time software checksum.
+ */
+struct Table {
+  std::uint32_t entries[256];
+
+  Table() {
+    for (std::uint32_t i = 0; i < 256; i++) {
+      std::uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1)));
+      }
+      entries[i] = crc;
+    }
+  }
+};
+
+std::uint32_t crc32cSoftware(std::uint32_t crc, const unsigned char* data,
+                             std::size_t length) {
+  static const Table table;
+  for (std::size_t i = 0; i < length; i++) {
+    crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(BADGERDB_CRC32C_SSE42)
+#if defined(__x86_64__)
+/**
+ * Bytes per stream in the three-way interleaved loop.  The CRC32 instruction
+ * has a latency of three cycles but accepts one per cycle, so three
+ * independent streams run about three times as fast as one.
+ */
+const std::size_t STREAM_BYTES = 512;
+
+/**
+ * Tables advancing a checksum state over STREAM_BYTES zero bytes, one per
+ * byte of the state, so that streams can be joined: the state after A then B
+ * is the state after A advanced over |B| zero bytes, xor that of B from zero.
+ */
+struct ShiftTable {
+  std::uint32_t entries[4][256];
+
+  ShiftTable() {
+    // The advance is linear, so the images of the 32 unit states span it.
+    std::uint32_t unit[32];
+    for (int bit = 0; bit < 32; bit++) {
+      std::uint32_t state = 1u << bit;
+      for (std::size_t i = 0; i < STREAM_BYTES; i++) {
+        for (int k = 0; k < 8; k++) {
+          state = (state >> 1) ^ (POLYNOMIAL & (0u - (state & 1)));
+        }
+      }
+      unit[bit] = state;
+    }
+    for (int byte = 0; byte < 4; byte++) {
+      for (std::uint32_t value = 0; value < 256; value++) {
+        std::uint32_t image = 0;
+        for (int bit = 0; bit < 8; bit++) {
+          if (value & (1u << bit)) {
+            image ^= unit[byte * 8 + bit];
+          }
+        }
+        entries[byte][value] = image;
+      }
+    }
+  }
+
+  std::uint32_t shift(const std::uint32_t state) const {
+    return entries[0][state & 0xff] ^ entries[1][(state >> 8) & 0xff] ^
+           entries[2][(state >> 16) & 0xff] ^ entries[3][state >> 24];
+  }
+};
+#endif
+
+__attribute__((target("sse4.2")))
+std::uint32_t crc32cInstructions(std::uint32_t crc, const unsigned char* data,
+                                 std::size_t length) {
+#if defined(__x86_64__)
+  static const ShiftTable table;
+  for (; length >= 3 * STREAM_BYTES;
+       data += 3 * STREAM_BYTES, length -= 3 * STREAM_BYTES) {
+    std::uint64_t a = crc;
+    std::uint64_t b = 0;
+    std::uint64_t c = 0;
+    for (std::size_t i = 0; i < STREAM_BYTES; i += 8) {
+      std::uint64_t word_a;
+      std::uint64_t word_b;
+      std::uint64_t word_c;
+      std::memcpy(&word_a, data + i, 8);
+      std::memcpy(&word_b, data + STREAM_BYTES + i, 8);
+      std::memcpy(&word_c, data + 2 * STREAM_BYTES + i, 8);
+      a = _mm_crc32_u64(a, word_a);
+      b = _mm_crc32_u64(b, word_b);
+      c = _mm_crc32_u64(c, word_c);
+    }
+    crc = table.shift(table.shift(static_cast<std::uint32_t>(a)) ^
+                      static_cast<std::uint32_t>(b)) ^
+          static_cast<std::uint32_t>(c);
+  }
+  std::uint64_t wide = crc;
+  for (; length >= 8; data += 8, length -= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    wide = _mm_crc32_u64(wide, word);
+  }
+  crc = static_cast<std::uint32_t>(wide);
+#endif
+  for (; length >= 4; data += 4, length -= 4) {
+    std::uint32_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc = _mm_crc32_u32(crc, word);
+  }
+  for (; length > 0; data++, length--) {
+    crc = _mm_crc32_u8(crc, *data);
+  }
+  return crc;
+}
+
+bool detect() {
+  // may run before the constructors that would initialize the CPU model
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(BADGERDB_CRC32C_ARMV8)
+std::uint32_t crc32cInstructions(std::uint32_t crc, const unsigned char* data,
+                                 std::size_t length) {
+  for (; length >= 8; data += 8, length -= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc = __crc32cd(crc, word);
+  }
+  for (; length > 0; data++, length--) {
+    crc = __crc32cb(crc, *data);
+  }
+  return crc;
+}
+
+bool detect() {
+  return true;
+}
+#else
+std::uint32_t crc32cInstructions(std::uint32_t crc, const unsigned char* data,
+                                 std::size_t length) {
+  return crc32cSoftware(crc, data, length);
+}
+
+bool detect() {
+  return false;
+}
+#endif
+
+/**
+ * Whether the checksum instructions may be used, decided once.
+ */
+const bool hardware = detect();
+
+}
+
+std::uint32_t crc32c(std::uint32_t crc, const void* data, std::size_t length) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  crc = ~crc;
+  crc = hardware ? crc32cInstructions(crc, bytes, length)
+                 : crc32cSoftware(crc, bytes, length);
+  return ~crc;
+}
+
+bool crc32cHardware() {
+  return hardware;
+}
+
+}
@@ -0,0 +1,35 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Extends a CRC-32C (Castagnoli) checksum over more bytes.  Uses the SSE4.2
+ * or ARMv8 CRC32 instructions when the processor has them and a table
+ * otherwise; all give the same result.
+ *
+ * @param crc     Checksum of the bytes so far; zero to start.
+ * @param data    Bytes to add.
+ * @param length  Number of bytes.
+ * @return  Checksum of the bytes so far followed by <data>.
+ */
+std::uint32_t crc32c(std::uint32_t crc, const void* data, std::size_t length);
+
+/**
+ * Returns true if crc32c() uses CRC32 instructions on this processor.
+ */
+bool crc32cHardware();
+
+}
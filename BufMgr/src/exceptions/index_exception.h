@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an index is used in a way it does
+ *        not allow, or its file does not hold an index.
+ */
+class IndexException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an index exception for the given index file.
+   *
+   * @param name    Name of the index file.
+   * @param reason  What is wrong.
+   */
+  IndexException(const std::string& name, const std::string& reason);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~IndexException() throw() {}
+
+  /**
+   * Returns name of the index file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of the index file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
@@ -0,0 +1,25 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_size_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageSizeException::PageSizeException(const std::string& name,
+                                     const std::size_t size,
+                                     const std::size_t expected)
+    : BadgerDbException(""), filename_(name), size_(size) {
+  std::stringstream ss;
+  ss << "File '" << filename_ << "' has " << size_ << " byte pages, but "
+     << expected << " byte pages are in use";
+  message_.assign(ss.str());
+}
+
+}
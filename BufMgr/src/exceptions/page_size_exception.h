@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file is opened whose pages are
+ *        not of the size this build of BadgerDB uses (see Page::SIZE).
+ */
+class PageSizeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page size exception for the given file.
+   *
+   * @param name      Name of file that was opened.
+   * @param size      Page size found in the file header.
+   * @param expected  Page size of this build.
+   */
+  PageSizeException(const std::string& name, const std::size_t size,
+                    const std::size_t expected);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageSizeException() throw() {}
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns the page size found in the file.
+   */
+  virtual std::size_t size() const { return size_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string filename_;
+
+  /**
+   * Page size found in the file header.
+   */
+  const std::size_t size_;
+};
+
+}
@@ -0,0 +1,25 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_type_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageTypeException::PageTypeException(const PageId page_num,
+                                     const std::uint32_t found,
+                                     const std::uint32_t expected)
+    : BadgerDbException(""), page_num_(page_num), found_(found) {
+  std::stringstream ss;
+  ss << "Page " << page_num_ << " has type " << found_ << ", not type "
+     << expected;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,62 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a page is used through a view of
+ *        another layout than its own (see PageType).
+ */
+class PageTypeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page type exception for the given page.
+   *
+   * @param page_num  Number of the page.
+   * @param found     Type of the page.
+   * @param expected  Type the view needs.
+   */
+  PageTypeException(const PageId page_num, const std::uint32_t found,
+                    const std::uint32_t expected);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageTypeException() throw() {}
+
+  /**
+   * Returns the page number of the page that caused this exception.
+   */
+  virtual PageId pageNo() const { return page_num_; }
+
+  /**
+   * Returns the type of the page.
+   */
+  virtual std::uint32_t found() const { return found_; }
+
+ protected:
+  /**
+   * Number of the page.
+   */
+  const PageId page_num_;
+
+  /**
+   * Type of the page.
+   */
+  const std::uint32_t found_;
+};
+
+}
@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a buffer pool partition is set up
+ *        with bounds the pool cannot keep, or one that does not exist is used.
+ */
+class PartitionException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a partition exception for the given partition.
+   *
+   * @param name    Name of the partition.
+   * @param reason  What is wrong.
+   */
+  PartitionException(const std::string& name, const std::string& reason);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PartitionException() throw() {}
+
+  /**
+   * Returns name of the partition that caused this exception.
+   */
+  virtual const std::string& partition() const { return partition_; }
+
+ protected:
+  /**
+   * Name of the partition that caused this exception.
+   */
+  const std::string partition_;
+};
+
+}
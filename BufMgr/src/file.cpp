@@ -14,27 +14,51 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <algorithm>
+#include <sys/stat.h>
 
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_format_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_exception.h"
+#include "exceptions/page_corrupt_exception.h"
+#include "exceptions/page_size_exception.h"
+#include "crc32c.h"
 #include "file_iterator.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
-File::CountMap File::open_counts_;
+namespace {
+
+/**
+ * Page size of every file that does not record its own.
+ */
+const std::size_t LEGACY_PAGE_SIZE = 8192;
 
-File File::create(const std::string& filename) {
-  return File(filename, true /* create_new */);
 }
 
-File File::open(const std::string& filename) {
-  return File(filename, false /* create_new */);
+const std::uint64_t File::EXTENT_SIZE;
+File::Registry File::open_files_;
+std::mutex File::registry_latch_;
+FileId File::next_id_ = 1;
+std::chrono::milliseconds File::header_write_interval_(0);
+
+File File::create(const std::string& filename, const StorageType storage,
+                  const bool checksums) {
+  return File(filename, true /* create_new */, storage, checksums);
+}
+
+File File::open(const std::string& filename, const StorageType storage) {
+  return File(filename, false /* create_new */, storage);
 }
 
 void File::remove(const std::string& filename) {
@@ -51,24 +75,29 @@ bool File::isOpen(const std::string& filename) {
   if (!exists(filename)) {
     return false;
   }
-  return open_counts_.find(filename) != open_counts_.end();
+  std::lock_guard<std::mutex> guard(registry_latch_);
+  return open_files_.find(filename) != open_files_.end();
 }
 
 bool File::exists(const std::string& filename) {
-	std::fstream file(filename);
-	if(file)
-	{
-		file.close();
-		return true;
-	}
+  struct stat status;
+  return ::stat(filename.c_str(), &status) == 0 && !S_ISDIR(status.st_mode);
+}
 
-	return false;
+void File::setHeaderWriteInterval(const std::chrono::milliseconds interval) {
+  header_write_interval_ = interval;
 }
 
 File::File(const File& other)
-  : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
-  ++open_counts_[filename_];
+  : std::enable_shared_from_this<File>(),
+    filename_(other.filename_),
+    storage_(other.storage_),
+    id_(0),
+    detached_(false) {
+  if (other.stream_) {
+    std::lock_guard<std::mutex> guard(registry_latch_);
+    attach(open_files_[filename_]);
+  }
 }
 
 File& File::operator=(const File& rhs) {
@@ -76,6 +105,7 @@ File& File::operator=(const File& rhs) {
   // same file.
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
+  storage_ = rhs.storage_;
   openIfNeeded(false /* create_new */);
   return *this;
 }
@@ -85,93 +115,154 @@ File::~File() {
 }
 
 Page File::allocatePage() {
-  FileHeader header = readHeader();
   Page new_page;
-  Page existing_page;
+  allocatePage(new_page);
+  return new_page;
+}
+
+PageId File::allocatePage(Page& new_page) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
+  const PageId page_number = takePage(header);
+  new_page.initialize();
+  new_page.set_page_number(page_number);
+  writePage(page_number, new_page);
+  writeHeader(header);
+
+  return page_number;
+}
+
+PageId File::allocateUnwritten(Page& new_page) {
+  if (isMapped()) {
+    // A read-only file would only fail the write later.
+    return allocatePage(new_page);
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
+  const PageId page_number = takePage(header);
+  new_page.initialize();
+  new_page.set_page_number(page_number);
+  header_->unwritten.insert(page_number);
+  header.flags |= FileHeader::UNWRITTEN;
+  writeHeader(header);
+
+  return page_number;
+}
+
+PageId File::takePage(FileHeader& header) {
+  PageId page_number;
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
+    // Reuse the head of the free list.
+    page_number = header.first_free_page;
+    header.first_free_page = readPageHeader(page_number).next_page_number;
     --header.num_free_pages;
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
-    } else {
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+    page_number = header.num_pages;
+    if (pagePosition(page_number + 1) > header_->reserved) {
+      stream_->reserve(pagePosition(page_number), EXTENT_SIZE);
+      header_->reserved = pagePosition(page_number) + EXTENT_SIZE;
     }
     ++header.num_pages;
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+  if (header.first_used_page == Page::INVALID_NUMBER ||
+      header.first_used_page > page_number) {
+    header.first_used_page = page_number;
   }
-  writeHeader(header);
-
-  return new_page;
+  return page_number;
 }
 
 Page File::readPage(const PageId page_number) const {
-  FileHeader header = readHeader();
-  if (page_number >= header.num_pages) {
+  Page page;
+  readPage(page_number, page);
+  return page;
+}
+
+void File::readPage(const PageId page_number, Page& page) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= header_->header.num_pages) {
     throw InvalidPageException(page_number, filename_);
   }
-  return readPage(page_number, false /* allow_free */);
+  readPage(page_number, false /* allow_free */, page);
 }
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
-  if (!allow_free && !page.isUsed()) {
+  readPage(page_number, allow_free, page);
+  return page;
+}
+
+void File::readPage(const PageId page_number, const bool allow_free,
+                    Page& page) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  // Header and data are contiguous, so the whole page is a single read.
+  stream_->read(pagePosition(page_number), reinterpret_cast<char*>(page.header_),
+                Page::SIZE);
+  verifyPage(page_number, page, hasChecksums(), filename_);
+  if (!allow_free && !page.isUsed() && !fillUnwritten(page_number, page)) {
     throw InvalidPageException(page_number, filename_);
   }
+}
 
-  return page;
+void File::readPages(const PageId first, std::span<Page* const> pages) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  if (first == Page::INVALID_NUMBER || first >= header_->header.num_pages ||
+      pages.size() > header_->header.num_pages - first) {
+    throw InvalidPageException(first, filename_);
+  }
+  // Header and data are contiguous, so each page is a single block.
+  std::vector<char*> blocks(pages.size());
+  for (std::size_t k = 0; k < pages.size(); ++k) {
+    blocks[k] = reinterpret_cast<char*>(pages[k]->header_);
+  }
+  stream_->readBlocks(pagePosition(first), blocks.data(), blocks.size(), Page::SIZE);
+  const bool checksums = hasChecksums();
+  for (std::size_t k = 0; k < pages.size(); ++k) {
+    Page& page = *pages[k];
+    verifyPage(static_cast<PageId>(first + k), page, checksums, filename_);
+    if (!page.isUsed() && !fillUnwritten(static_cast<PageId>(first + k), page)) {
+      throw InvalidPageException(static_cast<PageId>(first + k), filename_);
+    }
+  }
+}
+
+bool File::isMapped() const {
+  return stream_->isMapped();
+}
+
+char* File::mappedPage(const PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  char* bytes = NULL;
+  if (page_number != Page::INVALID_NUMBER &&
+      page_number < header_->header.num_pages) {
+    bytes = stream_->mapping(pagePosition(page_number), Page::SIZE);
+  }
+  if (bytes == NULL) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Page view(bytes);
+  verifyPage(page_number, view, hasChecksums(), filename_);
+  if (!view.isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return bytes;
+}
+
+Page File::viewPage(const PageId page_number) const {
+  if (isMapped()) {
+    return Page(mappedPage(page_number));
+  }
+  return readPage(page_number);
 }
 
 void File::writePage(const Page& new_page) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
   PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
+  if (header.current_page_number == Page::INVALID_NUMBER &&
+      header_->unwritten.count(new_page.page_number()) == 0) {
     // Page has been deleted since it was read.
     throw InvalidPageException(new_page.page_number(), filename_);
   }
@@ -179,130 +270,689 @@ void File::writePage(const Page& new_page) {
   // we don't modify that, but we do keep all the other modifications to the
   // page header.
   const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
+  header = *new_page.header_;
   header.next_page_number = next_page_number;
   writePage(new_page.page_number(), header, new_page);
+  header_->unwritten.erase(new_page.page_number());
 }
 
-void File::deletePage(const PageId page_number) {
-  FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
+void File::writePages(const std::vector<const Page*>& pages) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  for (const Page* page : pages) {
+    // as writePage() does, refuse a page deleted since it was read
+    if (!page->isUsed() || page->page_number() >= header_->header.num_pages ||
+        !isInUse(page->page_number())) {
+      throw InvalidPageException(page->page_number(), filename_);
+    }
+  }
+  const bool checksums = hasChecksums();
+  std::vector<char> run;
+  for (std::size_t first = 0; first < pages.size();) {
+    std::size_t last = first + 1;
+    while (last < pages.size() &&
+           pages[last]->page_number() == pages[last - 1]->page_number() + 1) {
+      ++last;
+    }
+    run.resize((last - first) * Page::SIZE);
+    for (std::size_t k = first; k < last; ++k) {
+      const Page& page = *pages[k];
+      // Used pages are in no list, whatever their header says.
+      page.header_->next_page_number = Page::INVALID_NUMBER;
+      page.header_->checksum =
+          checksums ? pageChecksum(*page.header_, page.data_) : 0;
+      std::memcpy(&run[(k - first) * Page::SIZE], page.header_, Page::SIZE);
+    }
+    stream_->write(pagePosition(pages[first]->page_number()), run.data(),
+                   run.size());
+    first = last;
+  }
+  if (!header_->unwritten.empty()) {
+    for (const Page* page : pages) {
+      header_->unwritten.erase(page->page_number());
+    }
+  }
+}
+
+IoRequest File::readPageRequest(const PageId page_number, Page& page,
+                                IoCallback done) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= header_->header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+
+  IoRequest request;
+  request.op = IoOp::READ;
+  request.offset = pagePosition(page_number);
+  request.buffer = reinterpret_cast<char*>(page.header_);
+  request.length = Page::SIZE;
+  request.filename = filename_;
+  if (stream_->rawAccess(request.offset, request.buffer, request.length)) {
+    request.descriptor = stream_->descriptor();
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
+    std::shared_ptr<StorageBackend> stream = stream_;
+    std::shared_ptr<std::recursive_mutex> latch = latch_;
+    const std::uint64_t offset = request.offset;
+    char* buffer = request.buffer;
+    request.fallback = [stream, latch, offset, buffer]() {
+      std::lock_guard<std::recursive_mutex> guard(*latch);
+      stream->read(offset, buffer, Page::SIZE);
+    };
+  }
+  const std::string filename = filename_;
+  const bool checksums = hasChecksums();
+  Page* target = &page;
+  // a page allocated unwritten reads as allocated, as with readPage()
+  std::shared_ptr<CachedHeader> cached = header_;
+  std::shared_ptr<std::recursive_mutex> latch = latch_;
+  request.done = [done, filename, checksums, page_number, target, cached,
+                  latch](std::exception_ptr error) {
+    if (!error) {
+      try {
+        verifyPage(page_number, *target, checksums, filename);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+    if (!error && !target->isUsed()) {
+      std::lock_guard<std::recursive_mutex> guard(*latch);
+      if (cached->unwritten.count(page_number) > 0) {
+        target->initialize();
+        target->set_page_number(page_number);
+      } else {
+        error = std::make_exception_ptr(
+            InvalidPageException(page_number, filename));
       }
     }
+    done(error);
+  };
+  return request;
+}
+
+IoRequest File::writePageRequest(const Page& new_page, IoCallback done) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  PageHeader header = readPageHeader(new_page.page_number());
+  const PageId page_number = new_page.page_number();
+  const bool unwritten = header_->unwritten.count(page_number) > 0;
+  if (header.current_page_number == Page::INVALID_NUMBER && !unwritten) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  // Same header merge as writePage().
+  const PageId next_page_number = header.next_page_number;
+  header = *new_page.header_;
+  header.next_page_number = next_page_number;
+  header.checksum = 0;
+  if (hasChecksums()) {
+    header.checksum = pageChecksum(header, new_page.data_);
+  }
+
+  IoRequest request;
+  request.op = IoOp::WRITE;
+  request.offset = pagePosition(new_page.page_number());
+  request.buffer =
+      const_cast<char*>(reinterpret_cast<const char*>(new_page.header_));
+  request.length = Page::SIZE;
+  request.filename = filename_;
+  request.done = done;
+  if (unwritten) {
+    // The page is on disk once the write completes.
+    std::shared_ptr<std::recursive_mutex> latch = latch_;
+    std::shared_ptr<CachedHeader> cached = header_;
+    request.done = [done, latch, cached, page_number](std::exception_ptr error) {
+      if (!error) {
+        std::lock_guard<std::recursive_mutex> guard(*latch);
+        cached->unwritten.erase(page_number);
+      }
+      done(error);
+    };
+  }
+  if (std::memcmp(&header, new_page.header_,
+                  offsetof(PageHeader, checksum)) == 0 &&
+      stream_->rawAccess(request.offset, request.buffer, request.length)) {
+    // The page's own header is the one to write, with the checksum in it.
+    new_page.header_->checksum = header.checksum;
+    request.descriptor = stream_->descriptor();
+  } else {
+    // The header differs from the page's own, or the backend needs the latch:
+    // write the merged header and the data separately under the latch.
+    std::shared_ptr<StorageBackend> stream = stream_;
+    std::shared_ptr<std::recursive_mutex> latch = latch_;
+    const std::uint64_t offset = request.offset;
+    const char* data = new_page.data_;
+    request.fallback = [stream, latch, offset, header, data]() {
+      std::lock_guard<std::recursive_mutex> guard(*latch);
+      stream->write(offset, reinterpret_cast<const char*>(&header),
+                    sizeof(header));
+      stream->write(offset + sizeof(header), data, Page::DATA_SIZE);
+    };
+  }
+  return request;
+}
+
+void File::deletePage(const PageId page_number) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
+  if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages ||
+      !isInUse(page_number)) {
+    throw InvalidPageException(page_number, filename_);
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
+  // Clear the page and add it to the head of the free list.  first_used_page
+  // stays a valid lower bound, so the used pages need no updating.
+  Page existing_page;
   existing_page.set_next_page_number(header.first_free_page);
   header.first_free_page = page_number;
   ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
-  }
   writePage(page_number, existing_page);
+  header_->unwritten.erase(page_number);
   writeHeader(header);
 }
 
+PageId File::numPages() const {
+  return readHeader().num_pages;
+}
+
+PageId File::nextUsedPage(const PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  const FileHeader header = readHeader();
+  PageId next = std::max<PageId>(page_number + 1, header.first_used_page);
+  for (; next < header.num_pages; ++next) {
+    if (isInUse(next)) {
+      return next;
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
 FileIterator File::begin() {
-  const FileHeader& header = readHeader();
-  return FileIterator(this, header.first_used_page);
+  return FileIterator(this, nextUsedPage(Page::INVALID_NUMBER));
 }
 
 FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+File::File(const std::string& name, const bool create_new,
+           const StorageType storage, const bool checksums)
+    : filename_(name), storage_(storage), id_(0), detached_(false) {
   openIfNeeded(create_new);
 
   if (create_new) {
     // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+    FileHeader header = {FileHeader::MAGIC, FileHeader::VERSION,
+                         1 /* num_pages */, 0 /* first_used_page */,
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         checksums ? FileHeader::CHECKSUMS : 0 /* flags */,
+                         Page::SIZE /* page_size */};
+    std::lock_guard<std::recursive_mutex> guard(*latch_);
     writeHeader(header);
+    flushHeader();
   }
 }
 
+File::File(const std::string& name, const StorageType storage,
+           const OpenFile& entry)
+    : filename_(name), stream_(entry.stream), storage_(storage),
+      latch_(entry.latch), header_(entry.header), id_(entry.id),
+      detached_(true) {
+}
+
+void File::attach(OpenFile& entry) {
+  ++entry.count;
+  stream_ = entry.stream;
+  latch_ = entry.latch;
+  header_ = entry.header;
+  id_ = entry.id;
+  shared_ = entry.shared;
+}
+
+std::shared_ptr<File> File::shared() const {
+  if (detached_) {
+    return std::const_pointer_cast<File>(shared_from_this());
+  }
+  return shared_;
+}
+
 void File::openIfNeeded(const bool create_new) {
-  if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
-    ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+  std::lock_guard<std::mutex> guard(registry_latch_);
+  Registry::iterator open = open_files_.find(filename_);
+  if (open != open_files_.end()) {	//exists an entry already
+    attach(open->second);
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
     const bool already_exists = exists(filename_);
+    if (create_new && storage_ == StorageType::MAPPED) {
+      // A read-only mapping could not even write the new file's header.
+      throw IoException(filename_, "create", EROFS);
+    }
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
         throw FileExistsException(filename_);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
+      // the format on disk decides whether the file is compressed
+      if (CompressedBackend::isCompressed(filename_)) {
+        storage_ = StorageType::COMPRESSED;
+      } else {
+        if (storage_ == StorageType::COMPRESSED) {
+          storage_ = StorageType::POSIX;
+        }
+        migrate(filename_);
+      }
+    }
+    if (storage_ == StorageType::STREAM) {
+      stream_.reset(new StreamBackend(filename_, create_new));
+    } else if (storage_ == StorageType::MAPPED) {
+      stream_.reset(new MappedBackend(filename_));
+    } else if (storage_ == StorageType::COMPRESSED) {
+      stream_.reset(new CompressedBackend(filename_, create_new, Page::SIZE));
+    } else {
+      stream_.reset(new PosixBackend(filename_, create_new,
+                                     storage_ == StorageType::POSIX_DIRECT));
+    }
+    latch_.reset(new std::recursive_mutex);
+    header_.reset(new CachedHeader());
+    if (!create_new) {
+      stream_->read(0 /* pos */, reinterpret_cast<char*>(&header_->header),
+                    sizeof(header_->header));
+      const std::size_t page_size = header_->header.page_size == 0 ?
+          LEGACY_PAGE_SIZE : header_->header.page_size;
+      if (page_size != Page::SIZE) {
+        stream_.reset();
+        throw PageSizeException(filename_, page_size, Page::SIZE);
+      }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
-    open_counts_[filename_] = 1;
+    header_->dirty = false;
+    header_->written = std::chrono::steady_clock::now();
+    if (!create_new && storage_ != StorageType::MAPPED &&
+        (header_->header.flags & FileHeader::UNWRITTEN) != 0) {
+      // Not closed since pages were allocated unwritten: those never written
+      // are counted but in neither use nor the free list.
+      header_->header.flags &= ~FileHeader::UNWRITTEN;
+      rebuildHeader(1);
+    }
+    id_ = next_id_++;
+    OpenFile entry = {id_, 1, stream_, latch_, header_, NULL};
+    entry.shared.reset(new File(filename_, storage_, entry));
+    shared_ = entry.shared;
+    open_files_.emplace(filename_, entry);
   }
 }
 
 void File::close() {
-  if (stream_) {
-    --open_counts_[filename_];
+  if (detached_) {
+    // not counted in the registry entry, which may be gone already
     stream_.reset();
-    if (open_counts_[filename_] == 0) {
-      open_streams_.erase(filename_);
-      open_counts_.erase(filename_);
+    latch_.reset();
+    header_.reset();
+    return;
+  }
+  if (stream_) {
+    std::lock_guard<std::mutex> guard(registry_latch_);
+    Registry::iterator open = open_files_.find(filename_);
+    if (open->second.count == 1) {
+      std::lock_guard<std::recursive_mutex> latch(*latch_);
+      // No owner is left to write the pages still unwritten, and the header
+      // counts them: put them on disk as the empty pages they were allocated
+      // as, or they would be in neither use nor the free list once reopened.
+      Page page;
+      for (const PageId page_number : header_->unwritten) {
+        fillUnwritten(page_number, page);
+        writePage(page_number, page);
+      }
+      header_->unwritten.clear();
+      if ((header_->header.flags & FileHeader::UNWRITTEN) != 0) {
+        header_->header.flags &= ~FileHeader::UNWRITTEN;
+        header_->dirty = true;
+      }
+      flushHeader();
+      open_files_.erase(open);
+    } else {
+      --open->second.count;
     }
+    stream_.reset();
+    latch_.reset();
+    header_.reset();
+    shared_.reset();
   }
 }
 
+void File::sync() const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  flushHeader();
+  stream_->sync();
+}
+
 void File::writePage(const PageId page_number, const Page& new_page) {
-  writePage(page_number, new_page.header_, new_page);
+  writePage(page_number, *new_page.header_, new_page);
 }
 
 void File::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(new_page.data_.c_str(),
-                 Page::DATA_SIZE);
-  stream_->flush();
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  const std::uint64_t position = pagePosition(page_number);
+  PageHeader stamped = header;
+  stamped.checksum = 0;
+  if (hasChecksums()) {
+    stamped.checksum = pageChecksum(stamped, new_page.data_);
+  }
+  if (std::memcmp(&stamped, new_page.header_,
+                  offsetof(PageHeader, checksum)) == 0) {
+    // The page already carries the header to write, so the whole page is a
+    // single contiguous write.
+    new_page.header_->checksum = stamped.checksum;
+    stream_->write(position, reinterpret_cast<const char*>(new_page.header_),
+                   Page::SIZE);
+    return;
+  }
+  stream_->write(position, reinterpret_cast<const char*>(&stamped),
+                 sizeof(stamped));
+  stream_->write(position + sizeof(header), new_page.data_, Page::DATA_SIZE);
 }
 
 FileHeader File::readHeader() const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  return header_->header;
+}
+
+void File::writeHeader(const FileHeader& header) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  header_->header = header;
+  header_->dirty = true;
+  if (header_write_interval_.count() > 0 &&
+      std::chrono::steady_clock::now() - header_->written >=
+          header_write_interval_) {
+    flushHeader();
+  }
+}
+
+void File::flushHeader() const {
+  if (!header_->dirty) {
+    return;
+  }
+  stream_->write(0 /* pos */, reinterpret_cast<const char*>(&header_->header),
+                 sizeof(header_->header));
+  header_->dirty = false;
+  header_->written = std::chrono::steady_clock::now();
+}
+
+void File::migrate(const std::string& filename) {
+  // Version 1 had no magic number: a 16 byte header of num_pages,
+  // first_used_page, num_free_pages and first_free_page, then the pages, with
+  // the used ones linked in page number order.  Version 2 had the current file
+  // header and layout.  Both had 16 byte page headers without an LSN,
+  // version 3 had 24 byte page headers without the checksum, version 4 had
+  // no chain of unused slots, and versions 4 and 5 had 32 byte page headers
+  // without the page type.  Every old page header is a prefix of the current
+  // one.
+  struct LegacyHeader {
+    PageId num_pages;
+    PageId first_used_page;
+    PageId num_free_pages;
+    PageId first_free_page;
+  };
+
+  std::fstream legacy(filename, std::ios::in | std::ios::binary);
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  std::memset(&header, 0, sizeof(header));
+  legacy.read(reinterpret_cast<char*>(&header), sizeof(header));
+  std::uint64_t first_page_position = Page::SIZE;
+  if (header.magic == FileHeader::MAGIC) {
+    if (header.version > FileHeader::VERSION) {
+      throw FileFormatException(filename, header.version);
+    }
+    if (header.version == FileHeader::VERSION) {
+      return;
+    }
+  } else {
+    LegacyHeader old_header;
+    std::memcpy(&old_header, &header, sizeof(old_header));
+    header.magic = FileHeader::MAGIC;
+    header.version = 1;
+    header.num_pages = std::max<PageId>(old_header.num_pages, 1);
+    header.first_used_page = old_header.first_used_page;
+    header.num_free_pages = old_header.num_free_pages;
+    header.first_free_page = old_header.first_free_page;
+    first_page_position = sizeof(LegacyHeader);
+  }
+  // every file of the old versions has 8192 byte pages
+  if (Page::SIZE != LEGACY_PAGE_SIZE) {
+    throw PageSizeException(filename, LEGACY_PAGE_SIZE, Page::SIZE);
+  }
+  const std::uint32_t old_version = header.version;
+  const std::size_t legacy_page_header =
+      old_version < 3 ? 16 :
+      old_version < 4 ? offsetof(PageHeader, checksum) :
+      offsetof(PageHeader, page_type);
+  const std::size_t legacy_data_size = Page::SIZE - legacy_page_header;
+  const std::size_t shift = sizeof(PageHeader) - legacy_page_header;
+  header.version = FileHeader::VERSION;
+  if (old_version < 4) {
+    header.flags = 0;
+  }
+  header.page_size = Page::SIZE;
+  const bool checksums = (header.flags & FileHeader::CHECKSUMS) != 0;
+
+  // Write the new file next to the old one, then replace it, so that a crash
+  // leaves one complete file of either format.
+  const std::string migrated = filename + ".migrating";
+  {
+    std::fstream out(migrated, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<char> old_page(Page::SIZE);
+    Page page;
+    for (PageId page_number = 1; page_number < header.num_pages; ++page_number) {
+      std::fill(old_page.begin(), old_page.end(), 0);
+      legacy.clear();
+      legacy.seekg(first_page_position + (page_number - 1) * Page::SIZE);
+      legacy.read(old_page.data(), Page::SIZE);
+
+      // The data area shrinks by the growth of the header, which comes out of
+      // the free space.
+      page.initialize();
+      std::memcpy(page.header_, old_page.data(), legacy_page_header);
+      const char* old_data = old_page.data() + legacy_page_header;
+      bool damaged = false;
+      if (checksums) {
+        // A damaged page is kept as it is, for scrub() to report.  The
+        // checksum covers the old layout's bytes in order, with its own field
+        // zero, like pageChecksum() does the current one.
+        std::uint32_t stored;
+        std::memcpy(&stored, old_page.data() + offsetof(PageHeader, checksum),
+                    sizeof(stored));
+        std::vector<char> zeroed(old_page);
+        std::memset(zeroed.data() + offsetof(PageHeader, checksum), 0,
+                    sizeof(stored));
+        const bool blank = std::all_of(old_page.begin(),
+                                       old_page.begin() + legacy_page_header,
+                                       [](char c) { return c == 0; });
+        damaged = !blank && crc32c(0, zeroed.data(), Page::SIZE) != stored;
+      }
+      if (damaged) {
+        std::memcpy(page.header_, old_page.data(), Page::SIZE);
+      } else if (!page.isUsed()) {
+        page.header_->free_space_lower_bound = 0;
+        page.header_->free_space_upper_bound = Page::DATA_SIZE;
+        page.header_->num_slots = 0;
+        page.header_->num_free_slots = 0;
+      } else {
+        if (old_version == 1) {
+          // Used pages are no longer linked.
+          page.set_next_page_number(Page::INVALID_NUMBER);
+        }
+        const PageOffset lower = page.header_->free_space_lower_bound;
+        const PageOffset upper = page.header_->free_space_upper_bound;
+        if (upper > legacy_data_size || upper < lower + shift) {
+          throw FileFormatException(filename, old_version);
+        }
+        std::memcpy(page.data_, old_data, lower);
+        std::memcpy(page.data_ + upper - shift, old_data + upper,
+                    legacy_data_size - upper);
+        page.header_->free_space_upper_bound = upper - shift;
+        for (SlotId slot = 1; slot <= page.header_->num_slots; ++slot) {
+          if (page.getSlot(slot)->used) {
+            page.getSlot(slot)->item_offset -= shift;
+          }
+        }
+        page.rebuildFreeSlots();
+      }
+      if (checksums && !damaged) {
+        page.header_->checksum = pageChecksum(*page.header_, page.data_);
+      }
+      out.seekp(pagePosition(page_number));
+      out.write(reinterpret_cast<const char*>(page.header_), Page::SIZE);
+    }
+    out.flush();
+    if (!out) {
+      throw IoException(migrated, "write", EIO);
+    }
+  }
+  legacy.close();
+  if (std::rename(migrated.c_str(), filename.c_str()) != 0) {
+    throw IoException(filename, "rename", errno);
+  }
+}
 
-  return header;
+void File::rebuildHeader(const PageId num_pages) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
+  header.num_pages = std::max<PageId>(std::max(header.num_pages, num_pages), 1);
+  header.first_used_page = Page::INVALID_NUMBER;
+  header.num_free_pages = 0;
+  header.first_free_page = Page::INVALID_NUMBER;
+  for (PageId page_number = header.num_pages - 1; page_number > 0;
+       --page_number) {
+    PageHeader page_header = readPageHeader(page_number);
+    if (page_header.current_page_number != Page::INVALID_NUMBER) {
+      header.first_used_page = page_number;
+      continue;
+    }
+    if (page_header.next_page_number != header.first_free_page) {
+      // read without verification: a torn free page is rewritten anyway
+      Page page;
+      stream_->read(pagePosition(page_number),
+                    reinterpret_cast<char*>(page.header_), Page::SIZE);
+      page.set_next_page_number(header.first_free_page);
+      writePage(page_number, page);
+    }
+    header.first_free_page = page_number;
+    ++header.num_free_pages;
+  }
+  writeHeader(header);
+  flushHeader();
 }
 
-void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
+bool File::hasChecksums() const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  return (header_->header.flags & FileHeader::CHECKSUMS) != 0;
+}
+
+std::vector<PageId> File::scrub() const {
+  std::vector<PageId> damaged;
+  const PageId num_pages = readHeader().num_pages;
+  Page page;
+  for (PageId page_number = 1; page_number < num_pages; ++page_number) {
+    try {
+      readPage(page_number, true /* allow_free */, page);
+    } catch (const PageCorruptException&) {
+      damaged.push_back(page_number);
+      continue;
+    }
+    if (page.isUsed() && !page.isConsistent()) {
+      damaged.push_back(page_number);
+    }
+  }
+  return damaged;
+}
+
+std::vector<std::pair<PageId, PageId> > File::compact() {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
+  std::vector<PageId> used;
+  std::vector<PageId> free;
+  for (PageId page_number = 1; page_number < header.num_pages; ++page_number) {
+    if (isInUse(page_number)) {
+      used.push_back(page_number);
+    } else {
+      free.push_back(page_number);
+    }
+  }
+  std::vector<std::pair<PageId, PageId> > moves;
+  if (!free.empty()) {
+    // The free pages are about to be overwritten: unlink them from the free
+    // list on disk first, so that no crash leaves it leading to a page in use.
+    header.num_free_pages = 0;
+    header.first_free_page = Page::INVALID_NUMBER;
+    writeHeader(header);
+    flushHeader();
+    stream_->sync();
+  }
+  Page page;
+  for (std::size_t k = 0; k < free.size() && !used.empty() &&
+                          used.back() > free[k]; ++k) {
+    readPage(used.back(), false /* allow_free */, page);
+    page.set_page_number(free[k]);
+    writePage(free[k], page);
+    header_->unwritten.erase(used.back());
+    moves.push_back(std::make_pair(used.back(), free[k]));
+    used.pop_back();
+  }
+  // Pages 1 to used.size() are now the pages in use; the rest go.
+  header.num_pages = static_cast<PageId>(used.size() + moves.size()) + 1;
+  header.first_used_page = header.num_pages > 1 ? 1 : Page::INVALID_NUMBER;
+  stream_->sync();
+  writeHeader(header);
+  flushHeader();
+  stream_->sync();
+  stream_->truncate(pagePosition(header.num_pages));
+  header_->reserved = pagePosition(header.num_pages);
+  return moves;
+}
+
+std::uint32_t File::pageChecksum(const PageHeader& header, const char* data) {
+  PageHeader zeroed = header;
+  zeroed.checksum = 0;
+  const std::uint32_t crc = crc32c(0, &zeroed, sizeof(zeroed));
+  return crc32c(crc, data, Page::DATA_SIZE);
+}
+
+void File::verifyPage(const PageId page_number, const Page& page,
+                      const bool checksums, const std::string& filename) {
+  if (!checksums) {
+    return;
+  }
+  static const PageHeader blank = PageHeader();
+  if (std::memcmp(page.header_, &blank, sizeof(blank)) == 0) {
+    return;
+  }
+  if (pageChecksum(*page.header_, page.data_) != page.header_->checksum) {
+    throw PageCorruptException(page_number, filename);
+  }
+}
+
+bool File::isInUse(const PageId page_number) const {
+  return readPageHeader(page_number).current_page_number != Page::INVALID_NUMBER ||
+         header_->unwritten.count(page_number) > 0;
+}
+
+bool File::fillUnwritten(const PageId page_number, Page& page) const {
+  if (header_->unwritten.count(page_number) == 0) {
+    return false;
+  }
+  page.initialize();
+  page.set_page_number(page_number);
+  return true;
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  stream_->read(pagePosition(page_number), reinterpret_cast<char*>(&header),
+                sizeof(header));
 
   return header;
 }
@@ -10,12 +10,20 @@
 
 #pragma once
 
+#include <chrono>
 #include <fstream>
 #include <string>
-#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "page.h"
+#include "io_engine.h"
+#include "storage_backend.h"
 
 namespace badgerdb {
 
@@ -23,15 +31,58 @@ class FileIterator;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
+ *
+ * The header is stored at the start of page 0, which is reserved for it, so
+ * that every data page starts at a multiple of Page::SIZE.
  */
 struct FileHeader {
   /**
-   * Number of pages allocated in the file.
+   * Value of <magic> in every file of the current format.
+   */
+  static const std::uint32_t MAGIC = 0x46424442;
+
+  /**
+   * Format version written by this version of BadgerDB.  Files without the
+   * magic number are version 1 (a bare header in front of the pages, with the
+   * used pages kept in a linked list); version 2 had no page LSNs,
+   * version 3 no page checksums, version 4 no chain of unused slots and
+   * version 5 no page types.  All are migrated when opened.
+   */
+  static const std::uint32_t VERSION = 6;
+
+  /**
+   * Flag set in <flags> if every page written carries a checksum.
+   */
+  static const std::uint32_t CHECKSUMS = 1;
+
+  /**
+   * Flag set in <flags> once a page has been allocated unwritten (see
+   * File::allocateUnwritten()), and cleared by the last close(), which writes
+   * any still unwritten.  A file opened with it set was not closed, e.g. after a crash, and
+   * pages counted in <num_pages> may be in neither use nor the free list;
+   * opening it rebuilds the free list.
+   */
+  static const std::uint32_t UNWRITTEN = 2;
+
+  /**
+   * Identifies the file as a BadgerDB file; always MAGIC.
+   */
+  std::uint32_t magic;
+
+  /**
+   * Format version of the file.
+   */
+  std::uint32_t version;
+
+  /**
+   * Number of pages allocated in the file, including the header page.
    */
   PageId num_pages;
 
   /**
-   * Page number of the first used page in the file.
+   * No page below this number is in use.  A lower bound rather than the exact
+   * first used page, so that deleting pages never has to search for the next
+   * one.
    */
   PageId first_used_page;
 
@@ -45,6 +96,17 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * Options the file was created with, such as CHECKSUMS.
+   */
+  std::uint32_t flags;
+
+  /**
+   * Page::SIZE of the build that created the file.  Zero in files written
+   * before the size was recorded, all of which have 8192 byte pages.
+   */
+  std::uint32_t page_size;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -52,10 +114,14 @@ struct FileHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const FileHeader& rhs) const {
-    return num_pages == rhs.num_pages &&
+    return magic == rhs.magic &&
+        version == rhs.version &&
+        num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        flags == rhs.flags &&
+        page_size == rhs.page_size;
   }
 };
 
@@ -63,37 +129,86 @@ struct FileHeader {
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a storage backend (a stream or a POSIX file
+ * descriptor, see StorageType) for an underlying file on disk.  Files contain
+ * fixed-sized pages, and they only give space back through compact() (though
+ * they do reuse deleted pages if possible).  Deleted pages form a free list; a page is in
+ * use exactly when its header carries its own page number, so allocating and
+ * deleting a page take constant time and iteration visits the used pages in
+ * page number order.  If multiple File objects refer to the same
+ * underlying file, they will share the backend in memory.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the registry of open files) and just returns a file object with
+ * the already created backend for the file without actually opening the UNIX file again.
+ * Every open file has a small integer identifier, id(), shared by all File
+ * objects for it; the buffer manager and iterators tell files apart by it.
+ *
+ * A file opened through StorageType::MAPPED is read-only: pages are handed
+ * out in place in the mapping (mappedPage(), viewPage(), and the pages a
+ * FileIterator yields), and allocating, writing or deleting pages throws
+ * IoException.
  *
- * @warning This class is not threadsafe.
+ * The file header is cached in memory, shared by all File objects for the
+ * same filename, and written back by sync(), by the last close(), or by an
+ * update once the header write interval has passed since the last write.
+ * Disk space for pages added at the end is reserved EXTENT_SIZE bytes at a
+ * time, and a page allocated with allocateUnwritten() is not written until
+ * its owner writes it, so a growing file costs one write per page, made
+ * when the page is written back.
+ *
+ * Page and header I/O on a file is serialized by a latch shared between all
+ * File objects for the same filename, so those methods may be called from
+ * several threads.  Opening, closing and copying File objects go through the
+ * registry under one latch, so they are threadsafe too; a single File object
+ * must still not be closed or assigned while another thread uses it.
  */
-class File {
+class File : public std::enable_shared_from_this<File> {
  public:
+  /**
+   * Bytes of disk space reserved at once when the file grows past the space
+   * reserved so far.
+   */
+  static const std::uint64_t EXTENT_SIZE = 4 << 20;
+
   /**
    * Creates a new file.
    *
+   * With <checksums> set, every page written to the file carries a CRC-32C
+   * of its contents, and a page read back that does not match it raises
+   * PageCorruptException.
+   *
    * @param filename  Name of the file.
+   * @param storage   Storage backend to access the file through.
+   * @param checksums Whether to checksum the pages of the file.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string& filename);
+  static File create(const std::string& filename,
+                     const StorageType storage = StorageType::STREAM,
+                     const bool checksums = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
 	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
-	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * that already open file. Reference count (count of the file's entry in the registry of open files) is incremented whenever an already open file is
+	 * opened again. Otherwise the UNIX file is actually opened, and the file's backend and a new identifier are entered into the
+	 * registry.
+   *
+   * If the file is already open, the new File object shares the existing
+   * backend and <storage> is ignored.
+   *
+   * A file in the previous format version is migrated to the current one in
+   * place, keeping its page numbers.  A compressed file is opened through
+   * StorageType::COMPRESSED whatever <storage> says.
    *
    * @param filename  Name of the file.
+   * @param storage   Storage backend to access the file through.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileFormatException     If the file has a newer format version.
+   * @throws  PageSizeException       If the file's pages are not Page::SIZE
+   *                                  bytes.
    */
-  static File open(const std::string& filename);
+  static File open(const std::string& filename,
+                   const StorageType storage = StorageType::STREAM);
 
   /**
    * Deletes an existing file.
@@ -113,12 +228,21 @@ class File {
 
 
   /**
-   * Returns true if the file exists and is open.
+   * Returns true if the file exists, checked with stat() without opening it.
    *
    * @param filename  Name of the file.
    */
   static bool exists(const std::string& filename);
 
+  /**
+   * Sets how long a changed file header may stay in memory only.  An update
+   * made at least <interval> after the header was last written writes it
+   * through; a zero interval leaves write-back to sync() and close().
+   *
+   * @param interval  Maximum age of an unwritten header update.
+   */
+  static void setHeaderWriteInterval(const std::chrono::milliseconds interval);
+
   /**
    * Copy constructor.
    * 
@@ -136,12 +260,18 @@ class File {
   File& operator=(const File& rhs);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying storage backend in <stream_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
   void close();
 
+  /**
+   * Writes the cached file header back if it changed and syncs the storage
+   * backend, so that everything written to the file so far is durable.
+   */
+  void sync() const;
+
   /**
    * Destructor that automatically closes the underlying file if no other
    * File objects are using it.
@@ -155,6 +285,29 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates a new page in the file, initializing it in place in the given
+   * page object (typically a buffer pool frame) instead of returning a copy.
+   *
+   * @param new_page  Page object that receives the new page.
+   * @return  Number of the new page.
+   */
+  PageId allocatePage(Page& new_page);
+
+  /**
+   * Allocates a new page as allocatePage() does, but leaves the page on disk
+   * as it was: <new_page> is the only copy, such as a buffer pool frame that
+   * will be written back, until it is written with writePage() or
+   * writePages().  Meanwhile reads of the page give an empty page, as
+   * allocated.  The last close() writes the page as that empty page if it
+   * is still unwritten.  A crash before the page is written loses it, and
+   * the next open puts it on the free list (see FileHeader::UNWRITTEN).
+   *
+   * @param new_page  Page object that receives the new page.
+   * @return  Number of the new page.
+   */
+  PageId allocateUnwritten(Page& new_page);
+
   /**
    * Reads an existing page from the file.
    *
@@ -165,6 +318,61 @@ class File {
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file directly into the given page object
+   * (typically a buffer pool frame), without creating a temporary page.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page object that receives the page contents.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPage(const PageId page_number, Page& page) const;
+
+  /**
+   * Reads consecutive existing pages with a single read of the file, each
+   * into the given page object, checking every page as readPage() would.
+   *
+   * @param first   Number of the first page to read.
+   * @param pages   Page objects that receive pages first, first + 1, ...
+   * @throws  InvalidPageException  If a page doesn't exist in the file or is
+   *                                not currently used; the page objects'
+   *                                contents are undefined then.
+   */
+  void readPages(const PageId first, std::span<Page* const> pages) const;
+
+  /**
+   * Returns true if the file is open through StorageType::MAPPED, so that its
+   * pages can be used in place with mappedPage().
+   */
+  bool isMapped() const;
+
+  /**
+   * Returns the address of an existing page in the mapping of a file opened
+   * through StorageType::MAPPED, after checking it as readPage() would.  The
+   * Page::SIZE bytes there are read-only, and stay valid until the last File
+   * object for the file is closed.
+   *
+   * @param page_number   Number of page to find.
+   * @return  Start of the page's bytes in the mapping.
+   * @throws  InvalidPageException  If the file is not mapped, or the page
+   *                                doesn't exist in the file or is not
+   *                                currently used.
+   */
+  char* mappedPage(const PageId page_number) const;
+
+  /**
+   * Returns an existing page for reading: a view of the page in the mapping
+   * if the file is mapped (see mappedPage()), a copy read from the file
+   * otherwise.  A view must not be modified.
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  Page viewPage(const PageId page_number) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
@@ -174,6 +382,44 @@ class File {
    */
   void writePage(const Page& new_page);
 
+  /**
+   * Writes several pages into the file, each like writePage(): a page
+   * deleted since it was read is refused.  Runs of consecutive page numbers
+   * go to the file in a single write each.
+   *
+   * @param pages   Pages to write, best in ascending page number order.
+   * @throws  InvalidPageException  If a page is not in the file or not in use;
+   *                                no page has been written then.
+   */
+  void writePages(const std::vector<const Page*>& pages);
+
+  /**
+   * Builds an asynchronous read of an existing page into the given page object
+   * for submission to an IoEngine.  The page must stay alive, and must not be
+   * touched, until the request completes.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page object that receives the page contents.
+   * @param done          Completion callback; receives InvalidPageException if
+   *                      the page turns out not to be in use.
+   * @return  The request.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  IoRequest readPageRequest(const PageId page_number, Page& page,
+                            IoCallback done) const;
+
+  /**
+   * Builds an asynchronous write of a page for submission to an IoEngine, with
+   * the semantics of writePage().  The page must stay alive, and must not be
+   * modified, until the request completes.
+   *
+   * @param new_page  Page to write.
+   * @param done      Completion callback.
+   * @return  The request.
+   * @throws  InvalidPageException  If the page has been deleted from the file.
+   */
+  IoRequest writePageRequest(const Page& new_page, IoCallback done);
+
   /**
    * Deletes a page from the file.
    *
@@ -188,6 +434,29 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns the identifier of the open file.  All File objects open on the
+   * same filename share it, and no other file opened in this process ever
+   * has it, so it can stand in for the filename as a key.
+   *
+   * @return Identifier of file.
+   */
+  FileId id() const { return id_; }
+
+  /**
+   * Returns a handle on the open file to hold on to beyond the life of this
+   * object.  It keeps the backend, latch and cached header alive and reads
+   * and writes pages as this object would, but does not keep the file open:
+   * the last close() of the File objects opened on it still writes the
+   * header back and ends the registry entry.  All File objects open on the
+   * same filename return the same handle.  The buffer pool keeps it for each
+   * frame, so that a page can be written back after the File object it was
+   * read through is gone.
+   *
+   * @return Shared handle on the file; NULL if this object is not open.
+   */
+  std::shared_ptr<File> shared() const;
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -203,6 +472,48 @@ class File {
    */
   FileIterator end();
 
+  /**
+   * Returns true if the pages of this file carry checksums.
+   */
+  bool hasChecksums() const;
+
+  /**
+   * Returns the number of pages allocated in the file, including the header
+   * page and pages not in use; every page number in use is below it.
+   */
+  PageId numPages() const;
+
+  /**
+   * Reads every page of the file and returns the numbers of those that are
+   * damaged: pages that do not match their checksum, and pages whose header
+   * or slot array is inconsistent (see Page::isConsistent()).  Pages never
+   * written are not reported.
+   *
+   * @return  Numbers of the damaged pages, in ascending order.
+   */
+  std::vector<PageId> scrub() const;
+
+  /**
+   * Moves the pages in use down into the free pages before them, the last
+   * page into the first free one, until the pages in use are pages 1 up to
+   * some page with none free between them, then shortens the file to them.
+   * A moved page keeps its contents and gets the number of its new place, so
+   * RecordIds on it change page number.  Callers must not use the file
+   * concurrently; the page images on disk are the ones moved.
+   *
+   * The move is not crash safe.  The free pages are first unlinked from
+   * the free list on disk, then the moved pages are written and synced, then
+   * the new header, and only then is the file shortened.  A crash part way
+   * never leaves the free list or the page count leading to a page in use,
+   * but it may leave a moved page at both places, and the free pages unlinked
+   * lost to reuse until the file is compacted again.  Replaying a log of
+   * changes made before the move may likewise bring pages back, which is why
+   * BufMgr::defragment() checkpoints after it.
+   *
+   * @return  Old and new number of each page moved, in the order moved.
+   */
+  std::vector<std::pair<PageId, PageId> > compact();
+
  private:
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -211,10 +522,31 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static std::uint64_t pagePosition(const PageId page_number) {
+    // Page 0 holds the file header.
+    return static_cast<std::uint64_t>(page_number) * Page::SIZE;
   }
 
+  /**
+   * Returns the first page in use after the given one.
+   *
+   * @param page_number   Page to start after; INVALID_NUMBER for the first.
+   * @return  Number of the next used page, or INVALID_NUMBER if there is none.
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
+  /**
+   * Rewrites a file of an older format version in the current format, keeping
+   * the number and contents of every page.  Does nothing to current files.
+   *
+   * @param filename  Name of the file, which must not be open.
+   * @throws  FileFormatException   If the file has a newer format version, or
+   *                                a page too full to take the LSN.
+   * @throws  PageSizeException     If the file is of an older version and
+   *                                Page::SIZE is not 8192.
+   */
+  static void migrate(const std::string& filename);
+
   /**
    * Constructs a file object representing a file on the filesystem.
    * This method should not be called directly; instead use the static methods
@@ -224,23 +556,51 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param storage     Storage backend to access the file through.
+   * @param checksums   Whether a new file checksums its pages.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const StorageType storage, const bool checksums = false);
+
+  /**
+   * Returns the checksum of a page with the given header and data, computed
+   * with the header's checksum field taken as zero.
+   *
+   * @param header  Header of the page.
+   * @param data    The page's <Page::DATA_SIZE> bytes of data.
+   * @return  CRC-32C of the page.
+   */
+  static std::uint32_t pageChecksum(const PageHeader& header, const char* data);
+
+  /**
+   * Checks a page just read against its checksum, if the file has them.  A
+   * page whose header is all zero was never written and is not checked.
+   *
+   * @param page_number   Number of the page.
+   * @param page          The page as read.
+   * @param checksums     Whether the file has checksums.
+   * @param filename      Name of the file, for the exception.
+   * @throws  PageCorruptException  If the page does not match its checksum.
+   */
+  static void verifyPage(const PageId page_number, const Page& page,
+                         const bool checksums, const std::string& filename);
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing backend.
    *
    * @param create_new  Whether to create a new file.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  PageSizeException       If the file's pages are not Page::SIZE
+   *                                  bytes.
    */
   void openIfNeeded(const bool create_new);
 
@@ -259,6 +619,19 @@ class File {
    */
   Page readPage(const PageId page_number, const bool allow_free) const;
 
+  /**
+   * Reads a page from the file into the given page object.  Behaves like
+   * readPage(page_number, allow_free) otherwise.
+   *
+   * @param page_number   Number of page to read.
+   * @param allow_free    Whether to allow reading a free (unused) page.
+   * @param page          Page object that receives the page contents.
+   * @throws  InvalidPageException  If the page is free (unused) and
+   *                                allow_free is false.
+   */
+  void readPage(const PageId page_number, const bool allow_free,
+                Page& page) const;
+
   /**
    * Writes a page into the file at the given page number.  This does not
    * update ensure that the number in the header equals the position on disk.
@@ -282,19 +655,36 @@ class File {
                  const Page& new_page);
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the cached header for this file.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Replaces the cached header for this file.  It reaches the disk at the
+   * next sync() or close(), or now if the header write interval has passed.
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader& header);
 
+  /**
+   * Writes the cached header to disk if it has changed since it was last
+   * written.  The caller must hold <latch_>.
+   */
+  void flushHeader() const;
+
+  /**
+   * Recomputes the file header from the page headers on disk, after a crash
+   * may have left the header on disk behind the pages.  The free list is
+   * rebuilt in page number order.
+   *
+   * @param num_pages   Lower bound on the number of pages in the file,
+   *                    including the header page.
+   */
+  void rebuildHeader(const PageId num_pages);
+
   /**
    * Reads only the header of the given page from disk (not the record data
    * or slot table).  No bounds checking is performed.
@@ -304,19 +694,138 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
-  typedef std::map<std::string, int> CountMap;
+  /**
+   * Returns true if a page is in use: its header on disk carries its number,
+   * or it was allocated and is yet to be written.  The caller must hold
+   * <latch_>.
+   *
+   * @param page_number   Number of page.
+   */
+  bool isInUse(const PageId page_number) const;
+
+  /**
+   * Turns <page>, just read from disk, into the empty page it was allocated
+   * as if it was allocated and is yet to be written.  The caller must hold
+   * <latch_>.
+   *
+   * @param page_number   Number of page read.
+   * @param page          The page read.
+   * @return  Whether the page is such a page.
+   */
+  bool fillUnwritten(const PageId page_number, Page& page) const;
+
+  /**
+   * Takes a page number to allocate: the head of the free list, or a new
+   * page at the end, for which space is reserved an extent at a time.  The
+   * caller must hold <latch_>, and writes <header> once the page is set up.
+   *
+   * @param header  Copy of the file header, updated for the allocation.
+   * @return  Number of the page.
+   */
+  PageId takePage(FileHeader& header);
+
+  /**
+   * In-memory copy of a file's header.
+   */
+  struct CachedHeader {
+    /**
+     * Current header.
+     */
+    FileHeader header;
+
+    /**
+     * Whether <header> differs from the one on disk.
+     */
+    bool dirty;
+
+    /**
+     * When the header was last written to disk.
+     */
+    std::chrono::steady_clock::time_point written;
+
+    /**
+     * Pages allocated by allocateUnwritten() and not written yet.
+     */
+    std::set<PageId> unwritten;
+
+    /**
+     * End of the disk space reserved for the file so far.
+     */
+    std::uint64_t reserved;
+  };
+
+  /**
+   * Entry of an open file in the registry, shared by all File objects for it.
+   */
+  struct OpenFile {
+    /**
+     * Identifier of the file while it is open.
+     */
+    FileId id;
+
+    /**
+     * Number of File objects open on the file.
+     */
+    int count;
+
+    /**
+     * Storage backend of the file.
+     */
+    std::shared_ptr<StorageBackend> stream;
+
+    /**
+     * I/O latch of the file.
+     */
+    std::shared_ptr<std::recursive_mutex> latch;
+
+    /**
+     * Cached header of the file.
+     */
+    std::shared_ptr<CachedHeader> header;
+
+    /**
+     * Handle on the file returned by shared().
+     */
+    std::shared_ptr<File> shared;
+  };
+  typedef std::unordered_map<std::string, OpenFile> Registry;
+
+  /**
+   * Joins this object to the registry entry of an open file.  The caller
+   * holds <registry_latch_>.
+   */
+  void attach(OpenFile& entry);
+
+  /**
+   * Creates the handle of a registry entry returned by shared(), which is
+   * not counted in the entry.
+   *
+   * @param name     Name of the file.
+   * @param storage  Backend type of the file.
+   * @param entry    Registry entry of the file.
+   */
+  File(const std::string& name, const StorageType storage,
+       const OpenFile& entry);
+
+  /**
+   * Open files by name.
+   */
+  static Registry open_files_;
+
+  /**
+   * Latch protecting <open_files_> and <next_id_>.
+   */
+  static std::mutex registry_latch_;
 
   /**
-   * Streams for opened files.
+   * Maximum age of an unwritten header update; zero for no limit.
    */
-  static StreamMap open_streams_;
+  static std::chrono::milliseconds header_write_interval_;
 
   /**
-   * Counts for opened files.
+   * Identifier for the next file opened.
    */
-  static CountMap open_counts_;
+  static FileId next_id_;
 
   /**
    * Name of the file this object represents.
@@ -324,12 +833,44 @@ class File {
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Storage backend for underlying filesystem object.
+   */
+  std::shared_ptr<StorageBackend> stream_;
+
+  /**
+   * Backend type to use when this object has to open the file itself.
+   */
+  StorageType storage_;
+
+  /**
+   * Latch serializing all use of stream_.  Recursive because compound
+   * operations such as allocatePage() call the primitive readers and writers.
+   */
+  std::shared_ptr<std::recursive_mutex> latch_;
+
+  /**
+   * Cached header of the file, guarded by <latch_>.
+   */
+  std::shared_ptr<CachedHeader> header_;
+
+  /**
+   * Identifier of the open file.
+   */
+  FileId id_;
+
+  /**
+   * Handle returned by shared(); NULL for that handle itself.
+   */
+  std::shared_ptr<File> shared_;
+
+  /**
+   * Whether this object is the handle of a registry entry, not counted in it.
    */
-  std::shared_ptr<std::fstream> stream_;
+  bool detached_;
 
   friend class FileIterator;
   friend class FileTest;
+  friend class LogManager;
 };
 
 }
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
 #include "file.h"
 #include "page.h"
 #include "types.h"
@@ -42,8 +43,7 @@ class FileIterator {
   FileIterator(File* file)
       : file_(file) {
     assert(file_ != NULL);
-    const FileHeader& header = file_->readHeader();
-    current_page_number_ = header.first_used_page;
+    current_page_number_ = file_->nextUsedPage(Page::INVALID_NUMBER);
   }
 
   /**
@@ -58,13 +58,37 @@ class FileIterator {
         current_page_number_(page_number) {
   }
 
+  /**
+   * Copy constructor.  The copy is at the same page but does not share the
+   * page buffer of <other>.
+   *
+   * @param other   Iterator to copy.
+   */
+  FileIterator(const FileIterator& other)
+      : file_(other.file_),
+        current_page_number_(other.current_page_number_) {
+  }
+
+  /**
+   * Assignment operator.  Drops this iterator's page buffer, which may be a
+   * view into another file.
+   *
+   * @param rhs   Iterator to copy.
+   * @return  This iterator.
+   */
+  FileIterator& operator=(const FileIterator& rhs) {
+    file_ = rhs.file_;
+    current_page_number_ = rhs.current_page_number_;
+    page_.reset();
+    return *this;
+  }
+
   /**
    * Advances the iterator to the next page in the file.
    */
 	inline FileIterator& operator++() {
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = file_->nextUsedPage(current_page_number_);
 
 		return *this;
 	}
@@ -75,8 +99,7 @@ class FileIterator {
 		FileIterator tmp = *this;   // copy ourselves
 
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = file_->nextUsedPage(current_page_number_);
 
 		return tmp;
 	}
@@ -88,23 +111,41 @@ class FileIterator {
    * @return    True if other iterator is equal to this one.
    */
 	inline bool operator==(const FileIterator& rhs) const {
-    return file_->filename() == rhs.file_->filename() &&
+    return file_->id() == rhs.file_->id() &&
         current_page_number_ == rhs.current_page_number_;
   }
 
 	inline bool operator!=(const FileIterator& rhs) const {
-    return (file_->filename() != rhs.file_->filename()) ||
+    return (file_->id() != rhs.file_->id()) ||
         (current_page_number_ != rhs.current_page_number_);
   }
 
   /**
-   * Dereferences the iterator, returning a copy of the current page in the
-   * file.
+   * Dereferences the iterator, returning the current page in the file: a
+   * view into the mapping for a mapped file, otherwise the page read into a
+   * buffer the iterator keeps and reuses, so a scan copies no whole pages
+   * around.  The page is the iterator's own; it is valid until the iterator
+   * is dereferenced again or destroyed, and changes made to it do not reach
+   * the file.
    *
    * @return  Page in file.
    */
-	inline Page operator*() const
-  { return file_->readPage(current_page_number_); }
+	inline Page& operator*() const
+  {
+    assert(file_ != NULL);
+    if (file_->isMapped()) {
+      // a view is always current, so only a new page needs a new one
+      if (!page_ || page_->page_number() != current_page_number_) {
+        page_.reset(new Page(file_->mappedPage(current_page_number_)));
+      }
+    } else {
+      if (!page_) {
+        page_.reset(new Page());
+      }
+      file_->readPage(current_page_number_, *page_);
+    }
+    return *page_;
+  }
 
  private:
   /**
@@ -116,6 +157,11 @@ class FileIterator {
    * Number of page in file iterator is currently pointing to.
    */
   PageId current_page_number_;
+
+  /**
+   * Page last returned by operator*(), or NULL before the first call.
+   */
+  mutable std::unique_ptr<Page> page_;
 };
 
 }
@@ -0,0 +1,139 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "freeSpaceMap.h"
+#include "file_iterator.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+const std::uint32_t FreeSpaceMap::PAGES_PER_MAP_PAGE;
+const std::size_t FreeSpaceMap::BYTES_PER_CATEGORY;
+
+FreeSpaceMap::FreeSpaceMap(const std::string& filename)
+  : map(openMap(mapName(filename))), hint(0)
+{
+  // map pages are allocated in order and never deleted, so map page k
+  // describes data pages from k * PAGES_PER_MAP_PAGE on
+  for (FileIterator iter = map.begin(); iter != map.end(); ++iter)
+  {
+    Page mapPage = *iter;
+    const std::size_t k = mapPage.page_number() - 1;
+    const std::string entries = mapPage.getRecord({mapPage.page_number(), 1});
+    categories.resize((k + 1) * PAGES_PER_MAP_PAGE);
+    std::memcpy(&categories[k * PAGES_PER_MAP_PAGE], entries.data(),
+                std::min<std::size_t>(entries.size(), PAGES_PER_MAP_PAGE));
+    largest.resize(k + 1);
+    largest[k] = *std::max_element(categories.begin() + k * PAGES_PER_MAP_PAGE,
+                                   categories.end());
+  }
+  changed.assign(largest.size(), false);
+}
+
+FreeSpaceMap::~FreeSpaceMap()
+{
+  flush();
+}
+
+File FreeSpaceMap::openMap(const std::string& name)
+{
+  if (File::exists(name)) {
+    return File::open(name);
+  }
+  return File::create(name);
+}
+
+PageId FreeSpaceMap::findPage(const std::size_t bytes)
+{
+  const std::size_t wanted = (bytes + BYTES_PER_CATEGORY - 1) / BYTES_PER_CATEGORY;
+  if (wanted > UINT8_MAX) {
+    return Page::INVALID_NUMBER;
+  }
+  for (std::size_t n = 0; n < largest.size(); n++)
+  {
+    const std::size_t k = (hint + n) % largest.size();
+    if (largest[k] < wanted) {
+      continue;
+    }
+    for (std::size_t i = k * PAGES_PER_MAP_PAGE; i < (k + 1) * PAGES_PER_MAP_PAGE; i++)
+    {
+      if (categories[i] >= wanted) {
+        hint = k;
+        return static_cast<PageId>(i);
+      }
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void FreeSpaceMap::update(const PageId pageNo, const std::size_t freeBytes)
+{
+  const std::uint8_t category = static_cast<std::uint8_t>(
+      std::min<std::size_t>(freeBytes / BYTES_PER_CATEGORY, UINT8_MAX));
+  const std::size_t k = pageNo / PAGES_PER_MAP_PAGE;
+  if (k >= largest.size()) {
+    if (category == 0) {
+      return;
+    }
+    categories.resize((k + 1) * PAGES_PER_MAP_PAGE);
+    largest.resize(k + 1);
+    changed.resize(k + 1, true);
+  }
+  const std::uint8_t old = categories[pageNo];
+  if (old == category) {
+    return;
+  }
+  categories[pageNo] = category;
+  changed[k] = true;
+  if (category > largest[k]) {
+    largest[k] = category;
+  } else if (old == largest[k]) {
+    largest[k] = *std::max_element(categories.begin() + k * PAGES_PER_MAP_PAGE,
+                                   categories.begin() + (k + 1) * PAGES_PER_MAP_PAGE);
+  }
+}
+
+void FreeSpaceMap::move(const PageId from, const PageId to)
+{
+  const std::size_t freeBytes =
+      from < categories.size() ? categories[from] * BYTES_PER_CATEGORY : 0;
+  update(from, 0);
+  update(to, freeBytes);
+}
+
+void FreeSpaceMap::flush()
+{
+  for (std::size_t k = 0; k < changed.size(); k++)
+  {
+    if (!changed[k]) {
+      continue;
+    }
+    const PageId pageNo = static_cast<PageId>(k + 1);
+    const std::string entries(
+        reinterpret_cast<const char*>(&categories[k * PAGES_PER_MAP_PAGE]),
+        PAGES_PER_MAP_PAGE);
+    Page mapPage;
+    try {
+      map.readPage(pageNo, mapPage);
+      mapPage.updateRecord({pageNo, 1}, entries);
+    } catch (const InvalidPageException&) {
+      // map pages are changed in order, so the next new one is pageNo
+      map.allocatePage(mapPage);
+      mapPage.insertRecord(entries);
+    }
+    map.writePage(mapPage);
+    changed[k] = false;
+  }
+}
+
+}
@@ -0,0 +1,137 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+* @brief Free space category of every page of a heap file
+*
+* One byte per data page records how much space the page has free, in units of
+* BYTES_PER_CATEGORY and rounded down, so a page is never thought to have more
+* room than it had when last reported.  The map lives in its own file next to
+* the data file (the file name with ".fsm" appended), PAGES_PER_MAP_PAGE
+* entries in one record on each of its pages, and a summary of the largest
+* category on each map page lets findPage() skip map pages that cannot help.
+*
+* The map is only as current as the updates it is given; users must check the
+* page they are handed and report its real free space if it does not fit.
+* Not threadsafe.
+*/
+class FreeSpaceMap
+{
+ public:
+	/**
+   * Data pages described by one page of the map; half a page, so that the
+   * record fits whatever Page::SIZE is
+	 */
+  static const std::uint32_t PAGES_PER_MAP_PAGE = Page::SIZE / 2;
+
+	/**
+   * Bytes of free space per category step, so that the 256 categories span
+   * a page
+	 */
+  static const std::size_t BYTES_PER_CATEGORY = Page::SIZE / 256;
+
+	/**
+   * Opens the map of a data file, creating an empty one if there is none.
+   *
+   * @param filename  Name of the data file
+	 */
+  explicit FreeSpaceMap(const std::string& filename);
+
+	/**
+   * Writes back the map and closes its file.
+	 */
+  ~FreeSpaceMap();
+
+	/**
+   * Returns the name of the file holding the map of a data file.
+   *
+   * @param filename  Name of the data file
+   * @return  Name of the map file
+	 */
+  static std::string mapName(const std::string& filename) {
+    return filename + ".fsm";
+  }
+
+	/**
+   * Finds a data page with at least the given free space, according to the
+   * map.  Searches on from the map page of the last page found, so that
+   * consecutive inserts fill one page after the other.
+   *
+   * @param bytes  Space needed
+   * @return  Number of such a page, or Page::INVALID_NUMBER if there is none
+	 */
+  PageId findPage(const std::size_t bytes);
+
+	/**
+   * Records the free space of a data page.
+   *
+   * @param pageNo     Number of the data page
+   * @param freeBytes  Bytes now free on it; zero for a deleted page
+	 */
+  void update(const PageId pageNo, const std::size_t freeBytes);
+
+	/**
+   * Records that a data page was moved to another number, which takes over
+   * its free space; the old number is left with none.
+   *
+   * @param from  Old number of the data page
+   * @param to    Its new number
+	 */
+  void move(const PageId from, const PageId to);
+
+	/**
+   * Writes the map pages changed since the last flush to the map file.
+	 */
+  void flush();
+
+ private:
+	/**
+   * Opens the map file, or creates it if it does not exist.
+	 */
+  static File openMap(const std::string& name);
+
+	/**
+   * File holding the map
+	 */
+  File map;
+
+	/**
+   * Category of every data page, PAGES_PER_MAP_PAGE per map page
+	 */
+  std::vector<std::uint8_t> categories;
+
+	/**
+   * Largest category on each map page
+	 */
+  std::vector<std::uint8_t> largest;
+
+	/**
+   * Whether each map page changed since the last flush
+	 */
+  std::vector<bool> changed;
+
+	/**
+   * Map page of the page findPage() found last
+	 */
+  std::size_t hint;
+};
+
+}
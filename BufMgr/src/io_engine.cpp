@@ -0,0 +1,510 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#include "exceptions/io_exception.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BADGERDB_HAVE_IO_URING 1
+#include <atomic>
+#include <limits>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+namespace badgerdb {
+
+std::future<void> IoEngine::submit(IoRequest request) {
+  std::shared_ptr<std::promise<void>> promise =
+      std::make_shared<std::promise<void>>();
+  std::future<void> result = promise->get_future();
+  IoCallback done = request.done;
+  request.done = [promise, done](std::exception_ptr error) {
+    if (done) {
+      done(error);
+    }
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value();
+    }
+  };
+  std::vector<IoRequest> batch;
+  batch.push_back(std::move(request));
+  submit(batch);
+  return result;
+}
+
+void IoEngine::drain() {
+  std::unique_lock<std::mutex> lock(inflight_mutex_);
+  inflight_changed_.wait(lock, [this] { return inflight_ == 0; });
+}
+
+std::size_t IoEngine::acquireSlots(std::size_t wanted, std::size_t limit) {
+  std::unique_lock<std::mutex> lock(inflight_mutex_);
+  inflight_changed_.wait(lock, [this, limit] { return inflight_ < limit; });
+  const std::size_t granted = std::min(wanted, limit - inflight_);
+  inflight_ += granted;
+  return granted;
+}
+
+void IoEngine::complete(IoRequest& request, std::exception_ptr error) {
+  if (request.done) {
+    request.done(error);
+  }
+  std::lock_guard<std::mutex> lock(inflight_mutex_);
+  inflight_--;
+  inflight_changed_.notify_all();
+}
+
+std::exception_ptr IoEngine::perform(IoRequest& request) {
+  try {
+    if (request.descriptor < 0) {
+      request.fallback();
+      return nullptr;
+    }
+    std::size_t done = 0;
+    while (done < request.length) {
+      const off_t offset = static_cast<off_t>(request.offset + done);
+      const ssize_t n =
+          request.op == IoOp::READ
+              ? ::pread(request.descriptor, request.buffer + done,
+                        request.length - done, offset)
+              : ::pwrite(request.descriptor, request.buffer + done,
+                         request.length - done, offset);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw IoException(request.filename,
+                          request.op == IoOp::READ ? "pread" : "pwrite", errno);
+      }
+      if (n == 0) {
+        if (request.op == IoOp::WRITE) {
+          throw IoException(request.filename, "pwrite", EIO);
+        }
+        // End of file: the rest reads as zero.
+        std::memset(request.buffer + done, 0, request.length - done);
+        break;
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    return nullptr;
+  } catch (...) {
+    return std::current_exception();
+  }
+}
+
+ThreadPoolIoEngine::ThreadPoolIoEngine(unsigned queue_depth, unsigned threads)
+    : queue_depth_(std::max(queue_depth, 1u)) {
+  for (unsigned i = 0; i < std::max(threads, 1u); i++) {
+    workers_.emplace_back(&ThreadPoolIoEngine::run, this);
+  }
+}
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine() {
+  drain();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stopping_ = true;
+  }
+  queue_changed_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPoolIoEngine::submit(std::vector<IoRequest>& batch) {
+  std::size_t next = 0;
+  while (next < batch.size()) {
+    const std::size_t granted =
+        acquireSlots(batch.size() - next, queue_depth_);
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      for (std::size_t i = 0; i < granted; i++) {
+        queue_.push_back(std::move(batch[next++]));
+      }
+    }
+    queue_changed_.notify_all();
+  }
+  batch.clear();
+}
+
+void ThreadPoolIoEngine::run() {
+  for (;;) {
+    IoRequest request;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_changed_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      request = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    complete(request, perform(request));
+  }
+}
+
+#ifdef BADGERDB_HAVE_IO_URING
+
+namespace {
+
+/**
+ * @brief Engine on a Linux io_uring, driven through raw system calls.
+ *
+ * Requests with a descriptor become vectored read/write entries of one
+ * submission queue; a single io_uring_enter() starts a whole batch.  A reaper
+ * thread waits for completions and runs the callbacks.  Requests without a
+ * descriptor, and the rare short transfer, are finished by blocking I/O.
+ */
+class UringIoEngine : public IoEngine {
+ public:
+  /**
+   * Marks the no-op entry that wakes the reaper for shutdown.
+   */
+  static const std::uint64_t STOP = std::numeric_limits<std::uint64_t>::max();
+
+  /**
+   * Sets up a ring.
+   *
+   * @return  The engine, or null if the kernel refuses io_uring.
+   */
+  static std::unique_ptr<IoEngine> tryCreate(unsigned queue_depth,
+                                             unsigned threads);
+
+  ~UringIoEngine() override;
+
+  void submit(std::vector<IoRequest>& batch) override;
+  using IoEngine::submit;
+  const char* name() const override { return "io_uring"; }
+
+ private:
+  /**
+   * @brief A request in flight in the ring.
+   */
+  struct Slot {
+    IoRequest request;
+    struct iovec vector;
+  };
+
+  UringIoEngine(int ring_fd, const io_uring_params& params, void* sq_ring,
+                std::size_t sq_ring_bytes, void* cq_ring,
+                std::size_t cq_ring_bytes, io_uring_sqe* sqes,
+                unsigned threads);
+
+  /**
+   * Places an entry on the submission queue.  Caller holds sq_mutex_.
+   */
+  void push(std::uint8_t opcode, int descriptor, const struct iovec* vector,
+            std::uint64_t offset, std::uint64_t user_data);
+
+  /**
+   * Hands entries on the submission queue to the kernel.  Caller holds
+   * sq_mutex_.
+   */
+  void enter(unsigned count);
+
+  /**
+   * Body of the reaper thread.
+   */
+  void reap();
+
+  /**
+   * Finishes a request whose entry completed with result <res>.
+   */
+  void finish(std::uint64_t slot, int res);
+
+  const int ring_fd_;
+  const unsigned entries_;
+  void* sq_ring_;
+  const std::size_t sq_ring_bytes_;
+  void* cq_ring_;
+  const std::size_t cq_ring_bytes_;
+  io_uring_sqe* sqes_;
+
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  io_uring_cqe* cqes_;
+
+  /**
+   * Serializes producers of the submission queue and guards free_slots_.
+   */
+  std::mutex sq_mutex_;
+  std::vector<Slot> slots_;
+  std::vector<std::uint64_t> free_slots_;
+
+  /**
+   * Runs requests that have no descriptor.
+   */
+  ThreadPoolIoEngine blocking_;
+  std::thread reaper_;
+};
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+std::unique_ptr<IoEngine> UringIoEngine::tryCreate(unsigned queue_depth,
+                                                   unsigned threads) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int fd = ioUringSetup(std::max(queue_depth, 1u), &params);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  std::size_t sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  std::size_t cq_bytes =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single) {
+    sq_bytes = cq_bytes = std::max(sq_bytes, cq_bytes);
+  }
+  void* sq_ring = ::mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    ::close(fd);
+    return nullptr;
+  }
+  void* cq_ring = sq_ring;
+  if (!single) {
+    cq_ring = ::mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      ::munmap(sq_ring, sq_bytes);
+      ::close(fd);
+      return nullptr;
+    }
+  }
+  void* sqes = ::mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    if (!single) {
+      ::munmap(cq_ring, cq_bytes);
+    }
+    ::munmap(sq_ring, sq_bytes);
+    ::close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<IoEngine>(new UringIoEngine(
+      fd, params, sq_ring, sq_bytes, cq_ring, cq_bytes,
+      static_cast<io_uring_sqe*>(sqes), threads));
+}
+
+UringIoEngine::UringIoEngine(int ring_fd, const io_uring_params& params,
+                             void* sq_ring, std::size_t sq_ring_bytes,
+                             void* cq_ring, std::size_t cq_ring_bytes,
+                             io_uring_sqe* sqes, unsigned threads)
+    : ring_fd_(ring_fd),
+      entries_(params.sq_entries),
+      sq_ring_(sq_ring),
+      sq_ring_bytes_(sq_ring_bytes),
+      cq_ring_(cq_ring),
+      cq_ring_bytes_(cq_ring_bytes),
+      sqes_(sqes),
+      slots_(params.sq_entries),
+      blocking_(params.sq_entries, threads) {
+  char* sq = static_cast<char*>(sq_ring);
+  char* cq = static_cast<char*>(cq_ring);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  for (std::uint64_t i = entries_; i > 0; i--) {
+    free_slots_.push_back(i - 1);
+  }
+  reaper_ = std::thread(&UringIoEngine::reap, this);
+}
+
+UringIoEngine::~UringIoEngine() {
+  drain();
+  {
+    std::lock_guard<std::mutex> lock(sq_mutex_);
+    push(IORING_OP_NOP, -1, nullptr, 0, STOP);
+    enter(1);
+  }
+  reaper_.join();
+  ::munmap(sqes_, entries_ * sizeof(io_uring_sqe));
+  if (cq_ring_ != sq_ring_) {
+    ::munmap(cq_ring_, cq_ring_bytes_);
+  }
+  ::munmap(sq_ring_, sq_ring_bytes_);
+  ::close(ring_fd_);
+}
+
+void UringIoEngine::submit(std::vector<IoRequest>& batch) {
+  std::size_t next = 0;
+  while (next < batch.size()) {
+    const std::size_t granted = acquireSlots(batch.size() - next, entries_);
+    std::vector<IoRequest> blocking;
+    std::unique_lock<std::mutex> lock(sq_mutex_);
+    unsigned queued = 0;
+    for (std::size_t i = 0; i < granted; i++) {
+      IoRequest& request = batch[next++];
+      if (request.descriptor < 0) {
+        // Counted in flight here; the completion below uncounts it.
+        std::shared_ptr<IoRequest> original =
+            std::make_shared<IoRequest>(std::move(request));
+        IoRequest forward;
+        forward.op = original->op;
+        forward.descriptor = -1;
+        forward.fallback = original->fallback;
+        forward.done = [this, original](std::exception_ptr error) {
+          complete(*original, error);
+        };
+        blocking.push_back(std::move(forward));
+        continue;
+      }
+      const std::uint64_t slot = free_slots_.back();
+      free_slots_.pop_back();
+      Slot& s = slots_[slot];
+      s.request = std::move(request);
+      s.vector.iov_base = s.request.buffer;
+      s.vector.iov_len = s.request.length;
+      push(s.request.op == IoOp::READ ? IORING_OP_READV : IORING_OP_WRITEV,
+           s.request.descriptor, &s.vector, s.request.offset, slot);
+      queued++;
+    }
+    if (queued > 0) {
+      enter(queued);
+    }
+    lock.unlock();
+    // Start these now: later chunks may wait for slots that they hold.
+    if (!blocking.empty()) {
+      blocking_.submit(blocking);
+    }
+  }
+  batch.clear();
+}
+
+void UringIoEngine::push(std::uint8_t opcode, int descriptor,
+                         const struct iovec* vector, std::uint64_t offset,
+                         std::uint64_t user_data) {
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & *sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = descriptor;
+  sqe->off = offset;
+  sqe->addr = reinterpret_cast<std::uint64_t>(vector);
+  sqe->len = vector != nullptr ? 1 : 0;
+  sqe->user_data = user_data;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+}
+
+void UringIoEngine::enter(unsigned count) {
+  while (count > 0) {
+    const int submitted = ioUringEnter(ring_fd_, count, 0, 0);
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      // The ring is unusable; nothing sensible is left but to stop.
+      std::terminate();
+    }
+    count -= static_cast<unsigned>(submitted);
+  }
+}
+
+void UringIoEngine::reap() {
+  for (;;) {
+    unsigned head = __atomic_load_n(cq_head_, __ATOMIC_RELAXED);
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      ioUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+    bool stop = false;
+    for (; head != tail; head++) {
+      const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+      const std::uint64_t user_data = cqe.user_data;
+      const int res = cqe.res;
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+      if (user_data == STOP) {
+        stop = true;
+      } else {
+        finish(user_data, res);
+      }
+    }
+    if (stop) {
+      return;
+    }
+  }
+}
+
+void UringIoEngine::finish(std::uint64_t slot, int res) {
+  IoRequest request = std::move(slots_[slot].request);
+  {
+    std::lock_guard<std::mutex> lock(sq_mutex_);
+    free_slots_.push_back(slot);
+  }
+
+  std::exception_ptr error;
+  if (res >= 0 && static_cast<std::size_t>(res) == request.length) {
+    // Done in one go, the common case.
+  } else if (res < 0 && res != -EINTR && res != -EAGAIN && res != -EINVAL &&
+             res != -EOPNOTSUPP) {
+    error = std::make_exception_ptr(IoException(
+        request.filename, request.op == IoOp::READ ? "read" : "write", -res));
+  } else {
+    // Short transfer, or an error worth retrying the plain way.
+    const std::size_t done = res > 0 ? static_cast<std::size_t>(res) : 0;
+    request.offset += done;
+    request.buffer += done;
+    request.length -= done;
+    error = perform(request);
+  }
+  complete(request, error);
+}
+
+}
+
+#endif
+
+std::unique_ptr<IoEngine> IoEngine::create(unsigned queue_depth,
+                                           unsigned threads) {
+#ifdef BADGERDB_HAVE_IO_URING
+  std::unique_ptr<IoEngine> engine =
+      UringIoEngine::tryCreate(queue_depth, threads);
+  if (engine) {
+    return engine;
+  }
+#endif
+  return std::unique_ptr<IoEngine>(new ThreadPoolIoEngine(queue_depth, threads));
+}
+
+}
@@ -0,0 +1,211 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief Completion callback of an asynchronous I/O request.  The argument is
+ *        null on success and holds the exception describing the failure
+ *        otherwise.
+ */
+typedef std::function<void(std::exception_ptr)> IoCallback;
+
+/**
+ * @brief Direction of an I/O request.
+ */
+enum class IoOp {
+  READ,
+  WRITE
+};
+
+/**
+ * @brief One asynchronous read or write.
+ *
+ * A request either names a file descriptor and a byte range, which the engine
+ * performs itself, or (with descriptor -1) carries a synchronous <fallback>
+ * job, which the engine runs on one of its threads.  The latter covers
+ * backends that have no descriptor or need locking.  Callers normally build
+ * requests with File::readPageRequest() and File::writePageRequest().
+ */
+struct IoRequest {
+  /**
+   * Whether to read or write.
+   */
+  IoOp op = IoOp::READ;
+
+  /**
+   * File descriptor to operate on, or -1 to run <fallback> instead.
+   */
+  int descriptor = -1;
+
+  /**
+   * Byte offset in the file.
+   */
+  std::uint64_t offset = 0;
+
+  /**
+   * Memory to read into or write from; must stay valid until completion.
+   */
+  char* buffer = nullptr;
+
+  /**
+   * Number of bytes to transfer.  Reads past the end of file yield zeros.
+   */
+  std::size_t length = 0;
+
+  /**
+   * Name of the file, for error reports.
+   */
+  std::string filename;
+
+  /**
+   * Synchronous implementation used when <descriptor> is -1.  It reports
+   * failure by throwing.
+   */
+  std::function<void()> fallback;
+
+  /**
+   * Called exactly once when the request has completed.
+   */
+  IoCallback done;
+};
+
+/**
+ * @brief Engine that performs batches of page reads and writes asynchronously.
+ *
+ * Completion callbacks run on threads owned by the engine, never on the
+ * submitting thread, so they must be threadsafe, must not block for long and
+ * must not submit further requests.
+ * Use create() to get the best engine available on this platform: io_uring on
+ * Linux, otherwise a pool of threads doing blocking pread/pwrite.
+ */
+class IoEngine {
+ public:
+  /**
+   * Creates an engine.
+   *
+   * @param queue_depth   Maximum number of requests in flight at once.
+   * @param threads       Number of worker threads for blocking requests.
+   * @return  io_uring engine if the kernel supports it, else a thread pool.
+   */
+  static std::unique_ptr<IoEngine> create(unsigned queue_depth = 64,
+                                          unsigned threads = 4);
+
+  /**
+   * Destructor; waits for all requests in flight.
+   */
+  virtual ~IoEngine() {}
+
+  /**
+   * Starts all requests of a batch.  May block while the queue is full.
+   *
+   * @param batch   Requests to start; left empty.
+   */
+  virtual void submit(std::vector<IoRequest>& batch) = 0;
+
+  /**
+   * Starts one request and returns a future for its completion instead of
+   * calling its callback (which may be empty).
+   *
+   * @param request   Request to start.
+   * @return  Future that becomes ready, or holds the error, on completion.
+   */
+  std::future<void> submit(IoRequest request);
+
+  /**
+   * Blocks until every request submitted so far has completed and had its
+   * callback run.
+   */
+  void drain();
+
+  /**
+   * Returns the name of the implementation, e.g. for benchmark reports.
+   */
+  virtual const char* name() const = 0;
+
+ protected:
+  /**
+   * Counts up to <wanted> requests as started; blocks while <limit> are in
+   * flight.
+   *
+   * @return  Number of requests counted, at least one.
+   */
+  std::size_t acquireSlots(std::size_t wanted, std::size_t limit);
+
+  /**
+   * Runs a request's callback and counts it as completed.
+   */
+  void complete(IoRequest& request, std::exception_ptr error);
+
+  /**
+   * Performs a request synchronously on the calling thread.
+   *
+   * @return  Null on success, else the error.
+   */
+  static std::exception_ptr perform(IoRequest& request);
+
+ private:
+  std::mutex inflight_mutex_;
+  std::condition_variable inflight_changed_;
+  std::size_t inflight_ = 0;
+};
+
+/**
+ * @brief Portable engine: worker threads perform requests with blocking I/O.
+ */
+class ThreadPoolIoEngine : public IoEngine {
+ public:
+  /**
+   * Starts the workers.
+   *
+   * @param queue_depth   Maximum number of requests in flight at once.
+   * @param threads       Number of worker threads.
+   */
+  ThreadPoolIoEngine(unsigned queue_depth, unsigned threads);
+
+  /**
+   * Finishes outstanding requests and stops the workers.
+   */
+  ~ThreadPoolIoEngine() override;
+
+  void submit(std::vector<IoRequest>& batch) override;
+  using IoEngine::submit;
+  const char* name() const override { return "threadpool"; }
+
+ private:
+  /**
+   * Body of each worker thread.
+   */
+  void run();
+
+  const std::size_t queue_depth_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_changed_;
+  std::deque<IoRequest> queue_;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}
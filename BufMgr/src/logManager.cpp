@@ -0,0 +1,286 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "logManager.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+const std::uint32_t LogManager::MAGIC;
+
+namespace {
+
+/**
+ * Writes all of <length> bytes at <offset>, retrying short writes.
+ */
+void writeFully(const std::string& path, const int fd, const char* buffer,
+                std::size_t length, std::uint64_t offset)
+{
+  while (length > 0) {
+    const ssize_t n = ::pwrite(fd, buffer, length, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException(path, "pwrite", errno);
+    }
+    buffer += n;
+    offset += n;
+    length -= n;
+  }
+}
+
+void syncFully(const std::string& path, const int fd)
+{
+#if defined(__APPLE__)
+  if (::fsync(fd) != 0) {
+#else
+  if (::fdatasync(fd) != 0) {
+#endif
+    throw IoException(path, "fdatasync", errno);
+  }
+}
+
+}
+
+LogManager::LogManager(const std::string& logPath)
+  : path(logPath), nextLsn(1), flushedLsn(0), flushing(false), end(0),
+    syncCount(0)
+{
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    throw IoException(path, "open", errno);
+  }
+  try {
+    recover();
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+}
+
+LogManager::~LogManager()
+{
+  try {
+    flush(lastLsn());
+  } catch (...) {
+    // the records are lost, as if we had crashed before the flush
+  }
+  ::close(fd);
+}
+
+std::uint32_t LogManager::checksum(const char* record, const std::size_t length)
+{
+  // FNV-1a
+  std::uint32_t hash = 2166136261u;
+  for (std::size_t i = 0; i < length; i++) {
+    hash = (hash ^ static_cast<unsigned char>(record[i])) * 16777619u;
+  }
+  return hash;
+}
+
+void LogManager::recover()
+{
+  const off_t size = ::lseek(fd, 0, SEEK_END);
+  if (size < 0) {
+    throw IoException(path, "lseek", errno);
+  }
+  std::vector<char> log(size);
+  std::size_t got = 0;
+  while (got < log.size()) {
+    const ssize_t n = ::pread(fd, log.data() + got, log.size() - got, got);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException(path, "pread", errno);
+    }
+    if (n == 0) {
+      break;
+    }
+    got += n;
+  }
+
+  LogHeader header;
+  if (got >= sizeof(header)) {
+    std::memcpy(&header, log.data(), sizeof(header));
+    if (header.magic == MAGIC) {
+      nextLsn = std::max(nextLsn, header.base);
+    } else {
+      got = 0;
+    }
+  }
+
+  // replay up to the first torn or damaged record; later ones were never
+  // acknowledged as durable
+  std::map<std::string, std::unique_ptr<File> > touched;
+  std::map<std::string, PageId> pages;
+  std::size_t offset = sizeof(header);
+  while (offset + sizeof(RecordHeader) <= got) {
+    RecordHeader record;
+    std::memcpy(&record, log.data() + offset, sizeof(record));
+    const std::size_t length =
+        sizeof(record) + std::size_t(record.name_length) + Page::SIZE;
+    if (record.lsn < nextLsn || length > got - offset) {
+      break;
+    }
+    const std::uint32_t expected = record.checksum;
+    std::memset(log.data() + offset + offsetof(RecordHeader, checksum), 0,
+                sizeof(record.checksum));
+    if (checksum(log.data() + offset, length) != expected) {
+      break;
+    }
+    const std::string name(log.data() + offset + sizeof(record),
+                           record.name_length);
+    const char* image = log.data() + offset + sizeof(record) + record.name_length;
+    offset += length;
+    nextLsn = record.lsn + 1;
+
+    // a file removed since it was logged stays removed
+    if (touched.find(name) == touched.end()) {
+      if (!File::exists(name)) {
+        continue;
+      }
+      touched[name].reset(new File(File::open(name)));
+    }
+    File* file = touched[name].get();
+    if (file->readPageHeader(record.page_number).lsn < record.lsn) {
+      Page page;
+      std::memcpy(page.header_, image, Page::SIZE);
+      file->writePage(record.page_number, page);
+    }
+    pages[name] = std::max(pages[name], record.page_number + 1);
+  }
+
+  for (std::map<std::string, std::unique_ptr<File> >::iterator it = touched.begin();
+       it != touched.end(); ++it)
+  {
+    it->second->rebuildHeader(pages[it->first]);
+    it->second->sync();
+  }
+  flushedLsn = nextLsn - 1;
+  reset();
+}
+
+void LogManager::reset()
+{
+  if (::ftruncate(fd, 0) != 0) {
+    throw IoException(path, "ftruncate", errno);
+  }
+  LogHeader header;
+  header.magic = MAGIC;
+  header.reserved = 0;
+  header.base = flushedLsn + 1;
+  writeFully(path, fd, reinterpret_cast<const char*>(&header), sizeof(header), 0);
+  syncFully(path, fd);
+  end = sizeof(header);
+  ++syncCount;
+}
+
+Lsn LogManager::append(const File& file, Page& page)
+{
+  const std::string& name = file.filename();
+  RecordHeader record;
+  record.checksum = 0;
+  record.name_length = static_cast<std::uint32_t>(name.size());
+  record.page_number = page.page_number();
+  record.reserved = 0;
+
+  std::lock_guard<std::mutex> lock(latch);
+  record.lsn = nextLsn++;
+  page.header_->lsn = record.lsn;
+  const std::size_t start = pending.size();
+  pending.append(reinterpret_cast<const char*>(&record), sizeof(record));
+  pending.append(name);
+  pending.append(reinterpret_cast<const char*>(page.header_), Page::SIZE);
+  record.checksum = checksum(&pending[start], pending.size() - start);
+  std::memcpy(&pending[start + offsetof(RecordHeader, checksum)],
+              &record.checksum, sizeof(record.checksum));
+  files.insert(name);
+  return record.lsn;
+}
+
+void LogManager::flush(const Lsn lsn)
+{
+  std::unique_lock<std::mutex> lock(latch);
+  const Lsn wanted = std::min(lsn, nextLsn - 1);
+  while (flushedLsn < wanted) {
+    if (flushing) {
+      // someone else's sync may cover our records
+      flushedCond.wait(lock);
+      continue;
+    }
+    flushing = true;
+    std::string batch;
+    batch.swap(pending);
+    const Lsn upTo = nextLsn - 1;
+    const std::uint64_t offset = end;
+    end += batch.size();
+    lock.unlock();
+    try {
+      writeFully(path, fd, batch.data(), batch.size(), offset);
+      syncFully(path, fd);
+    } catch (...) {
+      lock.lock();
+      pending.insert(0, batch);
+      end = offset;
+      flushing = false;
+      flushedCond.notify_all();
+      throw;
+    }
+    lock.lock();
+    flushing = false;
+    flushedLsn = upTo;
+    ++syncCount;
+    flushedCond.notify_all();
+  }
+}
+
+Lsn LogManager::lastLsn()
+{
+  std::lock_guard<std::mutex> lock(latch);
+  return nextLsn - 1;
+}
+
+std::uint64_t LogManager::syncs()
+{
+  std::lock_guard<std::mutex> lock(latch);
+  return syncCount;
+}
+
+std::set<std::string> LogManager::loggedFiles()
+{
+  std::lock_guard<std::mutex> lock(latch);
+  return files;
+}
+
+void LogManager::truncate()
+{
+  std::unique_lock<std::mutex> lock(latch);
+  while (flushing) {
+    flushedCond.wait(lock);
+  }
+  reset();
+  if (pending.empty()) {
+    files.clear();
+  }
+}
+
+}
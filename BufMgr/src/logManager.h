@@ -0,0 +1,226 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+* @brief Write-ahead log of page images with group commit
+*
+* Every record holds the full image of one page, stamped with the record's LSN
+* in the page header before it is copied, so redo is idempotent: a page on
+* disk is replaced by a logged image only if its own LSN is lower.  Records
+* are appended to an in-memory buffer and reach the log file when someone
+* needs them durable; whoever calls flush() first writes and syncs everything
+* appended so far, and later callers whose records that covered return
+* without touching the disk, so concurrent committers share one sync.
+*
+* Constructing a LogManager replays the log found at its path into the files
+* it names and then empties it.  Records of a file that was removed and
+* created again under the same name would be replayed into the new file, so
+* truncate() the log (see BufMgr::checkpoint()) before reusing names.
+*/
+class LogManager
+{
+ public:
+	/**
+   * Opens the log, creating it if it does not exist, and recovers: every page
+   * image newer than the page on disk is written back, the headers of the
+   * files touched are rebuilt and the files synced, and the log is emptied.
+   *
+   * @param path  Name of the log file
+   * @throws  IoException If the log cannot be opened, read or written
+	 */
+  explicit LogManager(const std::string& path);
+
+	/**
+   * Makes the records appended so far durable and closes the log.
+	 */
+  ~LogManager();
+
+	/**
+   * Appends an image of a page to the log, after setting the page's LSN to
+   * that of the new record.  The record is not durable before flush().
+   *
+   * @param file  File the page belongs to
+   * @param page  Page to log; its LSN is updated
+   * @return  LSN of the record
+	 */
+  Lsn append(const File& file, Page& page);
+
+	/**
+   * Returns once every record up to the given LSN is durable.
+   *
+   * @param lsn   LSN that must be durable; zero returns at once
+   * @throws  IoException If the log cannot be written or synced
+	 */
+  void flush(const Lsn lsn);
+
+	/**
+   * Returns the LSN of the last record appended; zero if there is none.
+	 */
+  Lsn lastLsn();
+
+	/**
+   * Returns the number of times the log file was synced.
+	 */
+  std::uint64_t syncs();
+
+	/**
+   * Returns the names of the files with records in the log.
+	 */
+  std::set<std::string> loggedFiles();
+
+	/**
+   * Empties the log.  Records appended but not yet flushed are kept.  Only
+   * call this once every flushed record's page is durable in its file.
+   *
+   * @throws  IoException If the log cannot be written or synced
+	 */
+  void truncate();
+
+ private:
+	/**
+   * @brief Start of the log file
+	 */
+  struct LogHeader {
+    /**
+     * Always MAGIC
+     */
+    std::uint32_t magic;
+
+    /**
+     * Padding; zero
+     */
+    std::uint32_t reserved;
+
+    /**
+     * The first record in the log has an LSN of at least this
+     */
+    Lsn base;
+  };
+
+	/**
+   * @brief Start of every log record; the file name and the page image follow
+	 */
+  struct RecordHeader {
+    /**
+     * LSN of the record
+     */
+    Lsn lsn;
+
+    /**
+     * Checksum of the rest of the record, including the page image
+     */
+    std::uint32_t checksum;
+
+    /**
+     * Length of the file name
+     */
+    std::uint32_t name_length;
+
+    /**
+     * Number of the logged page
+     */
+    PageId page_number;
+
+    /**
+     * Padding; zero
+     */
+    std::uint32_t reserved;
+  };
+
+	/**
+   * Value of LogHeader::magic
+	 */
+  static const std::uint32_t MAGIC = 0x4c414442;
+
+	/**
+   * Returns the checksum of a record whose header has a zero checksum.
+	 */
+  static std::uint32_t checksum(const char* record, const std::size_t length);
+
+	/**
+   * Replays the records in the log file.  Called by the constructor.
+	 */
+  void recover();
+
+	/**
+   * Replaces the log file contents with a header for the next LSN.  Caller
+   * holds the latch and no flush is in progress.
+	 */
+  void reset();
+
+	/**
+   * Name of the log file
+	 */
+  std::string path;
+
+	/**
+   * Descriptor of the log file
+	 */
+  int fd;
+
+	/**
+   * Protects all the fields below
+	 */
+  std::mutex latch;
+
+	/**
+   * Signalled when a flush finishes
+	 */
+  std::condition_variable flushedCond;
+
+	/**
+   * Records appended but not yet handed to the log file
+	 */
+  std::string pending;
+
+	/**
+   * LSN of the next record
+	 */
+  Lsn nextLsn;
+
+	/**
+   * All records up to this LSN are durable
+	 */
+  Lsn flushedLsn;
+
+	/**
+   * Whether some thread is writing and syncing the log
+	 */
+  bool flushing;
+
+	/**
+   * Offset at which the next flush writes
+	 */
+  std::uint64_t end;
+
+	/**
+   * Number of log file syncs
+	 */
+  std::uint64_t syncCount;
+
+	/**
+   * Files with records in the log
+	 */
+  std::set<std::string> files;
+};
+
+}
@@ -0,0 +1,162 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lruKPolicy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+LruKPolicy::LruKPolicy(const std::uint32_t bufs, const unsigned k)
+	: k(std::max(k, 1u)), now(0), history((std::size_t) bufs * std::max(k, 1u), 0),
+	  refs(bufs, 0), resident(bufs, false), isFree(bufs, true), limit(bufs)
+{
+  for (FrameId i = bufs; i > 0; i--) {
+    freeFrames.push_back(i - 1);
+  }
+}
+
+LruKPolicy::Rank LruKPolicy::rankOf(const FrameId frame) const
+{
+  const std::uint64_t* times = &history[(std::size_t) frame * k];
+  if (refs[frame] == 0) {
+    return Rank(0, times[0], frame);
+  }
+  if (refs[frame] < k) {
+    return Rank(1, times[0], frame);
+  }
+  return Rank(2, times[k - 1], frame);
+}
+
+void LruKPolicy::reference(const FrameId frame)
+{
+  std::uint64_t* times = &history[(std::size_t) frame * k];
+  std::copy_backward(times, times + k - 1, times + k);
+  times[0] = ++now;
+  if (refs[frame] < k) {
+    refs[frame]++;
+  }
+}
+
+bool LruKPolicy::evict(const FrameClaim& claim, FrameId& frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  for (std::size_t i = freeFrames.size(); i > 0; i--) {
+    if (claim(freeFrames[i - 1], false)) {
+      frame = freeFrames[i - 1];
+      freeFrames.erase(freeFrames.begin() + (i - 1));
+      isFree[frame] = false;
+      return true;
+    }
+  }
+  for (std::set<Rank>::iterator it = order.begin(); it != order.end(); ++it) {
+    const FrameId candidate = std::get<2>(*it);
+    if (claim(candidate, false)) {
+      order.erase(it);
+      resident[candidate] = false;
+      frame = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void LruKPolicy::installed(const FrameId frame, const File* file, const PageId pageNo,
+                           const bool cold)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  if (resident[frame]) {
+    order.erase(rankOf(frame));
+  }
+  refs[frame] = 0;
+  std::fill(&history[(std::size_t) frame * k], &history[(std::size_t) frame * k] + k, 0);
+  if (cold) {
+    history[(std::size_t) frame * k] = ++now;
+  } else {
+    reference(frame);
+  }
+  resident[frame] = true;
+  order.insert(rankOf(frame));
+}
+
+void LruKPolicy::accessed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  touch(frame);
+}
+
+void LruKPolicy::accessedAll(const std::vector<FrameId>& frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  for (FrameId frame : frames) {
+    touch(frame);
+  }
+}
+
+void LruKPolicy::touch(const FrameId frame)
+{
+  if (!resident[frame]) {
+    return;
+  }
+  order.erase(rankOf(frame));
+  reference(frame);
+  order.insert(rankOf(frame));
+}
+
+void LruKPolicy::removed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  if (resident[frame]) {
+    order.erase(rankOf(frame));
+    resident[frame] = false;
+  }
+  if (!isFree[frame] && frame < limit) {
+    isFree[frame] = true;
+    freeFrames.push_back(frame);
+  }
+}
+
+void LruKPolicy::resize(const std::uint32_t frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  if (frames > refs.size()) {
+    history.resize((std::size_t) frames * k, 0);
+    refs.resize(frames, 0);
+    resident.resize(frames, false);
+    isFree.resize(frames, false);
+  }
+  if (frames < limit) {
+    for (std::size_t i = freeFrames.size(); i > 0; i--) {
+      if (freeFrames[i - 1] >= frames) {
+        isFree[freeFrames[i - 1]] = false;
+        freeFrames.erase(freeFrames.begin() + (i - 1));
+      }
+    }
+  }
+  // new frames are used lowest first, as at construction
+  for (FrameId i = frames; i > limit; i--) {
+    if (!isFree[i - 1] && !resident[i - 1]) {
+      isFree[i - 1] = true;
+      freeFrames.push_back(i - 1);
+    }
+  }
+  limit = frames;
+}
+
+void LruKPolicy::victimOrder(std::vector<FrameId>& frames) const
+{
+  std::lock_guard<std::mutex> guard(latch);
+  frames.insert(frames.end(), freeFrames.rbegin(), freeFrames.rend());
+  for (const Rank& rank : order) {
+    frames.push_back(std::get<2>(rank));
+  }
+}
+
+}
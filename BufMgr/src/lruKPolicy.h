@@ -0,0 +1,125 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "replacementPolicy.h"
+
+namespace badgerdb {
+
+/**
+* @brief LRU-K: evicts the page whose K-th most recent reference is oldest
+*
+* Pages referenced fewer than K times rank below all others, oldest last
+* reference first, so the pages of a one-pass scan are evicted before pages
+* that have proven to be reused.  Read-ahead pages that have never been
+* referenced rank lowest of all.  History is kept for resident pages only.
+* All decisions are serialized by one latch.
+*/
+class LruKPolicy : public ReplacementPolicy
+{
+ public:
+	/**
+   * Constructor of LruKPolicy class
+   *
+   * @param bufs   Number of frames in the buffer pool
+   * @param k      Number of references remembered per page
+	 */
+  LruKPolicy(const std::uint32_t bufs, const unsigned k = 2);
+
+  bool evict(const FrameClaim& claim, FrameId& frame) override;
+  void installed(const FrameId frame, const File* file, const PageId pageNo,
+                 const bool cold) override;
+  void accessed(const FrameId frame) override;
+  void accessedAll(const std::vector<FrameId>& frames) override;
+  void removed(const FrameId frame) override;
+  void victimOrder(std::vector<FrameId>& frames) const override;
+  void resize(const std::uint32_t frames) override;
+
+ private:
+	/**
+   * Record a hit on a frame.  Caller holds the latch.
+	 */
+  void touch(const FrameId frame);
+
+	/**
+   * Eviction rank of a resident frame: (class, time, frame), where class is 0
+   * for never referenced, 1 for fewer than K references and 2 otherwise, and
+   * time is the last or the K-th most recent reference.  Smallest goes first.
+	 */
+  typedef std::tuple<int, std::uint64_t, FrameId> Rank;
+
+	/**
+   * Compute the current rank of a frame.  Caller holds the latch.
+	 */
+  Rank rankOf(const FrameId frame) const;
+
+	/**
+   * Record a reference to a frame.  Caller holds the latch.
+	 */
+  void reference(const FrameId frame);
+
+	/**
+   * Protects all other members
+	 */
+  mutable std::mutex latch;
+
+	/**
+   * Number of references remembered per page
+	 */
+  unsigned k;
+
+	/**
+   * Logical time, advanced by every reference
+	 */
+  std::uint64_t now;
+
+	/**
+   * Last k reference times of each frame, most recent first
+	 */
+  std::vector<std::uint64_t> history;
+
+	/**
+   * Number of references recorded for each frame, saturating at k
+	 */
+  std::vector<unsigned> refs;
+
+	/**
+   * True for frames holding a page the policy knows about
+	 */
+  std::vector<bool> resident;
+
+	/**
+   * Ranks of resident frames
+	 */
+  std::set<Rank> order;
+
+	/**
+   * Frames holding no page, next to use at the back
+	 */
+  std::vector<FrameId> freeFrames;
+
+	/**
+   * True for frames in freeFrames
+	 */
+  std::vector<bool> isFree;
+
+	/**
+   * Number of frames in the pool; frames above are not put in freeFrames
+	 */
+  std::uint32_t limit;
+};
+
+}
@@ -8,15 +8,41 @@
 //#include <stdio.h>
 #include <cstring>
 #include <memory>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <vector>
 #include "page.h"
 #include "buffer.h"
+#include "bufHashTbl.h"
+#include "openHashTbl.h"
+#include "io_engine.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
+#include "traceReplay.h"
+#include "bufPoolSet.h"
+#include "parallelScan.h"
+#include "paxPage.h"
+#include "btreeIndex.h"
+#include "taskExecutor.h"
+#include "crc32c.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/page_corrupt_exception.h"
+#include "exceptions/index_exception.h"
+#include "exceptions/page_size_exception.h"
+#include "exceptions/page_type_exception.h"
+#include "exceptions/io_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/partition_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -63,6 +89,47 @@ void test3();
 void test4();
 void test5();
 void test6();
+void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
+void test34();
+void test35();
+void test36();
+void test37();
+void test38();
+void test39();
+void test40();
+void test41();
+void test42();
+void test43();
+void test44();
+void test45();
+void test46();
+void test47();
 void newTest();
 void testBufMgr();
 
@@ -178,6 +245,47 @@ void testBufMgr()
 	fork_test(test4);
 	fork_test(test5);
 	fork_test(test6);
+	fork_test(test7);
+	fork_test(test8);
+	fork_test(test9);
+	fork_test(test10);
+	fork_test(test11);
+	fork_test(test12);
+	fork_test(test13);
+	fork_test(test14);
+	fork_test(test15);
+	fork_test(test16);
+	fork_test(test17);
+	fork_test(test18);
+	fork_test(test19);
+	fork_test(test20);
+	fork_test(test21);
+	fork_test(test22);
+	fork_test(test23);
+	fork_test(test24);
+	fork_test(test25);
+	fork_test(test26);
+	fork_test(test27);
+	fork_test(test28);
+	fork_test(test29);
+	fork_test(test30);
+	fork_test(test31);
+	fork_test(test32);
+	fork_test(test33);
+	fork_test(test34);
+	fork_test(test35);
+	fork_test(test36);
+	fork_test(test37);
+	fork_test(test38);
+	fork_test(test39);
+	fork_test(test40);
+	fork_test(test41);
+	fork_test(test42);
+	fork_test(test43);
+	fork_test(test44);
+	fork_test(test45);
+	fork_test(test46);
+	fork_test(test47);
   
 
 	//Close files before deleting them
@@ -342,6 +450,3561 @@ void test6()
 	bufMgr->flushFile(file1ptr);
 }
 
+void test7()
+{
+	//Concurrent readPage/unPinPage from several threads on a pool smaller than the file,
+	//so that hits, misses and evictions of dirty pages all race with each other
+	const std::string& filename = "test.7";
+	BufMgr* sharedMgr = new BufMgr(num / 4);
+	File* file7 = new File(File::create(filename));
+	for (i = 0; i < num; i++)
+	{
+		sharedMgr->allocPage(file7, pid[i], page);
+		sprintf((char*)tmpbuf, "test.7 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		sharedMgr->unPinPage(file7, pid[i], true);
+	}
+
+	std::vector<std::thread> workers;
+	std::atomic<int> mismatches(0);
+	for (int t = 0; t < 4; t++)
+	{
+		workers.emplace_back([&, t]() {
+			char expected[100];
+			for (PageId j = 0; j < 10 * num; j++)
+			{
+				PageId k = (j * (t + 1) * 7) % num;
+				Page* p;
+				sharedMgr->readPage(file7, pid[k], p);
+				sprintf(expected, "test.7 Page %d %7.1f", pid[k], (float)pid[k]);
+				if (strncmp(p->getRecord(rid[k]).c_str(), expected, strlen(expected)) != 0)
+					mismatches++;
+				sharedMgr->unPinPage(file7, pid[k], j % 3 == 0);
+			}
+		});
+	}
+	for (std::thread& w : workers)
+		w.join();
+	if (mismatches != 0)
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+
+	sharedMgr->flushFile(file7);
+	delete sharedMgr;
+	delete file7;
+	File::remove(filename);
+	std::cout << "Test 7 passed" << "\n";
+}
+
+void test8()
+{
+	//Both page table implementations must agree with a reference map under random
+	//inserts and removes, including removes from the middle of probe runs
+	BufHashTbl chained(31);
+	OpenHashTbl open(16, 2);
+	PageTable* tables[] = {&chained, &open};
+	for (PageTable* table : tables)
+	{
+		std::map<std::pair<File*, PageId>, FrameId> reference;
+		File* files[] = {file1ptr, file2ptr, file3ptr};
+		unsigned int seed = 1;
+		for (int op = 0; op < 20000; op++)
+		{
+			seed = seed * 1103515245 + 12345;
+			File* f = files[(seed >> 8) % 3];
+			PageId p = (seed >> 12) % 64;
+			FrameId frame;
+			bool present = reference.count({f, p}) != 0;
+			if ((seed >> 20) % 2)
+			{
+				if (table->tryInsert(f, p, op) == present)
+					PRINT_ERROR("ERROR :: PAGE TABLE INSERT DISAGREES WITH REFERENCE");
+				if (!present)
+					reference[{f, p}] = op;
+			}
+			else
+			{
+				if (table->tryRemove(f, p) != present)
+					PRINT_ERROR("ERROR :: PAGE TABLE REMOVE DISAGREES WITH REFERENCE");
+				reference.erase({f, p});
+			}
+			for (const auto& entry : reference)
+			{
+				if (!table->tryLookup(entry.first.first, entry.first.second, frame) || frame != entry.second)
+					PRINT_ERROR("ERROR :: PAGE TABLE LOST AN ENTRY");
+			}
+		}
+	}
+
+	//The buffer manager works the same on top of the open addressing table
+	BufMgrOptions options;
+	options.pageTable = PageTableType::OPEN_ADDRESSING;
+	BufMgr* openMgr = new BufMgr(num / 4, options);
+	for (i = 0; i < num; i++)
+	{
+		openMgr->allocPage(file5ptr, pid[i], page);
+		sprintf((char*)tmpbuf, "test.5 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		openMgr->unPinPage(file5ptr, pid[i], true);
+	}
+	for (i = 0; i < num; i++)
+	{
+		openMgr->readPage(file5ptr, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.5 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		openMgr->unPinPage(file5ptr, pid[i], false);
+	}
+	openMgr->flushFile(file5ptr);
+	delete openMgr;
+	std::cout << "Test 8 passed" << "\n";
+}
+
+void test9()
+{
+	//Pages written through the pool must read back identically with every storage backend
+	const std::string& filename = "test.9";
+	StorageType storages[] = {StorageType::STREAM, StorageType::POSIX, StorageType::POSIX_DIRECT,
+	                          StorageType::COMPRESSED};
+	for (StorageType storage : storages)
+	{
+		BufMgr* backendMgr = new BufMgr(num / 4);
+		File* file9 = new File(File::create(filename, storage));
+		for (i = 0; i < num; i++)
+		{
+			backendMgr->allocPage(file9, pid[i], page);
+			sprintf((char*)tmpbuf, "test.9 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			backendMgr->unPinPage(file9, pid[i], true);
+		}
+		backendMgr->flushFile(file9);
+		delete file9;
+		file9 = new File(File::open(filename, storage));
+		for (i = 0; i < num; i++)
+		{
+			backendMgr->readPage(file9, pid[i], page);
+			sprintf((char*)&tmpbuf, "test.9 Page %d %7.1f", pid[i], (float)pid[i]);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			backendMgr->unPinPage(file9, pid[i], false);
+		}
+		backendMgr->flushFile(file9);
+		delete backendMgr;
+		delete file9;
+		File::remove(filename);
+	}
+	std::cout << "Test 9 passed" << "\n";
+}
+
+void test10()
+{
+	//Batched asynchronous flushes and reads must match synchronous I/O with every backend and engine
+	const std::string& filename = "test.10";
+	StorageType storages[] = {StorageType::STREAM, StorageType::POSIX, StorageType::POSIX_DIRECT,
+	                          StorageType::COMPRESSED};
+	for (StorageType storage : storages)
+	{
+		BufMgrOptions options;
+		options.ioQueueDepth = 8;
+		BufMgr* asyncMgr = new BufMgr(num, options);
+		File* file10 = new File(File::create(filename, storage));
+		for (i = 0; i < num; i++)
+		{
+			asyncMgr->allocPage(file10, pid[i], page);
+			sprintf((char*)tmpbuf, "test.10 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			asyncMgr->unPinPage(file10, pid[i], true);
+		}
+		asyncMgr->flushFile(file10);
+		delete asyncMgr;
+		delete file10;
+
+		file10 = new File(File::open(filename, storage));
+		std::unique_ptr<IoEngine> engines[] = {IoEngine::create(8, 2),
+		                                       std::unique_ptr<IoEngine>(new ThreadPoolIoEngine(8, 2))};
+		for (std::unique_ptr<IoEngine>& engine : engines)
+		{
+			std::vector<Page> pages(num);
+			std::vector<IoRequest> batch;
+			std::atomic<int> failures(0);
+			for (i = 0; i < num; i++)
+			{
+				batch.push_back(file10->readPageRequest(pid[i], pages[i],
+				    [&failures](std::exception_ptr error) { if (error) failures++; }));
+			}
+			engine->submit(batch);
+			engine->drain();
+			if (failures != 0)
+			{
+				PRINT_ERROR("ERROR :: ASYNCHRONOUS READ FAILED");
+			}
+			for (i = 0; i < num; i++)
+			{
+				sprintf((char*)&tmpbuf, "test.10 Page %d %7.1f", pid[i], (float)pid[i]);
+				if(strncmp(pages[i].getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+			//Reading a page that was never allocated fails at once
+			try
+			{
+				file10->readPageRequest(num + 1, pages[0], IoCallback());
+				PRINT_ERROR("ERROR :: Invalid page read request should have failed");
+			}
+			catch(const InvalidPageException&)
+			{
+			}
+		}
+		delete file10;
+		File::remove(filename);
+	}
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Explicit prefetch and sequential read-ahead must turn scan reads into hits
+	const std::string& filename = "test.11";
+	File* file11 = new File(File::create(filename));
+	for (i = 0; i < num; i++)
+	{
+		Page new_page = file11->allocatePage();
+		pid[i] = new_page.page_number();
+		sprintf((char*)tmpbuf, "test.11 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = new_page.insertRecord(tmpbuf);
+		file11->writePage(new_page);
+	}
+
+	//Synchronous prefetch: every page is resident, unpinned and cold before it is read
+	BufMgr* syncMgr = new BufMgr(num);
+	syncMgr->prefetch(file11, pid[0], 10);
+	if (syncMgr->getBufStats().prefetches != 10 || syncMgr->getPinCnt(0) != 0 || syncMgr->getRefBit(0))
+	{
+		PRINT_ERROR("ERROR :: Prefetched pages not installed cold and unpinned");
+	}
+	syncMgr->clearBufStats();
+	for (i = 0; i < 10; i++)
+	{
+		syncMgr->readPage(file11, pid[i], page);
+		syncMgr->unPinPage(file11, pid[i], false);
+	}
+	if (syncMgr->getBufStats().diskreads != 0)
+	{
+		PRINT_ERROR("ERROR :: Prefetched pages were read again");
+	}
+	syncMgr->flushFile(file11);
+	delete syncMgr;
+
+	//Automatic read-ahead through the I/O engine during a sequential scan
+	BufMgrOptions options;
+	options.ioQueueDepth = 8;
+	options.readAheadPages = 8;
+	BufMgr* scanMgr = new BufMgr(num / 4, options);
+	for (i = 0; i < num; i++)
+	{
+		scanMgr->readPage(file11, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.11 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		scanMgr->unPinPage(file11, pid[i], false);
+	}
+	scanMgr->flushFile(file11);
+	if (scanMgr->getBufStats().prefetches == 0)
+	{
+		PRINT_ERROR("ERROR :: Sequential scan did not read ahead");
+	}
+	delete scanMgr;
+	delete file11;
+	File::remove(filename);
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//The background writer must clean dirty frames before eviction needs them, without losing updates
+	const std::string& filename = "test.12";
+	const unsigned engines[] = {0, 8};
+	for (unsigned depth : engines)
+	{
+		BufMgrOptions options;
+		options.ioQueueDepth = depth;
+		options.backgroundWriter = true;
+		options.dirtyHighWatermark = 0.2;
+		options.dirtyLowWatermark = 0.1;
+		options.writerIntervalMs = 5;
+		BufMgr* writerMgr = new BufMgr(num / 2, options);
+		File* file12 = new File(File::create(filename));
+		for (i = 0; i < num / 4; i++)
+		{
+			writerMgr->allocPage(file12, pid[i], page);
+			sprintf((char*)tmpbuf, "test.12 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			writerMgr->unPinPage(file12, pid[i], true);
+		}
+		for (int wait = 0; wait < 200 && writerMgr->getBufStats().backgroundwrites == 0; wait++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		if (writerMgr->getBufStats().backgroundwrites == 0)
+		{
+			PRINT_ERROR("ERROR :: Background writer did not write back dirty pages");
+		}
+		//Keep dirtying pages while the writer runs, then check every update reached the file
+		for (i = 0; i < num; i++)
+		{
+			if (i >= num / 4)
+			{
+				writerMgr->allocPage(file12, pid[i], page);
+				sprintf((char*)tmpbuf, "test.12 Page %d %7.1f", pid[i], (float)pid[i]);
+				rid[i] = page->insertRecord(tmpbuf);
+			}
+			else
+			{
+				writerMgr->readPage(file12, pid[i], page);
+			}
+			writerMgr->unPinPage(file12, pid[i], true);
+		}
+		writerMgr->flushFile(file12);
+		delete writerMgr;
+		for (i = 0; i < num; i++)
+		{
+			Page check = file12->readPage(pid[i]);
+			sprintf((char*)&tmpbuf, "test.12 Page %d %7.1f", pid[i], (float)pid[i]);
+			if(strncmp(check.getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		delete file12;
+		File::remove(filename);
+	}
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//Every replacement policy must manage the pool correctly, and the LRU variants must survive a scan
+	const std::string& filename = "test.13";
+	const PageId frames = 20;
+	const PageId pages = 5 * frames;
+	ReplacementType policies[] = {ReplacementType::CLOCK, ReplacementType::LRU_K,
+	                              ReplacementType::TWO_Q, ReplacementType::ARC};
+	for (ReplacementType policy : policies)
+	{
+		BufMgrOptions options;
+		options.replacement = policy;
+		BufMgr* policyMgr = new BufMgr(frames, options);
+		File* file13 = new File(File::create(filename));
+		for (i = 0; i < pages; i++)
+		{
+			policyMgr->allocPage(file13, pid[i], page);
+			sprintf((char*)tmpbuf, "test.13 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			policyMgr->unPinPage(file13, pid[i], true);
+		}
+
+		//A pool full of pinned pages has no victim
+		for (i = 0; i < frames; i++)
+		{
+			policyMgr->readPage(file13, pid[i], page);
+		}
+		try
+		{
+			policyMgr->readPage(file13, pid[frames], page);
+			PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException&)
+		{
+		}
+		for (i = 0; i < frames; i++)
+		{
+			policyMgr->unPinPage(file13, pid[i], false);
+		}
+
+		//Make pages 1-5 hot: read, displaced by a filler, then read twice more
+		for (int round = 0; round < 3; round++)
+		{
+			for (i = 0; i < 5; i++)
+			{
+				policyMgr->readPage(file13, pid[i], page);
+				policyMgr->unPinPage(file13, pid[i], false);
+			}
+			for (i = 5; round == 0 && i < 5 + frames; i++)
+			{
+				policyMgr->readPage(file13, pid[i], page);
+				policyMgr->unPinPage(file13, pid[i], false);
+			}
+		}
+		//One pass over the rest of the file, verifying contents written back by eviction
+		for (i = 5 + frames; i < pages; i++)
+		{
+			policyMgr->readPage(file13, pid[i], page);
+			sprintf((char*)&tmpbuf, "test.13 Page %d %7.1f", pid[i], (float)pid[i]);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			policyMgr->unPinPage(file13, pid[i], false);
+		}
+		policyMgr->clearBufStats();
+		for (i = 0; i < 5; i++)
+		{
+			policyMgr->readPage(file13, pid[i], page);
+			policyMgr->unPinPage(file13, pid[i], false);
+		}
+		if (policy != ReplacementType::CLOCK && policyMgr->getBufStats().diskreads != 0)
+		{
+			PRINT_ERROR("ERROR :: Scan evicted hot pages");
+		}
+		policyMgr->flushFile(file13);
+		delete policyMgr;
+		delete file13;
+		File::remove(filename);
+	}
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	//Files in the old linked-list format are migrated on open, and freed pages are reused
+	if (Page::SIZE != 8192)
+	{
+		//every file of the old formats has 8192 byte pages
+		std::cout << "Test 14 passed" << "\n";
+		return;
+	}
+	const std::string& filename = "test.14";
+	const PageId pages = 4;
+	std::vector<std::string> images(pages + 1);
+	{
+		File file14 = File::create(filename);
+		for (PageId n = 1; n <= pages; n++)
+		{
+			Page new_page;
+			file14.allocatePage(new_page);
+			sprintf((char*)tmpbuf, "test.14 Page %d", new_page.page_number());
+			new_page.insertRecord(tmpbuf);
+			file14.writePage(new_page);
+		}
+		file14.deletePage(2);
+	}
+	{
+		//Rewrite the file as a 16 byte header followed by linked pages 1 -> 3 -> 4
+		std::ifstream in(filename, std::ios::binary);
+		for (PageId n = 1; n <= pages; n++)
+		{
+			images[n].resize(Page::SIZE);
+			in.seekg((std::streamoff)n * Page::SIZE);
+			in.read(&images[n][0], Page::SIZE);
+		}
+		//Version 1 pages have a 16 byte header without the LSN, so the data area
+		//ends 8 bytes later and every record sits 8 bytes further in
+		const PageId links[] = {0, 3, 0, 4, Page::INVALID_NUMBER};
+		const std::size_t shift = sizeof(PageHeader) - 16;
+		for (PageId n = 1; n <= pages; n++)
+		{
+			PageHeader header;
+			memcpy(&header, images[n].data(), sizeof(header));
+			header.next_page_number = links[n];
+			std::string legacyPage(Page::SIZE, '\0');
+			const char* data = images[n].data() + sizeof(header);
+			char* legacyData = &legacyPage[16];
+			memcpy(legacyData, data, header.free_space_lower_bound);
+			for (SlotId slot = 0; slot < header.num_slots; slot++)
+			{
+				PageSlot* entry = (PageSlot*)(legacyData + slot * sizeof(PageSlot));
+				entry->item_offset += shift;
+			}
+			memcpy(legacyData + header.free_space_upper_bound + shift, data + header.free_space_upper_bound,
+			       Page::DATA_SIZE - header.free_space_upper_bound);
+			if (header.current_page_number != Page::INVALID_NUMBER)
+			{
+				header.free_space_upper_bound += shift;
+			}
+			memcpy(&legacyPage[0], &header, 16);
+			images[n] = legacyPage;
+		}
+		in.close();
+		const PageId legacy[] = {pages + 1, 1, 1, 2};
+		std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+		out.write((const char*)legacy, sizeof(legacy));
+		for (PageId n = 1; n <= pages; n++)
+		{
+			out.write(images[n].data(), Page::SIZE);
+		}
+	}
+
+	File file14 = File::open(filename);
+	const PageId before[] = {1, 3, 4};
+	i = 0;
+	for (FileIterator iter = file14.begin(); iter != file14.end(); ++iter, i++)
+	{
+		Page migrated = *iter;
+		sprintf((char*)tmpbuf, "test.14 Page %d", before[i]);
+		if (i >= 3 || migrated.page_number() != before[i] ||
+		    migrated.getRecord(RecordId{before[i], 1}) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Migrated file does not match");
+		}
+	}
+	if (i != 3)
+	{
+		PRINT_ERROR("ERROR :: Migrated file lost pages");
+	}
+
+	Page reused;
+	if (file14.allocatePage(reused) != 2)
+	{
+		PRINT_ERROR("ERROR :: Freed page was not reused");
+	}
+	file14.deletePage(1);
+	try
+	{
+		file14.deletePage(1);
+		PRINT_ERROR("ERROR :: Page is already free. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const InvalidPageException&)
+	{
+	}
+	const PageId after[] = {2, 3, 4};
+	i = 0;
+	for (FileIterator iter = file14.begin(); iter != file14.end(); ++iter, i++)
+	{
+		if (i >= 3 || (*iter).page_number() != after[i])
+		{
+			PRINT_ERROR("ERROR :: Iteration visited the wrong pages");
+		}
+	}
+	if (i != 3 || file14.allocatePage(reused) != 1 || file14.allocatePage(reused) != pages + 1)
+	{
+		PRINT_ERROR("ERROR :: Pages were not allocated from the free list first");
+	}
+	file14.close();
+	File::remove(filename);
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//The file header is shared by every File object and only reaches the disk when synced or closed
+	const std::string& filename = "test.15";
+	File file15 = File::create(filename);
+	File other = File::open(filename);
+	for (i = 0; i < 10; i++)
+	{
+		Page new_page;
+		file15.allocatePage(new_page);
+	}
+	PageId on_disk[5];
+	{
+		std::ifstream in(filename, std::ios::binary);
+		in.read((char*)on_disk, sizeof(on_disk));
+	}
+	if (on_disk[2] != 1)
+	{
+		PRINT_ERROR("ERROR :: Header was written before sync");
+	}
+	//The second handle sees the new pages without a disk read of the header
+	other.readPage(10);
+	other.sync();
+	{
+		std::ifstream in(filename, std::ios::binary);
+		in.read((char*)on_disk, sizeof(on_disk));
+	}
+	if (on_disk[2] != 11)
+	{
+		PRINT_ERROR("ERROR :: Header was not written by sync");
+	}
+
+	File::setHeaderWriteInterval(std::chrono::milliseconds(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	file15.deletePage(10);
+	{
+		std::ifstream in(filename, std::ios::binary);
+		in.read((char*)on_disk, sizeof(on_disk));
+	}
+	File::setHeaderWriteInterval(std::chrono::milliseconds(0));
+	if (on_disk[2] != 11 || on_disk[4] != 1)
+	{
+		PRINT_ERROR("ERROR :: Header older than the interval was not written");
+	}
+	other.close();
+	file15.close();
+	File::remove(filename);
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//Records placed through the free-space map fill pages in turn without reading full ones
+	const std::string& filename = "test.16";
+	//eight to a page
+	const std::string record(Page::SIZE / 8 - 24, 'x');
+	BufMgr* fsmMgr = new BufMgr(num);
+	File* file16 = new File(File::create(filename));
+	for (i = 0; i < 80; i++)
+	{
+		rid[i] = fsmMgr->insertRecord(file16, record);
+		if (rid[i].page_number != rid[0].page_number + i / 8)
+		{
+			PRINT_ERROR("ERROR :: Record was not placed on the first page with room");
+		}
+	}
+	fsmMgr->clearBufStats();
+	rid2 = fsmMgr->insertRecord(file16, record);
+	if (fsmMgr->getBufStats().accesses != 1 || rid2.page_number != rid[79].page_number + 1)
+	{
+		PRINT_ERROR("ERROR :: Insert looked at full pages");
+	}
+
+	//Space freed by a delete is found again, also after the map was written back and reopened
+	fsmMgr->deleteRecord(file16, rid[21]);
+	fsmMgr->flushFile(file16);
+	fsmMgr->clearBufStats();
+	rid3 = fsmMgr->insertRecord(file16, record);
+	if (rid3.page_number != rid[21].page_number || fsmMgr->getBufStats().diskreads != 1)
+	{
+		PRINT_ERROR("ERROR :: Freed space was not reused");
+	}
+
+	//Another File object for the same file shares its map
+	File* other = new File(File::open(filename));
+	for (i = 0; i < 7; i++)
+	{
+		fsmMgr->insertRecord(file16, record);
+	}
+	fsmMgr->clearBufStats();
+	const RecordId shared = fsmMgr->insertRecord(other, record);
+	if (fsmMgr->getBufStats().accesses != 1 || shared.page_number != rid2.page_number + 1)
+	{
+		PRINT_ERROR("ERROR :: Record was placed through a separate map");
+	}
+	fsmMgr->flushFile(other);
+	delete other;
+	fsmMgr->flushFile(file16);
+	delete fsmMgr;
+	delete file16;
+	File::remove(filename);
+	File::remove(FreeSpaceMap::mapName(filename));
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	//Pages unpinned dirty and logged survive a crash before they are written back
+	const std::string& filename = "test.17";
+	const std::string& logname = "test.17.log";
+	BufMgrOptions options;
+	options.logFile = logname;
+	pid_t child = fork();
+	if (child == 0)
+	{
+		BufMgr* walMgr = new BufMgr(num, options);
+		File* file17 = new File(File::create(filename));
+		for (i = 0; i < 20; i++)
+		{
+			walMgr->allocPage(file17, pid[i], page);
+			sprintf((char*)tmpbuf, "test.17 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			walMgr->unPinPage(file17, pid[i], true);
+			if (page->lsn() == 0)
+			{
+				_exit(1);
+			}
+		}
+		walMgr->flushLog();
+		//crash: neither the pages nor the file header are written
+		_exit(0);
+	}
+	int status;
+	waitpid(child, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		PRINT_ERROR("ERROR :: Logging pages failed");
+	}
+
+	BufMgr* walMgr = new BufMgr(num, options);
+	File* file17 = new File(File::open(filename));
+	for (i = 0; i < 20; i++)
+	{
+		walMgr->readPage(file17, i + 1, page);
+		sprintf((char*)&tmpbuf, "test.17 Page %d %7.1f", i + 1, (float)(i + 1));
+		if(strncmp(page->getRecord({i + 1, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: Logged page was not recovered");
+		}
+		walMgr->unPinPage(file17, i + 1, true);
+	}
+	//The recovered file header counts the recovered pages
+	walMgr->allocPage(file17, pageno1, page);
+	walMgr->unPinPage(file17, pageno1, false);
+	if (pageno1 != 21)
+	{
+		PRINT_ERROR("ERROR :: File header was not rebuilt");
+	}
+
+	//A checkpoint writes everything back and empties the log
+	walMgr->checkpoint();
+	std::ifstream log(logname, std::ios::binary | std::ios::ate);
+	if (log.tellg() > 64)
+	{
+		PRINT_ERROR("ERROR :: Checkpoint did not empty the log");
+	}
+	walMgr->flushFile(file17);
+	delete walMgr;
+	delete file17;
+	File::remove(filename);
+	std::remove(logname.c_str());
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	//A torn write is caught by the page checksum on read and by the scrubber
+	const std::string& filename = "test.18";
+	const std::string& plainname = "test.18.plain";
+	BufMgr* crcMgr = new BufMgr(num);
+	File* file18 = new File(File::create(filename, StorageType::STREAM, true));
+	File* plain = new File(File::create(plainname));
+	for (i = 0; i < 5; i++)
+	{
+		crcMgr->allocPage(file18, pid[i], page);
+		sprintf((char*)tmpbuf, "test.18 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		crcMgr->unPinPage(file18, pid[i], true);
+		crcMgr->allocPage(plain, pageno1, page);
+		page->insertRecord(tmpbuf);
+		crcMgr->unPinPage(plain, pageno1, true);
+	}
+	crcMgr->flushFile(file18);
+	crcMgr->flushFile(plain);
+	if (!file18->hasChecksums() || plain->hasChecksums() ||
+	    !file18->scrub().empty() || !plain->scrub().empty())
+	{
+		PRINT_ERROR("ERROR :: Intact pages reported as damaged");
+	}
+
+	//Only the first half of page 3 reached the disk
+	{
+		std::fstream raw(filename, std::ios::in | std::ios::out | std::ios::binary);
+		const std::string garbage(Page::SIZE / 2, 'z');
+		raw.seekp((std::streamoff)3 * Page::SIZE + Page::SIZE / 2);
+		raw.write(garbage.data(), garbage.size());
+	}
+	//Page 2 of the other file gets a slot pointing past the end of the page
+	{
+		std::fstream raw(plainname, std::ios::in | std::ios::out | std::ios::binary);
+		PageSlot slot = {true, (PageOffset)(Page::DATA_SIZE - 4), 100};
+		raw.seekp((std::streamoff)2 * Page::SIZE + sizeof(PageHeader));
+		raw.write((const char*)&slot, sizeof(slot));
+	}
+	try
+	{
+		crcMgr->readPage(file18, 3, page);
+		PRINT_ERROR("ERROR :: Page is torn. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const PageCorruptException&)
+	{
+	}
+	//The failed read left no trace in the pool
+	crcMgr->readPage(file18, 4, page);
+	crcMgr->unPinPage(file18, 4, false);
+
+	std::vector<PageId> torn = file18->scrub();
+	std::vector<PageId> broken = plain->scrub();
+	if (torn.size() != 1 || torn[0] != 3 || broken.size() != 1 || broken[0] != 2)
+	{
+		PRINT_ERROR("ERROR :: Scrubber did not report the damaged pages");
+	}
+	crcMgr->flushFile(file18);
+	delete crcMgr;
+	delete file18;
+	delete plain;
+	File::remove(filename);
+	File::remove(plainname);
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	//Pages of a mapped file are used in place, by iterators and by the pool
+	const std::string& filename = "test.19";
+	const std::string& othername = "test.19.other";
+	{
+		File file19 = File::create(filename);
+		for (i = 0; i < 5; i++)
+		{
+			Page new_page = file19.allocatePage();
+			sprintf((char*)tmpbuf, "test.19 Page %d %7.1f", new_page.page_number(), (float)new_page.page_number());
+			rid[i] = new_page.insertRecord(tmpbuf);
+			file19.writePage(new_page);
+		}
+	}
+
+	File* mapped = new File(File::open(filename, StorageType::MAPPED));
+	int pages = 0;
+	for (FileIterator iter = mapped->begin(); iter != mapped->end(); ++iter)
+	{
+		Page view = *iter;
+		sprintf((char*)tmpbuf, "test.19 Page %d %7.1f", view.page_number(), (float)view.page_number());
+		if (view.getRecord(rid[pages]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Mapped page has the wrong contents");
+		}
+		pages++;
+	}
+	if (pages != 5 || !mapped->isMapped())
+	{
+		PRINT_ERROR("ERROR :: Mapped file is not iterated correctly");
+	}
+	try
+	{
+		mapped->allocatePage();
+		PRINT_ERROR("ERROR :: File is read-only. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const IoException&)
+	{
+	}
+
+	//A pool page of a mapped file is the mapping itself: a change made to the
+	//file behind the pool's back shows through the pinned page at once
+	BufMgr* mapMgr = new BufMgr(3);
+	mapMgr->readPage(mapped, 3, page);
+	{
+		std::fstream raw(filename, std::ios::in | std::ios::out | std::ios::binary);
+		std::string contents((std::istreambuf_iterator<char>(raw)), std::istreambuf_iterator<char>());
+		const std::size_t at = contents.find("test.19 Page 3");
+		raw.seekp(at);
+		raw.write("TEST", 4);
+	}
+	if (page->getRecord(rid[2]).compare(0, 14, "TEST.19 Page 3") != 0)
+	{
+		PRINT_ERROR("ERROR :: Mapped page was copied into the pool");
+	}
+	mapMgr->unPinPage(mapped, 3, true);
+
+	//Frames that held mapped pages go back to their own memory when reused
+	for (i = 1; i <= 5; i++)
+	{
+		mapMgr->readPage(mapped, i, page);
+		mapMgr->unPinPage(mapped, i, false);
+	}
+	File* other = new File(File::create(othername));
+	for (i = 0; i < 3; i++)
+	{
+		mapMgr->allocPage(other, pid[i], page);
+		sprintf((char*)tmpbuf, "test.19 other %d", pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		mapMgr->unPinPage(other, pid[i], true);
+	}
+	mapMgr->flushFile(other);
+	mapMgr->flushFile(mapped);
+	for (i = 0; i < 3; i++)
+	{
+		sprintf((char*)tmpbuf, "test.19 other %d", pid[i]);
+		if (other->readPage(pid[i]).getRecord(rid[i]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Page written into a reused frame was lost");
+		}
+	}
+	delete mapMgr;
+	delete mapped;
+	delete other;
+	File::remove(filename);
+	File::remove(othername);
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	//Records are read, written and iterated without being copied
+	const std::string& filename = "test.20";
+	BufMgr* viewMgr = new BufMgr(num);
+	File* file20 = new File(File::create(filename));
+	const std::string line = "test.20 record 0|test.20 record 1|test.20 record 2";
+	viewMgr->allocPage(file20, pageno1, page);
+	for (i = 0; i < 3; i++)
+	{
+		//a view of part of a string needs no terminator
+		rid[i] = page->insertRecord(std::string_view(line).substr(i * 17, 16));
+	}
+	std::string_view first = page->getRecordView(rid[0]);
+	if (first != "test.20 record 0" || first.data() != page->getRecordView(rid[0]).data() ||
+	    page->getRecord(rid[2]) != "test.20 record 2")
+	{
+		PRINT_ERROR("ERROR :: Record view does not match the record");
+	}
+	//an update moves records on the page, so it takes a copy of one, not a view
+	page->updateRecord(rid[1], page->getRecord(rid[2]));
+	i = 0;
+	for (PageIterator page_iter = page->begin(); page_iter != page->end(); ++page_iter)
+	{
+		if (page_iter.record() != page->getRecordView(page_iter.recordId()))
+		{
+			PRINT_ERROR("ERROR :: Page iterator returned the wrong record");
+		}
+		i++;
+	}
+	if (i != 3 || page->getRecordView(rid[1]) != "test.20 record 2")
+	{
+		PRINT_ERROR("ERROR :: Records not iterated or updated correctly");
+	}
+	viewMgr->unPinPage(file20, pageno1, true);
+	for (i = 0; i < 3; i++)
+	{
+		viewMgr->allocPage(file20, pageno2, page);
+		page->insertRecord("test.20 more");
+		viewMgr->unPinPage(file20, pageno2, true);
+	}
+	viewMgr->flushFile(file20);
+
+	//The file iterator reads every page into the same buffer
+	const Page* buffer = NULL;
+	int pages = 0;
+	for (FileIterator iter = file20->begin(); iter != file20->end(); ++iter)
+	{
+		Page& scanned = *iter;
+		if (buffer == NULL)
+		{
+			buffer = &scanned;
+		}
+		if (&scanned != buffer || scanned.page_number() != (PageId)(pages + 1))
+		{
+			PRINT_ERROR("ERROR :: File iterator copied pages");
+		}
+		pages++;
+	}
+	if (pages != 4)
+	{
+		PRINT_ERROR("ERROR :: File iterator skipped pages");
+	}
+	delete viewMgr;
+	delete file20;
+	File::remove(filename);
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	//Deletes leave holes that are compacted only when an insert needs them
+	const std::string& filename = "test.21";
+	BufMgr* compactMgr = new BufMgr(num);
+	File* file21 = new File(File::create(filename));
+	compactMgr->allocPage(file21, pageno1, page);
+	std::vector<RecordId> records;
+	const std::string rec(100, 'r');
+	while (page->hasSpaceForRecord(rec))
+	{
+		records.push_back(page->insertRecord(rec));
+	}
+	const PageOffset full = page->getFreeSpace();
+	//every other record goes, first one by one, then in a batch
+	page->deleteRecord(records[1]);
+	page->deleteRecord(records[3]);
+	std::vector<RecordId> batch;
+	for (std::size_t k = 5; k < records.size(); k += 2)
+	{
+		batch.push_back(records[k]);
+	}
+	batch.push_back(records[5]);
+	page->deleteRecords(batch);
+	//freed slots at the end of the slot array add to that
+	const std::size_t deleted = 2 + (records.size() - 5 + 1) / 2;
+	if (page->getFreeSpace() < full + deleted * rec.size() || !page->isConsistent())
+	{
+		PRINT_ERROR("ERROR :: Deleted record space not accounted for");
+	}
+	//a record larger than any hole fits only after compaction
+	const std::string big(3 * rec.size(), 'b');
+	const RecordId bigId = page->insertRecord(big);
+	if (page->getRecord(bigId) != big || !page->isConsistent())
+	{
+		PRINT_ERROR("ERROR :: Page not compacted correctly");
+	}
+	for (std::size_t k = 0; k < records.size(); k += 2)
+	{
+		if (page->getRecord(records[k]) != rec)
+		{
+			PRINT_ERROR("ERROR :: Compaction damaged a record");
+		}
+	}
+
+	//a batch with one bad ID deletes nothing
+	batch.assign(1, records[0]);
+	batch.push_back(records[3]);
+	try
+	{
+		page->deleteRecords(batch);
+		PRINT_ERROR("ERROR :: Record was deleted. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const InvalidRecordException&)
+	{
+	}
+	if (page->getRecord(records[0]) != rec)
+	{
+		PRINT_ERROR("ERROR :: Failed batch deleted a record");
+	}
+	batch.clear();
+	for (PageIterator page_iter = page->begin(); page_iter != page->end(); ++page_iter)
+	{
+		batch.push_back(page_iter.recordId());
+	}
+	page->deleteRecords(batch);
+	if (page->getFreeSpace() != Page::DATA_SIZE || page->begin() != page->end() ||
+	    !page->isConsistent())
+	{
+		PRINT_ERROR("ERROR :: Emptied page is not empty");
+	}
+	compactMgr->unPinPage(file21, pageno1, true);
+	compactMgr->flushFile(file21);
+	delete compactMgr;
+	delete file21;
+	File::remove(filename);
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	//Freed slots are reused from a chain, also in files written before it
+	if (Page::SIZE != 8192)
+	{
+		//every file of the old formats has 8192 byte pages
+		std::cout << "Test 22 passed" << "\n";
+		return;
+	}
+	const std::string& filename = "test.22";
+	BufMgr* slotMgr = new BufMgr(num);
+	File* file22 = new File(File::create(filename));
+	slotMgr->allocPage(file22, pageno1, page);
+	std::vector<RecordId> records;
+	for (i = 0; i < 300; i++)
+	{
+		records.push_back(page->insertRecord("s"));
+	}
+	page->deleteRecord(records[10]);
+	page->deleteRecord(records[200]);
+	page->deleteRecord(records[50]);
+	//the slot freed last is taken first
+	if (page->insertRecord("t").slot_number != records[50].slot_number ||
+	    page->insertRecord("t").slot_number != records[200].slot_number ||
+	    !page->isConsistent())
+	{
+		PRINT_ERROR("ERROR :: Freed slots not reused in order");
+	}
+	//trailing free slots leave the chain as the slot array shrinks
+	for (i = 299; i >= 290; i--)
+	{
+		page->deleteRecord(records[i]);
+	}
+	if (page->insertRecord("u").slot_number != records[10].slot_number ||
+	    page->insertRecord("u").slot_number != 291 || !page->isConsistent())
+	{
+		PRINT_ERROR("ERROR :: Trailing slots not trimmed from the chain");
+	}
+	page->deleteRecord(records[20]);
+	page->deleteRecord(records[30]);
+	slotMgr->unPinPage(file22, pageno1, true);
+	slotMgr->flushFile(file22);
+	delete slotMgr;
+	delete file22;
+
+	//Turn the file back into version 4, which had no chain, and a page header
+	//without the page type, so that records sit further in
+	{
+		std::fstream raw(filename, std::ios::in | std::ios::out | std::ios::binary);
+		std::uint32_t version = 4;
+		raw.seekp(offsetof(FileHeader, version));
+		raw.write((const char*)&version, sizeof(version));
+		std::vector<char> image(Page::SIZE);
+		raw.seekg((std::streamoff)pageno1 * Page::SIZE);
+		raw.read(image.data(), Page::SIZE);
+		PageHeader header;
+		memcpy(&header, image.data(), sizeof(header));
+		header.first_free_slot = 0;
+		const std::size_t legacyHeader = offsetof(PageHeader, page_type);
+		const std::size_t shift = sizeof(PageHeader) - legacyHeader;
+		const char* data = image.data() + sizeof(PageHeader);
+		std::vector<char> legacyPage(Page::SIZE, 0);
+		char* legacyData = legacyPage.data() + legacyHeader;
+		memcpy(legacyData, data, header.free_space_lower_bound);
+		memcpy(legacyData + header.free_space_upper_bound + shift, data + header.free_space_upper_bound,
+		       Page::DATA_SIZE - header.free_space_upper_bound);
+		for (SlotId slot = 1; slot <= header.num_slots; slot++)
+		{
+			PageSlot* entry = (PageSlot*)legacyData + (slot - 1);
+			if (entry->used)
+			{
+				entry->item_offset += shift;
+			}
+			else
+			{
+				entry->item_offset = 0;
+				entry->item_length = 0;
+			}
+		}
+		header.free_space_upper_bound += shift;
+		memcpy(legacyPage.data(), &header, legacyHeader);
+		raw.seekp((std::streamoff)pageno1 * Page::SIZE);
+		raw.write(legacyPage.data(), Page::SIZE);
+	}
+	file22 = new File(File::open(filename));
+	Page migrated = file22->readPage(pageno1);
+	if (!migrated.isConsistent() || migrated.getRecord(records[40]) != "s")
+	{
+		PRINT_ERROR("ERROR :: Version 4 page not migrated correctly");
+	}
+	//the migrated chain starts at the lowest free slot
+	if (migrated.insertRecord("v").slot_number != records[20].slot_number ||
+	    migrated.insertRecord("v").slot_number != records[30].slot_number ||
+	    !migrated.isConsistent())
+	{
+		PRINT_ERROR("ERROR :: Migrated free slots not reused");
+	}
+	delete file22;
+	File::remove(filename);
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	//A bulk load packs pages and writes them in batches
+	const std::string& filename = "test.23";
+	BufMgrOptions options;
+	options.writerBatchPages = 8;
+	BufMgr* loadMgr = new BufMgr(num, options);
+	File* file23 = new File(File::create(filename, StorageType::POSIX, true));
+	std::vector<std::string> rows;
+	for (i = 0; i < 5000; i++)
+	{
+		sprintf((char*)tmpbuf, "test.23 row %d %7.1f", i, (float)i);
+		rows.push_back(tmpbuf);
+	}
+	std::vector<std::string_view> views(rows.begin(), rows.end());
+	std::vector<RecordId> loaded = loadMgr->bulkLoad(file23, views);
+	if (loaded.size() != rows.size())
+	{
+		PRINT_ERROR("ERROR :: Bulk load lost records");
+	}
+	//only the last page may have room for another row
+	PageId last = loaded.back().page_number;
+	const std::uint64_t pages = last;
+	for (i = 0; i < loaded.size(); i++)
+	{
+		loadMgr->readPage(file23, loaded[i].page_number, page);
+		if (page->getRecordView(loaded[i]) != rows[i] ||
+		    (loaded[i].page_number != last && i + 1 < loaded.size() &&
+		     loaded[i + 1].page_number != loaded[i].page_number &&
+		     page->hasSpaceForRecord(rows[i + 1])))
+		{
+			PRINT_ERROR("ERROR :: Bulk loaded page is wrong or not full");
+		}
+		loadMgr->unPinPage(file23, loaded[i].page_number, false);
+	}
+	//the pages are already on disk, with their checksums
+	if (loadMgr->getBufStats().diskwrites != pages || !file23->scrub().empty())
+	{
+		PRINT_ERROR("ERROR :: Bulk loaded pages not written");
+	}
+	Page onDisk = file23->readPage(loaded[123].page_number);
+	if (onDisk.getRecord(loaded[123]) != rows[123])
+	{
+		PRINT_ERROR("ERROR :: Bulk loaded page not on disk");
+	}
+
+	//a row too large for any page stops the load after the rows before it
+	views.assign(1, "test.23 small");
+	const std::string huge(Page::DATA_SIZE, 'h');
+	views.push_back(huge);
+	try
+	{
+		loadMgr->bulkLoad(file23, views);
+		PRINT_ERROR("ERROR :: Row cannot fit. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const InsufficientSpaceException&)
+	{
+	}
+	if (file23->readPage(last + 1).getRecord({last + 1, 1}) != "test.23 small")
+	{
+		PRINT_ERROR("ERROR :: Rows before the large one not loaded");
+	}
+	loadMgr->flushFile(file23);
+
+	//a batched write does not bring back a page deleted since it was read
+	const Page deleted = file23->readPage(loaded[0].page_number);
+	file23->deletePage(loaded[0].page_number);
+	try
+	{
+		file23->writePages(std::vector<const Page*>(1, &deleted));
+		PRINT_ERROR("ERROR :: Deleted page written. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const InvalidPageException&)
+	{
+	}
+	if (file23->allocatePage().page_number() != loaded[0].page_number)
+	{
+		PRINT_ERROR("ERROR :: Deleted page taken off the free list by a write");
+	}
+	delete loadMgr;
+	delete file23;
+	File::remove(filename);
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	//Flushing a file touches only its own frames and writes them in page order
+	const std::string& filename = "test.24";
+	const std::string& othername = "test.24.other";
+	BufMgr* listMgr = new BufMgr(num);
+	File* file24 = new File(File::create(filename));
+	File* other = new File(File::create(othername));
+	File* alias = new File(*file24);
+	if (alias->id() != file24->id() || other->id() == file24->id())
+	{
+		PRINT_ERROR("ERROR :: File identifiers not shared or not distinct");
+	}
+	for (i = 0; i < 20; i++)
+	{
+		listMgr->allocPage(i % 2 ? other : file24, pid[i], page);
+		listMgr->unPinPage(i % 2 ? other : file24, pid[i], false);
+	}
+	//dirty the pages of the file in reverse order, some through the alias
+	for (int k = 18; k >= 0; k -= 2)
+	{
+		File* owner = k % 4 ? alias : file24;
+		listMgr->readPage(owner, pid[k], page);
+		sprintf((char*)tmpbuf, "test.24 Page %d %7.1f", pid[k], (float)pid[k]);
+		rid[k] = page->insertRecord(tmpbuf);
+		listMgr->unPinPage(owner, pid[k], true);
+	}
+	const std::uint64_t writes = listMgr->getBufStats().diskwrites;
+	listMgr->flushFile(file24);
+	if (listMgr->getBufStats().diskwrites - writes != 10)
+	{
+		PRINT_ERROR("ERROR :: Flush did not write the dirty pages of the file");
+	}
+	int resident = 0;
+	for (FrameId frame = 0; frame < num; frame++)
+	{
+		if (listMgr->getFrameValid(frame))
+		{
+			resident++;
+			if (listMgr->getFileName(frame) != othername)
+			{
+				PRINT_ERROR("ERROR :: Flushed file still has pages in the pool");
+			}
+		}
+	}
+	if (resident != 10)
+	{
+		PRINT_ERROR("ERROR :: Flush evicted pages of another file");
+	}
+	for (i = 0; i < 20; i += 2)
+	{
+		sprintf((char*)tmpbuf, "test.24 Page %d %7.1f", pid[i], (float)pid[i]);
+		if (file24->readPage(pid[i]).getRecord(rid[i]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Flushed page has the wrong contents");
+		}
+	}
+	listMgr->flushFile(other);
+	delete listMgr;
+	delete alias;
+	delete file24;
+	delete other;
+	File::remove(filename);
+	File::remove(othername);
+	std::cout << "Test 24 passed" << "\n";
+}
+
+void test25()
+{
+	//Statistics count hits, misses, evictions and writes, also per file
+	const std::string& filename = "test.25";
+	BufMgr* statMgr = new BufMgr(5);
+	File* file25 = new File(File::create(filename));
+	for (i = 0; i < 10; i++)
+	{
+		statMgr->allocPage(file25, pid[i], page);
+		sprintf((char*)tmpbuf, "test.25 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		statMgr->unPinPage(file25, pid[i], true);
+	}
+	BufStats stats = statMgr->getBufStats();
+	if (stats.accesses != 10 || stats.evictions != 5 || stats.dirtyevictions != 5 ||
+	    stats.diskwrites != 5 || stats.victimsearches != 10 ||
+	    stats.sweepsteps < stats.victimsearches || stats.files[filename].writes != 5)
+	{
+		PRINT_ERROR("ERROR :: Allocations and evictions miscounted");
+	}
+
+	statMgr->clearBufStats();
+	stats = statMgr->getBufStats();
+	if (stats.accesses != 0 || stats.diskwrites != 0 || stats.misslatency.count != 0 ||
+	    stats.files[filename].writes != 0)
+	{
+		PRINT_ERROR("ERROR :: Statistics not cleared");
+	}
+	//page 0 was evicted, so the first read misses and the second hits
+	statMgr->readPage(file25, pid[0], page);
+	statMgr->readPage(file25, pid[0], page);
+	statMgr->unPinPage(file25, pid[0], false);
+	statMgr->unPinPage(file25, pid[0], false);
+	stats = statMgr->getBufStats();
+	if (stats.hits != 1 || stats.misses != 1 || stats.accesses != 2 ||
+	    stats.hitRatio() != 0.5 || stats.misslatency.count != 1 ||
+	    stats.misslatency.percentile(0.5) > stats.misslatency.max ||
+	    stats.files[filename].hits != 1 || stats.files[filename].reads != 1)
+	{
+		PRINT_ERROR("ERROR :: Hits and misses miscounted");
+	}
+
+	//hits from many threads at once are all counted, per file too
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.push_back(std::thread([statMgr, file25]() {
+			Page* hit;
+			for (int k = 0; k < 10000; k++)
+			{
+				statMgr->readPage(file25, pid[0], hit);
+				statMgr->unPinPage(file25, pid[0], false);
+			}
+		}));
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	stats = statMgr->getBufStats();
+	if (stats.hits != 40001 || stats.files[filename].hits != 40001 || stats.misses != 1)
+	{
+		PRINT_ERROR("ERROR :: Concurrent hits miscounted");
+	}
+
+	//the histogram keeps percentiles within a bucket's width
+	LatencyHistogram histogram;
+	for (std::uint64_t v = 1; v <= 1000; v++)
+	{
+		histogram.record(v);
+	}
+	const LatencySnapshot latency = histogram.snapshot();
+	const std::uint64_t median = latency.percentile(0.5);
+	if (latency.count != 1000 || latency.mean() != 500 || latency.max != 1000 ||
+	    median < 500 || median > 500 + 500 / LatencyHistogram::SUB_BUCKETS ||
+	    latency.percentile(1.0) != 1000)
+	{
+		PRINT_ERROR("ERROR :: Latency percentiles are off");
+	}
+	for (std::size_t b = 0; b < LatencyHistogram::BUCKETS; b++)
+	{
+		if (LatencyHistogram::bucketOf(LatencyHistogram::bucketLow(b)) != b ||
+		    (b > 0 && LatencyHistogram::bucketOf(LatencyHistogram::bucketLow(b) - 1) != b - 1))
+		{
+			PRINT_ERROR("ERROR :: Histogram buckets overlap");
+		}
+	}
+
+	//the read above wrote back one dirty page, the flush the other four
+	statMgr->flushFile(file25);
+	if (statMgr->getBufStats().files[filename].writes != 5)
+	{
+		PRINT_ERROR("ERROR :: Flushed pages not counted for the file");
+	}
+	delete statMgr;
+	delete file25;
+	File::remove(filename);
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	//Traced calls come back in order and replay against pools of any size
+	const std::string& filename = "test.26";
+	const std::string& tracename = "test.26.trace";
+	BufMgrOptions options;
+	options.traceFile = tracename;
+	BufMgr* traceMgr = new BufMgr(num, options);
+	File* file26 = new File(File::create(filename));
+	for (i = 0; i < 20; i++)
+	{
+		traceMgr->allocPage(file26, pid[i], page);
+		traceMgr->unPinPage(file26, pid[i], true);
+	}
+	for (int round = 0; round < 3; round++)
+	{
+		for (i = 0; i < 20; i++)
+		{
+			traceMgr->readPage(file26, pid[i], page);
+			traceMgr->unPinPage(file26, pid[i], false);
+		}
+	}
+	traceMgr->disposePage(file26, pid[19]);
+	const FileId id = file26->id();
+	traceMgr->flushFile(file26);
+	delete traceMgr;
+	delete file26;
+	File::remove(filename);
+
+	const std::vector<TraceRecord> trace = TraceRecorder::read(tracename);
+	if (trace.size() != 161 || trace[0].op != TraceOp::ALLOC || trace[1].op != TraceOp::UNPIN ||
+	    !trace[1].dirty || trace[40].op != TraceOp::READ || trace[41].dirty ||
+	    trace[160].op != TraceOp::DISPOSE || trace[160].page != pid[19])
+	{
+		PRINT_ERROR("ERROR :: Trace does not match the calls made");
+	}
+	for (std::size_t k = 1; k < trace.size(); k++)
+	{
+		if (trace[k].file != id || trace[k].nanos < trace[k - 1].nanos)
+		{
+			PRINT_ERROR("ERROR :: Trace records out of order");
+		}
+	}
+
+	//every page fits in a big pool, so only the allocations cost; a small
+	//pool misses on every read of the cyclic scan
+	const TraceReplay replay(trace, "test.26.replay");
+	const ReplayResult big = replay.run(num);
+	const ReplayResult small = replay.run(10);
+	if (big.operations != 161 || big.skipped != 0 || big.stats.hits != 60 ||
+	    big.stats.misses != 0 || small.stats.misses != 60 || small.stats.diskwrites < 10 ||
+	    File::exists("test.26.replay." + std::to_string(id)))
+	{
+		PRINT_ERROR("ERROR :: Replay did not reproduce the trace");
+	}
+
+	//batch reads racing for the same missing pages are traced once each
+	{
+		BufMgr* batchMgr = new BufMgr(160, options);
+		File* batch26 = new File(File::create(filename));
+		std::vector<PageId> batchPages(32);
+		for (PageId& pageNo : batchPages)
+		{
+			batchMgr->allocPage(batch26, pageNo, page);
+			batchMgr->unPinPage(batch26, pageNo, true);
+		}
+		batchMgr->flushFile(batch26);
+		for (int round = 0; round < 20; round++)
+		{
+			std::vector<std::thread> batchReaders;
+			std::atomic<int> ready(0);
+			for (int t = 0; t < 4; t++)
+			{
+				batchReaders.emplace_back([&]() {
+					//start together, so that they miss the same pages
+					ready++;
+					while (ready.load() < 4)
+					{
+					}
+					std::vector<Page*> pinned;
+					batchMgr->readPages(batch26, batchPages, pinned);
+					batchMgr->unPinPages(batch26, pinned, false);
+				});
+			}
+			for (std::thread& reader : batchReaders)
+			{
+				reader.join();
+			}
+			batchMgr->flushFile(batch26);
+		}
+		delete batchMgr;
+		delete batch26;
+		File::remove(filename);
+		std::size_t reads = 0;
+		std::size_t unpins = 0;
+		for (const TraceRecord& record : TraceRecorder::read(tracename))
+		{
+			reads += record.op == TraceOp::READ;
+			unpins += record.op == TraceOp::UNPIN;
+		}
+		if (reads != 20 * 4 * 32 || unpins != 32 + 20 * 4 * 32)
+		{
+			PRINT_ERROR("ERROR :: Batch reads traced more than once");
+		}
+	}
+
+	//a full ring keeps only the newest records
+	{
+		TraceRecorder ring(tracename, 16);
+		for (PageId n = 0; n < 40; n++)
+		{
+			ring.record(TraceOp::READ, 1, n);
+		}
+	}
+	const std::vector<TraceRecord> newest = TraceRecorder::read(tracename);
+	if (newest.size() != 16 || newest.front().page != 24 || newest.back().page != 39)
+	{
+		PRINT_ERROR("ERROR :: Trace ring did not keep the newest records");
+	}
+	File::remove(tracename);
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	//Batched reads look up and read each distinct page once, in runs
+	const std::string& filename = "test.27";
+	BufMgr* batchMgr = new BufMgr(num);
+	File* file27 = new File(File::create(filename));
+	for (i = 0; i < 30; i++)
+	{
+		batchMgr->allocPage(file27, pid[i], page);
+		sprintf((char*)tmpbuf, "test.27 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		batchMgr->unPinPage(file27, pid[i], true);
+	}
+	batchMgr->disposePage(file27, pid[29]);
+	batchMgr->flushFile(file27);
+	batchMgr->clearBufStats();
+
+	const std::vector<PageId> wanted = {pid[5], pid[3], pid[4], pid[3], pid[10], pid[11], pid[12], pid[20]};
+	std::vector<Page*> pages;
+	batchMgr->readPages(file27, wanted, pages);
+	BufStats stats = batchMgr->getBufStats();
+	if (pages.size() != wanted.size() || pages[1] != pages[3] || stats.misses != 8 ||
+	    stats.diskreads != 7 || stats.misslatency.count != 3)
+	{
+		PRINT_ERROR("ERROR :: Batched read did not read each page once, in runs");
+	}
+	for (std::size_t k = 0; k < wanted.size(); k++)
+	{
+		const int n = wanted[k] - pid[0];
+		sprintf((char*)tmpbuf, "test.27 Page %d %7.1f", pid[n], (float)pid[n]);
+		if (pages[k]->page_number() != wanted[k] || pages[k]->getRecord(rid[n]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Batched read returned the wrong page");
+		}
+	}
+	std::vector<Page*> again;
+	batchMgr->readPages(file27, wanted, again);
+	if (again != pages || batchMgr->getBufStats().hits != 8)
+	{
+		PRINT_ERROR("ERROR :: Batched read of resident pages did not hit");
+	}
+
+	//each listed page loses one pin per listing
+	batchMgr->unPinPages(file27, wanted, false);
+	batchMgr->unPinPages(file27, again, true);
+	try
+	{
+		batchMgr->unPinPage(file27, pid[3], false);
+		PRINT_ERROR("ERROR :: Page still pinned after batched unpin");
+	}
+	catch (const PageNotPinnedException&)
+	{
+	}
+	try
+	{
+		batchMgr->unPinPages(file27, std::vector<PageId>{pid[4], pid[4]}, false);
+		PRINT_ERROR("ERROR :: Unpinning an unpinned batch did not throw");
+	}
+	catch (const PageNotPinnedException&)
+	{
+	}
+
+	//a batch that fails leaves nothing pinned
+	try
+	{
+		batchMgr->readPages(file27, std::vector<PageId>{pid[1], pid[2], pid[29]}, pages);
+		PRINT_ERROR("ERROR :: Batched read of a deleted page did not throw");
+	}
+	catch (const InvalidPageException&)
+	{
+	}
+	BufMgr* smallMgr = new BufMgr(5);
+	try
+	{
+		smallMgr->readPages(file27, std::vector<PageId>{pid[1], pid[2], pid[3], pid[4], pid[5], pid[6]}, pages);
+		PRINT_ERROR("ERROR :: Batched read larger than the pool did not throw");
+	}
+	catch (const BufferExceededException&)
+	{
+	}
+	for (FrameId frame = 0; frame < num; frame++)
+	{
+		if (batchMgr->getPinCnt(frame) != 0 || (frame < 5 && smallMgr->getPinCnt(frame) != 0))
+		{
+			PRINT_ERROR("ERROR :: Failed batched read left pages pinned");
+		}
+	}
+	smallMgr->flushFile(file27);
+	delete smallMgr;
+	batchMgr->flushFile(file27);
+	delete batchMgr;
+	sprintf((char*)tmpbuf, "test.27 Page %d %7.1f", pid[3], (float)pid[3]);
+	if (file27->readPage(pid[3]).getRecord(rid[3]) != tmpbuf)
+	{
+		PRINT_ERROR("ERROR :: Page unpinned dirty in a batch was lost");
+	}
+	delete file27;
+	File::remove(filename);
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	//Guards unpin the frame they hold when they go away
+	const std::string& filename = "test.28";
+	BufMgr* guardMgr = new BufMgr(num);
+	File* file28 = new File(File::create(filename));
+	for (i = 0; i < 5; i++)
+	{
+		PageGuard guard = guardMgr->allocPage(file28, pid[i]);
+		sprintf((char*)tmpbuf, "test.28 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = guard->insertRecord(tmpbuf);
+		guard.markDirty();
+		if (guardMgr->getPinCnt(guard.frame()) != 1 || guard.pageNo() != pid[i])
+		{
+			PRINT_ERROR("ERROR :: Allocated page not pinned by its guard");
+		}
+	}
+	for (i = 0; i < 5; i++)
+	{
+		try
+		{
+			guardMgr->unPinPage(file28, pid[i], false);
+			PRINT_ERROR("ERROR :: Guard did not unpin its page");
+		}
+		catch (const PageNotPinnedException&)
+		{
+		}
+	}
+
+	PageGuard first = guardMgr->readPage(file28, pid[2]);
+	PageGuard second = guardMgr->readPage(file28, pid[2]);
+	const FrameId frame = first.frame();
+	if (first.get() != second.get() || guardMgr->getPinCnt(frame) != 2)
+	{
+		PRINT_ERROR("ERROR :: Two guards of a page do not share its frame");
+	}
+	PageGuard moved(std::move(first));
+	if (first || !moved || guardMgr->getPinCnt(frame) != 2)
+	{
+		PRINT_ERROR("ERROR :: Moving a guard changed the pins");
+	}
+	second = std::move(moved);
+	second.release();
+	second.release();
+	if (second || guardMgr->getPinCnt(frame) != 0)
+	{
+		PRINT_ERROR("ERROR :: Released guards still hold pins");
+	}
+
+	guardMgr->flushFile(file28);
+	delete guardMgr;
+	for (i = 0; i < 5; i++)
+	{
+		sprintf((char*)tmpbuf, "test.28 Page %d %7.1f", pid[i], (float)pid[i]);
+		if (file28->readPage(pid[i]).getRecord(rid[i]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Page a guard marked dirty was not written");
+		}
+	}
+	delete file28;
+	File::remove(filename);
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	//Pages live in the instance they hash to
+	const std::string& filename = "test.29";
+	BufMgrOptions options;
+	options.numaNode = 0;
+	BufPoolSet* pools = new BufPoolSet(4, 16, options);
+	File* file29 = new File(File::create(filename));
+	for (i = 0; i < 20; i++)
+	{
+		PageGuard guard = pools->allocPage(file29, pid[i]);
+		sprintf((char*)tmpbuf, "test.29 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = guard->insertRecord(tmpbuf);
+		guard.markDirty();
+		const std::uint32_t n = pools->instanceOf(file29, pid[i]);
+		if (pools->instance(n).getPinCnt(guard.frame()) != 1 ||
+		    &pools->instance(n).bufPool[guard.frame()] != guard.get())
+		{
+			PRINT_ERROR("ERROR :: Allocated page not in the instance it hashes to");
+		}
+	}
+	//new pages are only written back, not written empty first
+	std::ifstream allocated(filename, std::ios::binary | std::ios::ate);
+	if (allocated.tellg() >= std::streamoff(Page::SIZE))
+	{
+		PRINT_ERROR("ERROR :: New page of an instance written before write-back");
+	}
+	std::uint32_t used = 0;
+	for (std::uint32_t n = 0; n < pools->size(); n++)
+	{
+		if (pools->instance(n).getBufStats().accesses > 0)
+		{
+			used++;
+		}
+		if (pools->nodeOf(n) != 0)
+		{
+			PRINT_ERROR("ERROR :: Instance not placed on the chosen node");
+		}
+	}
+	if (used < 2)
+	{
+		PRINT_ERROR("ERROR :: Pages not spread over the instances");
+	}
+	pools->clearBufStats();
+	for (i = 0; i < 20; i++)
+	{
+		pools->readPage(file29, pid[i], page);
+		sprintf((char*)tmpbuf, "test.29 Page %d %7.1f", pid[i], (float)pid[i]);
+		if (page->getRecord(rid[i]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Page read from the wrong instance");
+		}
+		pools->unPinPage(file29, pid[i], false);
+	}
+	BufStats stats = pools->getBufStats();
+	if (stats.hits != 20 || stats.misses != 0 || stats.files[filename].hits != 20)
+	{
+		PRINT_ERROR("ERROR :: Instance statistics do not add up");
+	}
+	pools->disposePage(file29, pid[7]);
+	try
+	{
+		pools->readPage(file29, pid[7], page);
+		PRINT_ERROR("ERROR :: Disposed page still readable");
+	}
+	catch (const InvalidPageException&)
+	{
+	}
+	pools->flushFile(file29);
+	delete pools;
+	for (i = 0; i < 20; i++)
+	{
+		if (i == 7)
+		{
+			continue;
+		}
+		sprintf((char*)tmpbuf, "test.29 Page %d %7.1f", pid[i], (float)pid[i]);
+		if (file29->readPage(pid[i]).getRecord(rid[i]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Page of an instance was not written");
+		}
+	}
+	delete file29;
+	File::remove(filename);
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	//The pool grows and shrinks while it is being read
+	const std::string& filename = "test.30";
+	const ReplacementType policies[] = {ReplacementType::CLOCK, ReplacementType::LRU_K,
+	                                    ReplacementType::TWO_Q, ReplacementType::ARC};
+	for (const ReplacementType policy : policies)
+	{
+		BufMgrOptions options;
+		options.replacement = policy;
+		options.maxBufs = 40;
+		if (policy == ReplacementType::LRU_K)
+		{
+			options.pageTable = PageTableType::OPEN_ADDRESSING;
+		}
+		BufMgr* sizedMgr = new BufMgr(10, options);
+		File* file30 = new File(File::create(filename));
+		try
+		{
+			sizedMgr->resize(41);
+			PRINT_ERROR("ERROR :: Pool grew beyond its reserved frames");
+		}
+		catch (const BufferExceededException&)
+		{
+		}
+		for (i = 0; i < 10; i++)
+		{
+			sizedMgr->allocPage(file30, pid[i], page);
+		}
+		try
+		{
+			sizedMgr->allocPage(file30, pid[10], page);
+			PRINT_ERROR("ERROR :: Full pool handed out a frame");
+		}
+		catch (const BufferExceededException&)
+		{
+		}
+		sizedMgr->resize(30);
+		for (i = 10; i < 30; i++)
+		{
+			sizedMgr->allocPage(file30, pid[i], page);
+		}
+		for (i = 0; i < 30; i++)
+		{
+			sizedMgr->readPage(file30, pid[i], page);
+			sprintf((char*)tmpbuf, "test.30 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			sizedMgr->unPinPage(file30, pid[i], true);
+			sizedMgr->unPinPage(file30, pid[i], true);
+		}
+
+		//a reader keeps going while the pool shrinks under a pinned page
+		Page* held;
+		sizedMgr->readPage(file30, pid[25], held);
+		std::atomic<bool> stop(false);
+		std::atomic<int> readerErrors(0);
+		std::thread reader([&]() {
+			for (int n = 0; !stop.load(); n++)
+			{
+				Page* seen;
+				const int k = n % 30;
+				char expected[100];
+				sprintf(expected, "test.30 Page %d %7.1f", pid[k], (float)pid[k]);
+				sizedMgr->readPage(file30, pid[k], seen);
+				if (seen->getRecord(rid[k]) != expected)
+				{
+					readerErrors++;
+				}
+				sizedMgr->unPinPage(file30, pid[k], false);
+			}
+		});
+		std::thread shrinker([&]() { sizedMgr->resize(5); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		if (sizedMgr->size() != 5)
+		{
+			PRINT_ERROR("ERROR :: Shrinking pool still hands out the top frames");
+		}
+		sizedMgr->unPinPage(file30, pid[25], false);
+		shrinker.join();
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		stop = true;
+		reader.join();
+		if (readerErrors != 0)
+		{
+			PRINT_ERROR("ERROR :: Reader saw wrong contents during a resize");
+		}
+		for (FrameId frame = 5; frame < 40; frame++)
+		{
+			if (sizedMgr->getFrameValid(frame))
+			{
+				PRINT_ERROR("ERROR :: Frame beyond the shrunken pool holds a page");
+			}
+		}
+		sizedMgr->resize(12);
+		for (i = 0; i < 12; i++)
+		{
+			sizedMgr->readPage(file30, pid[i], page);
+		}
+		for (i = 0; i < 12; i++)
+		{
+			sizedMgr->unPinPage(file30, pid[i], false);
+		}
+		sizedMgr->flushFile(file30);
+		delete sizedMgr;
+		for (i = 0; i < 30; i++)
+		{
+			sprintf((char*)tmpbuf, "test.30 Page %d %7.1f", pid[i], (float)pid[i]);
+			if (file30->readPage(pid[i]).getRecord(rid[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Dirty page lost when the pool shrank");
+			}
+		}
+		delete file30;
+		File::remove(filename);
+	}
+
+	//misses racing a shrink never get a frame above the new size
+	{
+		File* file30 = new File(File::create(filename));
+		BufMgrOptions options;
+		options.maxBufs = 64;
+		BufMgr* sizedMgr = new BufMgr(48, options);
+		const int pages = 96;
+		std::vector<PageId> pageNos(pages);
+		std::vector<RecordId> rids(pages);
+		for (int n = 0; n < pages; n++)
+		{
+			sizedMgr->allocPage(file30, pageNos[n], page);
+			sprintf(tmpbuf, "test.30 Page %d", n);
+			rids[n] = page->insertRecord(tmpbuf);
+			sizedMgr->unPinPage(file30, pageNos[n], true);
+		}
+		sizedMgr->flushFile(file30);
+		std::atomic<bool> stop(false);
+		std::atomic<int> readerErrors(0);
+		std::vector<std::thread> readers;
+		for (int t = 0; t < 6; t++)
+		{
+			readers.emplace_back([&, t]() {
+				for (int n = t; !stop.load(); n += 7)
+				{
+					const int k = n % pages;
+					char expected[100];
+					sprintf(expected, "test.30 Page %d", k);
+					Page* seen;
+					try
+					{
+						sizedMgr->readPage(file30, pageNos[k], seen);
+					}
+					catch (const BufferExceededException&)
+					{
+						continue;
+					}
+					if (seen->getRecord(rids[k]) != expected)
+					{
+						readerErrors++;
+					}
+					sizedMgr->unPinPage(file30, pageNos[k], false);
+				}
+			});
+		}
+		std::atomic<int> strays(0);
+		for (int round = 0; round < 200; round++)
+		{
+			sizedMgr->resize(8);
+			//a miss that claimed a frame above the size would fill it meanwhile
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			for (FrameId frame = 8; frame < 48; frame++)
+			{
+				if (sizedMgr->getFrameValid(frame))
+				{
+					strays++;
+				}
+			}
+			sizedMgr->resize(48);
+		}
+		sizedMgr->resize(8);
+		stop = true;
+		for (std::thread& reader : readers)
+		{
+			reader.join();
+		}
+		if (readerErrors != 0 || strays != 0)
+		{
+			PRINT_ERROR("ERROR :: Miss racing a shrink took a dropped frame");
+		}
+		for (FrameId frame = 8; frame < 64; frame++)
+		{
+			if (sizedMgr->getFrameValid(frame))
+			{
+				PRINT_ERROR("ERROR :: Frame beyond the shrunken pool holds a page");
+			}
+		}
+		sizedMgr->flushFile(file30);
+		delete sizedMgr;
+		delete file30;
+	}
+
+	//a shrink whose write-back fails leaves the pool at its old size
+	{
+		File::remove(filename);
+		File* file30 = new File(File::create(filename));
+		BufMgrOptions options;
+		options.maxBufs = 8;
+		BufMgr* sizedMgr = new BufMgr(8, options);
+		for (i = 0; i < 8; i++)
+		{
+			sizedMgr->allocPage(file30, pid[i], page);
+			sprintf((char*)tmpbuf, "test.30 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			sizedMgr->unPinPage(file30, pid[i], true);
+		}
+		File other = File::open(filename);
+		other.deletePage(sizedMgr->getPage(5));
+		try
+		{
+			sizedMgr->resize(4);
+			PRINT_ERROR("ERROR :: Deleted page written back");
+		}
+		catch (const InvalidPageException&)
+		{
+		}
+		if (sizedMgr->size() != 8)
+		{
+			PRINT_ERROR("ERROR :: Failed shrink kept the new size");
+		}
+		for (FrameId frame = 5; frame < 8; frame++)
+		{
+			if (!sizedMgr->getFrameValid(frame) || !sizedMgr->getDirtyBit(frame) ||
+			    sizedMgr->getFrameFrozen(frame))
+			{
+				PRINT_ERROR("ERROR :: Failed shrink dropped a page it did not write back");
+			}
+		}
+		//every page is still readable, the dropped ones from the file
+		for (i = 0; i < 8; i++)
+		{
+			sizedMgr->readPage(file30, pid[i], page);
+			sprintf((char*)tmpbuf, "test.30 Page %d %7.1f", pid[i], (float)pid[i]);
+			if (page->getRecord(rid[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			sizedMgr->unPinPage(file30, pid[i], false);
+		}
+		//once the page can be written, calling resize() again finishes the shrink
+		other.allocatePage();
+		sizedMgr->resize(4);
+		if (sizedMgr->size() != 4)
+		{
+			PRINT_ERROR("ERROR :: Retried shrink did not take effect");
+		}
+		for (FrameId frame = 4; frame < 8; frame++)
+		{
+			if (sizedMgr->getFrameValid(frame))
+			{
+				PRINT_ERROR("ERROR :: Frame beyond the shrunken pool holds a page");
+			}
+		}
+		sizedMgr->flushFile(file30);
+		delete sizedMgr;
+		for (i = 0; i < 8; i++)
+		{
+			sprintf((char*)tmpbuf, "test.30 Page %d %7.1f", pid[i], (float)pid[i]);
+			if (file30->readPage(pid[i]).getRecord(rid[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Dirty page lost when the pool shrank");
+			}
+		}
+		delete file30;
+	}
+	File::remove(filename);
+	std::cout << "Test 30 passed" << "\n";
+}
+
+void test31()
+{
+	//A restarted pool reads back the pages its predecessor held
+	const std::string& filename = "test.31";
+	const std::string& warmname = "test.31.warm";
+	BufMgrOptions options;
+	options.warmFile = warmname;
+	options.warmDumpIntervalMs = 0;
+	std::remove(warmname.c_str());
+	BufMgr* firstMgr = new BufMgr(20, options);
+	File* file31 = new File(File::create(filename));
+	for (i = 0; i < 15; i++)
+	{
+		firstMgr->allocPage(file31, pid[i], page);
+		sprintf((char*)tmpbuf, "test.31 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		firstMgr->unPinPage(file31, pid[i], true);
+	}
+	for (i = 0; i < 5; i++)
+	{
+		firstMgr->readPage(file31, pid[i], page);
+		firstMgr->unPinPage(file31, pid[i], false);
+	}
+	//the pool's pages are dropped here but still listed at shutdown
+	firstMgr->flushFile(file31);
+	delete firstMgr;
+
+	BufMgr* secondMgr = new BufMgr(20, options);
+	secondMgr->warmUp(std::vector<File*>(1, file31));
+	if (secondMgr->waitWarmUp() != 15)
+	{
+		PRINT_ERROR("ERROR :: Warm-up did not load the listed pages");
+	}
+	secondMgr->clearBufStats();
+	for (i = 0; i < 15; i++)
+	{
+		secondMgr->readPage(file31, pid[i], page);
+		sprintf((char*)tmpbuf, "test.31 Page %d %7.1f", pid[i], (float)pid[i]);
+		if (page->getRecord(rid[i]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Warm-up loaded the wrong page");
+		}
+		secondMgr->unPinPage(file31, pid[i], false);
+	}
+	BufStats stats = secondMgr->getBufStats();
+	if (stats.hits != 15 || stats.misses != 0 || stats.diskreads != 0)
+	{
+		PRINT_ERROR("ERROR :: Pages read after a warm-up were not in the pool");
+	}
+	secondMgr->flushFile(file31);
+	delete secondMgr;
+
+	//a warm-up stopped by a failed write-back leaves no frame reserved
+	const std::string& dirtyname = "test.31b";
+	File* dirty31 = new File(File::create(dirtyname));
+	for (int n = 0; n < 4; n++)
+	{
+		Page newPage = dirty31->allocatePage();
+		dirty31->writePage(newPage);
+	}
+	BufMgr* failMgr = new BufMgr(4, options);
+	for (PageId n = 1; n <= 4; n++)
+	{
+		failMgr->readPage(dirty31, n, page);
+		failMgr->unPinPage(dirty31, n, true);
+	}
+	{
+		File other = File::open(dirtyname);
+		other.deletePage(failMgr->getPage(1));
+		failMgr->warmUp(std::vector<File*>(1, file31));
+		failMgr->waitWarmUp();
+		for (FrameId frame = 0; frame < 4; frame++)
+		{
+			if (failMgr->getPinCnt(frame) != 0)
+			{
+				PRINT_ERROR("ERROR :: Failed warm-up left a frame reserved");
+			}
+		}
+		other.allocatePage();
+	}
+	failMgr->flushFile(dirty31);
+	failMgr->flushFile(file31);
+	delete failMgr;
+	delete dirty31;
+	File::remove(dirtyname);
+
+	//without a list there is nothing to load
+	std::remove(warmname.c_str());
+	options.warmFile = "test.31.none";
+	BufMgr* coldMgr = new BufMgr(20, options);
+	coldMgr->warmUp(std::vector<File*>(1, file31));
+	if (coldMgr->waitWarmUp() != 0)
+	{
+		PRINT_ERROR("ERROR :: Warm-up without a list loaded pages");
+	}
+	coldMgr->flushFile(file31);
+	delete coldMgr;
+	std::remove("test.31.none");
+	delete file31;
+	File::remove(filename);
+	std::cout << "Test 31 passed" << "\n";
+}
+
+void test32()
+{
+	//Clean victims leave no mapping behind, and pinned frames are passed over
+	const std::string& filename = "test.32";
+	BufMgr* cleanMgr = new BufMgr(3);
+	File* file32 = new File(File::create(filename));
+	for (i = 0; i < 6; i++)
+	{
+		cleanMgr->allocPage(file32, pid[i], page);
+		sprintf((char*)tmpbuf, "test.32 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		cleanMgr->unPinPage(file32, pid[i], true);
+	}
+	cleanMgr->flushFile(file32);
+	cleanMgr->clearBufStats();
+	for (int round = 0; round < 3; round++)
+	{
+		for (i = 0; i < 6; i++)
+		{
+			cleanMgr->readPage(file32, pid[i], page);
+			sprintf((char*)tmpbuf, "test.32 Page %d %7.1f", pid[i], (float)pid[i]);
+			if (page->getRecord(rid[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Page read over a clean victim has the wrong contents");
+			}
+			cleanMgr->unPinPage(file32, pid[i], false);
+		}
+	}
+	BufStats stats = cleanMgr->getBufStats();
+	if (stats.misses != 18 || stats.dirtyevictions != 0)
+	{
+		PRINT_ERROR("ERROR :: Clean victim left its page in the page table");
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		cleanMgr->readPage(file32, pid[i], page);
+	}
+	try
+	{
+		cleanMgr->readPage(file32, pid[3], page);
+		PRINT_ERROR("ERROR :: Pinned frame was chosen as a victim");
+	}
+	catch (const BufferExceededException&)
+	{
+	}
+	//the unpin is seen by the next sweep
+	cleanMgr->unPinPage(file32, pid[1], false);
+	cleanMgr->readPage(file32, pid[3], page);
+	if (cleanMgr->getPinCnt(1) != 1 || cleanMgr->getPage(1) != pid[3])
+	{
+		PRINT_ERROR("ERROR :: Sweep passed over an unpinned frame");
+	}
+	cleanMgr->unPinPage(file32, pid[0], false);
+	cleanMgr->unPinPage(file32, pid[2], false);
+	cleanMgr->unPinPage(file32, pid[3], false);
+	cleanMgr->flushFile(file32);
+	delete cleanMgr;
+
+	//a victim whose write-back fails keeps its page and is not left frozen
+	BufMgr* failMgr = new BufMgr(1);
+	failMgr->readPage(file32, pid[0], page);
+	failMgr->unPinPage(file32, pid[0], true);
+	{
+		File other = File::open(filename);
+		other.deletePage(pid[0]);
+		try
+		{
+			failMgr->readPage(file32, pid[1], page);
+			PRINT_ERROR("ERROR :: Deleted page written back");
+		}
+		catch (const InvalidPageException&)
+		{
+		}
+		if (failMgr->getFrameFrozen(0) || !failMgr->getDirtyBit(0) || failMgr->getPage(0) != pid[0])
+		{
+			PRINT_ERROR("ERROR :: Failed eviction left the frame frozen");
+		}
+		other.allocatePage();
+	}
+	failMgr->flushFile(file32);
+	delete failMgr;
+	delete file32;
+	File::remove(filename);
+	std::cout << "Test 32 passed" << "\n";
+}
+
+void test33()
+{
+	//Compressed files take a fraction of the space and read back through the pool
+	const std::string& filename = "test.33";
+	BufMgr* zipMgr = new BufMgr(10);
+	File* file33 = new File(File::create(filename, StorageType::COMPRESSED, true));
+	for (i = 0; i < 40; i++)
+	{
+		zipMgr->allocPage(file33, pid[i], page);
+		sprintf((char*)tmpbuf, "test.33 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		zipMgr->unPinPage(file33, pid[i], true);
+	}
+	zipMgr->flushFile(file33);
+	//a page that is all but full does not compress and is stored as it is
+	zipMgr->readPage(file33, pid[0], page);
+	std::string filler(Page::DATA_SIZE / 2, 'x');
+	for (std::size_t k = 0; k < filler.size(); k++)
+	{
+		filler[k] = static_cast<char>('a' + (k * 7919 + k / 3) % 26);
+	}
+	const RecordId bulk = page->insertRecord(filler);
+	zipMgr->unPinPage(file33, pid[0], true);
+	zipMgr->disposePage(file33, pid[39]);
+	zipMgr->flushFile(file33);
+	delete file33;
+
+	std::ifstream stored(filename, std::ios::binary | std::ios::ate);
+	const std::uint64_t bytes = stored.tellg();
+	stored.close();
+	if (bytes == 0 || bytes * 4 > 41 * Page::SIZE)
+	{
+		PRINT_ERROR("ERROR :: Compressed file is not smaller than its pages");
+	}
+
+	//reopened with another type, the file is still read as compressed
+	file33 = new File(File::open(filename, StorageType::POSIX));
+	for (i = 0; i < 39; i++)
+	{
+		zipMgr->readPage(file33, pid[i], page);
+		sprintf((char*)tmpbuf, "test.33 Page %d %7.1f", pid[i], (float)pid[i]);
+		if (page->getRecord(rid[i]) != tmpbuf || (i == 0 && page->getRecord(bulk) != filler))
+		{
+			PRINT_ERROR("ERROR :: Compressed page read back wrong");
+		}
+		zipMgr->unPinPage(file33, pid[i], false);
+	}
+	try
+	{
+		zipMgr->readPage(file33, pid[39], page);
+		PRINT_ERROR("ERROR :: Deleted compressed page could be read");
+	}
+	catch (const InvalidPageException&)
+	{
+	}
+	if (!file33->scrub().empty())
+	{
+		PRINT_ERROR("ERROR :: Compressed file fails its checksums");
+	}
+	zipMgr->flushFile(file33);
+	delete zipMgr;
+	delete file33;
+	File::remove(filename);
+	std::cout << "Test 33 passed" << "\n";
+}
+
+void test34()
+{
+	//Pages evicted after being reused come back from the second tier
+	const std::string& filename = "test.34";
+	const std::string& ssdname = "test.34.ssd";
+	BufMgr* loadMgr = new BufMgr(4);
+	File* file34 = new File(File::create(filename));
+	for (i = 0; i < 20; i++)
+	{
+		loadMgr->allocPage(file34, pid[i], page);
+		sprintf((char*)tmpbuf, "test.34 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		loadMgr->unPinPage(file34, pid[i], true);
+	}
+	loadMgr->flushFile(file34);
+	delete loadMgr;
+
+	BufMgrOptions options;
+	options.ssdCacheFile = ssdname;
+	options.ssdCachePages = 32;
+	BufMgr* tierMgr = new BufMgr(4, options);
+	//a page read once is not admitted
+	for (i = 0; i < 20; i++)
+	{
+		tierMgr->readPage(file34, pid[i], page);
+		tierMgr->unPinPage(file34, pid[i], false);
+	}
+	BufStats stats = tierMgr->getBufStats();
+	if (stats.ssd.admissions != 0 || stats.ssd.rejections != 16 || stats.ssd.misses != 20)
+	{
+		PRINT_ERROR("ERROR :: Second tier admitted pages of a single scan");
+	}
+	//read again, they are
+	for (i = 0; i < 20; i++)
+	{
+		tierMgr->readPage(file34, pid[i], page);
+		tierMgr->unPinPage(file34, pid[i], false);
+	}
+	if (tierMgr->getBufStats().ssd.admissions != 16)
+	{
+		PRINT_ERROR("ERROR :: Second tier refused pages read again");
+	}
+	tierMgr->clearBufStats();
+	for (i = 0; i < 16; i++)
+	{
+		tierMgr->readPage(file34, pid[i], page);
+		sprintf((char*)tmpbuf, "test.34 Page %d %7.1f", pid[i], (float)pid[i]);
+		if (page->getRecord(rid[i]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Second tier returned the wrong page");
+		}
+		tierMgr->unPinPage(file34, pid[i], false);
+	}
+	stats = tierMgr->getBufStats();
+	if (stats.ssd.hits != 16 || stats.diskreads != 0 || stats.misses != 16)
+	{
+		PRINT_ERROR("ERROR :: Pages in the second tier were read from the file");
+	}
+
+	//a page changed in the pool is written back before it is demoted
+	tierMgr->readPage(file34, pid[16], page);
+	const RecordId changed = page->insertRecord("test.34 changed");
+	tierMgr->unPinPage(file34, pid[16], true);
+	tierMgr->readPage(file34, pid[16], page);
+	tierMgr->unPinPage(file34, pid[16], false);
+	for (i = 0; i < 8; i++)
+	{
+		tierMgr->readPage(file34, pid[i], page);
+		tierMgr->unPinPage(file34, pid[i], false);
+	}
+	tierMgr->readPage(file34, pid[16], page);
+	if (page->getRecord(changed) != "test.34 changed")
+	{
+		PRINT_ERROR("ERROR :: Second tier lost a change to a demoted page");
+	}
+	//a flush refused for a pinned page keeps the second tier's pages
+	try
+	{
+		tierMgr->flushFile(file34);
+		PRINT_ERROR("ERROR :: Flushed a file with a pinned page");
+	}
+	catch (const PagePinnedException&)
+	{
+	}
+	tierMgr->unPinPage(file34, pid[16], false);
+	tierMgr->clearBufStats();
+	for (i = 8; i < 16; i++)
+	{
+		tierMgr->readPage(file34, pid[i], page);
+		tierMgr->unPinPage(file34, pid[i], false);
+	}
+	if (tierMgr->getBufStats().ssd.hits == 0)
+	{
+		PRINT_ERROR("ERROR :: Refused flush dropped the second tier's pages");
+	}
+	tierMgr->flushFile(file34);
+	delete tierMgr;
+	if (File::exists(ssdname))
+	{
+		PRINT_ERROR("ERROR :: Second tier file outlived the pool");
+	}
+	delete file34;
+	File::remove(filename);
+	std::cout << "Test 34 passed" << "\n";
+}
+
+void test35()
+{
+	//Files record their page size and only open with the same one
+	const std::string& filename = "test.35";
+	File* file35 = new File(File::create(filename));
+	Page* page35;
+	BufMgr* sizeMgr = new BufMgr(4);
+	PageId pageno;
+	sizeMgr->allocPage(file35, pageno, page35);
+	//a record filling the page still has offsets that fit
+	const std::string big(Page::DATA_SIZE - sizeof(PageSlot), 'p');
+	const RecordId bigRid = page35->insertRecord(big);
+	if (page35->getFreeSpace() != 0 || page35->getRecord(bigRid) != big)
+	{
+		PRINT_ERROR("ERROR :: Record filling the page not stored");
+	}
+	sizeMgr->unPinPage(file35, pageno, true);
+	sizeMgr->flushFile(file35);
+	delete sizeMgr;
+	delete file35;
+
+	std::uint32_t size = 0;
+	{
+		std::ifstream raw(filename, std::ios::binary);
+		raw.seekg(offsetof(FileHeader, page_size));
+		raw.read((char*)&size, sizeof(size));
+	}
+	if (size != Page::SIZE)
+	{
+		PRINT_ERROR("ERROR :: File header does not record the page size");
+	}
+
+	//a file of another page size is refused
+	{
+		std::fstream raw(filename, std::ios::in | std::ios::out | std::ios::binary);
+		size = Page::SIZE * 2;
+		raw.seekp(offsetof(FileHeader, page_size));
+		raw.write((const char*)&size, sizeof(size));
+	}
+	try
+	{
+		File opened = File::open(filename);
+		PRINT_ERROR("ERROR :: File of another page size opened");
+	}
+	catch(const PageSizeException &e)
+	{
+		if (e.size() != Page::SIZE * 2 || e.filename() != filename)
+		{
+			PRINT_ERROR("ERROR :: Page size exception does not name the file's size");
+		}
+	}
+	if (File::isOpen(filename))
+	{
+		PRINT_ERROR("ERROR :: Refused file left open");
+	}
+
+	//files from before the size was recorded have 8192 byte pages
+	{
+		std::fstream raw(filename, std::ios::in | std::ios::out | std::ios::binary);
+		size = 0;
+		raw.seekp(offsetof(FileHeader, page_size));
+		raw.write((const char*)&size, sizeof(size));
+	}
+	try
+	{
+		File opened = File::open(filename);
+		if (Page::SIZE != 8192)
+		{
+			PRINT_ERROR("ERROR :: File without a page size opened");
+		}
+		else if (opened.readPage(pageno).getRecord(bigRid) != big)
+		{
+			PRINT_ERROR("ERROR :: File without a page size read wrongly");
+		}
+	}
+	catch(const PageSizeException &e)
+	{
+		if (Page::SIZE == 8192)
+		{
+			PRINT_ERROR("ERROR :: File without a page size refused");
+		}
+	}
+	File::remove(filename);
+	std::cout << "Test 35 passed" << "\n";
+}
+
+void test36()
+{
+	//A parallel scan delivers every record of the pages in use once
+	const std::string& filename = "test.36";
+	const PageId pages = 200;
+	const int perPage = 5;
+	BufMgr* scanMgr = new BufMgr(num);
+	File* file36 = new File(File::create(filename));
+	std::map<std::pair<PageId, SlotId>, std::string> expected;
+	std::vector<PageId> pageNos;
+	for (PageId n = 0; n < pages; n++)
+	{
+		PageId pageNo;
+		scanMgr->allocPage(file36, pageNo, page);
+		for (int r = 0; r < perPage; r++)
+		{
+			sprintf((char*)tmpbuf, "test.36 page %u record %d", pageNo, r);
+			const RecordId rid36 = page->insertRecord(tmpbuf);
+			expected[std::make_pair(rid36.page_number, rid36.slot_number)] = tmpbuf;
+		}
+		scanMgr->unPinPage(file36, pageNo, true);
+		pageNos.push_back(pageNo);
+	}
+	//freed pages are skipped
+	for (PageId n = 10; n < pages; n += 37)
+	{
+		scanMgr->disposePage(file36, pageNos[n]);
+		for (int r = 1; r <= perPage; r++)
+		{
+			expected.erase(std::make_pair(pageNos[n], (SlotId)r));
+		}
+	}
+	scanMgr->flushFile(file36);
+
+	ParallelScan scan(scanMgr, file36, 4, 4);
+	std::vector<std::map<std::pair<PageId, SlotId>, std::string> > seen(scan.workers());
+	ScanStats stats = scan.run([&](std::uint32_t worker, const RecordId& rid36, std::string_view record) {
+		seen[worker][std::make_pair(rid36.page_number, rid36.slot_number)] = std::string(record);
+	});
+	std::map<std::pair<PageId, SlotId>, std::string> all;
+	std::size_t delivered = 0;
+	for (const auto& worker : seen)
+	{
+		delivered += worker.size();
+		all.insert(worker.begin(), worker.end());
+	}
+	if (scan.workers() != 4 || all != expected || delivered != expected.size() ||
+	    stats.records != expected.size() || stats.pages != expected.size() / perPage)
+	{
+		PRINT_ERROR("ERROR :: Parallel scan missed or repeated records");
+	}
+
+	//a slow worker's pages are taken over by the others
+	stats = scan.run([&](std::uint32_t worker, const RecordId&, std::string_view) {
+		if (worker == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+	if (stats.steals == 0 || stats.records != expected.size())
+	{
+		PRINT_ERROR("ERROR :: Parallel scan did not share out a slow worker's pages");
+	}
+
+	//a failing consumer stops the scan with every page unpinned
+	std::atomic<int> calls(0);
+	try
+	{
+		scan.run([&](std::uint32_t, const RecordId& rid36, std::string_view) {
+			if (++calls == 100)
+			{
+				throw InvalidRecordException(rid36, rid36.page_number);
+			}
+		});
+		PRINT_ERROR("ERROR :: Parallel scan swallowed the consumer's exception");
+	}
+	catch(const InvalidRecordException &)
+	{
+	}
+	scanMgr->flushFile(file36);
+	delete scanMgr;
+	delete file36;
+	File::remove(filename);
+	std::cout << "Test 36 passed" << "\n";
+}
+
+void test37()
+{
+	//Predicates evaluated over a page in place match the records they should
+	Page filterPage;
+	std::vector<RecordId> filled;
+	for (int k = 0; filterPage.hasSpaceForRecord(std::string(40, 'f')); k++)
+	{
+		//a 2 byte tag, a 32 bit and a 64 bit field, then a name; some records are short
+		std::string record(2 + 4 + 8, '\0');
+		record[0] = (k % 3 == 0) ? 'a' : 'b';
+		record[1] = 'z';
+		const std::int32_t small = (k * 7919) % 101 - 50;
+		const std::int64_t large = (std::int64_t)(k % 13 - 6) * ((std::int64_t)1 << 40);
+		std::memcpy(&record[2], &small, sizeof(small));
+		std::memcpy(&record[6], &large, sizeof(large));
+		record += "name" + std::to_string(k % 5);
+		if (k % 11 == 0)
+		{
+			record.resize(k % 8);
+		}
+		filled.push_back(filterPage.insertRecord(record));
+	}
+	//deleted slots hold chain links, not records
+	for (std::size_t n = 3; n < filled.size(); n += 9)
+	{
+		filterPage.deleteRecord(filled[n]);
+	}
+
+	std::vector<RecordPredicate> predicates;
+	const RecordPredicate::Op ops[] = {RecordPredicate::EQ, RecordPredicate::NE,
+	    RecordPredicate::LT, RecordPredicate::LE, RecordPredicate::GT, RecordPredicate::GE};
+	for (RecordPredicate::Op op : ops)
+	{
+		predicates.push_back(RecordPredicate::int32(2, op, 7));
+		predicates.push_back(RecordPredicate::int32(2, op, -50));
+		predicates.push_back(RecordPredicate::int64(6, op, (std::int64_t)2 << 40));
+		predicates.push_back(RecordPredicate::int64(6, op, (std::int64_t)-6 * ((std::int64_t)1 << 40)));
+	}
+	const std::string prefixes[] = {"", "a", "az", "bz\x07", "az\x07\0\0\0", "bz"};
+	for (const std::string& prefix : prefixes)
+	{
+		predicates.push_back(RecordPredicate::startsWith(prefix));
+	}
+	for (const RecordPredicate& predicate : predicates)
+	{
+		std::vector<RecordId> expected;
+		for (PageIterator it = filterPage.begin(); it != filterPage.end(); ++it)
+		{
+			const std::string_view record = it.record();
+			bool match;
+			if (predicate.op == RecordPredicate::PREFIX)
+			{
+				match = record.substr(0, predicate.prefix.size()) == predicate.prefix;
+			}
+			else if (record.size() < predicate.offset + predicate.width)
+			{
+				match = false;
+			}
+			else
+			{
+				std::int64_t field;
+				if (predicate.width == 4)
+				{
+					std::int32_t narrow;
+					std::memcpy(&narrow, record.data() + predicate.offset, sizeof(narrow));
+					field = narrow;
+				}
+				else
+				{
+					std::memcpy(&field, record.data() + predicate.offset, sizeof(field));
+				}
+				switch (predicate.op)
+				{
+					case RecordPredicate::EQ: match = field == predicate.value; break;
+					case RecordPredicate::NE: match = field != predicate.value; break;
+					case RecordPredicate::LT: match = field < predicate.value; break;
+					case RecordPredicate::LE: match = field <= predicate.value; break;
+					case RecordPredicate::GT: match = field > predicate.value; break;
+					default: match = field >= predicate.value; break;
+				}
+			}
+			if (match)
+			{
+				expected.push_back(it.recordId());
+			}
+		}
+		std::vector<RecordId> found;
+		std::vector<std::uint64_t> bitmap;
+		if (filterPage.filterRecords(predicate, found) != expected.size() || found != expected ||
+		    filterPage.filterRecords(predicate, bitmap) != expected.size())
+		{
+			PRINT_ERROR("ERROR :: Page filter disagrees with the records");
+		}
+		std::size_t bits = 0;
+		for (std::uint64_t word : bitmap)
+		{
+			bits += __builtin_popcountll(word);
+		}
+		if (bits != expected.size() ||
+		    (!expected.empty() && !(bitmap[(expected[0].slot_number - 1) / 64] >>
+		                             ((expected[0].slot_number - 1) % 64) & 1)))
+		{
+			PRINT_ERROR("ERROR :: Page filter bitmap does not mark the matches");
+		}
+	}
+	std::cout << "Test 37 passed" << "\n";
+}
+
+void test38()
+{
+	//PAX pages keep fixed-width rows column by column behind the usual File and BufMgr
+	const std::string& filename = "test.38";
+	const std::vector<std::uint32_t> widths = {4, 8, 3};
+	BufMgr* paxMgr = new BufMgr(num);
+	File* file38 = new File(File::create(filename, StorageType::POSIX, true));
+	PageId paxNo;
+	paxMgr->allocPage(file38, paxNo, page);
+	PaxPage pax = PaxPage::format(page, widths);
+	if (pax.capacity() != PaxPage::capacityOf(widths) || pax.capacity() < Page::DATA_SIZE / 16 ||
+	    pax.rowWidth() != 15 || pax.rows() != 0 || !page->isConsistent() ||
+	    page->begin() != page->end())
+	{
+		PRINT_ERROR("ERROR :: PAX page not formatted");
+	}
+	std::vector<RecordId> rows;
+	for (std::int32_t k = 0; !pax.isFull(); k++)
+	{
+		std::string row(15, '\0');
+		const std::int32_t key = k % 100;
+		const std::int64_t amount = (std::int64_t)k * 1000;
+		std::memcpy(&row[0], &key, sizeof(key));
+		std::memcpy(&row[4], &amount, sizeof(amount));
+		row.replace(12, 3, std::to_string(100 + k % 900));
+		rows.push_back(pax.insertRow(row));
+	}
+	try
+	{
+		pax.insertRow(std::string(15, 'x'));
+		PRINT_ERROR("ERROR :: Full PAX page took a row");
+	}
+	catch(const InsufficientSpaceException &)
+	{
+	}
+	//Page sees no records and no room on a PAX page
+	try
+	{
+		page->insertRecord("slotted");
+		PRINT_ERROR("ERROR :: Record inserted into a PAX page");
+	}
+	catch(const InsufficientSpaceException &)
+	{
+	}
+	for (std::size_t n = 0; n < rows.size(); n += 7)
+	{
+		pax.deleteRow(rows[n]);
+	}
+	//deleted row numbers are reused
+	std::string again(15, '\0');
+	const std::int32_t key = 7;
+	std::memcpy(&again[0], &key, sizeof(key));
+	if (pax.insertRow(again) != rows[0])
+	{
+		PRINT_ERROR("ERROR :: Deleted PAX row not reused");
+	}
+	paxMgr->unPinPage(file38, paxNo, true);
+	paxMgr->flushFile(file38);
+	delete paxMgr;
+	delete file38;
+
+	//read back from the file, checksums and all
+	file38 = new File(File::open(filename, StorageType::POSIX));
+	if (!file38->scrub().empty())
+	{
+		PRINT_ERROR("ERROR :: PAX page failed its checksum");
+	}
+	paxMgr = new BufMgr(num);
+	paxMgr->readPage(file38, paxNo, page);
+	PaxPage reread(page);
+	std::vector<RecordId> found;
+	std::vector<RecordId> expected;
+	for (std::size_t n = 1; n < rows.size(); n++)
+	{
+		if (n % 7 != 0 && (std::int32_t)(n % 100) == 7)
+		{
+			expected.push_back(rows[n]);
+		}
+		if (n == 1 && reread.getRow(rows[n]).substr(12) != "101")
+		{
+			PRINT_ERROR("ERROR :: PAX row read back wrongly");
+		}
+	}
+	expected.insert(expected.begin(), rows[0]);
+	if (reread.filterColumn(0, RecordPredicate::int32(0, RecordPredicate::EQ, 7), found) != expected.size() ||
+	    found != expected)
+	{
+		PRINT_ERROR("ERROR :: PAX column filter disagrees with the rows");
+	}
+	found.clear();
+	reread.filterColumn(1, RecordPredicate::int64(0, RecordPredicate::GE, 1000 * (std::int64_t)(rows.size() - 3)), found);
+	std::int64_t amount;
+	if (found.empty() || found.back() != rows.back() ||
+	    (std::memcpy(&amount, reread.getValue(found.back(), 1).data(), sizeof(amount)), amount) !=
+	        1000 * (std::int64_t)(rows.size() - 1))
+	{
+		PRINT_ERROR("ERROR :: PAX column of longs read wrongly");
+	}
+	try
+	{
+		reread.getRow(rows[7]);
+		PRINT_ERROR("ERROR :: Deleted PAX row read");
+	}
+	catch(const InvalidRecordException &)
+	{
+	}
+	paxMgr->unPinPage(file38, paxNo, false);
+	Page slotted;
+	try
+	{
+		PaxPage wrong(&slotted);
+		PRINT_ERROR("ERROR :: Slotted page viewed as PAX");
+	}
+	catch(const PageTypeException &)
+	{
+	}
+	paxMgr->flushFile(file38);
+	delete paxMgr;
+	delete file38;
+	File::remove(filename);
+
+	if (Page::SIZE == 8192)
+	{
+		//a checksummed version 5 file, without page types, is migrated
+		File* old38 = new File(File::create(filename, StorageType::POSIX, true));
+		Page oldPage = old38->allocatePage();
+		const RecordId oldRid = oldPage.insertRecord("test.38 version 5");
+		old38->writePage(oldPage);
+		delete old38;
+		std::fstream raw(filename, std::ios::in | std::ios::out | std::ios::binary);
+		std::uint32_t version = 5;
+		raw.seekp(offsetof(FileHeader, version));
+		raw.write((const char*)&version, sizeof(version));
+		std::vector<char> image(Page::SIZE);
+		raw.seekg((std::streamoff)oldRid.page_number * Page::SIZE);
+		raw.read(image.data(), Page::SIZE);
+		PageHeader header;
+		memcpy(&header, image.data(), sizeof(header));
+		const std::size_t legacyHeader = offsetof(PageHeader, page_type);
+		const std::size_t shift = sizeof(PageHeader) - legacyHeader;
+		const char* data = image.data() + sizeof(PageHeader);
+		std::vector<char> legacyPage(Page::SIZE, 0);
+		char* legacyData = legacyPage.data() + legacyHeader;
+		memcpy(legacyData, data, header.free_space_lower_bound);
+		memcpy(legacyData + header.free_space_upper_bound + shift, data + header.free_space_upper_bound,
+		       Page::DATA_SIZE - header.free_space_upper_bound);
+		((PageSlot*)legacyData)->item_offset += shift;
+		header.free_space_upper_bound += shift;
+		header.checksum = 0;
+		memcpy(legacyPage.data(), &header, legacyHeader);
+		header.checksum = crc32c(0, legacyPage.data(), Page::SIZE);
+		memcpy(legacyPage.data(), &header, legacyHeader);
+		raw.seekp((std::streamoff)oldRid.page_number * Page::SIZE);
+		raw.write(legacyPage.data(), Page::SIZE);
+		raw.close();
+		old38 = new File(File::open(filename, StorageType::POSIX));
+		if (!old38->scrub().empty() ||
+		    old38->readPage(oldRid.page_number).getRecord(oldRid) != "test.38 version 5")
+		{
+			PRINT_ERROR("ERROR :: Version 5 file not migrated correctly");
+		}
+		delete old38;
+		File::remove(filename);
+	}
+	std::cout << "Test 38 passed" << "\n";
+}
+
+void test39()
+{
+	//a B+-tree index bulk loaded from sorted keys, then changed key by key
+	const std::string& filename = "test.39";
+	BufMgr* indexMgr = new BufMgr(num);
+	File* file39 = new File(File::create(filename, StorageType::POSIX, true));
+	std::vector<std::pair<std::int64_t, RecordId> > sorted;
+	for (std::int64_t k = 0; k < 100000; k++)
+	{
+		const RecordId rid = {(PageId)(k / 100 + 1), (SlotId)(k % 100 + 1)};
+		sorted.push_back(std::make_pair(k * 3 - 150000, rid));
+	}
+	{
+		BTreeIndex index(indexMgr, file39);
+		std::vector<std::pair<std::int64_t, RecordId> > unsorted = sorted;
+		std::swap(unsorted[10], unsorted[11]);
+		try
+		{
+			index.bulkLoad(unsorted);
+			PRINT_ERROR("ERROR :: Unsorted keys bulk loaded");
+		}
+		catch(const IndexException &)
+		{
+		}
+		index.bulkLoad(sorted, 0.8);
+		if (index.size() != sorted.size() || index.height() < 2)
+		{
+			PRINT_ERROR("ERROR :: Bulk load built the wrong tree");
+		}
+		RecordId rid;
+		if (!index.lookup(sorted[12345].first, rid) || rid != sorted[12345].second ||
+		    index.lookup(sorted[12345].first + 1, rid) || index.lookup(-150001, rid))
+		{
+			PRINT_ERROR("ERROR :: Index lookup wrong after bulk load");
+		}
+		std::vector<std::int64_t> keys;
+		const std::uint64_t visited = index.scan(-10, 3000, [&](std::int64_t key, const RecordId&)
+		{
+			keys.push_back(key);
+			return true;
+		});
+		if (visited != 1004 || keys.front() != -9 || keys.back() != 3000)
+		{
+			PRINT_ERROR("ERROR :: Index range scan wrong");
+		}
+		try
+		{
+			index.bulkLoad(sorted);
+			PRINT_ERROR("ERROR :: Bulk load into a full index");
+		}
+		catch(const IndexException &)
+		{
+		}
+	}
+
+	//small nodes split and grow the tree under random inserts and removes
+	const std::string& smallname = "test.39a";
+	File* small39 = new File(File::create(smallname, StorageType::POSIX, true));
+	std::map<std::int64_t, RecordId> model;
+	{
+		BTreeIndex index(indexMgr, small39, 8);
+		srand(39);
+		for (int n = 0; n < 20000; n++)
+		{
+			const std::int64_t key = rand() % 5000;
+			const RecordId rid = {(PageId)(n + 1), 1};
+			if (n % 3 == 2)
+			{
+				if (index.remove(key) != (model.erase(key) == 1))
+				{
+					PRINT_ERROR("ERROR :: Index remove disagrees with the model");
+				}
+			}
+			else if (index.insert(key, rid) != model.insert(std::make_pair(key, rid)).second)
+			{
+				PRINT_ERROR("ERROR :: Index insert disagrees with the model");
+			}
+		}
+		if (index.size() != model.size() || index.height() < 4)
+		{
+			PRINT_ERROR("ERROR :: Index of small nodes did not grow");
+		}
+	}
+	indexMgr->flushFile(small39);
+	indexMgr->flushFile(file39);
+	delete indexMgr;
+	delete small39;
+	delete file39;
+
+	//reopened, the index is as it was left
+	small39 = new File(File::open(smallname, StorageType::POSIX));
+	if (!small39->scrub().empty())
+	{
+		PRINT_ERROR("ERROR :: Index pages failed their checksums");
+	}
+	indexMgr = new BufMgr(num);
+	{
+		BTreeIndex index(indexMgr, small39, 100);
+		std::map<std::int64_t, RecordId>::const_iterator it = model.begin();
+		bool inOrder = true;
+		index.scan(std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max(),
+		           [&](std::int64_t key, const RecordId& rid)
+		{
+			inOrder = inOrder && it != model.end() && it->first == key && it->second == rid;
+			++it;
+			return true;
+		});
+		if (!inOrder || it != model.end() || index.size() != model.size())
+		{
+			PRINT_ERROR("ERROR :: Reopened index differs from the model");
+		}
+		std::uint64_t stopped = index.scan(0, 5000, [](std::int64_t, const RecordId&) { return false; });
+		if (stopped != 1)
+		{
+			PRINT_ERROR("ERROR :: Index scan did not stop");
+		}
+	}
+	indexMgr->flushFile(small39);
+	delete indexMgr;
+	delete small39;
+	File::remove(smallname);
+	File::remove(filename);
+
+	//a file of other pages is no index
+	File* plain39 = new File(File::create(filename, StorageType::POSIX, true));
+	Page plain = plain39->allocatePage();
+	plain39->writePage(plain);
+	indexMgr = new BufMgr(num);
+	try
+	{
+		BTreeIndex index(indexMgr, plain39);
+		PRINT_ERROR("ERROR :: Slotted page opened as an index");
+	}
+	catch(const IndexException &)
+	{
+	}
+	indexMgr->flushFile(plain39);
+	delete indexMgr;
+	delete plain39;
+	File::remove(filename);
+	std::cout << "Test 39 passed" << "\n";
+}
+
+/**
+ * Task of test40: reads every <stride>th page of the file from <first> on
+ * and checks its record.
+ */
+Task test40Reader(BufMgr* asyncMgr, File* file, const PageId first, const PageId stride,
+                  const std::vector<RecordId>& rids, std::atomic<std::uint32_t>& matched)
+{
+	for (PageId n = first; n < rids.size(); n += stride)
+	{
+		PageGuard guard = co_await asyncMgr->readPageAsync(file, rids[n].page_number);
+		char expected[100];
+		sprintf(expected, "test.40 Page %u", rids[n].page_number);
+		if (guard->getRecord(rids[n]) == expected)
+		{
+			matched++;
+		}
+	}
+}
+
+void test40()
+{
+	//coroutines await page reads through the I/O engine instead of blocking a thread
+	const std::string& filename = "test.40";
+	File* file40 = new File(File::create(filename, StorageType::POSIX));
+	std::vector<RecordId> rids;
+	for (PageId n = 0; n < num; n++)
+	{
+		Page newPage = file40->allocatePage();
+		sprintf(tmpbuf, "test.40 Page %u", newPage.page_number());
+		rids.push_back(newPage.insertRecord(tmpbuf));
+		file40->writePage(newPage);
+	}
+	for (unsigned depth : {8u, 0u})
+	{
+		BufMgrOptions options;
+		options.ioQueueDepth = depth;
+		BufMgr* asyncMgr = new BufMgr(num, options);
+		std::atomic<std::uint32_t> matched(0);
+		{
+			TaskExecutor executor;
+			for (PageId first = 0; first < 16; first++)
+			{
+				executor.spawn(test40Reader(asyncMgr, file40, first, 16, rids, matched));
+			}
+			executor.run(4);
+		}
+		BufStats stats = asyncMgr->getBufStats();
+		if (matched != num || stats.misses != num || stats.diskreads != num)
+		{
+			PRINT_ERROR("ERROR :: Coroutine reads did not read every page once");
+		}
+		//a hit completes at once, without suspending
+		PageRead again = asyncMgr->readPageAsync(file40, rids[7].page_number);
+		if (!again.await_ready())
+		{
+			PRINT_ERROR("ERROR :: Coroutine read of a resident page would suspend");
+		}
+		PageGuard guard = again.await_resume();
+		if (guard->page_number() != rids[7].page_number || asyncMgr->getBufStats().hits != 1)
+		{
+			PRINT_ERROR("ERROR :: Coroutine hit pinned the wrong page");
+		}
+		guard.release();
+		//a failed read ends its task, and run() rethrows once the others are done
+		{
+			TaskExecutor executor;
+			executor.spawn(test40Reader(asyncMgr, file40, 0, 1, rids, matched));
+			std::vector<RecordId> missing(1);
+			missing[0].page_number = num + 50;
+			missing[0].slot_number = 1;
+			executor.spawn(test40Reader(asyncMgr, file40, 0, 1, missing, matched));
+			try
+			{
+				executor.run(2);
+				PRINT_ERROR("ERROR :: Coroutine read past the end of the file succeeded");
+			}
+			catch(const InvalidPageException &)
+			{
+			}
+		}
+		if (matched != 2 * num)
+		{
+			PRINT_ERROR("ERROR :: Coroutine task stopped by another's failure");
+		}
+		asyncMgr->flushFile(file40);
+		delete asyncMgr;
+	}
+	delete file40;
+	File::remove(filename);
+	std::cout << "Test 40 passed" << "\n";
+}
+
+/**
+ * Task of test41: reads the pages of <rids> and checks their records.
+ */
+Task test41Reader(BufMgr* sharedMgr, File* file, const std::vector<RecordId> rids,
+                  std::atomic<std::uint32_t>& matched)
+{
+	for (const RecordId& rid : rids)
+	{
+		PageGuard guard = co_await sharedMgr->readPageAsync(file, rid.page_number);
+		char expected[100];
+		sprintf(expected, "test.41 Page %u", rid.page_number);
+		if (guard->getRecord(rid) == expected)
+		{
+			matched++;
+		}
+	}
+}
+
+void test41()
+{
+	//readers of a page not in the pool at the same time share one read of it
+	const std::string& filename = "test.41";
+	File* file41 = new File(File::create(filename, StorageType::POSIX));
+	std::vector<RecordId> rids;
+	for (PageId n = 0; n < num; n++)
+	{
+		Page newPage = file41->allocatePage();
+		sprintf(tmpbuf, "test.41 Page %u", newPage.page_number());
+		rids.push_back(newPage.insertRecord(tmpbuf));
+		file41->writePage(newPage);
+	}
+	BufMgr* sharedMgr = new BufMgr(num);
+	const std::uint32_t readers = 8;
+	for (int round = 0; round < 3; round++)
+	{
+		std::atomic<std::uint32_t> started(0);
+		std::atomic<std::uint32_t> matched(0);
+		std::vector<std::thread> threads;
+		for (std::uint32_t t = 0; t < readers; t++)
+		{
+			threads.emplace_back([&]()
+			{
+				started++;
+				while (started < readers)
+				{
+				}
+				for (const RecordId& rid : rids)
+				{
+					Page* shared;
+					sharedMgr->readPage(file41, rid.page_number, shared);
+					char expected[100];
+					sprintf(expected, "test.41 Page %u", rid.page_number);
+					if (shared->getRecord(rid) == expected)
+					{
+						matched++;
+					}
+					sharedMgr->unPinPage(file41, rid.page_number, false);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		BufStats stats = sharedMgr->getBufStats();
+		if (matched != readers * num || stats.diskreads != num || stats.misses != num ||
+		    stats.hits != (readers - 1) * num || stats.sharedreads > stats.hits)
+		{
+			PRINT_ERROR("ERROR :: Concurrent misses on a page read it more than once");
+		}
+		sharedMgr->flushFile(file41);
+		sharedMgr->clearBufStats();
+	}
+
+	//batch readers share reads with single-page readers of the same pages
+	{
+		BufMgr* batchMgr = new BufMgr(readers * num);
+		std::vector<PageId> pageNos;
+		for (const RecordId& rid : rids)
+		{
+			pageNos.push_back(rid.page_number);
+		}
+		for (int round = 0; round < 3; round++)
+		{
+			std::atomic<std::uint32_t> started(0);
+			std::atomic<std::uint32_t> matched(0);
+			std::vector<std::thread> threads;
+			for (std::uint32_t t = 0; t < readers; t++)
+			{
+				threads.emplace_back([&, t]()
+				{
+					started++;
+					while (started < readers)
+					{
+					}
+					char expected[100];
+					if (t % 2 == 0)
+					{
+						std::vector<Page*> batch;
+						batchMgr->readPages(file41, pageNos, batch);
+						for (PageId n = 0; n < num; n++)
+						{
+							sprintf(expected, "test.41 Page %u", rids[n].page_number);
+							if (batch[n]->getRecord(rids[n]) == expected)
+							{
+								matched++;
+							}
+						}
+						batchMgr->unPinPages(file41, batch, false);
+						return;
+					}
+					for (const RecordId& rid : rids)
+					{
+						Page* shared;
+						batchMgr->readPage(file41, rid.page_number, shared);
+						sprintf(expected, "test.41 Page %u", rid.page_number);
+						if (shared->getRecord(rid) == expected)
+						{
+							matched++;
+						}
+						batchMgr->unPinPage(file41, rid.page_number, false);
+						std::this_thread::yield();
+					}
+				});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+			BufStats stats = batchMgr->getBufStats();
+			if (matched != readers * num || stats.diskreads != num || stats.misses != num)
+			{
+				PRINT_ERROR("ERROR :: Batch and single misses on a page read it more than once");
+			}
+			batchMgr->flushFile(file41);
+			batchMgr->clearBufStats();
+		}
+		delete batchMgr;
+	}
+
+	//a read that fails takes its page out of the pool and frees its frame
+	file41->deletePage(rids[0].page_number);
+	try
+	{
+		sharedMgr->readPage(file41, rids[0].page_number, page);
+		PRINT_ERROR("ERROR :: Deleted page read");
+	}
+	catch(const InvalidPageException &)
+	{
+	}
+	for (PageId n = 1; n < num; n++)
+	{
+		sharedMgr->readPage(file41, rids[n].page_number, page);
+	}
+	for (PageId n = 1; n < num; n++)
+	{
+		sharedMgr->unPinPage(file41, rids[n].page_number, false);
+	}
+	try
+	{
+		sharedMgr->readPage(file41, rids[0].page_number, page);
+		PRINT_ERROR("ERROR :: Failed read left its page in the pool");
+	}
+	catch(const InvalidPageException &)
+	{
+	}
+	sharedMgr->flushFile(file41);
+	delete sharedMgr;
+
+	//tasks awaiting a page being read wait for that read
+	BufMgrOptions options;
+	options.ioQueueDepth = 8;
+	sharedMgr = new BufMgr(num, options);
+	std::atomic<std::uint32_t> matched(0);
+	{
+		TaskExecutor executor;
+		std::vector<RecordId> one(1, rids[5]);
+		for (std::uint32_t t = 0; t < readers; t++)
+		{
+			executor.spawn(test41Reader(sharedMgr, file41, one, matched));
+		}
+		executor.run(2);
+	}
+	BufStats stats = sharedMgr->getBufStats();
+	if (matched != readers || stats.diskreads != 1 || stats.misses != 1 || stats.hits != readers - 1)
+	{
+		PRINT_ERROR("ERROR :: Tasks awaiting one page read it more than once");
+	}
+	sharedMgr->flushFile(file41);
+	delete sharedMgr;
+	delete file41;
+	File::remove(filename);
+	std::cout << "Test 41 passed" << "\n";
+}
+
+void test42()
+{
+	//hits pin frames without the latch while other pages are evicted around them
+	const std::string& filename = "test.42";
+	File* file42 = new File(File::create(filename, StorageType::POSIX));
+	std::vector<RecordId> rids;
+	for (PageId n = 0; n < num; n++)
+	{
+		Page newPage = file42->allocatePage();
+		sprintf(tmpbuf, "test.42 Page %u", newPage.page_number());
+		rids.push_back(newPage.insertRecord(tmpbuf));
+		file42->writePage(newPage);
+	}
+	BufMgrOptions options;
+	options.pageTable = PageTableType::OPEN_ADDRESSING;
+	const std::uint32_t frames = num / 4;
+	BufMgr* racingMgr = new BufMgr(frames, options);
+	const std::uint32_t readers = 8;
+	const std::uint32_t reads = 4000;
+	std::atomic<std::uint32_t> wrong(0);
+	std::vector<std::thread> threads;
+	for (std::uint32_t t = 0; t < readers; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			std::uint32_t seed = t * 2654435761u + 1;
+			for (std::uint32_t n = 0; n < reads; n++)
+			{
+				seed = seed * 1103515245u + 12345;
+				// half the reads go to a few hot pages, which stay in the pool
+				const RecordId& rid = rids[(n & 1) ? (seed >> 16) % 4 : (seed >> 16) % num];
+				Page* pinned;
+				racingMgr->readPage(file42, rid.page_number, pinned);
+				char expected[100];
+				sprintf(expected, "test.42 Page %u", rid.page_number);
+				std::this_thread::yield();
+				// the pin keeps the page in its frame while others are evicted
+				if (pinned->page_number() != rid.page_number || pinned->getRecord(rid) != expected)
+				{
+					wrong++;
+				}
+				racingMgr->unPinPage(file42, rid.page_number, false);
+			}
+		});
+	}
+	//lookups racing inserts that grow the shard never miss a published entry
+	OpenHashTbl growing(8, 1);
+	const PageId inserts = 20000;
+	std::atomic<PageId> published(0);
+	std::atomic<std::uint32_t> missed(0);
+	for (std::uint32_t t = 0; t < readers / 2; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			std::uint32_t seed = t * 2654435761u + 1;
+			while (published.load() < inserts)
+			{
+				seed = seed * 1103515245u + 12345;
+				const PageId known = published.load();
+				if (known == 0)
+					continue;
+				const PageId key = (seed >> 8) % known;
+				FrameId frame;
+				if (!growing.tryLookup(file42, key, frame) || frame != key)
+				{
+					missed++;
+				}
+			}
+		});
+	}
+	for (PageId key = 0; key < inserts; key++)
+	{
+		growing.tryInsert(file42, key, key);
+		published.store(key + 1);
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	BufStats stats = racingMgr->getBufStats();
+	if (wrong != 0 || stats.accesses != readers * reads || stats.hits + stats.misses != stats.accesses ||
+	    stats.hits == 0 || stats.evictions == 0)
+	{
+		PRINT_ERROR("ERROR :: Optimistic pins saw the wrong page");
+	}
+	if (missed != 0)
+	{
+		PRINT_ERROR("ERROR :: Lookup racing a grow missed a resident page");
+	}
+	//no pin was lost or left behind
+	for (FrameId frame = 0; frame < frames; frame++)
+	{
+		if (racingMgr->getPinCnt(frame) != 0)
+		{
+			PRINT_ERROR("ERROR :: Optimistic pins left a frame pinned");
+		}
+	}
+	racingMgr->flushFile(file42);
+	delete racingMgr;
+	delete file42;
+	File::remove(filename);
+	std::cout << "Test 42 passed" << "\n";
+}
+
+void test43()
+{
+	//every File object open on a file has its identifier and shares its frames
+	const std::string& filename = "test.43";
+	if (File::exists(filename) || File::exists(".") || File::isOpen(filename))
+	{
+		PRINT_ERROR("ERROR :: File that is not there reported");
+	}
+	File* first = new File(File::create(filename, StorageType::POSIX));
+	for (int n = 0; n < 5; n++)
+	{
+		Page newPage = first->allocatePage();
+		sprintf(tmpbuf, "test.43 Page %u", newPage.page_number());
+		newPage.insertRecord(tmpbuf);
+		first->writePage(newPage);
+	}
+	File* second = new File(File::open(filename, StorageType::POSIX));
+	if (!File::exists(filename) || !File::isOpen(filename) || first->id() != second->id() ||
+	    first->begin() != second->begin() || first->begin() == first->end())
+	{
+		PRINT_ERROR("ERROR :: File objects of one file told apart");
+	}
+	BufMgr* sharingMgr = new BufMgr(num);
+	sharingMgr->readPage(first, 2, page);
+	Page* again;
+	sharingMgr->readPage(second, 2, again);
+	if (again != page || sharingMgr->getBufStats().diskreads != 1)
+	{
+		PRINT_ERROR("ERROR :: Second File object read its own copy of a page");
+	}
+	sharingMgr->unPinPage(second, 2, false);
+	sharingMgr->unPinPage(first, 2, false);
+	sharingMgr->flushFile(first);
+	delete sharingMgr;
+
+	//a page is written back after the File object that loaded it is gone
+	File* loader = new File(File::open(filename, StorageType::POSIX));
+	BufMgr* singleMgr = new BufMgr(1);
+	PageId loaded;
+	singleMgr->allocPage(loader, loaded, page);
+	page->insertRecord("test.43 loaded");
+	singleMgr->unPinPage(loader, loaded, true);
+	singleMgr->readPage(second, loaded, page);
+	singleMgr->unPinPage(second, loaded, false);
+	delete loader;
+	PageId evicting;
+	singleMgr->allocPage(second, evicting, page);
+	singleMgr->unPinPage(second, evicting, true);
+	if (second->readPage(loaded).getRecord({loaded, 1}) != "test.43 loaded")
+	{
+		PRINT_ERROR("ERROR :: Page lost with the File object that loaded it");
+	}
+	singleMgr->flushFile(second);
+	delete singleMgr;
+
+	//threads opening and closing the file keep its entry and count right
+	std::vector<std::thread> threads;
+	std::atomic<std::uint32_t> wrong(0);
+	for (int t = 0; t < 8; t++)
+	{
+		threads.emplace_back([&]()
+		{
+			for (int n = 0; n < 200; n++)
+			{
+				File opened = File::open(filename, StorageType::POSIX);
+				File copy(opened);
+				if (opened.id() != first->id() || copy.id() != first->id())
+				{
+					wrong++;
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	const FileId id = first->id();
+	delete second;
+	delete first;
+	if (wrong != 0 || File::isOpen(filename))
+	{
+		PRINT_ERROR("ERROR :: Concurrent opens lost count of a file");
+	}
+	//a file opened again is a new file to the pool
+	first = new File(File::open(filename, StorageType::POSIX));
+	if (first->id() == id)
+	{
+		PRINT_ERROR("ERROR :: Identifier of a closed file reused");
+	}
+	delete first;
+	File::remove(filename);
+	std::cout << "Test 43 passed" << "\n";
+}
+
+void test44()
+{
+	//a scan confined to a small partition leaves the reserved pages in place
+	const std::string& hotname = "test.44a";
+	const std::string& scanname = "test.44b";
+	File* hot = new File(File::create(hotname, StorageType::POSIX));
+	File* scan = new File(File::create(scanname, StorageType::POSIX));
+	for (PageId n = 0; n < 10; n++)
+	{
+		Page newPage = hot->allocatePage();
+		hot->writePage(newPage);
+	}
+	for (PageId n = 0; n < 100; n++)
+	{
+		Page newPage = scan->allocatePage();
+		scan->writePage(newPage);
+	}
+	BufMgr* quotaMgr = new BufMgr(20);
+	quotaMgr->setPartition("oltp", 10);
+	quotaMgr->setPartition("scan", 0, 4);
+	quotaMgr->assignPartition(hotname, "oltp");
+	quotaMgr->assignPartition(scanname, "scan");
+	for (FileIterator iter = hot->begin(); iter != hot->end(); ++iter)
+	{
+		quotaMgr->readPage(hot, (*iter).page_number(), page);
+		quotaMgr->unPinPage(hot, (*iter).page_number(), false);
+	}
+	for (FileIterator iter = scan->begin(); iter != scan->end(); ++iter)
+	{
+		quotaMgr->readPage(scan, (*iter).page_number(), page);
+		quotaMgr->unPinPage(scan, (*iter).page_number(), false);
+	}
+	BufStats stats = quotaMgr->getBufStats();
+	if (stats.partitions["oltp"].frames != 10 || stats.partitions["scan"].frames != 4 ||
+	    stats.partitions["scan"].reads != 100 || stats.partitions["scan"].maxFrames != 4 ||
+	    stats.partitions["default"].frames != 0)
+	{
+		PRINT_ERROR("ERROR :: Scan went past its partition");
+	}
+	for (FileIterator iter = hot->begin(); iter != hot->end(); ++iter)
+	{
+		quotaMgr->readPage(hot, (*iter).page_number(), page);
+		quotaMgr->unPinPage(hot, (*iter).page_number(), false);
+	}
+	stats = quotaMgr->getBufStats();
+	if (stats.partitions["oltp"].hits != 10 || stats.partitions["oltp"].reads != 10)
+	{
+		PRINT_ERROR("ERROR :: Scan evicted reserved pages");
+	}
+
+	//a partition at its bound still gets a frame when its own are all pinned
+	std::vector<PageId> pinned;
+	for (FileIterator iter = scan->begin(); pinned.size() < 6; ++iter)
+	{
+		quotaMgr->readPage(scan, (*iter).page_number(), page);
+		pinned.push_back((*iter).page_number());
+	}
+	if (quotaMgr->getBufStats().partitions["scan"].frames != 6)
+	{
+		PRINT_ERROR("ERROR :: Pinned partition could not grow");
+	}
+	for (PageId pageNo : pinned)
+	{
+		quotaMgr->unPinPage(scan, pageNo, false);
+	}
+
+	try
+	{
+		quotaMgr->setPartition("big", 15);
+		PRINT_ERROR("ERROR :: Minimums beyond the pool accepted");
+	}
+	catch(const PartitionException &)
+	{
+	}
+	try
+	{
+		quotaMgr->assignPartition(hotname, "none");
+		PRINT_ERROR("ERROR :: File assigned to a missing partition");
+	}
+	catch(const PartitionException &)
+	{
+	}
+	quotaMgr->flushFile(hot);
+	quotaMgr->flushFile(scan);
+	delete quotaMgr;
+	delete hot;
+	delete scan;
+	File::remove(hotname);
+	File::remove(scanname);
+	std::cout << "Test 44 passed" << "\n";
+}
+
 void newTest(){
 //TEST for allocPage and disposePage
   bool passed = true;
@@ -520,3 +4183,478 @@ void newTest(){
   }
   bufMgr->flushFile(file1ptr);
 }
+
+void test45()
+{
+	//pages after holes move down into them, keeping their frames
+	const std::string& holename = "test.45a";
+	File* holes = new File(File::create(holename, StorageType::POSIX));
+	for (PageId n = 1; n <= 20; n++)
+	{
+		Page newPage = holes->allocatePage();
+		sprintf(tmpbuf, "page %d", n);
+		newPage.insertRecord(tmpbuf);
+		holes->writePage(newPage);
+	}
+	for (PageId n = 1; n <= 20; n += 2)
+	{
+		holes->deletePage(n);
+	}
+	BufMgr* defragMgr = new BufMgr(20);
+	defragMgr->readPage(holes, 20, page);
+	defragMgr->unPinPage(holes, 20, false);
+	defragMgr->readPage(holes, 18, page);
+	defragMgr->unPinPage(holes, 18, true);
+	DefragResult moved = defragMgr->defragment(holes, false);
+	if (moved.pages.size() != 5 || moved.pages[0] != std::make_pair(PageId(20), PageId(1)) ||
+	    moved.pages[1] != std::make_pair(PageId(18), PageId(3)) || !moved.records.empty() ||
+	    moved.pagesBefore != 21 || moved.pagesAfter != 11 || holes->numPages() != 11)
+	{
+		PRINT_ERROR("ERROR :: Pages not moved into the holes");
+	}
+	std::ifstream length(holename, std::ios::binary | std::ios::ate);
+	if (length.tellg() != std::streamoff(11 * Page::SIZE))
+	{
+		PRINT_ERROR("ERROR :: File not shortened");
+	}
+	defragMgr->clearBufStats();
+	defragMgr->readPage(holes, 1, page);
+	if (page->getRecord({1, 1}) != "page 20" || defragMgr->getBufStats().hits != 1)
+	{
+		PRINT_ERROR("ERROR :: Moved page lost its frame");
+	}
+	defragMgr->unPinPage(holes, 1, false);
+	PageId expected = 1;
+	for (FileIterator iter = holes->begin(); iter != holes->end(); ++iter, expected++)
+	{
+		if ((*iter).page_number() != expected)
+		{
+			PRINT_ERROR("ERROR :: Pages in use not contiguous");
+		}
+	}
+	if (expected != 11)
+	{
+		PRINT_ERROR("ERROR :: Pages lost in the move");
+	}
+	defragMgr->flushFile(holes);
+	delete holes;
+	File::remove(holename);
+
+	//records of half empty pages are gathered onto the first of them
+	const std::string& sparsename = "test.45b";
+	File* sparse = new File(File::create(sparsename, StorageType::POSIX));
+	std::map<std::string, RecordId> placed;
+	for (int n = 0; n < 10; n++)
+	{
+		Page* newPage;
+		PageId pageNo;
+		defragMgr->allocPage(sparse, pageNo, newPage);
+		for (int k = 0; k < 3; k++)
+		{
+			sprintf(tmpbuf, "record %d.%d", n, k);
+			placed[tmpbuf] = newPage->insertRecord(tmpbuf);
+		}
+		defragMgr->unPinPage(sparse, pageNo, true);
+	}
+	try
+	{
+		defragMgr->readPage(sparse, 1, page);
+		defragMgr->defragment(sparse);
+		PRINT_ERROR("ERROR :: Pinned file defragmented");
+	}
+	catch(const PagePinnedException &)
+	{
+	}
+	defragMgr->unPinPage(sparse, 1, false);
+	moved = defragMgr->defragment(sparse);
+	if (moved.records.size() != 27 || moved.pagesAfter != 2)
+	{
+		PRINT_ERROR("ERROR :: Records not gathered");
+	}
+	for (const std::pair<RecordId, RecordId>& record : moved.records)
+	{
+		for (std::map<std::string, RecordId>::iterator it = placed.begin(); it != placed.end(); ++it)
+		{
+			if (it->second.page_number == record.first.page_number &&
+			    it->second.slot_number == record.first.slot_number)
+			{
+				it->second = record.second;
+				break;
+			}
+		}
+	}
+	for (std::map<std::string, RecordId>::iterator it = placed.begin(); it != placed.end(); ++it)
+	{
+		defragMgr->readPage(sparse, it->second.page_number, page);
+		if (page->getRecord(it->second) != it->first)
+		{
+			PRINT_ERROR("ERROR :: Gathered record not at its new ID");
+		}
+		defragMgr->unPinPage(sparse, it->second.page_number, false);
+	}
+	defragMgr->flushFile(sparse);
+	delete defragMgr;
+	delete sparse;
+	File::remove(sparsename);
+
+	//with a log, recovery after a defragment brings back no moved page
+	const std::string& logname = "test.45.log";
+	BufMgrOptions options;
+	options.logFile = logname;
+	pid_t child = fork();
+	if (child == 0)
+	{
+		BufMgr* walMgr = new BufMgr(20, options);
+		File* logged = new File(File::create(sparsename, StorageType::POSIX));
+		for (int n = 0; n < 4; n++)
+		{
+			Page* newPage;
+			PageId pageNo;
+			walMgr->allocPage(logged, pageNo, newPage);
+			for (int k = 0; k < 3; k++)
+			{
+				sprintf(tmpbuf, "record %d.%d", n, k);
+				newPage->insertRecord(tmpbuf);
+			}
+			walMgr->unPinPage(logged, pageNo, true);
+		}
+		//the records gather on page 2, logged there, which then moves to page 1
+		walMgr->disposePage(logged, 1);
+		walMgr->flushLog();
+		if (walMgr->defragment(logged).pagesAfter != 2)
+		{
+			_exit(1);
+		}
+		//crash: nothing is closed
+		_exit(0);
+	}
+	int status;
+	waitpid(child, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		PRINT_ERROR("ERROR :: Logged file not defragmented");
+	}
+	BufMgr* walMgr = new BufMgr(20, options);
+	File* logged = new File(File::open(sparsename));
+	if (logged->numPages() != 2)
+	{
+		PRINT_ERROR("ERROR :: Recovery brought back moved pages");
+	}
+	std::map<std::string, int> found;
+	for (FileIterator iter = logged->begin(); iter != logged->end(); ++iter)
+	{
+		Page recovered = *iter;
+		for (PageIterator record = recovered.begin(); record != recovered.end(); ++record)
+		{
+			found[*record]++;
+		}
+	}
+	if (found.size() != 9)
+	{
+		PRINT_ERROR("ERROR :: Records lost or repeated by recovery");
+	}
+	for (int n = 1; n < 4; n++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			sprintf(tmpbuf, "record %d.%d", n, k);
+			if (found[tmpbuf] != 1)
+			{
+				PRINT_ERROR("ERROR :: Records lost or repeated by recovery");
+			}
+		}
+	}
+	delete walMgr;
+	delete logged;
+	File::remove(sparsename);
+	std::remove(logname.c_str());
+	std::cout << "Test 45 passed" << "\n";
+}
+
+void test46()
+{
+	//pages allocated through the pool reach the file only when written back
+	const std::string& growname = "test.46";
+	File* grow = new File(File::create(growname, StorageType::POSIX));
+	BufMgr* growMgr = new BufMgr(10);
+	std::vector<PageId> added;
+	for (int n = 0; n < 5; n++)
+	{
+		PageId pageNo;
+		growMgr->allocPage(grow, pageNo, page);
+		sprintf(tmpbuf, "grown %d", n);
+		page->insertRecord(tmpbuf);
+		growMgr->unPinPage(grow, pageNo, n % 2 == 0);
+		added.push_back(pageNo);
+	}
+	std::ifstream before(growname, std::ios::binary | std::ios::ate);
+	if (before.tellg() >= std::streamoff(Page::SIZE) || grow->numPages() != 6 ||
+	    growMgr->getBufStats().diskwrites != 0)
+	{
+		PRINT_ERROR("ERROR :: New pages written before write-back");
+	}
+	//the file sees them as allocated meanwhile
+	PageId seen = 0;
+	for (FileIterator iter = grow->begin(); iter != grow->end(); ++iter, seen++)
+	{
+		if ((*iter).page_number() != added[seen] || (*iter).begin() != (*iter).end())
+		{
+			PRINT_ERROR("ERROR :: Unwritten page not read as allocated");
+		}
+	}
+	if (seen != 5)
+	{
+		PRINT_ERROR("ERROR :: Unwritten pages not in use");
+	}
+	growMgr->disposePage(grow, added[4]);
+	growMgr->flushFile(grow);
+	std::ifstream after(growname, std::ios::binary | std::ios::ate);
+	if (growMgr->getBufStats().diskwrites != 4 || after.tellg() != std::streamoff(6 * Page::SIZE))
+	{
+		PRINT_ERROR("ERROR :: New pages not written back");
+	}
+	for (int n = 0; n < 4; n++)
+	{
+		sprintf(tmpbuf, "grown %d", n);
+		if (grow->readPage(added[n]).getRecord({added[n], 1}) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Written back page lost its record");
+		}
+	}
+	//a page still unwritten at the last close is kept as allocated
+	Page unwritten;
+	const PageId kept = grow->allocateUnwritten(unwritten);
+	//an asynchronous read gives it as allocated too
+	{
+		ThreadPoolIoEngine engine(8, 2);
+		Page async;
+		std::atomic<int> failures(0);
+		std::vector<IoRequest> batch(1, grow->readPageRequest(kept, async,
+		    [&failures](std::exception_ptr error) { if (error) failures++; }));
+		engine.submit(batch);
+		engine.drain();
+		if (failures != 0 || async.page_number() != kept || async.begin() != async.end())
+		{
+			PRINT_ERROR("ERROR :: Unwritten page not read asynchronously as allocated");
+		}
+	}
+	grow->close();
+	*grow = File::open(growname);
+	try
+	{
+		if (grow->readPage(kept).begin() != grow->readPage(kept).end())
+		{
+			PRINT_ERROR("ERROR :: Unwritten page not kept empty");
+		}
+	}
+	catch(const InvalidPageException&)
+	{
+		PRINT_ERROR("ERROR :: Unwritten page lost by close");
+	}
+	if (grow->allocatePage().page_number() == kept)
+	{
+		PRINT_ERROR("ERROR :: Unwritten page allocated again");
+	}
+	delete growMgr;
+	delete grow;
+	File::remove(growname);
+
+	//unwritten pages counted in a header flushed before a crash are reused
+	pid_t child = fork();
+	if (child == 0)
+	{
+		File crashed = File::create(growname, StorageType::POSIX);
+		Page written = crashed.allocatePage();
+		crashed.writePage(written);
+		for (int n = 0; n < 3; n++)
+		{
+			crashed.allocateUnwritten(unwritten);
+		}
+		crashed.sync();
+		//crash: the file is not closed
+		_exit(0);
+	}
+	int status;
+	waitpid(child, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		PRINT_ERROR("ERROR :: Allocating unwritten pages failed");
+	}
+	{
+		File reopened = File::open(growname, StorageType::POSIX);
+		if (reopened.numPages() != 5)
+		{
+			PRINT_ERROR("ERROR :: Unwritten pages not counted after a crash");
+		}
+		for (PageId n = 2; n <= 4; n++)
+		{
+			if (reopened.allocatePage().page_number() > 4)
+			{
+				PRINT_ERROR("ERROR :: Unwritten pages leaked by a crash");
+			}
+		}
+	}
+	File::remove(growname);
+	std::cout << "Test 46 passed" << "\n";
+}
+
+void test47()
+{
+	//writers change private copies, while readers keep the version they pinned
+	const std::string& cowname = "test.47";
+	File* cow = new File(File::create(cowname, StorageType::POSIX));
+	BufMgrOptions options;
+	options.copyOnWrite = true;
+	BufMgr* cowMgr = new BufMgr(10, options);
+	PageId pageNo;
+	{
+		PageGuard first = cowMgr->allocPage(cow, pageNo);
+		first->insertRecord("version 1");
+		first.markDirty();
+	}
+	auto records = [](Page p) {
+		int n = 0;
+		for (PageIterator it = p.begin(); it != p.end(); ++it)
+		{
+			n++;
+		}
+		return n;
+	};
+	PageGuard reader = cowMgr->readPage(cow, pageNo);
+	const FrameId old = reader.frame();
+	PageGuard writer = cowMgr->readPageForUpdate(cow, pageNo);
+	writer->insertRecord("version 2");
+	if (writer.frame() == old || records(*reader) != 1)
+	{
+		PRINT_ERROR("ERROR :: Writer changed the page readers see");
+	}
+	if (cowMgr->readPage(cow, pageNo).frame() != old)
+	{
+		PRINT_ERROR("ERROR :: Private copy visible before it was installed");
+	}
+	writer.markDirty();
+	writer.release();
+	//the old version stays for its reader, new readers get the new one
+	PageGuard later = cowMgr->readPage(cow, pageNo);
+	if (later.frame() == old || records(*later) != 2 || records(*reader) != 1 ||
+	    !cowMgr->getFrameValid(old))
+	{
+		PRINT_ERROR("ERROR :: New version not installed");
+	}
+	//flushing writes the stable version while it is pinned
+	cowMgr->flushFile(cow);
+	if (records(cow->readPage(pageNo)) != 2 || !cowMgr->getFrameValid(later.frame()))
+	{
+		PRINT_ERROR("ERROR :: Pinned version not written back");
+	}
+	reader.release();
+	if (cowMgr->getFrameValid(old))
+	{
+		PRINT_ERROR("ERROR :: Retired version not reclaimed");
+	}
+	//a copy released clean is dropped
+	{
+		PageGuard discarded = cowMgr->readPageForUpdate(cow, pageNo);
+		discarded->insertRecord("dropped");
+		const FrameId copy = discarded.frame();
+		discarded.release();
+		if (cowMgr->getFrameValid(copy) || records(*later) != 2)
+		{
+			PRINT_ERROR("ERROR :: Clean copy installed");
+		}
+	}
+	//a second writer waits for the first and sees its change
+	PageGuard one = cowMgr->readPageForUpdate(cow, pageNo);
+	std::atomic<int> seen(0);
+	std::thread second([&] {
+		PageGuard two = cowMgr->readPageForUpdate(cow, pageNo);
+		seen = records(*two);
+		two->insertRecord("version 4");
+		two.markDirty();
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	if (seen != 0)
+	{
+		PRINT_ERROR("ERROR :: Second writer did not wait");
+	}
+	one->insertRecord("version 3");
+	one.markDirty();
+	one.release();
+	second.join();
+	later.release();
+	if (seen != 3 || records(*cowMgr->readPage(cow, pageNo)) != 4 ||
+	    cowMgr->getBufStats().pagecopies != 4)
+	{
+		PRINT_ERROR("ERROR :: Writers of one page not serialized");
+	}
+	//a scan gives back its pin on the version it read, not on a newer one
+	ParallelScan scan(cowMgr, cow, 1);
+	bool updated = false;
+	try
+	{
+		scan.run([&](std::uint32_t, const RecordId& rid47, std::string_view) {
+			if (!updated)
+			{
+				PageGuard five = cowMgr->readPageForUpdate(cow, rid47.page_number);
+				five->insertRecord("version 5");
+				five.markDirty();
+				updated = true;
+			}
+		});
+	}
+	catch(const PageNotPinnedException&)
+	{
+		PRINT_ERROR("ERROR :: Scan unpinned a newer version");
+	}
+	if (records(*cowMgr->readPage(cow, pageNo)) != 5)
+	{
+		PRINT_ERROR("ERROR :: Version installed during a scan lost");
+	}
+	//a page changed in place is not written while it is pinned
+	PageId fresh;
+	PageGuard inPlace = cowMgr->allocPage(cow, fresh);
+	inPlace->insertRecord("in place");
+	try
+	{
+		cowMgr->flushFile(cow);
+		PRINT_ERROR("ERROR :: Page changed in place flushed while pinned");
+	}
+	catch(const PagePinnedException&)
+	{
+	}
+	inPlace.markDirty();
+	inPlace.release();
+	cowMgr->flushFile(cow);
+	if (records(cow->readPage(fresh)) != 1)
+	{
+		PRINT_ERROR("ERROR :: Page changed in place not written back");
+	}
+	delete cowMgr;
+	//nor by a checkpoint, which keeps the log for it
+	const std::string& cowlog = "test.47.log";
+	options.logFile = cowlog;
+	cowMgr = new BufMgr(10, options);
+	cowMgr->readPage(cow, fresh, page);
+	page->insertRecord("changed");
+	cowMgr->unPinPage(cow, fresh, true);
+	cowMgr->readPage(cow, fresh, page);
+	page->insertRecord("changing");
+	cowMgr->checkpoint();
+	std::ifstream kept(cowlog, std::ios::binary | std::ios::ate);
+	if (records(cow->readPage(fresh)) != 1 || kept.tellg() <= 64)
+	{
+		PRINT_ERROR("ERROR :: Checkpoint wrote a page changed in place while pinned");
+	}
+	cowMgr->unPinPage(cow, fresh, true);
+	cowMgr->checkpoint();
+	if (records(cow->readPage(fresh)) != 3)
+	{
+		PRINT_ERROR("ERROR :: Checkpoint did not write the page once unpinned");
+	}
+	cowMgr->flushFile(cow);
+	delete cowMgr;
+	delete cow;
+	File::remove(cowname);
+	std::remove(cowlog.c_str());
+	std::cout << "Test 47 passed" << "\n";
+}
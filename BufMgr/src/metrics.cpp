@@ -0,0 +1,137 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "metrics.h"
+
+namespace badgerdb {
+
+const std::size_t ShardedCounter::SHARDS;
+const std::size_t LatencyHistogram::SUB_BUCKETS;
+const unsigned LatencyHistogram::MAX_BITS;
+const std::size_t LatencyHistogram::BUCKETS;
+
+std::size_t ShardedCounter::shard()
+{
+  // threads take the slots in turn as they first count something
+  static std::atomic<std::size_t> next(0);
+  thread_local const std::size_t mine = next.fetch_add(1) % SHARDS;
+  return mine;
+}
+
+std::uint64_t ShardedCounter::value() const
+{
+  std::uint64_t sum = 0;
+  for (std::size_t i = 0; i < SHARDS; i++) {
+    sum += slots[i].value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void ShardedCounter::clear()
+{
+  for (std::size_t i = 0; i < SHARDS; i++) {
+    slots[i].value.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::uint64_t LatencySnapshot::percentile(const double fraction) const
+{
+  if (count == 0) {
+    return 0;
+  }
+  const double wanted = std::ceil(std::min(std::max(fraction, 0.0), 1.0) * count);
+  const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(wanted));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // the top of the bucket, but never more than was actually seen
+      if (i + 1 == buckets.size()) {
+        return max;
+      }
+      return std::min(LatencyHistogram::bucketLow(i + 1) - 1, max);
+    }
+  }
+  return max;
+}
+
+void LatencySnapshot::merge(const LatencySnapshot& other)
+{
+  count += other.count;
+  total += other.total;
+  max = std::max(max, other.max);
+  if (buckets.size() < other.buckets.size()) {
+    buckets.resize(other.buckets.size(), 0);
+  }
+  for (std::size_t i = 0; i < other.buckets.size(); i++) {
+    buckets[i] += other.buckets[i];
+  }
+}
+
+std::size_t LatencyHistogram::bucketOf(const std::uint64_t value)
+{
+  if (value < SUB_BUCKETS) {
+    return static_cast<std::size_t>(value);
+  }
+  // SUB_BUCKETS is 2^3: the three bits below the top one pick the sub-bucket
+  const unsigned top = 63 - __builtin_clzll(value);
+  if (top >= MAX_BITS) {
+    return BUCKETS - 1;
+  }
+  const std::size_t sub = (value >> (top - 3)) & (SUB_BUCKETS - 1);
+  return (top - 2) * SUB_BUCKETS + sub;
+}
+
+std::uint64_t LatencyHistogram::bucketLow(const std::size_t bucket)
+{
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  const unsigned top = static_cast<unsigned>(bucket / SUB_BUCKETS) + 2;
+  return (std::uint64_t(SUB_BUCKETS) + bucket % SUB_BUCKETS) << (top - 3);
+}
+
+void LatencyHistogram::record(const std::uint64_t nanos)
+{
+  buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(nanos, std::memory_order_relaxed);
+  std::uint64_t seen = max.load(std::memory_order_relaxed);
+  while (nanos > seen &&
+         !max.compare_exchange_weak(seen, nanos, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::clear()
+{
+  for (std::size_t i = 0; i < BUCKETS; i++) {
+    buckets[i].store(0, std::memory_order_relaxed);
+  }
+  total.store(0, std::memory_order_relaxed);
+  max.store(0, std::memory_order_relaxed);
+}
+
+LatencySnapshot LatencyHistogram::snapshot() const
+{
+  LatencySnapshot result;
+  result.buckets.resize(BUCKETS);
+  for (std::size_t i = 0; i < BUCKETS; i++) {
+    result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    // counted from the buckets so that percentiles agree with it
+    result.count += result.buckets[i];
+  }
+  result.total = total.load(std::memory_order_relaxed);
+  result.max = max.load(std::memory_order_relaxed);
+  return result;
+}
+
+}
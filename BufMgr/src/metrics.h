@@ -0,0 +1,203 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+* @brief 64-bit event counter that threads bump without sharing a cache line
+*
+* Every thread adds to one of SHARDS slots, picked once per thread, so a
+* counter bumped on each page hit does not bounce a cache line between cores.
+* Reading sums the slots; adds racing with a read may or may not be included.
+*/
+class ShardedCounter
+{
+ public:
+	/**
+   * Number of slots
+	 */
+  static const std::size_t SHARDS = 16;
+
+  ShardedCounter() {
+    clear();
+  }
+
+	/**
+   * Adds to the counter.
+   *
+   * @param n  Amount to add
+	 */
+  void add(const std::uint64_t n = 1) {
+    slots[shard()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+	/**
+   * Returns the sum of all slots.
+	 */
+  std::uint64_t value() const;
+
+	/**
+   * Sets the counter to zero.
+	 */
+  void clear();
+
+ private:
+	/**
+   * @brief One slot, alone on its cache line
+	 */
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> value;
+  };
+
+	/**
+   * Returns the slot of the calling thread.
+	 */
+  static std::size_t shard();
+
+	/**
+   * The slots
+	 */
+  Slot slots[SHARDS];
+};
+
+
+/**
+* @brief Contents of a LatencyHistogram at one point in time
+*/
+struct LatencySnapshot
+{
+	/**
+   * Number of values recorded
+	 */
+  std::uint64_t count;
+
+	/**
+   * Sum of the values recorded
+	 */
+  std::uint64_t total;
+
+	/**
+   * Largest value recorded
+	 */
+  std::uint64_t max;
+
+	/**
+   * Number of values in each bucket, see LatencyHistogram::bucketLow()
+	 */
+  std::vector<std::uint64_t> buckets;
+
+  LatencySnapshot() : count(0), total(0), max(0) {}
+
+	/**
+   * Returns the mean of the values recorded; zero if there are none.
+	 */
+  std::uint64_t mean() const {
+    return count == 0 ? 0 : total / count;
+  }
+
+	/**
+   * Returns a value at least as large as the given fraction of the values
+   * recorded, and within a bucket's width of the smallest such value.
+   *
+   * @param fraction  Fraction between 0 and 1, e.g. 0.99 for the 99th percentile
+   * @return  The percentile; zero if no values were recorded
+	 */
+  std::uint64_t percentile(const double fraction) const;
+
+	/**
+   * Adds the values of another snapshot to this one, as if both had been
+   * recorded in one histogram.
+   *
+   * @param other  Snapshot to add
+	 */
+  void merge(const LatencySnapshot& other);
+};
+
+
+/**
+* @brief Histogram of latencies in nanoseconds with bounded relative error
+*
+* Values below SUB_BUCKETS get a bucket each.  Each power of two above is split
+* into SUB_BUCKETS buckets of equal width, so a value and the bounds of its
+* bucket are never more than 1/SUB_BUCKETS apart relative to the value, from
+* nanoseconds up to values of MAX_BITS bits (about 18 minutes); larger values
+* land in the last bucket.  Recording is a few relaxed atomic adds, which is
+* cheap next to the misses and writes it is meant to time.
+*/
+class LatencyHistogram
+{
+ public:
+	/**
+   * Buckets per power of two
+	 */
+  static const std::size_t SUB_BUCKETS = 8;
+
+	/**
+   * Values of more bits than this share the last bucket
+	 */
+  static const unsigned MAX_BITS = 40;
+
+	/**
+   * Number of buckets
+	 */
+  static const std::size_t BUCKETS = (MAX_BITS - 2) * SUB_BUCKETS;
+
+  LatencyHistogram() {
+    clear();
+  }
+
+	/**
+   * Records a value.
+   *
+   * @param nanos  The value, in nanoseconds
+	 */
+  void record(const std::uint64_t nanos);
+
+	/**
+   * Forgets all values recorded.
+	 */
+  void clear();
+
+	/**
+   * Returns the values recorded so far.
+	 */
+  LatencySnapshot snapshot() const;
+
+	/**
+   * Returns the bucket a value belongs to.
+	 */
+  static std::size_t bucketOf(const std::uint64_t value);
+
+	/**
+   * Returns the smallest value of a bucket.
+	 */
+  static std::uint64_t bucketLow(const std::size_t bucket);
+
+ private:
+	/**
+   * Number of values in each bucket
+	 */
+  std::atomic<std::uint64_t> buckets[BUCKETS];
+
+	/**
+   * Sum and maximum of the values recorded
+	 */
+  std::atomic<std::uint64_t> total;
+  std::atomic<std::uint64_t> max;
+};
+
+}
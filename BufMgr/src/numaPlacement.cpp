@@ -0,0 +1,128 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "numaPlacement.h"
+
+namespace badgerdb {
+
+namespace {
+
+// mbind() mode that prefers a node but falls back to others when it is full
+const int PREFERRED = 1;
+
+/**
+ * Parses a sysfs list such as "0-3,8,10-11" into the numbers it names.
+ */
+std::vector<int> parseList(const std::string& list)
+{
+  std::vector<int> numbers;
+  std::size_t at = 0;
+  while (at < list.size()) {
+    char* end;
+    const long first = std::strtol(list.c_str() + at, &end, 10);
+    if (end == list.c_str() + at) {
+      break;
+    }
+    long last = first;
+    at = end - list.c_str();
+    if (at < list.size() && list[at] == '-') {
+      last = std::strtol(list.c_str() + at + 1, &end, 10);
+      at = end - list.c_str();
+    }
+    for (long n = first; n <= last; n++) {
+      numbers.push_back(static_cast<int>(n));
+    }
+    if (at < list.size() && list[at] == ',') {
+      at++;
+    } else {
+      break;
+    }
+  }
+  return numbers;
+}
+
+/**
+ * Reads the first line of a sysfs file, empty if there is none.
+ */
+std::string readLine(const std::string& path)
+{
+  std::ifstream in(path.c_str());
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+}
+
+int numaNodes()
+{
+  const std::vector<int> online = parseList(readLine("/sys/devices/system/node/online"));
+  int nodes = 1;
+  for (int node : online) {
+    if (node + 1 > nodes) {
+      nodes = node + 1;
+    }
+  }
+  return nodes;
+}
+
+bool placeOnNode(void* start, const std::size_t length, const int node)
+{
+  bool placed = false;
+#ifdef SYS_mbind
+  if (node >= 0) {
+    const std::size_t bits = sizeof(unsigned long) * CHAR_BIT;
+    // a spare word, since the kernel ignores the last bit it is given
+    std::vector<unsigned long> mask(node / bits + 2, 0);
+    mask[node / bits] |= 1UL << (node % bits);
+    placed = syscall(SYS_mbind, start, length, PREFERRED, mask.data(),
+                     mask.size() * bits, 0) == 0;
+  }
+#endif
+  // first touch: one write per page commits it where the policy says
+  const long pageSize = sysconf(_SC_PAGESIZE);
+  const std::size_t step = pageSize > 0 ? static_cast<std::size_t>(pageSize) : 4096;
+  volatile char* bytes = static_cast<volatile char*>(start);
+  for (std::size_t offset = 0; offset < length; offset += step) {
+    bytes[offset] = 0;
+  }
+  return placed;
+}
+
+bool runOnNode(const int node)
+{
+  if (node < 0) {
+    return false;
+  }
+  const std::vector<int> cpus = parseList(
+      readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+}
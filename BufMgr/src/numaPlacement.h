@@ -0,0 +1,44 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Returns the number of NUMA nodes of the machine, counting from node 0 to
+ * the highest online node; 1 where the platform does not tell.
+ */
+int numaNodes();
+
+/**
+ * Asks the kernel to place the pages of a memory range on a NUMA node, and
+ * faults them in from the calling thread so that they are placed now rather
+ * than on first use.  Where the platform has no NUMA support the pages are
+ * only faulted in.
+ *
+ * @param start   Page-aligned start of the range
+ * @param length  Length of the range in bytes
+ * @param node    Node to place the pages on
+ * @return  True if the kernel accepted the placement
+ */
+bool placeOnNode(void* start, const std::size_t length, const int node);
+
+/**
+ * Restricts the calling thread to the CPUs of a NUMA node.
+ *
+ * @param node  Node to run on
+ * @return  True if the thread's affinity was changed
+ */
+bool runOnNode(const int node);
+
+}
@@ -0,0 +1,241 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "openHashTbl.h"
+
+namespace badgerdb {
+
+std::uint64_t OpenHashTbl::hash(const FileId fileId, const PageId pageNo)
+{
+  // Combine both halves of the key, then apply the murmur3 finalizer so that
+  // every input bit affects both the shard and the slot
+  std::uint64_t h = fileId * 0x9e3779b97f4a7c15ULL;
+  h ^= pageNo;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+OpenHashTbl::OpenHashTbl(const std::uint32_t capacity, const int shards)
+	: numShards(1)
+{
+  while (numShards * 2 <= (std::uint32_t) shards)
+    numShards *= 2;
+
+  // Start each shard at no more than half full for the expected load
+  std::uint32_t perShard = 8;
+  while (perShard < 2 * (capacity / numShards + 1))
+    perShard *= 2;
+
+  this->shards = new Shard[numShards];
+  for (std::uint32_t i = 0; i < numShards; i++) {
+    this->shards[i].slots = new openHashSlot[perShard]();
+    this->shards[i].mask = perShard - 1;
+    this->shards[i].count = 0;
+    this->shards[i].sequence = 0;
+  }
+}
+
+OpenHashTbl::~OpenHashTbl()
+{
+  for (std::uint32_t i = 0; i < numShards; i++) {
+    delete [] shards[i].slots.load();
+    for (openHashSlot* old : shards[i].retired)
+      delete [] old;
+  }
+  delete [] shards;
+}
+
+void OpenHashTbl::putSlot(openHashSlot& slot, const FileId fileId, const PageId pageNo,
+                          const FrameId frameNo)
+{
+  // the file last, so a probe seeing it also sees the rest
+  std::atomic_ref<PageId>(slot.pageNo).store(pageNo, std::memory_order_relaxed);
+  std::atomic_ref<FrameId>(slot.frameNo).store(frameNo, std::memory_order_relaxed);
+  std::atomic_ref<FileId>(slot.fileId).store(fileId, std::memory_order_release);
+}
+
+bool OpenHashTbl::probe(const openHashSlot* slots, const std::uint32_t mask,
+                        const std::uint64_t h, const FileId fileId, const PageId pageNo,
+                        FrameId& frameNo)
+{
+  // at most one pass over the array, in case a torn read sees no empty slot
+  std::uint32_t pos = h & mask;
+  for (std::uint32_t n = 0; n <= mask; n++) {
+    openHashSlot& slot = const_cast<openHashSlot&>(slots[pos]);
+    const FileId found = std::atomic_ref<FileId>(slot.fileId).load(std::memory_order_acquire);
+    if (!found)
+      return false;
+    if (found == fileId && std::atomic_ref<PageId>(slot.pageNo).load(std::memory_order_relaxed) == pageNo) {
+      frameNo = std::atomic_ref<FrameId>(slot.frameNo).load(std::memory_order_relaxed);
+      return true;
+    }
+    pos = (pos + 1) & mask;
+  }
+  return false;
+}
+
+void OpenHashTbl::grow(Shard& shard)
+{
+  openHashSlot* old = shard.slots.load(std::memory_order_relaxed);
+  const std::uint32_t oldSize = shard.mask.load(std::memory_order_relaxed) + 1;
+  openHashSlot* slots = new openHashSlot[2 * oldSize]();
+  const std::uint32_t mask = 2 * oldSize - 1;
+  for (std::uint32_t i = 0; i < oldSize; i++) {
+    if (!old[i].fileId)
+      continue;
+    std::uint32_t pos = hash(old[i].fileId, old[i].pageNo) & mask;
+    while (slots[pos].fileId)
+      pos = (pos + 1) & mask;
+    slots[pos] = old[i];
+  }
+  // entries change home slots, so a probe pairing the old mask with the new
+  // array could stop short of one; as in tryRemove, such probes see the
+  // sequence number odd, or changed once done, and retry under the latch
+  const std::uint32_t sequence = shard.sequence.load(std::memory_order_relaxed);
+  shard.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // the array before the mask, so a probe reading the new mask never indexes
+  // the old, smaller array; probes may still be reading that one
+  shard.slots.store(slots, std::memory_order_release);
+  shard.mask.store(mask, std::memory_order_release);
+  shard.retired.push_back(old);
+
+  shard.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void OpenHashTbl::reserve(const std::uint32_t entries)
+{
+  // no more than half full for the expected load, as at construction
+  const std::uint64_t wanted = 2 * (entries / numShards + 1);
+  for (std::uint32_t i = 0; i < numShards; i++) {
+    std::lock_guard<std::mutex> guard(shards[i].latch);
+    while (shards[i].mask + 1 < wanted)
+      grow(shards[i]);
+  }
+}
+
+bool OpenHashTbl::tryInsert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  const std::uint64_t h = hash(file->id(), pageNo);
+  Shard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+
+  if (4 * (shard.count + 1) > 3 * (shard.mask + 1))
+    grow(shard);
+
+  openHashSlot* slots = shard.slots.load(std::memory_order_relaxed);
+  const std::uint32_t mask = shard.mask.load(std::memory_order_relaxed);
+  std::uint32_t pos = h & mask;
+  while (slots[pos].fileId) {
+    if (slots[pos].fileId == file->id() && slots[pos].pageNo == pageNo)
+      return false;
+    pos = (pos + 1) & mask;
+  }
+  // filling an empty slot moves nothing, so probes need not be warned
+  putSlot(slots[pos], file->id(), pageNo, frameNo);
+  shard.count++;
+  return true;
+}
+
+bool OpenHashTbl::tryLookup(const File* file, const PageId pageNo, FrameId &frameNo)
+{
+  const std::uint64_t h = hash(file->id(), pageNo);
+  Shard& shard = shardFor(h);
+
+  // optimistic probe: good if no removal moved slots meanwhile
+  const std::uint32_t before = shard.sequence.load(std::memory_order_acquire);
+  if ((before & 1) == 0) {
+    const std::uint32_t mask = shard.mask.load(std::memory_order_acquire);
+    const openHashSlot* slots = shard.slots.load(std::memory_order_acquire);
+    FrameId found;
+    const bool hit = probe(slots, mask, h, file->id(), pageNo, found);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (shard.sequence.load(std::memory_order_relaxed) == before) {
+      if (hit)
+        frameNo = found;
+      return hit;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(shard.latch);
+  return probe(shard.slots.load(std::memory_order_relaxed),
+               shard.mask.load(std::memory_order_relaxed), h, file->id(), pageNo, frameNo);
+}
+
+bool OpenHashTbl::tryRemove(const File* file, const PageId pageNo)
+{
+  const std::uint64_t h = hash(file->id(), pageNo);
+  Shard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+
+  openHashSlot* slots = shard.slots.load(std::memory_order_relaxed);
+  const std::uint32_t mask = shard.mask.load(std::memory_order_relaxed);
+  std::uint32_t hole = h & mask;
+  while (slots[hole].fileId) {
+    if (slots[hole].fileId == file->id() && slots[hole].pageNo == pageNo)
+      break;
+    hole = (hole + 1) & mask;
+  }
+  if (!slots[hole].fileId)
+    return false;
+
+  // optimistic probes seeing an odd sequence number, or a new one once done,
+  // retry under the latch
+  const std::uint32_t sequence = shard.sequence.load(std::memory_order_relaxed);
+  shard.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // Backward-shift deletion: pull later entries of the probe run into the
+  // hole as long as that does not move them in front of their home slot
+  std::uint32_t next = (hole + 1) & mask;
+  while (slots[next].fileId) {
+    const std::uint32_t home = hash(slots[next].fileId, slots[next].pageNo) & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      putSlot(slots[hole], slots[next].fileId, slots[next].pageNo, slots[next].frameNo);
+      hole = next;
+    }
+    next = (next + 1) & mask;
+  }
+  putSlot(slots[hole], 0, 0, 0);
+  shard.count--;
+
+  shard.sequence.store(sequence + 2, std::memory_order_release);
+  return true;
+}
+
+bool OpenHashTbl::tryReplace(const File* file, const PageId pageNo, const FrameId from,
+                             const FrameId to)
+{
+  const std::uint64_t h = hash(file->id(), pageNo);
+  Shard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+
+  openHashSlot* slots = shard.slots.load(std::memory_order_relaxed);
+  const std::uint32_t mask = shard.mask.load(std::memory_order_relaxed);
+  std::uint32_t pos = h & mask;
+  while (slots[pos].fileId) {
+    if (slots[pos].fileId == file->id() && slots[pos].pageNo == pageNo) {
+      if (slots[pos].frameNo != from)
+        return false;
+      // nothing moves, so a probe sees either frame and need not retry
+      std::atomic_ref<FrameId>(slots[pos].frameNo).store(to, std::memory_order_release);
+      return true;
+    }
+    pos = (pos + 1) & mask;
+  }
+  return false;
+}
+
+}
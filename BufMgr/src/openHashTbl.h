@@ -0,0 +1,154 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "file.h"
+#include "pageTable.h"
+
+namespace badgerdb {
+
+/**
+* @brief One slot of the open addressing page table.  A slot with file
+* identifier 0, which no open file has, is empty.
+*/
+struct openHashSlot {
+	/**
+	 * Identifier of the file the page belongs to, 0 if the slot is empty
+	 */
+	FileId fileId;
+
+	/**
+	 * page number within a file
+	 */
+	PageId pageNo;
+
+	/**
+	 * frame number of page in the buffer pool
+	 */
+	FrameId frameNo;
+};
+
+
+/**
+* @brief Flat, open addressing page table using linear probing
+*
+* Slots are stored inline in one array per shard, so neither insert nor lookup
+* allocates or chases pointers.  Keys are spread with a 64-bit mixing hash of
+* (file, pageNo); the high half of the hash picks the shard and the low half
+* the home slot within it.  Removal shifts the following entries of the probe
+* run back instead of leaving tombstones, so probe sequences never degrade
+* with churn.  A shard doubles its slot array when it becomes three quarters
+* full.
+*
+* Like BufHashTbl, each shard has its own latch and every public method is
+* atomic with respect to the others.  Inserts and removals take the latch;
+* lookups first probe without it, under a per-shard sequence number that
+* writers make odd while they move slots, and only take the latch if a writer
+* got in the way.  Slot arrays outgrown stay allocated until the table goes,
+* so an optimistic probe never reads freed memory.
+*/
+class OpenHashTbl : public PageTable
+{
+ private:
+	/**
+	 * Slot array and latch of one partition of the table
+	 */
+  struct Shard {
+    std::mutex latch;
+    std::atomic<openHashSlot*> slots;
+    std::atomic<std::uint32_t> mask;
+    std::uint32_t count;
+    std::atomic<std::uint32_t> sequence;
+    std::vector<openHashSlot*> retired;
+  };
+
+	/**
+	 * Number of shards, a power of two
+	 */
+  std::uint32_t numShards;
+
+	/**
+	 * The shards themselves
+	 */
+  Shard* shards;
+
+	/**
+	 * Returns the 64-bit mixed hash of (file, pageNo)
+	 *
+	 * @param fileId 	Identifier of the file
+	 * @param pageNo  Page number in the file
+	 * @return  			Hash value.
+	 */
+  static std::uint64_t hash(const FileId fileId, const PageId pageNo);
+
+	/**
+	 * Returns the shard owning the given hash value
+	 */
+  Shard& shardFor(const std::uint64_t h) { return shards[(h >> 32) & (numShards - 1)]; }
+
+	/**
+	 * Doubles the slot array of a shard and reinserts its entries, with the
+	 * sequence number odd while the array and mask change.  The caller must
+	 * hold the shard's latch.
+	 *
+	 * @param shard  	Shard to grow
+	 */
+  void grow(Shard& shard);
+
+	/**
+	 * Fills a slot, for probes reading it without the latch.  The caller must
+	 * hold the shard's latch, and have made its sequence number odd unless the
+	 * slot was empty.
+	 */
+  static void putSlot(openHashSlot& slot, const FileId fileId, const PageId pageNo,
+                      const FrameId frameNo);
+
+	/**
+	 * Probes a shard for a key.  With the latch held, or by an optimistic
+	 * probe whose result the sequence number then confirms.
+	 */
+  static bool probe(const openHashSlot* slots, const std::uint32_t mask,
+                    const std::uint64_t h, const FileId fileId, const PageId pageNo,
+                    FrameId& frameNo);
+
+ public:
+	/**
+   * Constructor of OpenHashTbl class
+   *
+   * @param capacity  Expected maximum number of entries (the number of frames)
+   * @param shards    Requested number of independently latched shards, rounded
+   *                  down to a power of two
+	 */
+  OpenHashTbl(const std::uint32_t capacity, const int shards = 64);
+
+	/**
+   * Destructor of OpenHashTbl class
+	 */
+  ~OpenHashTbl() override;
+
+  bool tryInsert(const File* file, const PageId pageNo, const FrameId frameNo) override;
+
+  bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo) override;
+
+  bool tryRemove(const File* file, const PageId pageNo) override;
+
+  bool tryReplace(const File* file, const PageId pageNo, const FrameId from,
+                  const FrameId to) override;
+
+  void reserve(const std::uint32_t entries) override;
+};
+
+}
@@ -8,7 +8,15 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BADGERDB_FILTER_AVX2 1
+#endif
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
@@ -16,41 +24,330 @@
 #include "exceptions/slot_in_use_exception.h"
 #include "page_iterator.h"
 #include "page.h"
+#include "paxPage.h"
+#include "btreeIndex.h"
 
 namespace badgerdb {
 
-Page::Page() {
+namespace {
+
+/**
+ * Number of record bytes a predicate looks at.
+ */
+std::size_t predicateBytes(const RecordPredicate& predicate) {
+  return predicate.op == RecordPredicate::PREFIX
+             ? predicate.prefix.size()
+             : predicate.offset + predicate.width;
+}
+
+bool compare(const std::int64_t field, const RecordPredicate& predicate) {
+  switch (predicate.op) {
+    case RecordPredicate::EQ: return field == predicate.value;
+    case RecordPredicate::NE: return field != predicate.value;
+    case RecordPredicate::LT: return field < predicate.value;
+    case RecordPredicate::LE: return field <= predicate.value;
+    case RecordPredicate::GT: return field > predicate.value;
+    case RecordPredicate::GE: return field >= predicate.value;
+    default: return false;
+  }
+}
+
+/**
+ * Tests one record, which holds at least predicateBytes() bytes.
+ */
+bool matches(const char* record, const RecordPredicate& predicate) {
+  if (predicate.op == RecordPredicate::PREFIX) {
+    return std::memcmp(record, predicate.prefix.data(), predicate.prefix.size()) == 0;
+  }
+  if (predicate.width == 4) {
+    std::int32_t field;
+    std::memcpy(&field, record + predicate.offset, sizeof(field));
+    return compare(field, predicate);
+  }
+  std::int64_t field;
+  std::memcpy(&field, record + predicate.offset, sizeof(field));
+  return compare(field, predicate);
+}
+
+/**
+ * Tests slots [first, last) one by one, setting their bits.
+ */
+std::size_t filterSlots(const char* data, const SlotId first, const SlotId last,
+                        const RecordPredicate& predicate,
+                        std::vector<std::uint64_t>& bitmap) {
+  const std::size_t needed = predicateBytes(predicate);
+  std::size_t count = 0;
+  for (SlotId index = first; index < last; ++index) {
+    PageSlot slot;
+    std::memcpy(&slot, data + index * sizeof(PageSlot), sizeof(slot));
+    if (slot.used && slot.item_length >= needed &&
+        matches(data + slot.item_offset, predicate)) {
+      bitmap[index / 64] |= std::uint64_t(1) << (index % 64);
+      ++count;
+    }
+  }
+  return count;
+}
+
+#if defined(BADGERDB_FILTER_AVX2)
+/**
+ * Combines the results of the two signed comparisons into the predicate's.
+ */
+__attribute__((target("avx2")))
+__m256i combine(const RecordPredicate::Op op, const __m256i equal,
+                const __m256i greater, const __m256i less) {
+  const __m256i ones = _mm256_set1_epi32(-1);
+  switch (op) {
+    case RecordPredicate::EQ: return equal;
+    case RecordPredicate::NE: return _mm256_xor_si256(equal, ones);
+    case RecordPredicate::LT: return less;
+    case RecordPredicate::LE: return _mm256_xor_si256(greater, ones);
+    case RecordPredicate::GT: return greater;
+    default: return _mm256_xor_si256(less, ones);
+  }
+}
+
+/**
+ * Gathers a slot field of eight slots, widened to 32 bits.
+ */
+__attribute__((target("avx2")))
+__m256i gatherField(const char* field, const __m256i positions, const int mask) {
+  const __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(field),
+                                               positions, 1);
+  return _mm256_and_si256(words, _mm256_set1_epi32(mask));
+}
+
+/**
+ * Tests slots eight at a time: the used flags, offsets and lengths of eight
+ * slots are gathered from the slot array, the fields (or first four bytes of
+ * the prefix) of the records long enough are gathered from the data area,
+ * and all eight are compared at once.  Prefixes longer than four bytes are
+ * finished one candidate at a time.  The slots left over go to filterSlots().
+ */
+__attribute__((target("avx2")))
+std::size_t filterSlotsAvx2(const char* data, const SlotId slots,
+                            const RecordPredicate& predicate,
+                            std::vector<std::uint64_t>& bitmap) {
+  const bool prefix = predicate.op == RecordPredicate::PREFIX;
+  const std::size_t needed = predicateBytes(predicate);
+  // a prefix of under four bytes is matched by filterSlots(), since a
+  // gather of four bytes could read past the end of a record at the
+  // end of the page
+  if (prefix && needed < 4) {
+    return filterSlots(data, 0, slots, predicate, bitmap);
+  }
+  // each gather of a slot field reads four bytes, which may reach past the
+  // slot but must stay in the data area
+  const std::size_t reach =
+      std::max(offsetof(PageSlot, item_length), offsetof(PageSlot, item_offset)) + 4;
+  const int field_mask = sizeof(PageOffset) >= 4 ? -1 : (1 << (8 * sizeof(PageOffset))) - 1;
+  const __m256i steps = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                           _mm256_set1_epi32(sizeof(PageSlot)));
+  const __m256i at_least = _mm256_set1_epi32(static_cast<int>(needed) - 1);
+  const __m256i zero = _mm256_setzero_si256();
+
+  std::int32_t head = 0;
+  if (prefix) {
+    std::memcpy(&head, predicate.prefix.data(), sizeof(head));
+  }
+  const __m256i value32 = _mm256_set1_epi32(
+      prefix ? head : static_cast<std::int32_t>(predicate.value));
+  const __m256i value64 = _mm256_set1_epi64x(predicate.value);
+  const int field_offset = prefix ? 0 : static_cast<int>(predicate.offset);
+
+  std::size_t count = 0;
+  SlotId index = 0;
+  for (; index + 8 <= slots &&
+         (index + 7) * sizeof(PageSlot) + reach <= Page::DATA_SIZE;
+       index += 8) {
+    const __m256i positions = _mm256_add_epi32(
+        _mm256_set1_epi32(static_cast<int>(index * sizeof(PageSlot))), steps);
+    const __m256i used = gatherField(data + offsetof(PageSlot, used), positions, 0xff);
+    const __m256i offsets = gatherField(data + offsetof(PageSlot, item_offset),
+                                        positions, field_mask);
+    const __m256i lengths = gatherField(data + offsetof(PageSlot, item_length),
+                                        positions, field_mask);
+    // lanes of records that hold the field; the others read nothing
+    const __m256i valid = _mm256_andnot_si256(_mm256_cmpeq_epi32(used, zero),
+                                              _mm256_cmpgt_epi32(lengths, at_least));
+    if (_mm256_testz_si256(valid, valid)) {
+      continue;
+    }
+    const __m256i fields = _mm256_add_epi32(offsets, _mm256_set1_epi32(field_offset));
+    std::uint32_t bits;
+    if (prefix || predicate.width == 4) {
+      const __m256i values = _mm256_mask_i32gather_epi32(
+          zero, reinterpret_cast<const int*>(data), fields, valid, 1);
+      const __m256i equal = _mm256_cmpeq_epi32(values, value32);
+      const __m256i result = prefix ? equal :
+          combine(predicate.op, equal, _mm256_cmpgt_epi32(values, value32),
+                  _mm256_cmpgt_epi32(value32, values));
+      bits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(result, valid)));
+    } else {
+      bits = 0;
+      for (int half = 0; half < 2; ++half) {
+        const __m128i lanes = half == 0 ? _mm256_castsi256_si128(fields)
+                                        : _mm256_extracti128_si256(fields, 1);
+        const __m256i lane_valid = _mm256_cvtepi32_epi64(
+            half == 0 ? _mm256_castsi256_si128(valid) : _mm256_extracti128_si256(valid, 1));
+        const __m256i values = _mm256_mask_i64gather_epi64(
+            zero, reinterpret_cast<const long long*>(data),
+            _mm256_cvtepi32_epi64(lanes), lane_valid, 1);
+        const __m256i result = _mm256_and_si256(
+            combine(predicate.op, _mm256_cmpeq_epi64(values, value64),
+                    _mm256_cmpgt_epi64(values, value64),
+                    _mm256_cmpgt_epi64(value64, values)),
+            lane_valid);
+        bits |= static_cast<std::uint32_t>(
+            _mm256_movemask_pd(_mm256_castsi256_pd(result))) << (4 * half);
+      }
+    }
+    if (prefix && needed > 4) {
+      for (std::uint32_t candidates = bits; candidates != 0; candidates &= candidates - 1) {
+        const int lane = __builtin_ctz(candidates);
+        PageSlot slot;
+        std::memcpy(&slot, data + (index + lane) * sizeof(PageSlot), sizeof(slot));
+        if (std::memcmp(data + slot.item_offset + 4, predicate.prefix.data() + 4,
+                        needed - 4) != 0) {
+          bits &= ~(1u << lane);
+        }
+      }
+    }
+    // eight slots from a multiple of eight never straddle two words
+    bitmap[index / 64] |= std::uint64_t(bits) << (index % 64);
+    count += __builtin_popcount(bits);
+  }
+  return count + filterSlots(data, index, slots, predicate, bitmap);
+}
+
+bool detect() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#else
+std::size_t filterSlotsAvx2(const char* data, const SlotId slots,
+                            const RecordPredicate& predicate,
+                            std::vector<std::uint64_t>& bitmap) {
+  return filterSlots(data, 0, slots, predicate, bitmap);
+}
+
+bool detect() {
+  return false;
+}
+#endif
+
+/**
+ * Whether filterRecords() may use AVX2, decided once.
+ */
+const bool hardware = detect();
+
+}
+
+Page::Page()
+    : storage_(new char[SIZE]),
+      header_(reinterpret_cast<PageHeader*>(storage_.get())),
+      data_(storage_.get() + sizeof(PageHeader)) {
   initialize();
 }
 
+Page::Page(char* frame)
+    : header_(reinterpret_cast<PageHeader*>(frame)),
+      data_(frame + sizeof(PageHeader)) {
+}
+
+Page::Page(const Page& other)
+    : storage_(new char[SIZE]),
+      header_(reinterpret_cast<PageHeader*>(storage_.get())),
+      data_(storage_.get() + sizeof(PageHeader)) {
+  std::memcpy(storage_.get(), other.header_, SIZE);
+}
+
+Page& Page::operator=(const Page& rhs) {
+  if (this != &rhs) {
+    std::memcpy(header_, rhs.header_, SIZE);
+  }
+  return *this;
+}
+
 void Page::initialize() {
-  header_.free_space_lower_bound = 0;
-  header_.free_space_upper_bound = DATA_SIZE;
-  header_.num_slots = 0;
-  header_.num_free_slots = 0;
-  header_.current_page_number = INVALID_NUMBER;
-  header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  header_->free_space_lower_bound = 0;
+  header_->free_space_upper_bound = DATA_SIZE;
+  header_->num_slots = 0;
+  header_->num_free_slots = 0;
+  header_->current_page_number = INVALID_NUMBER;
+  header_->next_page_number = INVALID_NUMBER;
+  header_->lsn = 0;
+  header_->checksum = 0;
+  header_->fragmented_bytes = 0;
+  header_->first_free_slot = INVALID_SLOT;
+  header_->page_type = SLOTTED;
+  header_->reserved = 0;
+  std::memset(data_, 0, DATA_SIZE);
 }
 
-RecordId Page::insertRecord(const std::string& record_data) {
+RecordId Page::insertRecord(std::string_view record_data) {
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
   }
+  // a new slot extends the slot array into the free space, so it has to be
+  // contiguous before the slot is taken
+  makeContiguous(record_data.length() +
+                 (header_->num_free_slots == 0 ? sizeof(PageSlot) : 0));
   const SlotId slot_number = getAvailableSlot();
   insertRecordInSlot(slot_number, record_data);
   return {page_number(), slot_number};
 }
 
+std::size_t Page::insertRecords(const std::vector<std::string_view>& records,
+                                const std::size_t first,
+                                std::vector<RecordId>& record_ids) {
+  const std::size_t available = getFreeSpace();
+  std::size_t needed = 0;
+  std::size_t count = 0;
+  while (first + count < records.size()) {
+    const std::size_t more =
+        needed + records[first + count].length() + sizeof(PageSlot);
+    if (more > available) {
+      break;
+    }
+    needed = more;
+    ++count;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  makeContiguous(needed);
+  std::size_t offset = header_->free_space_upper_bound;
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::string_view record = records[first + k];
+    const SlotId slot_number = header_->num_slots + 1 + k;
+    PageSlot* slot = getSlot(slot_number);
+    offset -= record.length();
+    slot->used = true;
+    slot->item_offset = static_cast<PageOffset>(offset);
+    slot->item_length = static_cast<PageOffset>(record.length());
+    std::memcpy(data_ + offset, record.data(), record.length());
+    record_ids.push_back({page_number(), slot_number});
+  }
+  header_->num_slots += count;
+  header_->free_space_lower_bound = sizeof(PageSlot) * header_->num_slots;
+  header_->free_space_upper_bound = static_cast<PageOffset>(offset);
+  return count;
+}
+
 std::string Page::getRecord(const RecordId& record_id) const {
+  return std::string(getRecordView(record_id));
+}
+
+std::string_view Page::getRecordView(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-  return data_.substr(slot.item_offset, slot.item_length);
+  return std::string_view(data_ + slot.item_offset, slot.item_length);
 }
 
 void Page::updateRecord(const RecordId& record_id,
-                        const std::string& record_data) {
+                        std::string_view record_data) {
   validateRecordId(record_id);
   const PageSlot* slot = getSlot(record_id.slot_number);
   const std::size_t free_space_after_delete =
@@ -73,103 +370,222 @@ void Page::deleteRecord(const RecordId& record_id) {
 void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
-  PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
-
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
+  releaseSlot(record_id.slot_number);
+  if (allow_slot_compaction && record_id.slot_number == header_->num_slots) {
+    trimSlots();
+  }
+}
+
+void Page::deleteRecords(std::span<const RecordId> record_ids) {
+  for (const RecordId& record_id : record_ids) {
+    validateRecordId(record_id);
+  }
+  for (const RecordId& record_id : record_ids) {
+    if (getSlot(record_id.slot_number)->used) {
+      releaseSlot(record_id.slot_number);
     }
   }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+  if (header_->num_slots > 0 && !getSlot(header_->num_slots)->used) {
+    trimSlots();
+  }
+}
+
+void Page::releaseSlot(const SlotId slot_number) {
+  PageSlot* slot = getSlot(slot_number);
+  std::memset(data_ + slot->item_offset, 0, slot->item_length);
+  if (slot->item_offset == header_->free_space_upper_bound) {
+    // The lowest record borders the free space, so no hole is left.
+    header_->free_space_upper_bound += slot->item_length;
+  } else {
+    header_->fragmented_bytes += slot->item_length;
   }
-  header_.free_space_upper_bound += slot->item_length;
 
   // Mark slot as unused.
   slot->used = false;
+  ++header_->num_free_slots;
+  linkFreeSlot(slot_number);
+}
+
+void Page::trimSlots() {
+  // Free the unused slots at the end of the slot list; used slots cannot be
+  // moved without affecting record IDs.
+  // Each slot is trimmed at most once after being freed, so this is
+  // constant time per delete when amortized.
+  while (header_->num_slots > 0 && !getSlot(header_->num_slots)->used) {
+    unlinkFreeSlot(header_->num_slots);
+    --header_->num_slots;
+    --header_->num_free_slots;
+    header_->free_space_lower_bound -= sizeof(PageSlot);
+  }
+}
+
+void Page::linkFreeSlot(const SlotId slot_number) {
+  PageSlot* slot = getSlot(slot_number);
+  slot->item_offset = header_->first_free_slot;
+  slot->item_length = INVALID_SLOT;
+  if (header_->first_free_slot != INVALID_SLOT) {
+    getSlot(header_->first_free_slot)->item_length = slot_number;
+  }
+  header_->first_free_slot = slot_number;
+}
+
+void Page::unlinkFreeSlot(const SlotId slot_number) {
+  PageSlot* slot = getSlot(slot_number);
+  const SlotId next = slot->item_offset;
+  const SlotId previous = slot->item_length;
+  if (previous == INVALID_SLOT) {
+    header_->first_free_slot = next;
+  } else {
+    getSlot(previous)->item_offset = next;
+  }
+  if (next != INVALID_SLOT) {
+    getSlot(next)->item_length = previous;
+  }
   slot->item_offset = 0;
   slot->item_length = 0;
-  ++header_.num_free_slots;
-
-  if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
-    // Last slot in the list, so we need to free any unused slots that are at
-    // the end of the slot list.
-    int num_slots_to_delete = 1;
-    for (SlotId i = 1; i < header_.num_slots; ++i) {
-      // Traverse list backwards, looking for unused slots.
-      const PageSlot* other_slot = getSlot(header_.num_slots - i);
-      if (!other_slot->used) {
-        ++num_slots_to_delete;
-      } else {
-        // Stop at the first used slot we find, since we can't move used slots
-        // without affecting record IDs.
-        break;
-      }
+}
+
+void Page::rebuildFreeSlots() {
+  header_->first_free_slot = INVALID_SLOT;
+  // Linking from the end leaves the lowest unused slot at the head.
+  for (SlotId i = header_->num_slots; i >= 1; --i) {
+    if (!getSlot(i)->used) {
+      linkFreeSlot(i);
+    }
+  }
+}
+
+void Page::compact() {
+  if (header_->fragmented_bytes == 0) {
+    return;
+  }
+  // Move the records up in decreasing offset order: each one's destination
+  // is at or above its start and below the records already moved.
+  SlotId order[DATA_SIZE / sizeof(PageSlot)];
+  std::size_t count = 0;
+  for (SlotId i = 1; i <= header_->num_slots; ++i) {
+    if (getSlot(i)->used) {
+      order[count++] = i;
     }
-    header_.num_slots -= num_slots_to_delete;
-    header_.num_free_slots -= num_slots_to_delete;
-    header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
+  }
+  std::sort(order, order + count, [this](const SlotId a, const SlotId b) {
+    return getSlot(a)->item_offset > getSlot(b)->item_offset;
+  });
+  std::size_t end = DATA_SIZE;
+  for (std::size_t k = 0; k < count; ++k) {
+    PageSlot* slot = getSlot(order[k]);
+    end -= slot->item_length;
+    if (slot->item_offset != end) {
+      std::memmove(data_ + end, data_ + slot->item_offset, slot->item_length);
+      slot->item_offset = static_cast<PageOffset>(end);
+    }
+  }
+  std::memset(data_ + header_->free_space_upper_bound, 0,
+              end - header_->free_space_upper_bound);
+  header_->free_space_upper_bound = static_cast<PageOffset>(end);
+  header_->fragmented_bytes = 0;
+}
+
+void Page::makeContiguous(const std::size_t bytes) {
+  if (header_->free_space_upper_bound - header_->free_space_lower_bound <
+      static_cast<int>(bytes)) {
+    compact();
   }
 }
 
-bool Page::hasSpaceForRecord(const std::string& record_data) const {
+bool Page::hasSpaceForRecord(std::string_view record_data) const {
   std::size_t record_size = record_data.length();
-  if (header_.num_free_slots == 0) {
+  if (header_->num_free_slots == 0) {
     record_size += sizeof(PageSlot);
   }
   return record_size <= getFreeSpace();
 }
 
+void Page::initializeAs(const PageType type) {
+  header_->page_type = type;
+  header_->free_space_lower_bound = 0;
+  header_->free_space_upper_bound = 0;
+  header_->num_slots = 0;
+  header_->num_free_slots = 0;
+  header_->fragmented_bytes = 0;
+  header_->first_free_slot = INVALID_SLOT;
+  std::memset(data_, 0, DATA_SIZE);
+}
+
+bool Page::isConsistent() const {
+  if (header_->page_type == PAX) {
+    return PaxPage::isConsistent(*this);
+  }
+  if (header_->page_type == BTREE) {
+    return BTreeIndex::isConsistent(*this);
+  }
+  if (header_->page_type != SLOTTED) {
+    return false;
+  }
+  if (header_->free_space_lower_bound !=
+          header_->num_slots * sizeof(PageSlot) ||
+      header_->free_space_lower_bound > header_->free_space_upper_bound ||
+      header_->free_space_upper_bound > DATA_SIZE ||
+      header_->num_free_slots > header_->num_slots) {
+    return false;
+  }
+  SlotId free_slots = 0;
+  std::size_t record_bytes = 0;
+  for (SlotId i = 1; i <= header_->num_slots; ++i) {
+    const PageSlot& slot = getSlot(i);
+    if (!slot.used) {
+      ++free_slots;
+    } else if (slot.item_offset < header_->free_space_upper_bound ||
+               slot.item_offset + slot.item_length > DATA_SIZE) {
+      return false;
+    } else {
+      record_bytes += slot.item_length;
+    }
+  }
+  // Every unused slot is in the chain exactly once.
+  SlotId chained = 0;
+  SlotId previous = INVALID_SLOT;
+  for (SlotId i = header_->first_free_slot; i != INVALID_SLOT;
+       i = getSlot(i).item_offset) {
+    if (i > header_->num_slots || getSlot(i).used ||
+        getSlot(i).item_length != previous || ++chained > free_slots) {
+      return false;
+    }
+    previous = i;
+  }
+  return free_slots == header_->num_free_slots && chained == free_slots &&
+      record_bytes + header_->fragmented_bytes ==
+          std::size_t(DATA_SIZE - header_->free_space_upper_bound);
+}
+
 PageSlot* Page::getSlot(const SlotId slot_number) {
   return reinterpret_cast<PageSlot*>(
-      &data_[(slot_number - 1) * sizeof(PageSlot)]);
+      data_ + (slot_number - 1) * sizeof(PageSlot));
 }
 
 const PageSlot& Page::getSlot(const SlotId slot_number) const {
   return *reinterpret_cast<const PageSlot*>(
-      &data_[(slot_number - 1) * sizeof(PageSlot)]);
+      data_ + (slot_number - 1) * sizeof(PageSlot));
 }
 
 SlotId Page::getAvailableSlot() {
-  SlotId slot_number = INVALID_SLOT;
-  if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
-      const PageSlot* slot = getSlot(i);
-      if (!slot->used) {
-        // We don't decrement the number of free slots until someone actually
-        // puts data in the slot.
-        slot_number = i;
-        break;
-      }
-    }
-  } else {
-    // Have to allocate a new slot.
-    slot_number = header_.num_slots + 1;
-    ++header_.num_slots;
-    ++header_.num_free_slots;
-    header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+  if (header_->first_free_slot == INVALID_SLOT) {
+    // Have to allocate a new slot; it joins the chain until it is filled.
+    const SlotId slot_number = header_->num_slots + 1;
+    ++header_->num_slots;
+    ++header_->num_free_slots;
+    header_->free_space_lower_bound = sizeof(PageSlot) * header_->num_slots;
+    getSlot(slot_number)->used = false;
+    linkFreeSlot(slot_number);
   }
-  assert(slot_number != INVALID_SLOT);
-  return static_cast<SlotId>(slot_number);
+  // We don't take the slot out of the chain until someone actually puts data
+  // in it.
+  return header_->first_free_slot;
 }
 
 void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string& record_data) {
-  if (slot_number > header_.num_slots ||
+                              std::string_view record_data) {
+  if (slot_number > header_->num_slots ||
       slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
   }
@@ -177,17 +593,20 @@ void Page::insertRecordInSlot(const SlotId slot_number,
   if (slot->used) {
     throw SlotInUseException(page_number(), slot_number);
   }
+  makeContiguous(record_data.length());
+  unlinkFreeSlot(slot_number);
   const int record_length = record_data.length();
   slot->used = true;
   slot->item_length = record_length;
-  slot->item_offset = header_.free_space_upper_bound - record_length;
-  header_.free_space_upper_bound = slot->item_offset;
-  --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  slot->item_offset = header_->free_space_upper_bound - record_length;
+  header_->free_space_upper_bound = slot->item_offset;
+  --header_->num_free_slots;
+  std::memcpy(data_ + slot->item_offset, record_data.data(), slot->item_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
-  if (record_id.page_number != page_number()) {
+  // the records of other layouts are not in slots
+  if (record_id.page_number != page_number() || header_->page_type != SLOTTED) {
     throw InvalidRecordException(record_id, page_number());
   }
   const PageSlot& slot = getSlot(record_id.slot_number);
@@ -205,4 +624,29 @@ PageIterator Page::end() {
   return PageIterator(this, end_record_id);
 }
 
+std::size_t Page::filterRecords(const RecordPredicate& predicate,
+                               std::vector<std::uint64_t>& bitmap) const {
+  const SlotId slots = header_->num_slots;
+  bitmap.assign((slots + 63) / 64, 0);
+  return hardware ? filterSlotsAvx2(data_, slots, predicate, bitmap)
+                  : filterSlots(data_, 0, slots, predicate, bitmap);
+}
+
+std::size_t Page::filterRecords(const RecordPredicate& predicate,
+                               std::vector<RecordId>& matches) const {
+  std::vector<std::uint64_t> bitmap;
+  const std::size_t count = filterRecords(predicate, bitmap);
+  for (std::size_t word = 0; word < bitmap.size(); ++word) {
+    for (std::uint64_t bits = bitmap[word]; bits != 0; bits &= bits - 1) {
+      const SlotId slot = static_cast<SlotId>(word * 64 + __builtin_ctzll(bits) + 1);
+      matches.push_back({page_number(), slot});
+    }
+  }
+  return count;
+}
+
+bool Page::filterHardware() {
+  return hardware;
+}
+
 }
@@ -13,12 +13,39 @@
 #include <cstddef>
 #include <stdint.h>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "types.h"
 
 namespace badgerdb {
 
+/**
+ * @brief Layout of a page's data area.
+ *
+ * Pages of any type but SLOTTED have no slots and no free space to Page; the
+ * classes named below read and change them.
+ */
+enum PageType : std::uint32_t {
+  /**
+   * Slot array growing up from the front, records growing down from the end;
+   * the layout Page works with.
+   */
+  SLOTTED = 0,
+
+  /**
+   * Fixed-width rows split into one mini-page per column, see PaxPage.
+   */
+  PAX = 1,
+
+  /**
+   * Node or root pointer of a B+-tree, see BTreeIndex.
+   */
+  BTREE = 2
+};
+
 /**
  * @brief Header metadata in a page.
  *
@@ -30,13 +57,13 @@ struct PageHeader {
    * Lower bound of the free space.  This is the offset of the first unused byte
    * after the slot array.
    */
-  std::uint16_t free_space_lower_bound;
+  PageOffset free_space_lower_bound;
 
   /**
    * Upper bound of the free space.  This is the offset of the last unused byte
    * before the first data record.
    */
-  std::uint16_t free_space_upper_bound;
+  PageOffset free_space_upper_bound;
 
   /**
    * Number of slots currently allocated.  This number may include slots which
@@ -56,10 +83,45 @@ struct PageHeader {
   PageId current_page_number;
 
   /**
-   * Number of the next used page in the file.
+   * Number of the next page in the file's free list if this page is free;
+   * INVALID_NUMBER if it is in use.
    */
   PageId next_page_number;
 
+  /**
+   * LSN of the log record holding the latest logged image of the page; zero
+   * if the page has never been logged.
+   */
+  Lsn lsn;
+
+  /**
+   * CRC-32C of the page with this field zero, in files with checksums.
+   */
+  std::uint32_t checksum;
+
+  /**
+   * Bytes of deleted records between the free space and the end of the data
+   * area, not yet reclaimed by compaction.
+   */
+  PageOffset fragmented_bytes;
+
+  /**
+   * First slot of the chain of allocated but unused slots; INVALID_SLOT if
+   * there is none.
+   */
+  SlotId first_free_slot;
+
+  /**
+   * Layout of the data area, a PageType.  Pages of files from before the
+   * type was recorded are all SLOTTED.
+   */
+  std::uint32_t page_type;
+
+  /**
+   * Zero; keeps the header free of padding at the default page size.
+   */
+  std::uint32_t reserved;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -70,12 +132,17 @@ struct PageHeader {
     return num_slots == rhs.num_slots &&
         num_free_slots == rhs.num_free_slots &&
         current_page_number == rhs.current_page_number &&
-        next_page_number == rhs.next_page_number;
+        next_page_number == rhs.next_page_number &&
+        lsn == rhs.lsn &&
+        page_type == rhs.page_type;
   }
 };
 
 /**
  * @brief Slot metadata that tracks where a record is in the data space.
+ *
+ * An unused slot has no data item; its offset and length fields link it into
+ * the page's doubly linked chain of unused slots instead.
  */
 struct PageSlot {
   /**
@@ -85,18 +152,93 @@ struct PageSlot {
   bool used;
 
   /**
-   * Offset of the data item in the page.
+   * Offset of the data item in the page; for an unused slot, the next unused
+   * slot in the chain, or INVALID_SLOT.
    */
-  std::uint16_t item_offset;
+  PageOffset item_offset;
 
   /**
-   * Length of the data item in this slot.
+   * Length of the data item in this slot; for an unused slot, the previous
+   * unused slot in the chain, or INVALID_SLOT.
    */
-  std::uint16_t item_length;
+  PageOffset item_length;
 };
 
 class PageIterator;
 
+/**
+ * @brief A test of a record that Page::filterRecords() evaluates in place.
+ *
+ * Either compares a little-endian signed integer of <width> bytes at <offset>
+ * in the record with <value>, or checks that the record starts with <prefix>.
+ * A record too short to hold the field or the prefix does not match.
+ */
+struct RecordPredicate {
+  /**
+   * Comparison of the field with the value, or a prefix match.
+   */
+  enum Op { EQ, NE, LT, LE, GT, GE, PREFIX };
+
+  /**
+   * Test applied.
+   */
+  Op op;
+
+  /**
+   * Offset of the field in the record.
+   */
+  std::uint32_t offset;
+
+  /**
+   * Size of the field, 4 or 8 bytes.
+   */
+  std::uint32_t width;
+
+  /**
+   * Value the field is compared with.
+   */
+  std::int64_t value;
+
+  /**
+   * Bytes a record must start with, for PREFIX.  Not copied: they must
+   * outlive the predicate.
+   */
+  std::string_view prefix;
+
+  /**
+   * Returns a comparison of a 32 bit field with a value.
+   *
+   * @param offset  Offset of the field in the record.
+   * @param op      Comparison, other than PREFIX.
+   * @param value   Value to compare with.
+   */
+  static RecordPredicate int32(const std::uint32_t offset, const Op op,
+                               const std::int32_t value) {
+    return RecordPredicate{op, offset, 4, value, std::string_view()};
+  }
+
+  /**
+   * Returns a comparison of a 64 bit field with a value.
+   *
+   * @param offset  Offset of the field in the record.
+   * @param op      Comparison, other than PREFIX.
+   * @param value   Value to compare with.
+   */
+  static RecordPredicate int64(const std::uint32_t offset, const Op op,
+                               const std::int64_t value) {
+    return RecordPredicate{op, offset, 8, value, std::string_view()};
+  }
+
+  /**
+   * Returns a prefix match.
+   *
+   * @param prefix  Bytes a record must start with.
+   */
+  static RecordPredicate startsWith(std::string_view prefix) {
+    return RecordPredicate{PREFIX, 0, 0, 0, prefix};
+  }
+};
+
 /**
  * @brief Class which represents a fixed-size database page containing records.
  *
@@ -110,10 +252,10 @@ class PageIterator;
 class Page {
  public:
   /**
-   * Page size in bytes.  If this is changed, database files created with a
-   * different page size value will be unreadable by the resulting binaries.
+   * Page size in bytes, BADGERDB_PAGE_SIZE.  Files record the size they were
+   * created with, and File::open() refuses files of another size.
    */
-  static const std::size_t SIZE = 8192;
+  static const std::size_t SIZE = BADGERDB_PAGE_SIZE;
 
   /**
    * Size of page free space area in bytes.
@@ -130,18 +272,66 @@ class Page {
    */
   static const SlotId INVALID_SLOT = 0;
 
+  static_assert((SIZE & (SIZE - 1)) == 0 && SIZE >= 4096 && SIZE <= (1 << 20),
+                "BADGERDB_PAGE_SIZE must be a power of two from 4096 to 1048576");
+  static_assert(DATA_SIZE <= PageOffset(~PageOffset(0)),
+                "PageOffset is too narrow for the page size");
+
   /**
-   * Constructs a new, uninitialized page.
+   * Constructs a new, uninitialized page which owns its own storage.
    */
   Page();
 
+  /**
+   * Constructs a page which is a view over <Page::SIZE> bytes of externally
+   * owned memory, such as a buffer pool frame.  The header sits inline at the
+   * start of those bytes, followed by the data area.  The memory is not
+   * initialized and must outlive the page.
+   *
+   * @param frame   Start of the page's bytes.
+   */
+  explicit Page(char* frame);
+
+  /**
+   * Copy constructor.  The copy always owns its storage, even if <other> is a
+   * view.
+   *
+   * @param other   Page to copy.
+   */
+  Page(const Page& other);
+
+  /**
+   * Assignment operator.  Copies the contents of <rhs> into this page's
+   * storage; a view keeps pointing at the same frame.
+   *
+   * @param rhs   Page to copy.
+   * @return  This page.
+   */
+  Page& operator=(const Page& rhs);
+
   /**
    * Inserts a new record into the page.
    *
    * @param record_data  Bytes that compose the record.
    * @return  ID of the newly inserted record.
    */
-  RecordId insertRecord(const std::string& record_data);
+  RecordId insertRecord(std::string_view record_data);
+
+  /**
+   * Inserts as many records as fit, in order from <records>[<first>], in new
+   * slots at the end of the slot array.  Space is checked once for all of
+   * them and the slots and record bytes are laid out in a single pass, so
+   * this is how a bulk load fills a page.  Unused slots are not reused.
+   *
+   * @param records     Records to insert.
+   * @param first       Index in <records> of the first record to insert.
+   * @param record_ids  Receives the IDs of the inserted records, appended.
+   * @return  Number of records inserted; zero if <records>[<first>] does not
+   *          fit or there is none.
+   */
+  std::size_t insertRecords(const std::vector<std::string_view>& records,
+                            const std::size_t first,
+                            std::vector<RecordId>& record_ids);
 
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
@@ -153,6 +343,17 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns the record with the given ID in place on the page, without
+   * copying it.  The view is only valid until the page changes or goes away;
+   * for a page in the buffer pool, that is at most until it is unpinned.
+   *
+   * @see getRecord
+   * @param record_id  ID of the record to return.
+   * @return  The record's bytes on the page.
+   */
+  std::string_view getRecordView(const RecordId& record_id) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
@@ -161,46 +362,117 @@ class Page {
    * @param record_id   ID of record to update.
    * @param record_data Updated bytes that compose the record.
    */
-  void updateRecord(const RecordId& record_id, const std::string& record_data);
+  void updateRecord(const RecordId& record_id, std::string_view record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Deletes the record with the given ID.  The record's bytes are only
+   * counted as fragmented; the page is compacted when an insert or update
+   * needs them.  Slot array is compacted if the slot deleted is at the end of
+   * the slot array.
    *
    * @param record_id   ID of the record to delete.
    */
   void deleteRecord(const RecordId& record_id);
 
+  /**
+   * Deletes the records with the given IDs, as deleteRecord() would one by
+   * one, but compacts the slot array once at the end.  If any ID is invalid
+   * nothing is deleted.  An ID given twice is deleted once.
+   *
+   * @param record_ids  IDs of the records to delete.
+   * @throws  InvalidRecordException  If an ID has a bad page or slot number.
+   */
+  void deleteRecords(std::span<const RecordId> record_ids);
+
+  /**
+   * Evaluates a predicate over every record of the page in place, reading the
+   * slot array in bulk.  Uses AVX2 gathers and compares, eight slots at a
+   * time, when the processor has them (see filterHardware()); the results
+   * are the same either way.
+   *
+   * @param predicate  Test of each record.
+   * @param bitmap     Resized to one bit per slot and set to the matches:
+   *                   the bit of slot s is bit (s - 1) % 64 of word
+   *                   (s - 1) / 64.
+   * @return  Number of matching records.
+   */
+  std::size_t filterRecords(const RecordPredicate& predicate,
+                            std::vector<std::uint64_t>& bitmap) const;
+
+  /**
+   * Evaluates a predicate as above, appending the IDs of the matching
+   * records, in slot order, to <matches>.
+   *
+   * @param predicate  Test of each record.
+   * @param matches    Receives the IDs of the matching records.
+   * @return  Number of matching records.
+   */
+  std::size_t filterRecords(const RecordPredicate& predicate,
+                            std::vector<RecordId>& matches) const;
+
+  /**
+   * Returns true if filterRecords() uses AVX2 on this processor.
+   */
+  static bool filterHardware();
+
   /**
    * Returns true if the page has enough free space to hold the given data.
    *
    * @param record_data Bytes that compose the record.
    * @return  Whether the page can hold the data.
    */
-  bool hasSpaceForRecord(const std::string& record_data) const;
+  bool hasSpaceForRecord(std::string_view record_data) const;
 
   /**
-   * Returns this page's free space in bytes.
+   * Returns true if the header and slot array describe a valid layout: the
+   * free space bounds are in order, and every record lies within the data
+   * area above the free space, which with the fragmented bytes accounts for
+   * the whole data area.  Reading records of a page that fails this
+   * check may read out of bounds.  A PAX page is checked by
+   * PaxPage::isConsistent() instead.
+   *
+   * @return  True if the page layout is consistent.
+   */
+  bool isConsistent() const;
+
+  /**
+   * Returns this page's free space in bytes, including the bytes of deleted
+   * records that are not yet compacted.
    *
    * @return  Free space in bytes.
    */
-  std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+  PageOffset getFreeSpace() const { return header_->free_space_upper_bound -
+                                              header_->free_space_lower_bound +
+                                              header_->fragmented_bytes; }
 
   /**
    * Returns this page's number in its file.
    *
    * @return  Page number.
    */
-  PageId page_number() const { return header_.current_page_number; }
+  PageId page_number() const { return header_->current_page_number; }
 
   /**
-   * Returns the number of the next used page this page in its file.
+   * Returns the number of the next free page after this one in its file's
+   * free list, if this page is free.
    *
-   * @return  Page number of next used page in file.
+   * @return  Page number of next free page in file.
    */
-  PageId next_page_number() const { return header_.next_page_number; }
+  PageId next_page_number() const { return header_->next_page_number; }
+
+  /**
+   * Returns the LSN of the latest logged image of this page.
+   *
+   * @return  LSN of the page; zero if it was never logged.
+   */
+  Lsn lsn() const { return header_->lsn; }
+
+  /**
+   * Returns the layout of this page's data area.
+   *
+   * @return  Type of the page.
+   */
+  PageType type() const { return static_cast<PageType>(header_->page_type); }
 
   /**
    * Returns an iterator at the first record in the page.
@@ -229,16 +501,16 @@ class Page {
    * @param page_number   Number of page in file.
    */
   void set_page_number(const PageId new_page_number) {
-    header_.current_page_number = new_page_number;
+    header_->current_page_number = new_page_number;
   }
 
   /**
-   * Sets the number of the next used page after this page in its file.
+   * Sets the number of the next free page after this page in its file.
    *
-   * @param next_page_number  Page number of next used page in file.
+   * @param next_page_number  Page number of next free page in file.
    */
   void set_next_page_number(const PageId new_next_page_number) {
-    header_.next_page_number = new_next_page_number;
+    header_->next_page_number = new_next_page_number;
   }
 
   /**
@@ -254,6 +526,62 @@ class Page {
   void deleteRecord(const RecordId& record_id,
                     const bool allow_slot_compaction);
 
+  /**
+   * Marks the slot of a valid record ID unused and counts its bytes as
+   * fragmented, without compacting the slot array.
+   *
+   * @param slot_number   Slot of the record to delete.
+   */
+  void releaseSlot(const SlotId slot_number);
+
+  /**
+   * Frees the unused slots at the end of the slot array.
+   */
+  void trimSlots();
+
+  /**
+   * Puts an unused slot at the head of the chain of unused slots.
+   *
+   * @param slot_number   Slot to add.
+   */
+  void linkFreeSlot(const SlotId slot_number);
+
+  /**
+   * Takes an unused slot out of the chain of unused slots.
+   *
+   * @param slot_number   Slot to remove.
+   */
+  void unlinkFreeSlot(const SlotId slot_number);
+
+  /**
+   * Builds the chain of unused slots from scratch, for pages written before
+   * there was one.
+   */
+  void rebuildFreeSlots();
+
+  /**
+   * Moves all records to the end of the data area, so that the fragmented
+   * bytes join the free space.
+   */
+  void compact();
+
+  /**
+   * Compacts the page if fewer than <bytes> bytes of free space are
+   * contiguous.
+   *
+   * @param bytes   Contiguous free space needed.
+   */
+  void makeContiguous(const std::size_t bytes);
+
+  /**
+   * Gives the page another layout: sets its type, leaves it no slots and no
+   * free space, and zeroes the data area.  The page number, free list link
+   * and LSN are kept.
+   *
+   * @param type  The layout, other than SLOTTED.
+   */
+  void initializeAs(const PageType type);
+
   /**
    * Returns the slot with the given number.  This method will return
    * unallocated slots if requested; it is up to the caller to ensure they
@@ -275,9 +603,10 @@ class Page {
   const PageSlot& getSlot(const SlotId slot_number) const;
 
   /**
-   * Returns the slot number of an available slot.  If no slots are available
-   * to be reused, allocates a new slot.  Updates available slot count in the
-   * header metadata, but does not mark returned slot as used.  If a new slot is
+   * Returns the slot number of an available slot in constant time: the head
+   * of the chain of unused slots, or if there is none a newly allocated slot
+   * added to the chain.  Updates available slot count in the header
+   * metadata, but does not mark returned slot as used.  If a new slot is
    * allocated, updates the free space lower bound.
    *
    * Callers are responsible for making sure there is enough space to allocate a
@@ -292,7 +621,7 @@ class Page {
 
   /**
    * Inserts record data into the given slot.  The slot should not be currently
-   * in use.  <slot_number> must be less than <header_.num_slots>.
+   * in use.  <slot_number> must be less than <header_->num_slots>.
    *
    * Callers are responsible for making sure there is enough space to hold the
    * record before calling this method.
@@ -304,7 +633,7 @@ class Page {
    * @throws  SlotInUseException  Thrown when given slot is in use.
    */
   void insertRecordInSlot(const SlotId slot_number,
-                          const std::string& record_data);
+                          std::string_view record_data);
 
   /**
    * Throws an exception if the given record ID is not valid for this page
@@ -324,19 +653,27 @@ class Page {
   bool isUsed() const { return page_number() != INVALID_NUMBER; }
 
   /**
-   * Header metadata.
+   * Storage of pages which are not views over a frame; null for views.
    */
-  PageHeader header_;
+  std::unique_ptr<char[]> storage_;
 
   /**
-   * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * Header metadata, at the start of the page's bytes.
    */
+  PageHeader* header_;
 
-  std::string data_;
+  /**
+   * Data stored on the page, <DATA_SIZE> bytes directly after the header.
+   * Includes bookkeeping information about slots as well as actual content.
+   */
+  char* data_;
 
+  friend class BufMgr;
   friend class File;
+  friend class LogManager;
   friend class PageIterator;
+  friend class PaxPage;
+  friend class BTreeIndex;
   friend class PageTest;
   friend class BufferTest;
 };
@@ -0,0 +1,180 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pageCodec.h"
+
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Shortest back reference worth a sequence.
+ */
+const std::size_t MIN_MATCH = 4;
+
+/**
+ * Farthest a back reference reaches.
+ */
+const std::size_t MAX_OFFSET = 65535;
+
+/**
+ * Number of bits of the match finder's hash.
+ */
+const int HASH_BITS = 12;
+
+std::uint32_t load32(const char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash(std::uint32_t value) {
+  return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Output cursor that refuses to go past the end of the buffer.
+ */
+struct Sink {
+  char* next;
+  char* end;
+
+  bool put(const std::uint8_t byte) {
+    if (next == end) return false;
+    *next++ = static_cast<char>(byte);
+    return true;
+  }
+
+  bool put(const char* bytes, const std::size_t length) {
+    if (static_cast<std::size_t>(end - next) < length) return false;
+    std::memcpy(next, bytes, length);
+    next += length;
+    return true;
+  }
+
+  /**
+   * Writes the part of a length beyond the token's 15 as bytes of 255 and a
+   * remainder.
+   */
+  bool putLength(std::size_t length) {
+    for (; length >= 255; length -= 255) {
+      if (!put(255)) return false;
+    }
+    return put(static_cast<std::uint8_t>(length));
+  }
+
+  /**
+   * Writes a sequence of literals followed, if <match> is non-zero, by a back
+   * reference of <match> bytes at <offset>.
+   */
+  bool sequence(const char* literals, const std::size_t count,
+                const std::size_t offset, const std::size_t match) {
+    const std::size_t extra = match == 0 ? 0 : match - MIN_MATCH;
+    const std::uint8_t token = static_cast<std::uint8_t>(
+        ((count < 15 ? count : 15) << 4) | (extra < 15 ? extra : 15));
+    if (!put(token)) return false;
+    if (count >= 15 && !putLength(count - 15)) return false;
+    if (!put(literals, count)) return false;
+    if (match == 0) return true;
+    if (!put(static_cast<std::uint8_t>(offset & 0xff)) ||
+        !put(static_cast<std::uint8_t>(offset >> 8))) {
+      return false;
+    }
+    return extra < 15 || putLength(extra - 15);
+  }
+};
+
+/**
+ * Reads the part of a length beyond the token's 15.
+ */
+bool getLength(const std::uint8_t*& next, const std::uint8_t* end,
+               std::size_t& length) {
+  std::uint8_t byte;
+  do {
+    if (next == end) return false;
+    byte = *next++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+}
+
+std::size_t compressBlock(const char* source, const std::size_t length,
+                          char* dest, const std::size_t capacity) {
+  // positions plus one, so that zero means empty
+  std::uint32_t table[1 << HASH_BITS] = {};
+  Sink out = {dest, dest + capacity};
+  std::size_t anchor = 0;
+  std::size_t ip = 0;
+  while (ip + MIN_MATCH <= length) {
+    const std::uint32_t word = load32(source + ip);
+    std::uint32_t& slot = table[hash(word)];
+    const std::size_t candidate = slot;
+    slot = static_cast<std::uint32_t>(ip + 1);
+    if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET ||
+        load32(source + candidate - 1) != word) {
+      ++ip;
+      continue;
+    }
+    const std::size_t from = candidate - 1;
+    std::size_t match = MIN_MATCH;
+    while (ip + match < length && source[from + match] == source[ip + match]) {
+      ++match;
+    }
+    if (!out.sequence(source + anchor, ip - anchor, ip - from, match)) {
+      return 0;
+    }
+    ip += match;
+    anchor = ip;
+  }
+  // the last sequence is literals only, possibly none
+  if (!out.sequence(source + anchor, length - anchor, 0, 0)) {
+    return 0;
+  }
+  return static_cast<std::size_t>(out.next - dest);
+}
+
+bool decompressBlock(const char* source, const std::size_t length, char* dest,
+                     const std::size_t capacity) {
+  const std::uint8_t* next = reinterpret_cast<const std::uint8_t*>(source);
+  const std::uint8_t* const end = next + length;
+  std::size_t op = 0;
+  while (next < end) {
+    const std::uint8_t token = *next++;
+    std::size_t count = token >> 4;
+    if (count == 15 && !getLength(next, end, count)) return false;
+    if (static_cast<std::size_t>(end - next) < count || capacity - op < count) {
+      return false;
+    }
+    std::memcpy(dest + op, next, count);
+    next += count;
+    op += count;
+    if (next == end) break;
+    if (end - next < 2) return false;
+    const std::size_t offset = next[0] | (std::size_t(next[1]) << 8);
+    next += 2;
+    std::size_t match = token & 15;
+    if (match == 15 && !getLength(next, end, match)) return false;
+    match += MIN_MATCH;
+    if (offset == 0 || offset > op || capacity - op < match) return false;
+    // byte by byte: a reference may overlap the bytes it produces
+    const char* from = dest + op - offset;
+    for (std::size_t k = 0; k < match; ++k) {
+      dest[op + k] = from[k];
+    }
+    op += match;
+  }
+  return op == capacity;
+}
+
+}
@@ -0,0 +1,46 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Compresses a block with a byte-oriented LZ77 codec laid out like LZ4's
+ * block format: sequences of a token, literal bytes and a back reference of
+ * up to 64KiB.  Runs of equal bytes, such as the zero fill of a page's free
+ * space, shrink to a few bytes.
+ *
+ * @param source    Bytes to compress.
+ * @param length    Number of bytes.
+ * @param dest      Receives the compressed bytes.
+ * @param capacity  Size of <dest>.
+ * @return  Number of compressed bytes, or 0 if they do not fit in <capacity>.
+ */
+std::size_t compressBlock(const char* source, std::size_t length, char* dest,
+                          std::size_t capacity);
+
+/**
+ * Reverses compressBlock().
+ *
+ * @param source    Compressed bytes.
+ * @param length    Number of compressed bytes.
+ * @param dest      Receives the original bytes.
+ * @param capacity  Number of original bytes.
+ * @return  False if the input is damaged or does not expand to exactly
+ *          <capacity> bytes.
+ */
+bool decompressBlock(const char* source, std::size_t length, char* dest,
+                     std::size_t capacity);
+
+}
@@ -0,0 +1,76 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pageGuard.h"
+#include "buffer.h"
+
+namespace badgerdb {
+
+PageGuard::PageGuard()
+  : pool(NULL), file(NULL), pageNumber(Page::INVALID_NUMBER), frameNo(0),
+    page(NULL), dirty(false)
+{
+}
+
+PageGuard::PageGuard(BufMgr* bufMgr, File* filePtr, const PageId pageNo,
+                     const FrameId frame, Page* pinned)
+  : pool(bufMgr), file(filePtr), pageNumber(pageNo), frameNo(frame),
+    page(pinned), dirty(false)
+{
+}
+
+PageGuard::PageGuard(PageGuard&& other)
+  : pool(other.pool), file(other.file), pageNumber(other.pageNumber),
+    frameNo(other.frameNo), page(other.page), dirty(other.dirty)
+{
+  other.pool = NULL;
+  other.page = NULL;
+  other.dirty = false;
+}
+
+PageGuard& PageGuard::operator=(PageGuard&& other)
+{
+  if (this != &other) {
+    release();
+    pool = other.pool;
+    file = other.file;
+    pageNumber = other.pageNumber;
+    frameNo = other.frameNo;
+    page = other.page;
+    dirty = other.dirty;
+    other.pool = NULL;
+    other.page = NULL;
+    other.dirty = false;
+  }
+  return *this;
+}
+
+PageGuard::~PageGuard()
+{
+  try {
+    release();
+  } catch (...) {
+  }
+}
+
+void PageGuard::release()
+{
+  if (pool == NULL) {
+    return;
+  }
+  BufMgr* const holder = pool;
+  const bool wasDirty = dirty;
+  pool = NULL;
+  page = NULL;
+  dirty = false;
+  holder->releaseFrame(file, frameNo, wasDirty);
+}
+
+}
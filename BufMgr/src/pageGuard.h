@@ -0,0 +1,144 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+class File;
+
+/**
+* @brief A pin on a page in the buffer pool, given back when the guard goes
+*
+* BufMgr::readPage() and BufMgr::allocPage() return a guard instead of filling
+* in a Page pointer.  The guard knows the frame it pinned, so it unpins it
+* without looking the page up again.  Guards can be moved but not copied; a
+* moved-from guard holds no pin.
+*/
+class PageGuard
+{
+ public:
+	/**
+   * Creates a guard that holds no pin.
+	 */
+  PageGuard();
+
+	/**
+   * Takes over the pin of another guard.
+   *
+   * @param other  Guard to take the pin from; it holds none afterwards
+	 */
+  PageGuard(PageGuard&& other);
+
+	/**
+   * Gives back the pin held, if any, then takes over the pin of another guard.
+   *
+   * @param other  Guard to take the pin from; it holds none afterwards
+   * @return  This guard
+	 */
+  PageGuard& operator=(PageGuard&& other);
+
+  PageGuard(const PageGuard&) = delete;
+  PageGuard& operator=(const PageGuard&) = delete;
+
+	/**
+   * Gives back the pin held, if any.  Errors writing the log are lost; call
+   * release() to see them.
+	 */
+  ~PageGuard();
+
+	/**
+   * Unpins the page, dirty if markDirty() was called.  Does nothing if the
+   * guard holds no pin.
+   *
+   * @throws  IoException If the page is dirty and logging it fails; the page
+   *          is unpinned all the same
+	 */
+  void release();
+
+	/**
+   * Marks the page dirty.  The frame's dirty bit is set, and the page
+   * logged, when the pin is given back, so the change must be complete by
+   * then.
+	 */
+  void markDirty() { dirty = true; }
+
+	/**
+   * @return  Whether the guard holds a pin
+	 */
+  explicit operator bool() const { return page != NULL; }
+
+	/**
+   * @return  The pinned page, or NULL if the guard holds no pin
+	 */
+  Page* get() const { return page; }
+
+  Page* operator->() const { return page; }
+  Page& operator*() const { return *page; }
+
+	/**
+   * @return  Number of the pinned page in its file
+	 */
+  PageId pageNo() const { return pageNumber; }
+
+	/**
+   * @return  Frame holding the pinned page
+	 */
+  FrameId frame() const { return frameNo; }
+
+ private:
+  friend class BufMgr;
+  friend class BufPoolSet;
+  friend class PageRead;
+
+	/**
+   * Guards a pin BufMgr has just taken.
+	 */
+  PageGuard(BufMgr* pool, File* file, const PageId pageNo, const FrameId frame,
+            Page* page);
+
+	/**
+   * Pool the pin is held in, NULL if none is held
+	 */
+  BufMgr* pool;
+
+	/**
+   * File of the pinned page
+	 */
+  File* file;
+
+	/**
+   * Number of the pinned page in its file
+	 */
+  PageId pageNumber;
+
+	/**
+   * Frame holding the pinned page
+	 */
+  FrameId frameNo;
+
+	/**
+   * The pinned page
+	 */
+  Page* page;
+
+	/**
+   * Whether the page is to be unpinned dirty
+	 */
+  bool dirty;
+};
+
+}
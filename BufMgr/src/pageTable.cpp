@@ -0,0 +1,38 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pageTable.h"
+#include "exceptions/hash_already_present_exception.h"
+#include "exceptions/hash_not_found_exception.h"
+
+namespace badgerdb {
+
+void PageTable::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  if (!tryInsert(file, pageNo, frameNo)) {
+    FrameId existing = 0;
+    tryLookup(file, pageNo, existing);
+    throw HashAlreadyPresentException(file->filename(), pageNo, existing);
+  }
+}
+
+void PageTable::lookup(const File* file, const PageId pageNo, FrameId &frameNo)
+{
+  if (!tryLookup(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+void PageTable::remove(const File* file, const PageId pageNo)
+{
+  if (!tryRemove(file, pageNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+}
@@ -0,0 +1,117 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+* @brief Interface of the tables mapping (File, page) to a buffer pool frame
+*
+* Implementations must make every method atomic with respect to the others, so
+* that BufMgr can use a table from several threads without further locking.
+* The try* methods are the primitives; the throwing variants are provided on
+* top of them for callers that treat a miss as an error.  Files are known by
+* File::id(), so every File object open on a file finds the same entries.
+*/
+class PageTable
+{
+ public:
+	/**
+   * Destructor of PageTable class
+	 */
+  virtual ~PageTable() {}
+
+	/**
+   * Insert entry into the table mapping (file, pageNo) to frameNo unless the
+   * page already has an entry.  Never throws on a duplicate.
+	 *
+	 * @param file   	File object
+	 * @param pageNo 	Page number in the file
+	 * @param frameNo Frame number assigned to that page of the file
+   * @return  			False if the page already exists in the table.
+	 */
+  virtual bool tryInsert(const File* file, const PageId pageNo, const FrameId frameNo) = 0;
+
+	/**
+   * Check if (file, pageNo) is currently in the table.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, only written when found
+   * @return  			True if the page entry is in the table.
+	 */
+  virtual bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo) = 0;
+
+	/**
+   * Delete entry (file,pageNo) from the table if present.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+   * @return  			True if an entry was removed.
+	 */
+  virtual bool tryRemove(const File* file, const PageId pageNo) = 0;
+
+	/**
+   * Point the entry of (file, pageNo) at another frame if it is at the given
+   * one, e.g. to install a new version of a page in place of the old.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param from    Frame the entry must be at
+	 * @param to      Frame it is moved to
+   * @return  			False, changing nothing, if the page has no entry at <from>.
+	 */
+  virtual bool tryReplace(const File* file, const PageId pageNo, const FrameId from,
+                          const FrameId to) = 0;
+
+	/**
+   * Make room for the given number of entries, e.g. after the pool has grown,
+   * so that inserts up to that number do not have to.  Each shard is rehashed
+   * on its own under its latch, while the others stay usable.
+	 *
+	 * @param entries Expected maximum number of entries (the number of frames)
+	 */
+  virtual void reserve(const std::uint32_t entries) = 0;
+
+	/**
+   * Insert entry into the table mapping (file, pageNo) to frameNo.
+	 *
+	 * @param file   	File object
+	 * @param pageNo 	Page number in the file
+	 * @param frameNo Frame number assigned to that page of the file
+   * @throws  HashAlreadyPresentException	if the corresponding page already exists in the table
+	 */
+  void insert(const File* file, const PageId pageNo, const FrameId frameNo);
+
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in
+   * the table).
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference
+   * @throws HashNotFoundException if the page entry is not found in the table
+	 */
+  void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
+
+	/**
+   * Delete entry (file,pageNo) from the table.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+   * @throws HashNotFoundException if the page entry is not found in the table
+	 */
+  void remove(const File* file, const PageId pageNo);
+};
+
+}
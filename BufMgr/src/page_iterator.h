@@ -104,6 +104,24 @@ class PageIterator {
 		return page_->getRecord(current_record_); 
 	}
 
+  /**
+   * Returns the current record in place on the page, without copying it.  The
+   * view is valid as long as the page is unchanged (and, for a buffer pool
+   * page, pinned).
+   *
+   * @return  Record in page.
+   */
+	inline std::string_view record() const {
+		return page_->getRecordView(current_record_);
+	}
+
+  /**
+   * Returns the ID of the current record.
+   */
+	inline const RecordId& recordId() const {
+		return current_record_;
+	}
+
   /**
    * Returns the next used slot in the page after the given slot or
    * Page::INVALID_SLOT if no slots are used after the given slot.
@@ -113,7 +131,7 @@ class PageIterator {
    */
   SlotId getNextUsedSlot(const SlotId start) const {
     SlotId slot_number = Page::INVALID_SLOT;
-    for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
+    for (SlotId i = start + 1; i <= page_->header_->num_slots; ++i) {
       const PageSlot* slot = page_->getSlot(i);
       if (slot->used) {
         slot_number = i;
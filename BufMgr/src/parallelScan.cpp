@@ -0,0 +1,184 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+#include "parallelScan.h"
+#include "page_iterator.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+const std::uint32_t ParallelScan::MORSEL;
+
+ParallelScan::ParallelScan(BufMgr* bufMgr, File* file, const std::uint32_t workers,
+                           const std::uint32_t morsel)
+	: bufMgr(bufMgr),
+	  file(file),
+	  morsel(std::max<std::uint32_t>(morsel, 1)),
+	  stopped(false)
+{
+  std::uint32_t count = workers;
+  if (count == 0) {
+    count = std::max<std::uint32_t>(std::thread::hardware_concurrency(), 1);
+  }
+  for (std::uint32_t i = 0; i < count; i++) {
+    ranges.emplace_back(new Range);
+  }
+}
+
+bool ParallelScan::takeMorsel(Range& range, PageId& first, PageId& last,
+                              PageId& ahead)
+{
+  std::lock_guard<std::mutex> guard(range.latch);
+  if (range.next >= range.end) {
+    return false;
+  }
+  first = range.next;
+  last = std::min<PageId>(range.end, first + morsel);
+  ahead = std::min<PageId>(range.end, last + morsel);
+  range.next = last;
+  return true;
+}
+
+bool ParallelScan::steal(const std::uint32_t worker)
+{
+  // the largest range has the most to give; it may have shrunk by the time
+  // it is latched, so look again if it is empty then
+  for (;;) {
+    std::uint32_t victim = worker;
+    PageId most = 0;
+    for (std::uint32_t i = 0; i < ranges.size(); i++) {
+      if (i == worker) {
+        continue;
+      }
+      std::lock_guard<std::mutex> guard(ranges[i]->latch);
+      if (ranges[i]->end > ranges[i]->next && ranges[i]->end - ranges[i]->next > most) {
+        most = ranges[i]->end - ranges[i]->next;
+        victim = i;
+      }
+    }
+    if (victim == worker) {
+      return false;
+    }
+    PageId first;
+    PageId end;
+    {
+      std::lock_guard<std::mutex> guard(ranges[victim]->latch);
+      Range& range = *ranges[victim];
+      if (range.next >= range.end) {
+        continue;
+      }
+      // the victim keeps the front, whose pages it may be reading ahead
+      first = range.next + (range.end - range.next) / 2;
+      end = range.end;
+      range.end = first;
+    }
+    std::lock_guard<std::mutex> guard(ranges[worker]->latch);
+    ranges[worker]->next = first;
+    ranges[worker]->end = end;
+    return true;
+  }
+}
+
+void ParallelScan::runWorker(const std::uint32_t worker, const Consumer& consumer,
+                             ScanStats& stats)
+{
+  Range& own = *ranges[worker];
+  PageId first;
+  PageId last;
+  PageId ahead;
+  for (;;) {
+    if (!takeMorsel(own, first, last, ahead)) {
+      if (!steal(worker)) {
+        return;
+      }
+      stats.steals++;
+      continue;
+    }
+    // pages already in the pool, such as those of the morsel read ahead
+    // last time, are skipped
+    bufMgr->prefetch(file, first, ahead - first);
+    for (PageId pageNo = first; pageNo < last; pageNo++) {
+      if (stopped.load(std::memory_order_relaxed)) {
+        return;
+      }
+      // the guard gives the pin back by frame, as a writer may install a
+      // newer version of the page meanwhile
+      PageGuard page;
+      try {
+        page = bufMgr->readPage(file, pageNo);
+      }
+      catch (InvalidPageException&) {
+        // not in use
+        continue;
+      }
+      for (PageIterator it = page->begin(); it != page->end(); ++it) {
+        consumer(worker, it.recordId(), it.record());
+        stats.records++;
+        if (stopped.load(std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      page.release();
+      stats.pages++;
+    }
+  }
+}
+
+ScanStats ParallelScan::run(const Consumer& consumer)
+{
+  // page 0 holds the file header
+  const PageId pages = file->numPages();
+  const PageId used = pages > 1 ? pages - 1 : 0;
+  const std::uint32_t count = workers();
+  for (std::uint32_t i = 0; i < count; i++) {
+    ranges[i]->next = static_cast<PageId>(1 + static_cast<std::uint64_t>(used) * i / count);
+    ranges[i]->end = static_cast<PageId>(1 + static_cast<std::uint64_t>(used) * (i + 1) / count);
+  }
+  stopped = false;
+
+  std::vector<ScanStats> stats(count, ScanStats{0, 0, 0});
+  std::vector<std::exception_ptr> errors(count);
+  auto work = [&](const std::uint32_t worker) {
+    try {
+      runWorker(worker, consumer, stats[worker]);
+    }
+    catch (...) {
+      errors[worker] = std::current_exception();
+      stopped = true;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (std::uint32_t i = 1; i < count; i++) {
+    threads.emplace_back(work, i);
+  }
+  work(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (const std::exception_ptr& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  ScanStats total = {0, 0, 0};
+  for (const ScanStats& worker : stats) {
+    total.records += worker.records;
+    total.pages += worker.pages;
+    total.steals += worker.steals;
+  }
+  return total;
+}
+
+}
@@ -0,0 +1,171 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+* @brief Totals of a ParallelScan::run()
+*/
+struct ScanStats
+{
+	/**
+   * Number of records delivered to the consumer
+	 */
+  std::uint64_t records;
+
+	/**
+   * Number of pages in use that were scanned
+	 */
+  std::uint64_t pages;
+
+	/**
+   * Number of times a worker out of pages took half of another's
+	 */
+  std::uint64_t steals;
+};
+
+
+/**
+* @brief Scan of every record of a file by several threads, through a buffer
+* pool
+*
+* The file's pages are split into one range of consecutive pages per worker.
+* A worker takes MORSEL pages at a time from the front of its range, asking
+* the pool to read them and the morsel after them ahead, and pins each page with
+* readPage() while it hands the page's records to the consumer.  A worker whose
+* range is used up takes the back half of the largest range left, so that
+* workers slowed by their pages or their consumer are helped out until the
+* end.  Each page is scanned by exactly one worker, in no particular order
+* across workers.
+*
+* The records of a page are read while it is pinned and not latched: the scan
+* must not run together with changes to the records of the file's pages.
+* Pages freed before the scan reaches them are skipped.
+*/
+class ParallelScan
+{
+ public:
+	/**
+   * Called with the number of the worker calling, from 0 up to the number of
+   * workers, and a record together with its ID.  Calls with the same worker
+   * number come from the same thread, one after the other.  The view is
+   * valid for the duration of the call.
+	 */
+  typedef std::function<void(std::uint32_t worker, const RecordId& rid,
+                             std::string_view record)> Consumer;
+
+	/**
+   * Default number of pages a worker takes at a time
+	 */
+  static const std::uint32_t MORSEL = 16;
+
+	/**
+   * Prepares a scan of a file.
+   *
+   * @param bufMgr   Pool to read the pages through
+   * @param file     File to scan, open for as long as the scan
+   * @param workers  Number of threads, 0 for one per hardware thread
+   * @param morsel   Number of pages a worker takes at a time, at least 1
+	 */
+  ParallelScan(BufMgr* bufMgr, File* file, const std::uint32_t workers = 0,
+               const std::uint32_t morsel = MORSEL);
+
+	/**
+   * @return  Number of threads a run uses
+	 */
+  std::uint32_t workers() const { return static_cast<std::uint32_t>(ranges.size()); }
+
+	/**
+   * Scans the pages in use when the call is made.  The calling thread is
+   * worker 0; the others are started here and joined before returning.
+   *
+   * @param consumer  Receives every record
+   * @return  What the scan did
+   * @throws  Whatever the consumer or readPage() throws first.  The workers
+   *          stop at the next record, unpin their pages and are joined first.
+	 */
+  ScanStats run(const Consumer& consumer);
+
+ private:
+	/**
+   * Pages a worker has left, [next, end)
+	 */
+  struct Range
+  {
+    std::mutex latch;
+    PageId next;
+    PageId end;
+  };
+
+	/**
+   * Takes up to a morsel of pages from the front of a worker's range.
+   *
+   * @param range  The range
+   * @param first  Set to the first page taken
+   * @param last   Set to the page after the last one taken
+   * @param ahead  Set to the end of the morsel after, which stays in the range
+   * @return  False if the range is empty
+	 */
+  bool takeMorsel(Range& range, PageId& first, PageId& last, PageId& ahead);
+
+	/**
+   * Moves the back half of the largest other range into a worker's own,
+   * which is empty.
+   *
+   * @return  False if every range is empty
+	 */
+  bool steal(const std::uint32_t worker);
+
+	/**
+   * Loop of one worker: morsels of its range, then of stolen ones, until no
+   * range has pages left or the scan is stopped.
+	 */
+  void runWorker(const std::uint32_t worker, const Consumer& consumer,
+                 ScanStats& stats);
+
+	/**
+   * Pool the pages are read through
+	 */
+  BufMgr* bufMgr;
+
+	/**
+   * File scanned
+	 */
+  File* file;
+
+	/**
+   * Pages taken at a time
+	 */
+  std::uint32_t morsel;
+
+	/**
+   * Range of each worker
+	 */
+  std::vector<std::unique_ptr<Range> > ranges;
+
+	/**
+   * Set when a worker failed, so that the others stop
+	 */
+  std::atomic<bool> stopped;
+};
+
+}
@@ -0,0 +1,353 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "paxPage.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/page_type_exception.h"
+
+namespace badgerdb {
+
+const std::uint32_t PaxPage::MAX_COLUMNS;
+
+namespace {
+
+/**
+ * Start of the data area of a PAX page
+ */
+struct Directory {
+  std::uint32_t columns;
+  std::uint32_t capacity;
+  std::uint32_t rows;
+  std::uint32_t live_offset;
+};
+
+/**
+ * Place of a column, one per column after the Directory
+ */
+struct ColumnEntry {
+  std::uint32_t width;
+  std::uint32_t offset;
+};
+
+std::size_t roundUp(const std::size_t bytes) {
+  return (bytes + 7) & ~std::size_t(7);
+}
+
+/**
+ * Lays out <capacity> rows of a schema: sets the offset of each column and
+ * of the row bitmap, and returns the bytes used, which may exceed the data
+ * area.
+ */
+std::size_t layout(const std::vector<std::uint32_t>& widths, const std::size_t capacity,
+                   std::vector<ColumnEntry>& entries, std::size_t& live_offset) {
+  std::size_t end = roundUp(sizeof(Directory) + widths.size() * sizeof(ColumnEntry));
+  live_offset = end;
+  end += roundUp((capacity + 63) / 64 * 8);
+  entries.resize(widths.size());
+  for (std::size_t i = 0; i < widths.size(); i++) {
+    entries[i].width = widths[i];
+    entries[i].offset = static_cast<std::uint32_t>(end);
+    end += roundUp(widths[i] * capacity);
+  }
+  return end;
+}
+
+Directory& directoryOf(char* data) {
+  return *reinterpret_cast<Directory*>(data);
+}
+
+const Directory& directoryOf(const char* data) {
+  return *reinterpret_cast<const Directory*>(data);
+}
+
+const ColumnEntry& entryOf(const char* data, const std::uint32_t column) {
+  return reinterpret_cast<const ColumnEntry*>(data + sizeof(Directory))[column];
+}
+
+/**
+ * Sets bit k of <bits> for each of the <count> values of a column from row
+ * <first> on that passes <test>; a loop the compiler can vectorize.
+ */
+template <typename T, typename Test>
+std::uint64_t matchWord(const char* values, const std::uint32_t first,
+                        const std::uint32_t count, const T value, Test test) {
+  std::uint64_t bits = 0;
+  for (std::uint32_t k = 0; k < count; k++) {
+    T field;
+    std::memcpy(&field, values + (first + k) * sizeof(T), sizeof(T));
+    bits |= std::uint64_t(test(field, value)) << k;
+  }
+  return bits;
+}
+
+template <typename T>
+std::uint64_t matchWord(const char* values, const std::uint32_t first,
+                        const std::uint32_t count, const RecordPredicate& predicate) {
+  const T value = static_cast<T>(predicate.value);
+  switch (predicate.op) {
+    case RecordPredicate::EQ:
+      return matchWord(values, first, count, value, [](T a, T b) { return a == b; });
+    case RecordPredicate::NE:
+      return matchWord(values, first, count, value, [](T a, T b) { return a != b; });
+    case RecordPredicate::LT:
+      return matchWord(values, first, count, value, [](T a, T b) { return a < b; });
+    case RecordPredicate::LE:
+      return matchWord(values, first, count, value, [](T a, T b) { return a <= b; });
+    case RecordPredicate::GT:
+      return matchWord(values, first, count, value, [](T a, T b) { return a > b; });
+    default:
+      return matchWord(values, first, count, value, [](T a, T b) { return a >= b; });
+  }
+}
+
+}
+
+std::uint32_t PaxPage::capacityOf(const std::vector<std::uint32_t>& widths)
+{
+  if (widths.empty() || widths.size() > MAX_COLUMNS) {
+    return 0;
+  }
+  std::size_t row = 0;
+  for (std::uint32_t width : widths) {
+    if (width == 0) {
+      return 0;
+    }
+    row += width;
+  }
+  // a row takes its bytes and a bit; rounding in the layout may take a few
+  // rows off that
+  std::vector<ColumnEntry> entries;
+  std::size_t live_offset;
+  std::size_t capacity = Page::DATA_SIZE * 8 / (row * 8 + 1);
+  while (capacity > 0 && layout(widths, capacity, entries, live_offset) > Page::DATA_SIZE) {
+    capacity--;
+  }
+  return static_cast<std::uint32_t>(capacity);
+}
+
+PaxPage PaxPage::format(Page* page, const std::vector<std::uint32_t>& widths)
+{
+  const std::uint32_t capacity = capacityOf(widths);
+  if (capacity == 0) {
+    std::size_t row = 0;
+    for (std::uint32_t width : widths) {
+      row += width;
+    }
+    throw InsufficientSpaceException(page->page_number(), row, Page::DATA_SIZE);
+  }
+  std::vector<ColumnEntry> entries;
+  std::size_t live_offset;
+  layout(widths, capacity, entries, live_offset);
+
+  page->initializeAs(PAX);
+  Directory& directory = directoryOf(page->data_);
+  directory.columns = static_cast<std::uint32_t>(widths.size());
+  directory.capacity = capacity;
+  directory.rows = 0;
+  directory.live_offset = static_cast<std::uint32_t>(live_offset);
+  std::memcpy(page->data_ + sizeof(Directory), entries.data(),
+              entries.size() * sizeof(ColumnEntry));
+  return PaxPage(page);
+}
+
+bool PaxPage::isConsistent(const Page& page)
+{
+  if (page.header_->page_type != PAX || page.header_->num_slots != 0 ||
+      page.header_->free_space_upper_bound != 0) {
+    return false;
+  }
+  const char* data = page.data_;
+  const Directory& directory = directoryOf(data);
+  if (directory.columns == 0 || directory.columns > MAX_COLUMNS) {
+    return false;
+  }
+  std::vector<std::uint32_t> widths(directory.columns);
+  for (std::uint32_t i = 0; i < directory.columns; i++) {
+    widths[i] = entryOf(data, i).width;
+  }
+  // the layout must be the one format() gave the schema
+  if (directory.capacity != capacityOf(widths)) {
+    return false;
+  }
+  std::vector<ColumnEntry> entries;
+  std::size_t live_offset;
+  layout(widths, directory.capacity, entries, live_offset);
+  if (directory.live_offset != live_offset) {
+    return false;
+  }
+  for (std::uint32_t i = 0; i < directory.columns; i++) {
+    if (entryOf(data, i).offset != entries[i].offset) {
+      return false;
+    }
+  }
+  std::uint32_t live = 0;
+  const std::uint64_t* bits = reinterpret_cast<const std::uint64_t*>(data + live_offset);
+  for (std::uint32_t word = 0; word < (directory.capacity + 63) / 64; word++) {
+    std::uint64_t valid = ~std::uint64_t(0);
+    if ((word + 1) * 64 > directory.capacity) {
+      valid = (std::uint64_t(1) << (directory.capacity % 64)) - 1;
+    }
+    if ((bits[word] & ~valid) != 0) {
+      return false;
+    }
+    live += __builtin_popcountll(bits[word]);
+  }
+  return live == directory.rows;
+}
+
+PaxPage::PaxPage(Page* page)
+	: page(page)
+{
+  if (page->header_->page_type != PAX) {
+    throw PageTypeException(page->page_number(), page->header_->page_type, PAX);
+  }
+}
+
+std::uint32_t PaxPage::columns() const
+{
+  return directoryOf(page->data_).columns;
+}
+
+std::uint32_t PaxPage::width(const std::uint32_t column) const
+{
+  return entryOf(page->data_, column).width;
+}
+
+std::uint32_t PaxPage::rowWidth() const
+{
+  std::uint32_t total = 0;
+  for (std::uint32_t i = 0; i < columns(); i++) {
+    total += width(i);
+  }
+  return total;
+}
+
+std::uint32_t PaxPage::capacity() const
+{
+  return directoryOf(page->data_).capacity;
+}
+
+std::uint32_t PaxPage::rows() const
+{
+  return directoryOf(page->data_).rows;
+}
+
+const char* PaxPage::columnData(const std::uint32_t column) const
+{
+  return page->data_ + entryOf(page->data_, column).offset;
+}
+
+bool PaxPage::isLive(const std::uint32_t row) const
+{
+  const Directory& directory = directoryOf(page->data_);
+  const std::uint64_t* bits =
+      reinterpret_cast<const std::uint64_t*>(page->data_ + directory.live_offset);
+  return row < directory.capacity && ((bits[row / 64] >> (row % 64)) & 1) != 0;
+}
+
+std::uint32_t PaxPage::rowOf(const RecordId& rid) const
+{
+  if (rid.page_number != page->page_number() || rid.slot_number == Page::INVALID_SLOT ||
+      !isLive(rid.slot_number - 1)) {
+    throw InvalidRecordException(rid, page->page_number());
+  }
+  return rid.slot_number - 1;
+}
+
+RecordId PaxPage::insertRow(std::string_view row)
+{
+  Directory& directory = directoryOf(page->data_);
+  if (row.size() != rowWidth()) {
+    throw InvalidRecordException(RecordId{page->page_number(), Page::INVALID_SLOT},
+                                 page->page_number());
+  }
+  if (directory.rows == directory.capacity) {
+    throw InsufficientSpaceException(page->page_number(), row.size(), 0);
+  }
+  // the lowest row number not in use
+  std::uint64_t* bits = reinterpret_cast<std::uint64_t*>(page->data_ + directory.live_offset);
+  std::uint32_t word = 0;
+  while (bits[word] == ~std::uint64_t(0)) {
+    word++;
+  }
+  const std::uint32_t number = word * 64 + __builtin_ctzll(~bits[word]);
+  bits[word] |= std::uint64_t(1) << (number % 64);
+  directory.rows++;
+  const char* next = row.data();
+  for (std::uint32_t i = 0; i < directory.columns; i++) {
+    const ColumnEntry& entry = entryOf(page->data_, i);
+    std::memcpy(page->data_ + entry.offset + std::size_t(number) * entry.width, next,
+                entry.width);
+    next += entry.width;
+  }
+  return RecordId{page->page_number(), static_cast<SlotId>(number + 1)};
+}
+
+void PaxPage::deleteRow(const RecordId& rid)
+{
+  const std::uint32_t row = rowOf(rid);
+  Directory& directory = directoryOf(page->data_);
+  std::uint64_t* bits = reinterpret_cast<std::uint64_t*>(page->data_ + directory.live_offset);
+  bits[row / 64] &= ~(std::uint64_t(1) << (row % 64));
+  directory.rows--;
+}
+
+std::string PaxPage::getRow(const RecordId& rid) const
+{
+  const std::uint32_t row = rowOf(rid);
+  std::string bytes;
+  bytes.reserve(rowWidth());
+  for (std::uint32_t i = 0; i < columns(); i++) {
+    bytes.append(columnData(i) + std::size_t(row) * width(i), width(i));
+  }
+  return bytes;
+}
+
+std::string_view PaxPage::getValue(const RecordId& rid, const std::uint32_t column) const
+{
+  const std::uint32_t row = rowOf(rid);
+  return std::string_view(columnData(column) + std::size_t(row) * width(column), width(column));
+}
+
+std::size_t PaxPage::filterColumn(const std::uint32_t column, const RecordPredicate& predicate,
+                                  std::vector<RecordId>& matches) const
+{
+  if (predicate.op == RecordPredicate::PREFIX || predicate.width != width(column) ||
+      (predicate.width != 4 && predicate.width != 8)) {
+    throw InvalidRecordException(RecordId{page->page_number(), Page::INVALID_SLOT},
+                                 page->page_number());
+  }
+  const Directory& directory = directoryOf(page->data_);
+  const std::uint64_t* live =
+      reinterpret_cast<const std::uint64_t*>(page->data_ + directory.live_offset);
+  const char* values = columnData(column);
+  std::size_t count = 0;
+  for (std::uint32_t first = 0; first < directory.capacity; first += 64) {
+    if (live[first / 64] == 0) {
+      continue;
+    }
+    const std::uint32_t n = std::min<std::uint32_t>(64, directory.capacity - first);
+    std::uint64_t bits = predicate.width == 4
+        ? matchWord<std::int32_t>(values, first, n, predicate)
+        : matchWord<std::int64_t>(values, first, n, predicate);
+    for (bits &= live[first / 64]; bits != 0; bits &= bits - 1) {
+      matches.push_back({page->page_number(),
+                         static_cast<SlotId>(first + __builtin_ctzll(bits) + 1)});
+      count++;
+    }
+  }
+  return count;
+}
+
+}
@@ -0,0 +1,197 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+* @brief View of a page in the PAX layout: rows of a fixed schema of
+* fixed-width columns, stored column by column
+*
+* The data area starts with a directory giving the width and place of each
+* column, followed by a bitmap of the rows in use and then one mini-page per
+* column holding that column's value of every row, each mini-page starting on
+* an eight byte boundary.  A scan reading some columns only touches those
+* columns' bytes, and a column of integers is an array it can compare in a
+* tight loop.  A row is known by a RecordId whose slot number is its row
+* number plus one; rows keep their number until deleted, and the numbers of
+* deleted rows are reused.
+*
+* The page header, its number, LSN and checksum included, is the one every
+* page has, with page_type PAX, so that File and BufMgr read, write, log and
+* check PAX pages as they do any other.  Page sees a PAX page as having no
+* records and no room for any.
+*
+* Like Page, not threadsafe.
+*/
+class PaxPage
+{
+ public:
+	/**
+   * Largest number of columns of a schema
+	 */
+  static const std::uint32_t MAX_COLUMNS = 64;
+
+	/**
+   * Returns the number of rows of a schema one page holds.
+   *
+   * @param widths  Width in bytes of each column
+   * @return  Rows per page; zero if the schema is empty, has a column of
+   *          width zero or more than MAX_COLUMNS columns, or a row does not
+   *          fit
+	 */
+  static std::uint32_t capacityOf(const std::vector<std::uint32_t>& widths);
+
+	/**
+   * Turns a page, such as one just allocated, into an empty PAX page of a
+   * schema, keeping its number.  Any records on it are lost.
+   *
+   * @param page    The page
+   * @param widths  Width in bytes of each column
+   * @return  View of the page
+   * @throws  InsufficientSpaceException If no row of the schema fits a page
+	 */
+  static PaxPage format(Page* page, const std::vector<std::uint32_t>& widths);
+
+	/**
+   * Returns true if a page is a PAX page whose directory and row counts are
+   * in order, so that reading its rows stays within the page.
+   *
+   * @param page  The page
+	 */
+  static bool isConsistent(const Page& page);
+
+	/**
+   * Views a PAX page.
+   *
+   * @param page  The page, which must outlive the view
+   * @throws  PageTypeException If the page is not a PAX page
+	 */
+  explicit PaxPage(Page* page);
+
+	/**
+   * @return  Number of columns
+	 */
+  std::uint32_t columns() const;
+
+	/**
+   * @param column  Column number, from 0
+   * @return  Width of the column in bytes
+	 */
+  std::uint32_t width(const std::uint32_t column) const;
+
+	/**
+   * @return  Bytes of a whole row, all columns together
+	 */
+  std::uint32_t rowWidth() const;
+
+	/**
+   * @return  Number of rows the page holds when full
+	 */
+  std::uint32_t capacity() const;
+
+	/**
+   * @return  Number of rows in use
+	 */
+  std::uint32_t rows() const;
+
+	/**
+   * @return  Whether every row is in use
+	 */
+  bool isFull() const { return rows() == capacity(); }
+
+	/**
+   * Adds a row.
+   *
+   * @param row  The row's column values one after the other, rowWidth()
+   *             bytes in all
+   * @return  ID of the row
+   * @throws  InsufficientSpaceException If the page is full
+   * @throws  InvalidRecordException If the row is not rowWidth() bytes
+	 */
+  RecordId insertRow(std::string_view row);
+
+	/**
+   * Deletes a row.
+   *
+   * @param rid  ID of the row
+   * @throws  InvalidRecordException If the row is not in use
+	 */
+  void deleteRow(const RecordId& rid);
+
+	/**
+   * Returns a row with its column values one after the other.
+   *
+   * @param rid  ID of the row
+   * @throws  InvalidRecordException If the row is not in use
+	 */
+  std::string getRow(const RecordId& rid) const;
+
+	/**
+   * Returns one column value of a row in place on the page.
+   *
+   * @param rid     ID of the row
+   * @param column  Column number
+   * @throws  InvalidRecordException If the row is not in use
+	 */
+  std::string_view getValue(const RecordId& rid, const std::uint32_t column) const;
+
+	/**
+   * Returns the mini-page of a column: width(column) bytes for every row
+   * number up to capacity(), rows not in use included.
+   *
+   * @param column  Column number
+	 */
+  const char* columnData(const std::uint32_t column) const;
+
+	/**
+   * Returns true if a row number is in use.
+   *
+   * @param row  Row number, from 0
+	 */
+  bool isLive(const std::uint32_t row) const;
+
+	/**
+   * Compares one integer column of every row in use with a value, reading
+   * only that column's mini-page.  The predicate's width must be the
+   * column's; its offset is ignored.
+   *
+   * @param column     Column number
+   * @param predicate  Comparison, other than PREFIX
+   * @param matches    Receives the IDs of the matching rows, in row order
+   * @return  Number of matching rows
+   * @throws  InvalidRecordException If the column is not as wide as the
+   *          predicate's field or the predicate is a PREFIX
+	 */
+  std::size_t filterColumn(const std::uint32_t column,
+                           const RecordPredicate& predicate,
+                           std::vector<RecordId>& matches) const;
+
+ private:
+	/**
+   * Returns the row number of an ID, checking that the row is in use.
+	 */
+  std::uint32_t rowOf(const RecordId& rid) const;
+
+	/**
+   * The page viewed
+	 */
+  Page* page;
+};
+
+}
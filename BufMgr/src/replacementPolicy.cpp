@@ -0,0 +1,122 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "replacementPolicy.h"
+
+namespace badgerdb {
+
+ClockPolicy::ClockPolicy(const std::uint32_t bufs)
+	: numBufs(bufs), clockHand(bufs - 1)
+{
+}
+
+FrameId ClockPolicy::advanceClock()
+{
+	FrameId hand = clockHand.load(std::memory_order_relaxed);
+	FrameId next;
+	const std::uint32_t bufs = numBufs.load(std::memory_order_relaxed);
+	do {
+		next = (hand + 1) % bufs;
+	} while (!clockHand.compare_exchange_weak(hand, next, std::memory_order_relaxed));
+	return next;
+}
+
+bool ClockPolicy::evict(const FrameClaim& claim, FrameId& frame)
+{
+  // The first rotation may do nothing but clear reference bits, so a victim is
+  // guaranteed to be found within two rotations if one exists at all
+  for (std::uint32_t steps = 0; steps < 2 * numBufs.load(std::memory_order_relaxed); steps++) {
+    FrameId hand = advanceClock();
+    if (claim(hand, true)) {
+      frame = hand;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockPolicy::victimOrder(std::vector<FrameId>& frames) const
+{
+  FrameId hand = clockHand.load(std::memory_order_relaxed);
+  const std::uint32_t bufs = numBufs.load(std::memory_order_relaxed);
+  for (std::uint32_t i = 0; i < bufs; i++) {
+    hand = (hand + 1) % bufs;
+    frames.push_back(hand);
+  }
+}
+
+void ClockPolicy::resize(const std::uint32_t frames)
+{
+  // a hand left beyond a shrunken pool wraps on its next step
+  numBufs.store(frames, std::memory_order_relaxed);
+}
+
+void GhostList::push(const PageKey& key)
+{
+  erase(key);
+  keys.push_back(key);
+  index[key] = std::prev(keys.end());
+}
+
+bool GhostList::erase(const PageKey& key)
+{
+  auto it = index.find(key);
+  if (it == index.end()) {
+    return false;
+  }
+  keys.erase(it->second);
+  index.erase(it);
+  return true;
+}
+
+void GhostList::popOldest()
+{
+  index.erase(keys.front());
+  keys.pop_front();
+}
+
+const int FrameLists::NONE;
+
+FrameLists::FrameLists(const std::uint32_t bufs, const int lists)
+	: lists(lists), where(bufs, NONE), position(bufs)
+{
+}
+
+void FrameLists::pushBack(const int list, const FrameId frame)
+{
+  erase(frame);
+  position[frame] = lists[list].insert(lists[list].end(), frame);
+  where[frame] = list;
+}
+
+void FrameLists::pushFront(const int list, const FrameId frame)
+{
+  erase(frame);
+  position[frame] = lists[list].insert(lists[list].begin(), frame);
+  where[frame] = list;
+}
+
+void FrameLists::resize(const std::uint32_t bufs)
+{
+  if (bufs > where.size()) {
+    where.resize(bufs, NONE);
+    position.resize(bufs);
+  }
+}
+
+void FrameLists::erase(const FrameId frame)
+{
+  if (where[frame] != NONE) {
+    lists[where[frame]].erase(position[frame]);
+    where[frame] = NONE;
+  }
+}
+
+}
@@ -0,0 +1,287 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+* @brief Callback through which a policy asks BufMgr to take a frame as victim
+*
+* Returns true if the frame was free or its page could be evicted, in which
+* case the frame is now empty and reserved for the caller.  Returns false if
+* the frame is pinned or latched by another thread.  With secondChance set, a
+* frame whose reference bit is set is refused as well, after clearing the bit.
+*/
+typedef std::function<bool(FrameId frame, bool secondChance)> FrameClaim;
+
+/**
+* @brief Interface of the buffer pool replacement policies
+*
+* BufMgr reports every page it installs in a frame, every hit on a resident
+* page and every frame it empties, and asks the policy for a victim when it
+* needs a frame.  Implementations must be threadsafe.
+*/
+class ReplacementPolicy
+{
+ public:
+	/**
+   * Destructor of ReplacementPolicy class
+	 */
+  virtual ~ReplacementPolicy() {}
+
+	/**
+   * Pick a victim frame and claim it.  Frames are offered to <claim> from most
+   * to least preferred until one is accepted.
+	 *
+	 * @param claim   Callback that takes the frame, see FrameClaim
+	 * @param frame   Frame reference, the claimed frame is returned via this variable
+   * @return  			False if no frame could be claimed.
+	 */
+  virtual bool evict(const FrameClaim& claim, FrameId& frame) = 0;
+
+	/**
+   * A page has been placed in a frame previously returned by evict().
+	 *
+	 * @param frame   Frame holding the page
+	 * @param file   	File object
+	 * @param pageNo 	Page number in the file
+	 * @param cold   	True if the page was read ahead rather than requested, so
+	 *              	it should not count as referenced
+	 */
+  virtual void installed(const FrameId frame, const File* file, const PageId pageNo,
+                         const bool cold) = 0;
+
+	/**
+   * A resident page has been pinned again.  The frame may have been
+   * reassigned since; policies must tolerate stale calls.
+	 *
+	 * @param frame   Frame that was hit
+	 */
+  virtual void accessed(const FrameId frame) = 0;
+
+	/**
+   * Several resident pages have been pinned again, as by accessed() for each
+   * frame in turn.  Policies with a latch take it once for all of them.
+	 *
+	 * @param frames  Frames that were hit
+	 */
+  virtual void accessedAll(const std::vector<FrameId>& frames) {
+    for (FrameId frame : frames) {
+      accessed(frame);
+    }
+  }
+
+	/**
+   * A frame has been emptied other than through evict(), or was returned
+   * unused after evict().
+	 *
+	 * @param frame   Frame that is now free
+	 */
+  virtual void removed(const FrameId frame) = 0;
+
+	/**
+   * List the frames in the order they would next be offered as victims, for
+   * the background writer to clean ahead of eviction.
+	 *
+	 * @param frames  Receives the frame numbers, most likely victim first
+	 */
+  virtual void victimOrder(std::vector<FrameId>& frames) const = 0;
+
+	/**
+   * The pool now has the given number of frames, see BufMgr::resize().  When
+   * it grows, the new frames are free.  When it shrinks, frames at or above
+   * the new size are no longer offered once they are free, and BufMgr
+   * empties the others and reports each through removed().
+	 *
+	 * @param frames  New number of frames
+	 */
+  virtual void resize(const std::uint32_t frames) = 0;
+};
+
+/**
+* @brief The clock algorithm, using the reference bit of each frame
+*
+* Lock free: the hand is advanced atomically, and a frame can only be claimed
+* by the thread holding its latch.
+*/
+class ClockPolicy : public ReplacementPolicy
+{
+ public:
+	/**
+   * Constructor of ClockPolicy class
+   *
+   * @param bufs   Number of frames in the buffer pool
+	 */
+  explicit ClockPolicy(const std::uint32_t bufs);
+
+  bool evict(const FrameClaim& claim, FrameId& frame) override;
+  void installed(const FrameId frame, const File* file, const PageId pageNo,
+                 const bool cold) override {}
+  void accessed(const FrameId frame) override {}
+  void accessedAll(const std::vector<FrameId>& frames) override {}
+  void removed(const FrameId frame) override {}
+  void victimOrder(std::vector<FrameId>& frames) const override;
+  void resize(const std::uint32_t frames) override;
+
+ private:
+	/**
+   * Advance clock to next frame in the buffer pool
+   *
+   * @return  The frame the clock hand now points at
+	 */
+  FrameId advanceClock();
+
+	/**
+   * Number of frames in the buffer pool
+	 */
+  std::atomic<std::uint32_t> numBufs;
+
+	/**
+   * Current position of clockhand in our buffer pool
+	 */
+  std::atomic<FrameId> clockHand;
+};
+
+/**
+* @brief Identity of a page, as remembered by policies with ghost lists
+*/
+typedef std::pair<FileId, PageId> PageKey;
+
+/**
+* @brief Hash function for PageKey
+*/
+struct PageKeyHash
+{
+  std::size_t operator()(const PageKey& key) const
+  {
+    return (std::size_t) key.first * 0x9e3779b97f4a7c15ULL + key.second;
+  }
+};
+
+/**
+* @brief Bounded FIFO of the identities of recently evicted pages
+*/
+class GhostList
+{
+ public:
+	/**
+   * Remember a page at the most recent end.
+	 */
+  void push(const PageKey& key);
+
+	/**
+   * Forget a page if present.
+   *
+   * @return  True if the page was in the list.
+	 */
+  bool erase(const PageKey& key);
+
+	/**
+   * Forget the least recently pushed page; the list must not be empty.
+	 */
+  void popOldest();
+
+	/**
+   * Returns true if the page is in the list.
+	 */
+  bool contains(const PageKey& key) const { return index.count(key) != 0; }
+
+	/**
+   * Number of pages in the list
+	 */
+  std::size_t size() const { return keys.size(); }
+
+ private:
+	/**
+   * Pages, least recently pushed first
+	 */
+  std::list<PageKey> keys;
+
+	/**
+   * Position of each page in keys
+	 */
+  std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash> index;
+};
+
+/**
+* @brief Ordered lists of frames with constant time moves between them
+*
+* Each frame is in at most one list.  Lists are kept least recently used at the
+* front; policies give each list a small integer id.
+*/
+class FrameLists
+{
+ public:
+	/**
+   * Id meaning "in no list"
+	 */
+  static const int NONE = -1;
+
+	/**
+   * Constructor of FrameLists class
+   *
+   * @param bufs   Number of frames
+   * @param lists  Number of lists
+	 */
+  FrameLists(const std::uint32_t bufs, const int lists);
+
+	/**
+   * Move a frame to the back (most recently used end) of a list.
+	 */
+  void pushBack(const int list, const FrameId frame);
+
+	/**
+   * Move a frame to the front (least recently used end) of a list.
+	 */
+  void pushFront(const int list, const FrameId frame);
+
+	/**
+   * Take a frame out of its list, if it is in one.
+	 */
+  void erase(const FrameId frame);
+
+	/**
+   * Make room for frames up to the given number; never shrinks.
+	 */
+  void resize(const std::uint32_t bufs);
+
+	/**
+   * Returns the list the frame is in, or NONE.
+	 */
+  int listOf(const FrameId frame) const { return where[frame]; }
+
+	/**
+   * Returns the frames of a list, least recently used first.
+	 */
+  const std::list<FrameId>& frames(const int list) const { return lists[list]; }
+
+	/**
+   * Number of frames in a list
+	 */
+  std::size_t size(const int list) const { return lists[list].size(); }
+
+ private:
+  std::vector<std::list<FrameId> > lists;
+  std::vector<int> where;
+  std::vector<std::list<FrameId>::iterator> position;
+};
+
+}
@@ -0,0 +1,186 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "residentList.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+const std::uint32_t ResidentList::MAGIC;
+
+namespace {
+
+/**
+ * Header of a resident list file
+ */
+struct ListHeader {
+  std::uint32_t magic;
+  std::uint32_t files;
+  std::uint64_t pages;
+};
+
+/**
+ * A page as stored: the flag is bit 0 of flags
+ */
+struct StoredPage {
+  std::uint32_t file;
+  std::uint32_t pageNo;
+  std::uint32_t flags;
+};
+
+void append(std::vector<char>& bytes, const void* data, const std::size_t length)
+{
+  const char* from = static_cast<const char*>(data);
+  bytes.insert(bytes.end(), from, from + length);
+}
+
+/**
+ * Copies <length> bytes at <offset> out of the list, which must hold them.
+ */
+void take(const std::string& path, const std::vector<char>& bytes, std::size_t& offset,
+          void* data, const std::size_t length)
+{
+  if (bytes.size() - offset < length) {
+    throw IoException(path, "read", EINVAL);
+  }
+  std::memcpy(data, bytes.data() + offset, length);
+  offset += length;
+}
+
+}
+
+std::uint32_t ResidentList::fileIndex(const std::string& name)
+{
+  for (std::size_t i = 0; i < files.size(); i++) {
+    if (files[i] == name) {
+      return static_cast<std::uint32_t>(i);
+    }
+  }
+  files.push_back(name);
+  return static_cast<std::uint32_t>(files.size() - 1);
+}
+
+void ResidentList::write(const std::string& path) const
+{
+  std::vector<char> bytes;
+  ListHeader header;
+  header.magic = MAGIC;
+  header.files = static_cast<std::uint32_t>(files.size());
+  header.pages = pages.size();
+  append(bytes, &header, sizeof(header));
+  for (const std::string& name : files) {
+    const std::uint32_t length = static_cast<std::uint32_t>(name.size());
+    append(bytes, &length, sizeof(length));
+    append(bytes, name.data(), name.size());
+  }
+  for (const ResidentPage& page : pages) {
+    StoredPage stored;
+    stored.file = page.file;
+    stored.pageNo = page.pageNo;
+    stored.flags = page.referenced ? 1 : 0;
+    append(bytes, &stored, sizeof(stored));
+  }
+
+  const std::string temporary = path + ".tmp";
+  const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw IoException(temporary, "open", errno);
+  }
+  const char* next = bytes.data();
+  std::size_t left = bytes.size();
+  while (left > 0) {
+    const ssize_t n = ::write(fd, next, left);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      const int error = errno;
+      ::close(fd);
+      throw IoException(temporary, "write", error);
+    }
+    next += n;
+    left -= n;
+  }
+  if (::fsync(fd) != 0) {
+    const int error = errno;
+    ::close(fd);
+    throw IoException(temporary, "fsync", error);
+  }
+  ::close(fd);
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    throw IoException(path, "rename", errno);
+  }
+}
+
+ResidentList ResidentList::read(const std::string& path)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw IoException(path, "open", errno);
+  }
+  std::vector<char> bytes;
+  char block[65536];
+  for (;;) {
+    const ssize_t n = ::read(fd, block, sizeof(block));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      const int error = errno;
+      ::close(fd);
+      throw IoException(path, "read", error);
+    }
+    if (n == 0) {
+      break;
+    }
+    bytes.insert(bytes.end(), block, block + n);
+  }
+  ::close(fd);
+
+  ResidentList list;
+  std::size_t offset = 0;
+  ListHeader header;
+  take(path, bytes, offset, &header, sizeof(header));
+  if (header.magic != MAGIC) {
+    throw IoException(path, "read", EINVAL);
+  }
+  for (std::uint32_t i = 0; i < header.files; i++) {
+    std::uint32_t length;
+    take(path, bytes, offset, &length, sizeof(length));
+    std::string name(length, '\0');
+    take(path, bytes, offset, &name[0], length);
+    list.files.push_back(name);
+  }
+  if ((bytes.size() - offset) / sizeof(StoredPage) < header.pages) {
+    throw IoException(path, "read", EINVAL);
+  }
+  list.pages.reserve(header.pages);
+  for (std::uint64_t i = 0; i < header.pages; i++) {
+    StoredPage stored;
+    take(path, bytes, offset, &stored, sizeof(stored));
+    if (stored.file >= list.files.size()) {
+      throw IoException(path, "read", EINVAL);
+    }
+    ResidentPage page;
+    page.file = stored.file;
+    page.pageNo = stored.pageNo;
+    page.referenced = (stored.flags & 1) != 0;
+    list.pages.push_back(page);
+  }
+  return list;
+}
+
+}
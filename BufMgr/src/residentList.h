@@ -0,0 +1,96 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+* @brief A page that was in the buffer pool, see ResidentList
+*/
+struct ResidentPage
+{
+	/**
+   * Index of the page's file in ResidentList::files
+	 */
+  std::uint32_t file;
+
+	/**
+   * Number of the page in its file
+	 */
+  PageId pageNo;
+
+	/**
+   * Whether the page had been referenced since the clock last passed it
+	 */
+  bool referenced;
+};
+
+
+/**
+* @brief The pages a buffer pool held, saved so that a restarted pool can
+* read them back; see BufMgrOptions::warmFile
+*
+* Files are named rather than identified, since FileIds do not outlive the
+* File objects.  On disk the list is a header, the file names and then one
+* fixed-size record per page; it is written to a temporary file first and
+* renamed over the old list, so a crash leaves one list or the other.
+*/
+struct ResidentList
+{
+	/**
+   * Names of the files the pages belong to
+	 */
+  std::vector<std::string> files;
+
+	/**
+   * The pages, hottest first
+	 */
+  std::vector<ResidentPage> pages;
+
+	/**
+   * Returns the index of a file in files, adding it if it is not there.
+   *
+   * @param name  File name
+   * @return  Index of the file
+	 */
+  std::uint32_t fileIndex(const std::string& name);
+
+	/**
+   * Writes the list, replacing the file of that name.
+   *
+   * @param path  File to write
+   * @throws  IoException If the file cannot be written
+	 */
+  void write(const std::string& path) const;
+
+	/**
+   * Reads a list written by write().
+   *
+   * @param path  File to read
+   * @return  The list
+   * @throws  IoException If the file cannot be read or is not such a list
+	 */
+  static ResidentList read(const std::string& path);
+
+ private:
+	/**
+   * Identifies a resident list file, "WARM" in little endian
+	 */
+  static const std::uint32_t MAGIC = 0x4d524157;
+};
+
+}
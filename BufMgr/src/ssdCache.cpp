@@ -0,0 +1,159 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "ssdCache.h"
+#include "page.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Key of an empty slot
+ */
+const PageKey EMPTY(0, PageId(Page::INVALID_NUMBER));
+
+}
+
+SsdCache::SsdCache(const std::string& filename, const std::uint32_t pages)
+	: filename(filename),
+	  store(filename, true /* create */, true /* direct */),
+	  slots(std::max<std::uint32_t>(pages, 1), EMPTY),
+	  hand(0)
+{
+  for (std::uint32_t slot = static_cast<std::uint32_t>(slots.size()); slot > 0; slot--) {
+    unused.push_back(slot - 1);
+  }
+  clearStats();
+}
+
+SsdCache::~SsdCache()
+{
+  std::remove(filename.c_str());
+}
+
+std::uint32_t SsdCache::claimSlot()
+{
+  if (!unused.empty()) {
+    const std::uint32_t slot = unused.back();
+    unused.pop_back();
+    return slot;
+  }
+  const std::uint32_t slot = hand;
+  hand = (hand + 1) % slots.size();
+  index.erase(slots[slot]);
+  return slot;
+}
+
+bool SsdCache::take(const File* file, const PageId pageNo, char* bytes)
+{
+  const PageKey key(file->id(), pageNo);
+  std::lock_guard<std::mutex> guard(latch);
+  auto it = index.find(key);
+  if (it == index.end()) {
+    counters.misses++;
+    return false;
+  }
+  const std::uint32_t slot = it->second;
+  index.erase(it);
+  slots[slot] = EMPTY;
+  unused.push_back(slot);
+  store.read(static_cast<std::uint64_t>(slot) * Page::SIZE, bytes, Page::SIZE);
+  // a page that came back is worth keeping when it is evicted again
+  ghosts.push(key);
+  while (ghosts.size() > slots.size()) {
+    ghosts.popOldest();
+  }
+  counters.hits++;
+  return true;
+}
+
+void SsdCache::offer(const File* file, const PageId pageNo, const char* bytes,
+                     const bool reused)
+{
+  const PageKey key(file->id(), pageNo);
+  std::lock_guard<std::mutex> guard(latch);
+  auto it = index.find(key);
+  if (!reused && !ghosts.contains(key)) {
+    if (it != index.end()) {
+      slots[it->second] = EMPTY;
+      unused.push_back(it->second);
+      index.erase(it);
+    }
+    ghosts.push(key);
+    while (ghosts.size() > slots.size()) {
+      ghosts.popOldest();
+    }
+    counters.rejections++;
+    return;
+  }
+  ghosts.erase(key);
+  std::uint32_t slot;
+  if (it != index.end()) {
+    slot = it->second;
+    index.erase(it);
+  } else {
+    slot = claimSlot();
+  }
+  slots[slot] = EMPTY;
+  try {
+    store.write(static_cast<std::uint64_t>(slot) * Page::SIZE, bytes, Page::SIZE);
+  } catch (...) {
+    unused.push_back(slot);
+    throw;
+  }
+  slots[slot] = key;
+  index[key] = slot;
+  counters.admissions++;
+}
+
+void SsdCache::erase(const File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  auto it = index.find(PageKey(file->id(), pageNo));
+  if (it == index.end()) {
+    return;
+  }
+  slots[it->second] = EMPTY;
+  unused.push_back(it->second);
+  index.erase(it);
+}
+
+void SsdCache::eraseFile(const File* file)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  for (std::uint32_t slot = 0; slot < slots.size(); slot++) {
+    if (slots[slot].first == file->id()) {
+      index.erase(slots[slot]);
+      slots[slot] = EMPTY;
+      unused.push_back(slot);
+    }
+  }
+}
+
+SsdCacheStats SsdCache::stats() const
+{
+  std::lock_guard<std::mutex> guard(latch);
+  return counters;
+}
+
+void SsdCache::clearStats()
+{
+  std::lock_guard<std::mutex> guard(latch);
+  counters.hits = 0;
+  counters.misses = 0;
+  counters.admissions = 0;
+  counters.rejections = 0;
+}
+
+}
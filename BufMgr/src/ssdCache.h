@@ -0,0 +1,192 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "replacementPolicy.h"
+#include "storage_backend.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+
+/**
+* @brief Counters of an SsdCache, see BufStats
+*/
+struct SsdCacheStats
+{
+	/**
+   * Number of pages found in the cache, read from it instead of their file
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Number of pages looked for in the cache and not found
+	 */
+  std::uint64_t misses;
+
+	/**
+   * Number of evicted pages stored in the cache
+	 */
+  std::uint64_t admissions;
+
+	/**
+   * Number of evicted pages refused because they had not been used again
+	 */
+  std::uint64_t rejections;
+};
+
+
+/**
+* @brief Second tier of the buffer pool: a file of page-sized slots, best on
+* a fast local device, holding pages evicted from the pool
+*
+* The cache is exclusive of the pool.  A page is offered when the pool evicts
+* it, after any write-back, so a cached page always equals the page in its
+* file; reading a page from the cache takes it out, and a page read from its
+* file drops any cached copy.  A page is only admitted if it was hit in the
+* pool, was taken from the cache before, or is offered again while its
+* refusal is remembered, so that pages a scan reads once do not push out
+* pages that are used again.  When every slot is taken, slots are reused in
+* turn.
+*
+* Pages are known by file identifier, so the cache lasts as long as the pool: the
+* file is created empty and removed when the cache goes.  Slots are read and
+* written with direct I/O where the filesystem allows it.
+*/
+class SsdCache
+{
+ public:
+	/**
+   * Creates the cache file.
+   *
+   * @param filename  Name of the file, which is replaced if it exists
+   * @param pages     Number of pages the cache holds
+   * @throws  IoException If the file cannot be created
+	 */
+  SsdCache(const std::string& filename, const std::uint32_t pages);
+
+	/**
+   * Closes and removes the cache file.
+	 */
+  ~SsdCache();
+
+  SsdCache(const SsdCache&) = delete;
+  SsdCache& operator=(const SsdCache&) = delete;
+
+	/**
+   * Moves a page out of the cache, if it is there.
+   *
+   * @param file    File of the page
+   * @param pageNo  Page number in the file
+   * @param bytes   Receives the page's Page::SIZE bytes
+   * @return  True if the page was in the cache
+   * @throws  IoException If the slot cannot be read; the page is dropped
+	 */
+  bool take(const File* file, const PageId pageNo, char* bytes);
+
+	/**
+   * Offers a page evicted from the pool.  A page refused replaces no copy:
+   * any older one is dropped.
+   *
+   * @param file    File of the page
+   * @param pageNo  Page number in the file
+   * @param bytes   The page's Page::SIZE bytes, as in its file
+   * @param reused  Whether the page was hit while it was in the pool
+   * @throws  IoException If the slot cannot be written; the page is dropped
+	 */
+  void offer(const File* file, const PageId pageNo, const char* bytes,
+             const bool reused);
+
+	/**
+   * Drops the cached copy of a page, if any.
+   *
+   * @param file    File of the page
+   * @param pageNo  Page number in the file
+	 */
+  void erase(const File* file, const PageId pageNo);
+
+	/**
+   * Drops the cached copies of every page of a file.
+   *
+   * @param file    File object
+	 */
+  void eraseFile(const File* file);
+
+	/**
+   * @return  The counters since the cache was created or last cleared
+	 */
+  SsdCacheStats stats() const;
+
+	/**
+   * Clears the counters.
+	 */
+  void clearStats();
+
+ private:
+	/**
+   * Returns a free slot, emptying the one at the hand if there is none.
+	 */
+  std::uint32_t claimSlot();
+
+	/**
+   * Name of the cache file
+	 */
+  std::string filename;
+
+	/**
+   * The cache file
+	 */
+  PosixBackend store;
+
+	/**
+   * Page in each slot; the file identifier is 0 for an empty slot
+	 */
+  std::vector<PageKey> slots;
+
+	/**
+   * Empty slots
+	 */
+  std::vector<std::uint32_t> unused;
+
+	/**
+   * Next slot to reuse when none is empty
+	 */
+  std::uint32_t hand;
+
+	/**
+   * Slot of every cached page
+	 */
+  std::unordered_map<PageKey, std::uint32_t, PageKeyHash> index;
+
+	/**
+   * Pages refused, or taken, recently; admitted when offered again
+	 */
+  GhostList ghosts;
+
+	/**
+   * Counters, see stats()
+	 */
+  SsdCacheStats counters;
+
+	/**
+   * Latch protecting all of the above, held for the I/O as well
+	 */
+  mutable std::mutex latch;
+};
+
+}
@@ -0,0 +1,638 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "storage_backend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "crc32c.h"
+#include "exceptions/io_exception.h"
+#include "pageCodec.h"
+
+namespace badgerdb {
+
+StreamBackend::StreamBackend(const std::string& filename, bool create)
+    : filename_(filename) {
+  std::ios_base::openmode mode =
+      std::fstream::in | std::fstream::out | std::fstream::binary;
+  if (create) {
+    // New files have to be truncated on open.
+    mode = mode | std::fstream::trunc;
+  }
+  stream_.open(filename, mode);
+}
+
+void StreamBackend::read(std::uint64_t offset, char* buffer,
+                         std::size_t length) {
+  stream_.clear();
+  stream_.seekg(offset, std::ios::beg);
+  stream_.read(buffer, length);
+  if (stream_.gcount() < static_cast<std::streamsize>(length)) {
+    std::memset(buffer + stream_.gcount(), 0, length - stream_.gcount());
+  }
+}
+
+void StreamBackend::write(std::uint64_t offset, const char* buffer,
+                          std::size_t length) {
+  stream_.clear();
+  stream_.seekp(offset, std::ios::beg);
+  stream_.write(buffer, length);
+  stream_.flush();
+}
+
+void StreamBackend::truncate(std::uint64_t length) {
+  stream_.flush();
+  if (::truncate(filename_.c_str(), static_cast<off_t>(length)) != 0) {
+    throw IoException(filename_, "truncate", errno);
+  }
+}
+
+void StreamBackend::sync() {
+  stream_.flush();
+  // The stream has no descriptor of its own to sync; any descriptor for the
+  // file will do.
+  const int fd = ::open(filename_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw IoException(filename_, "open", errno);
+  }
+  const int result = ::fsync(fd);
+  const int error = errno;
+  ::close(fd);
+  if (result != 0) {
+    throw IoException(filename_, "fsync", error);
+  }
+}
+
+PosixBackend::PosixBackend(const std::string& filename, bool create,
+                           bool direct)
+    : filename_(filename), fd_(-1), direct_(false) {
+  int flags = O_RDWR;
+  if (create) {
+    flags |= O_CREAT | O_TRUNC;
+  }
+#ifdef O_DIRECT
+  if (direct) {
+    fd_ = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+    direct_ = fd_ >= 0;
+  }
+#endif
+  if (fd_ < 0) {
+    // Either direct I/O was not requested or the filesystem refused it.
+    fd_ = ::open(filename.c_str(), flags, 0644);
+    if (fd_ < 0) {
+      throw IoException(filename_, "open", errno);
+    }
+#if defined(F_NOCACHE)
+    if (direct) {
+      fcntl(fd_, F_NOCACHE, 1);
+    }
+#endif
+  }
+}
+
+PosixBackend::~PosixBackend() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool PosixBackend::aligned(std::uint64_t offset, const char* buffer,
+                           std::size_t length) const {
+  return offset % ALIGNMENT == 0 && length % ALIGNMENT == 0 &&
+      reinterpret_cast<std::uintptr_t>(buffer) % ALIGNMENT == 0;
+}
+
+void PosixBackend::readFully(std::uint64_t offset, char* buffer,
+                             std::size_t length) {
+  while (length > 0) {
+    const ssize_t n = ::pread(fd_, buffer, length, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException(filename_, "pread", errno);
+    }
+    if (n == 0) {
+      std::memset(buffer, 0, length);
+      return;
+    }
+    buffer += n;
+    offset += n;
+    length -= n;
+  }
+}
+
+void PosixBackend::writeFully(std::uint64_t offset, const char* buffer,
+                              std::size_t length) {
+  while (length > 0) {
+    const ssize_t n = ::pwrite(fd_, buffer, length, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException(filename_, "pwrite", errno);
+    }
+    buffer += n;
+    offset += n;
+    length -= n;
+  }
+}
+
+namespace {
+
+/**
+ * Aligned scratch buffer for direct I/O requests that are not aligned.
+ */
+struct BounceBuffer {
+  explicit BounceBuffer(std::size_t length) : data(NULL) {
+    if (posix_memalign(reinterpret_cast<void**>(&data),
+                       PosixBackend::ALIGNMENT, length) != 0) {
+      throw std::bad_alloc();
+    }
+  }
+  ~BounceBuffer() { std::free(data); }
+  char* data;
+};
+
+}
+
+void PosixBackend::read(std::uint64_t offset, char* buffer,
+                        std::size_t length) {
+  if (!direct_ || aligned(offset, buffer, length)) {
+    readFully(offset, buffer, length);
+    return;
+  }
+  const std::uint64_t start = offset - offset % ALIGNMENT;
+  const std::uint64_t end =
+      (offset + length + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  BounceBuffer bounce(end - start);
+  readFully(start, bounce.data, end - start);
+  std::memcpy(buffer, bounce.data + (offset - start), length);
+}
+
+void PosixBackend::readBlocks(std::uint64_t offset, char* const* buffers,
+                              std::size_t count, std::size_t length) {
+  for (std::size_t k = 0; direct_ && k < count; ++k) {
+    if (!aligned(offset + k * length, buffers[k], length)) {
+      StorageBackend::readBlocks(offset, buffers, count, length);
+      return;
+    }
+  }
+  std::vector<struct iovec> iov;
+  for (std::size_t k = 0; k < count;) {
+    const std::size_t n = std::min<std::size_t>(count - k, IOV_MAX);
+    iov.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      iov[i].iov_base = buffers[k + i];
+      iov[i].iov_len = length;
+    }
+    const ssize_t got = ::preadv(fd_, iov.data(), static_cast<int>(n),
+                                 offset + k * length);
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException(filename_, "preadv", errno);
+    }
+    // A block the call did not fill, e.g. at the end of the file, is read
+    // again on its own.
+    const std::size_t whole = static_cast<std::size_t>(got) / length;
+    k += whole;
+    if (whole < n) {
+      readFully(offset + k * length, buffers[k], length);
+      ++k;
+    }
+  }
+}
+
+void PosixBackend::write(std::uint64_t offset, const char* buffer,
+                         std::size_t length) {
+  if (!direct_ || aligned(offset, buffer, length)) {
+    writeFully(offset, buffer, length);
+    return;
+  }
+  const std::uint64_t start = offset - offset % ALIGNMENT;
+  const std::uint64_t end =
+      (offset + length + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  BounceBuffer bounce(end - start);
+  // Preserve the bytes of the first and last block outside the request.
+  readFully(start, bounce.data, ALIGNMENT);
+  if (end - start > ALIGNMENT) {
+    readFully(end - ALIGNMENT, bounce.data + (end - start - ALIGNMENT),
+              ALIGNMENT);
+  }
+  std::memcpy(bounce.data + (offset - start), buffer, length);
+  writeFully(start, bounce.data, end - start);
+  // A write at the end of the file leaves it padded to a whole block; the
+  // padding reads back as zeros, which is what read() returns past the end.
+}
+
+void PosixBackend::truncate(std::uint64_t length) {
+  if (::ftruncate(fd_, static_cast<off_t>(length)) != 0) {
+    throw IoException(filename_, "ftruncate", errno);
+  }
+}
+
+void PosixBackend::reserve(std::uint64_t offset, std::uint64_t length) {
+#if defined(__linux__)
+  if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset),
+                  static_cast<off_t>(length)) != 0 &&
+      errno != EOPNOTSUPP && errno != ENOSYS) {
+    throw IoException(filename_, "fallocate", errno);
+  }
+#endif
+}
+
+void PosixBackend::sync() {
+#if defined(__APPLE__)
+  if (::fsync(fd_) != 0) {
+#else
+  if (::fdatasync(fd_) != 0) {
+#endif
+    throw IoException(filename_, "fdatasync", errno);
+  }
+}
+
+MappedBackend::MappedBackend(const std::string& filename)
+    : filename_(filename), fd_(-1), base_(NULL), length_(0) {
+  fd_ = ::open(filename.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    throw IoException(filename_, "open", errno);
+  }
+  struct stat status;
+  if (::fstat(fd_, &status) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw IoException(filename_, "fstat", error);
+  }
+  length_ = status.st_size;
+  if (length_ == 0) {
+    return;
+  }
+  void* base = ::mmap(NULL, length_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (base == MAP_FAILED) {
+    const int error = errno;
+    ::close(fd_);
+    throw IoException(filename_, "mmap", error);
+  }
+  base_ = static_cast<char*>(base);
+  // Only hints; a kernel that ignores them still maps the file correctly.
+  ::madvise(base_, length_, MADV_SEQUENTIAL);
+  ::madvise(base_, length_, MADV_WILLNEED);
+}
+
+MappedBackend::~MappedBackend() {
+  if (base_ != NULL) {
+    ::munmap(base_, length_);
+  }
+  ::close(fd_);
+}
+
+void MappedBackend::read(std::uint64_t offset, char* buffer,
+                         std::size_t length) {
+  std::size_t mapped = 0;
+  if (offset < length_) {
+    mapped = static_cast<std::size_t>(
+        std::min<std::uint64_t>(length, length_ - offset));
+    std::memcpy(buffer, base_ + offset, mapped);
+  }
+  std::memset(buffer + mapped, 0, length - mapped);
+}
+
+void MappedBackend::write(std::uint64_t offset, const char* buffer,
+                          std::size_t length) {
+  throw IoException(filename_, "write", EROFS);
+}
+
+void MappedBackend::truncate(std::uint64_t length) {
+  throw IoException(filename_, "truncate", EROFS);
+}
+
+char* MappedBackend::mapping(std::uint64_t offset, std::size_t length) const {
+  if (base_ == NULL || offset > length_ || length > length_ - offset) {
+    return NULL;
+  }
+  return base_ + offset;
+}
+
+namespace {
+
+std::uint64_t roundUp(const std::uint64_t length) {
+  const std::uint64_t sector = CompressedBackend::SECTOR;
+  return (length + sector - 1) / sector * sector;
+}
+
+}
+
+const std::uint32_t CompressedBackend::MAGIC;
+const std::size_t CompressedBackend::SECTOR;
+const std::size_t CompressedBackend::MAX_BLOCK_SIZE;
+
+CompressedBackend::CompressedBackend(const std::string& filename, bool create,
+                                     std::size_t blockSize)
+    : filename_(filename), raw_(filename, create, false /* direct */),
+      blockSize_(blockSize), mapDirty_(false), end_(SECTOR),
+      compressed_(blockSize), cachedBlock_(UINT64_MAX), cached_(blockSize) {
+  mapLocation_.offset = 0;
+  mapLocation_.length = 0;
+  mapLocation_.capacity = 0;
+  if (create) {
+    // an empty map, so that the file is recognised from the start
+    writeMap();
+    return;
+  }
+  Superblock super;
+  raw_.read(0, reinterpret_cast<char*>(&super), sizeof(super));
+  if (super.magic != MAGIC || super.version != 1 || super.block_size == 0 ||
+      super.block_size > MAX_BLOCK_SIZE ||
+      super.map_length != super.blocks * sizeof(Location)) {
+    throw IoException(filename_, "open", EINVAL);
+  }
+  // the file's own block size, so that a caller expecting another one can
+  // still read what the file holds and tell what is wrong
+  blockSize_ = super.block_size;
+  compressed_.resize(blockSize_);
+  cached_.resize(blockSize_);
+  map_.resize(super.blocks);
+  if (super.map_length > 0) {
+    raw_.read(super.map_offset, reinterpret_cast<char*>(map_.data()),
+              super.map_length);
+    if (crc32c(0, map_.data(), super.map_length) != super.map_checksum) {
+      throw IoException(filename_, "open", EINVAL);
+    }
+    mapLocation_.offset = super.map_offset;
+    mapLocation_.length = static_cast<std::uint32_t>(super.map_length);
+    mapLocation_.capacity = static_cast<std::uint32_t>(roundUp(super.map_length));
+  }
+  // whatever neither the map nor a block holds is free
+  std::vector<std::pair<std::uint64_t, std::uint64_t> > used;
+  for (const Location& location : map_) {
+    if (location.capacity > 0) {
+      used.push_back(std::make_pair(location.offset, location.capacity));
+    }
+  }
+  if (mapLocation_.capacity > 0) {
+    used.push_back(std::make_pair(mapLocation_.offset, mapLocation_.capacity));
+  }
+  std::sort(used.begin(), used.end());
+  for (const std::pair<std::uint64_t, std::uint64_t>& extent : used) {
+    // sorted, so an extent overlapping the last one or the superblock is damage
+    if (extent.first < end_) {
+      throw IoException(filename_, "open", EINVAL);
+    }
+    if (extent.first > end_) {
+      free_[end_] = extent.first - end_;
+    }
+    end_ = extent.first + extent.second;
+  }
+}
+
+CompressedBackend::~CompressedBackend() {
+  try {
+    if (mapDirty_) {
+      writeMap();
+    }
+  } catch (const IoException&) {
+  }
+}
+
+bool CompressedBackend::isCompressed(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  std::uint32_t magic = 0;
+  file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  return file && magic == MAGIC;
+}
+
+void CompressedBackend::loadBlock(std::uint64_t block, char* buffer) {
+  if (block == cachedBlock_) {
+    std::memcpy(buffer, cached_.data(), blockSize_);
+    return;
+  }
+  if (block >= map_.size() || map_[block].length == 0) {
+    std::memset(buffer, 0, blockSize_);
+    return;
+  }
+  const Location& location = map_[block];
+  if (location.length == blockSize_) {
+    raw_.read(location.offset, buffer, blockSize_);
+    return;
+  }
+  raw_.read(location.offset, compressed_.data(), location.length);
+  if (!decompressBlock(compressed_.data(), location.length, buffer,
+                       blockSize_)) {
+    throw IoException(filename_, "decompress", EIO);
+  }
+}
+
+void CompressedBackend::cacheBlock(std::uint64_t block) {
+  if (block != cachedBlock_) {
+    // invalid while it is being filled, in case that fails
+    cachedBlock_ = UINT64_MAX;
+    loadBlock(block, cached_.data());
+    cachedBlock_ = block;
+  }
+}
+
+void CompressedBackend::storeBlock(std::uint64_t block, const char* buffer) {
+  // anything that does not save a sector is stored as it is
+  const char* bytes = compressed_.data();
+  std::size_t length = compressBlock(buffer, blockSize_, compressed_.data(),
+                                     blockSize_ - SECTOR);
+  if (length == 0) {
+    bytes = buffer;
+    length = blockSize_;
+  }
+  if (block >= map_.size()) {
+    Location empty = {0, 0, 0};
+    map_.resize(block + 1, empty);
+  }
+  Location& location = map_[block];
+  const std::uint64_t needed = roundUp(length);
+  if (needed > location.capacity) {
+    if (location.capacity > 0) {
+      pending_.push_back(std::make_pair(location.offset, location.capacity));
+    }
+    location.offset = allocate(needed);
+    location.capacity = static_cast<std::uint32_t>(needed);
+  } else if (needed < location.capacity) {
+    pending_.push_back(std::make_pair(location.offset + needed,
+                                      location.capacity - needed));
+    location.capacity = static_cast<std::uint32_t>(needed);
+  }
+  raw_.write(location.offset, bytes, length);
+  location.length = static_cast<std::uint32_t>(length);
+  mapDirty_ = true;
+  if (cachedBlock_ == block && buffer != cached_.data()) {
+    std::memcpy(cached_.data(), buffer, blockSize_);
+  }
+}
+
+std::uint64_t CompressedBackend::allocate(std::uint64_t length) {
+  for (std::map<std::uint64_t, std::uint64_t>::iterator it = free_.begin();
+       it != free_.end(); ++it) {
+    if (it->second >= length) {
+      const std::uint64_t offset = it->first;
+      const std::uint64_t left = it->second - length;
+      free_.erase(it);
+      if (left > 0) {
+        free_[offset + length] = left;
+      }
+      return offset;
+    }
+  }
+  const std::uint64_t offset = end_;
+  end_ += length;
+  return offset;
+}
+
+void CompressedBackend::release(std::uint64_t offset, std::uint64_t length) {
+  std::map<std::uint64_t, std::uint64_t>::iterator next = free_.lower_bound(offset);
+  if (next != free_.end() && offset + length == next->first) {
+    length += next->second;
+    next = free_.erase(next);
+  }
+  if (next != free_.begin()) {
+    std::map<std::uint64_t, std::uint64_t>::iterator before = std::prev(next);
+    if (before->first + before->second == offset) {
+      offset = before->first;
+      length += before->second;
+      free_.erase(before);
+    }
+  }
+  if (offset + length == end_) {
+    end_ = offset;
+  } else {
+    free_[offset] = length;
+  }
+}
+
+void CompressedBackend::writeMap() {
+  const std::uint64_t length = map_.size() * sizeof(Location);
+  Location written = {0, 0, 0};
+  if (length > 0) {
+    written.capacity = static_cast<std::uint32_t>(roundUp(length));
+    written.offset = allocate(written.capacity);
+    written.length = static_cast<std::uint32_t>(length);
+    raw_.write(written.offset, reinterpret_cast<const char*>(map_.data()),
+               length);
+  }
+  Superblock super;
+  std::memset(&super, 0, sizeof(super));
+  super.magic = MAGIC;
+  super.version = 1;
+  super.block_size = static_cast<std::uint32_t>(blockSize_);
+  super.map_checksum = length > 0 ? crc32c(0, map_.data(), length) : 0;
+  super.blocks = map_.size();
+  super.map_offset = written.offset;
+  super.map_length = length;
+  // the map must be on disk before the superblock points at it
+  raw_.sync();
+  raw_.write(0, reinterpret_cast<const char*>(&super), sizeof(super));
+  raw_.sync();
+  mapDirty_ = false;
+  if (mapLocation_.capacity > 0) {
+    release(mapLocation_.offset, mapLocation_.capacity);
+  }
+  mapLocation_ = written;
+  for (const std::pair<std::uint64_t, std::uint64_t>& extent : pending_) {
+    release(extent.first, extent.second);
+  }
+  pending_.clear();
+  // give back the space freed at the end of the file
+  if (::ftruncate(raw_.descriptor(), end_) != 0) {
+    throw IoException(filename_, "ftruncate", errno);
+  }
+}
+
+void CompressedBackend::read(std::uint64_t offset, char* buffer,
+                             std::size_t length) {
+  while (length > 0) {
+    const std::uint64_t block = offset / blockSize_;
+    const std::size_t start = static_cast<std::size_t>(offset % blockSize_);
+    const std::size_t n = std::min(length, blockSize_ - start);
+    if (n == blockSize_) {
+      // a whole page is decompressed straight into the caller's memory
+      loadBlock(block, buffer);
+    } else {
+      cacheBlock(block);
+      std::memcpy(buffer, cached_.data() + start, n);
+    }
+    offset += n;
+    buffer += n;
+    length -= n;
+  }
+}
+
+void CompressedBackend::write(std::uint64_t offset, const char* buffer,
+                              std::size_t length) {
+  while (length > 0) {
+    const std::uint64_t block = offset / blockSize_;
+    const std::size_t start = static_cast<std::size_t>(offset % blockSize_);
+    const std::size_t n = std::min(length, blockSize_ - start);
+    if (n == blockSize_) {
+      storeBlock(block, buffer);
+    } else {
+      cacheBlock(block);
+      std::memcpy(cached_.data() + start, buffer, n);
+      storeBlock(block, cached_.data());
+    }
+    offset += n;
+    buffer += n;
+    length -= n;
+  }
+}
+
+void CompressedBackend::truncate(std::uint64_t length) {
+  const std::uint64_t blocks = (length + blockSize_ - 1) / blockSize_;
+  if (blocks < map_.size()) {
+    // the space of the blocks dropped is reused once the map is written
+    for (std::uint64_t block = blocks; block < map_.size(); ++block) {
+      if (map_[block].capacity > 0) {
+        pending_.push_back(std::make_pair(map_[block].offset,
+                                          map_[block].capacity));
+      }
+    }
+    map_.resize(blocks);
+    mapDirty_ = true;
+    if (cachedBlock_ != UINT64_MAX && cachedBlock_ >= blocks) {
+      cachedBlock_ = UINT64_MAX;
+    }
+  }
+  // the rest of a block cut part way reads as zero
+  const std::size_t kept = static_cast<std::size_t>(length % blockSize_);
+  if (kept > 0 && blocks <= map_.size()) {
+    cacheBlock(blocks - 1);
+    std::memset(cached_.data() + kept, 0, blockSize_ - kept);
+    storeBlock(blocks - 1, cached_.data());
+  }
+}
+
+void CompressedBackend::sync() {
+  if (mapDirty_) {
+    writeMap();
+  } else {
+    raw_.sync();
+  }
+}
+
+}
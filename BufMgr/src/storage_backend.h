@@ -0,0 +1,545 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief Kinds of storage backend a File can sit on.
+ */
+enum class StorageType {
+  /**
+   * std::fstream, buffered by the C++ library and the OS page cache.
+   */
+  STREAM,
+
+  /**
+   * POSIX file descriptor with pread/pwrite, buffered by the OS page cache
+   * only.
+   */
+  POSIX,
+
+  /**
+   * POSIX file descriptor opened for direct I/O, bypassing the OS page cache
+   * so that the buffer pool is the only cache.  Falls back to POSIX if the
+   * filesystem does not support direct I/O.
+   */
+  POSIX_DIRECT,
+
+  /**
+   * Read-only memory mapping of the whole file, for scans of files nobody
+   * writes to.  Pages can be used in place in the mapping instead of being
+   * copied (see File::mappedPage()); every write fails.  Only for opening
+   * existing files.
+   */
+  MAPPED,
+
+  /**
+   * Every page stored compressed, with a map of where each one is, see
+   * CompressedBackend.  Pages are compressed on their way to the file and
+   * decompressed on their way into memory, so the buffer pool holds them
+   * uncompressed.  A file created this way is read through CompressedBackend
+   * whatever type it is opened with, and opening a plain file with this type
+   * leaves it plain.
+   */
+  COMPRESSED
+};
+
+/**
+ * @brief Byte-addressed storage underneath a File.
+ *
+ * A backend is shared by all File objects open on the same filename.  Callers
+ * serialize access through the File latch, so implementations need not be
+ * threadsafe.
+ */
+class StorageBackend {
+ public:
+  /**
+   * Destructor; closes the underlying file.
+   */
+  virtual ~StorageBackend() {}
+
+  /**
+   * Reads <length> bytes at <offset>.  Bytes past the end of the file read as
+   * zero.
+   *
+   * @param offset  Byte offset in the file.
+   * @param buffer  Destination of the bytes.
+   * @param length  Number of bytes to read.
+   * @throws  IoException   If the operating system reports an error.
+   */
+  virtual void read(std::uint64_t offset, char* buffer, std::size_t length) = 0;
+
+  /**
+   * Reads <count> consecutive blocks of <length> bytes starting at <offset>,
+   * each into its own buffer, as that many read() calls would.  Backends that
+   * can do so fill all buffers with a single request to the OS.
+   *
+   * @param offset   Byte offset in the file of the first block.
+   * @param buffers  Destination of each block.
+   * @param count    Number of blocks.
+   * @param length   Number of bytes per block.
+   * @throws  IoException   If the operating system reports an error.
+   */
+  virtual void readBlocks(std::uint64_t offset, char* const* buffers,
+                          std::size_t count, std::size_t length) {
+    for (std::size_t k = 0; k < count; ++k) {
+      read(offset + k * length, buffers[k], length);
+    }
+  }
+
+  /**
+   * Writes <length> bytes at <offset>, extending the file if needed.
+   *
+   * @param offset  Byte offset in the file.
+   * @param buffer  Source of the bytes.
+   * @param length  Number of bytes to write.
+   * @throws  IoException   If the operating system reports an error.
+   */
+  virtual void write(std::uint64_t offset, const char* buffer,
+                     std::size_t length) = 0;
+
+  /**
+   * Shortens the file to <length> bytes.  Bytes past the end read as zero
+   * afterwards, as they would had they never been written.
+   *
+   * @param length  New length of the file.
+   * @throws  IoException   If the operating system reports an error.
+   */
+  virtual void truncate(std::uint64_t length) = 0;
+
+  /**
+   * Allocates disk space for <length> bytes at <offset> without changing the
+   * length of the file, so that later writes there need not allocate.  Only
+   * a hint: backends that cannot do so need not.
+   *
+   * @param offset  Byte offset in the file.
+   * @param length  Number of bytes.
+   * @throws  IoException   If the operating system reports an error other
+   *                        than lacking support.
+   */
+  virtual void reserve(std::uint64_t offset, std::uint64_t length) {}
+
+  /**
+   * Makes all completed writes durable.
+   *
+   * @throws  IoException   If the operating system reports an error.
+   */
+  virtual void sync() = 0;
+
+  /**
+   * Returns the file descriptor for backends built on one, -1 otherwise.
+   */
+  virtual int descriptor() const { return -1; }
+
+  /**
+   * Returns true if the given request may bypass this object and go to
+   * descriptor() with plain pread/pwrite, concurrently with other requests.
+   *
+   * @param offset  Byte offset in the file.
+   * @param buffer  Memory to transfer.
+   * @param length  Number of bytes.
+   */
+  virtual bool rawAccess(std::uint64_t offset, const char* buffer,
+                         std::size_t length) const {
+    return false;
+  }
+
+  /**
+   * Returns true for backends whose file is mapped into memory.
+   */
+  virtual bool isMapped() const { return false; }
+
+  /**
+   * Returns the address of <length> bytes at <offset> in the mapping of the
+   * file, or NULL if the backend is not mapped or the range is not inside the
+   * mapping.  The memory is read-only and stays valid until the backend is
+   * destroyed.
+   *
+   * @param offset  Byte offset in the file.
+   * @param length  Number of bytes.
+   */
+  virtual char* mapping(std::uint64_t offset, std::size_t length) const {
+    return NULL;
+  }
+};
+
+/**
+ * @brief Backend over a std::fstream.  Every write is flushed to the OS.
+ */
+class StreamBackend : public StorageBackend {
+ public:
+  /**
+   * Opens the file.
+   *
+   * @param filename  Name of the file.
+   * @param create    Whether to create (and truncate) the file.
+   */
+  StreamBackend(const std::string& filename, bool create);
+
+  void read(std::uint64_t offset, char* buffer, std::size_t length) override;
+  void write(std::uint64_t offset, const char* buffer,
+             std::size_t length) override;
+  void truncate(std::uint64_t length) override;
+  void sync() override;
+
+ private:
+  /**
+   * Name of the file.
+   */
+  std::string filename_;
+
+  /**
+   * The underlying stream.
+   */
+  std::fstream stream_;
+};
+
+/**
+ * @brief Backend over a POSIX file descriptor using pread/pwrite.
+ *
+ * In direct mode requests whose offset, length and buffer are all aligned to
+ * ALIGNMENT go straight to the device.  Others are staged through an aligned
+ * bounce buffer, with a read-modify-write of partially covered blocks.
+ */
+class PosixBackend : public StorageBackend {
+ public:
+  /**
+   * Alignment of offsets, lengths and buffers required for direct I/O.
+   */
+  static const std::size_t ALIGNMENT = 4096;
+
+  /**
+   * Opens the file.
+   *
+   * @param filename  Name of the file.
+   * @param create    Whether to create (and truncate) the file.
+   * @param direct    Whether to bypass the OS page cache.
+   * @throws  IoException   If the file cannot be opened.
+   */
+  PosixBackend(const std::string& filename, bool create, bool direct);
+
+  /**
+   * Closes the file descriptor.
+   */
+  ~PosixBackend() override;
+
+  void read(std::uint64_t offset, char* buffer, std::size_t length) override;
+  void readBlocks(std::uint64_t offset, char* const* buffers,
+                  std::size_t count, std::size_t length) override;
+  void write(std::uint64_t offset, const char* buffer,
+             std::size_t length) override;
+  void truncate(std::uint64_t length) override;
+  void reserve(std::uint64_t offset, std::uint64_t length) override;
+  void sync() override;
+  int descriptor() const override { return fd_; }
+  bool rawAccess(std::uint64_t offset, const char* buffer,
+                 std::size_t length) const override {
+    return !direct_ || aligned(offset, buffer, length);
+  }
+
+  /**
+   * Returns whether the descriptor really is in direct I/O mode.
+   */
+  bool isDirect() const { return direct_; }
+
+ private:
+  /**
+   * pread loop which retries short and interrupted reads and zero-fills past
+   * the end of the file.
+   */
+  void readFully(std::uint64_t offset, char* buffer, std::size_t length);
+
+  /**
+   * pwrite loop which retries short and interrupted writes.
+   */
+  void writeFully(std::uint64_t offset, const char* buffer, std::size_t length);
+
+  /**
+   * Returns true if a request can be issued without a bounce buffer.
+   */
+  bool aligned(std::uint64_t offset, const char* buffer,
+               std::size_t length) const;
+
+  /**
+   * Name of the file, for error messages.
+   */
+  std::string filename_;
+
+  /**
+   * The file descriptor.
+   */
+  int fd_;
+
+  /**
+   * Whether fd_ was opened for direct I/O.
+   */
+  bool direct_;
+};
+
+/**
+ * @brief Backend over a read-only, shared memory mapping of the whole file.
+ *
+ * The mapping covers the file as it was when opened and is advised for
+ * sequential access, with read-ahead of all of it requested up front.  Writes
+ * throw IoException with EROFS.
+ */
+class MappedBackend : public StorageBackend {
+ public:
+  /**
+   * Opens and maps the file.
+   *
+   * @param filename  Name of the file.
+   * @throws  IoException   If the file cannot be opened or mapped.
+   */
+  explicit MappedBackend(const std::string& filename);
+
+  /**
+   * Unmaps and closes the file.
+   */
+  ~MappedBackend() override;
+
+  void read(std::uint64_t offset, char* buffer, std::size_t length) override;
+  void write(std::uint64_t offset, const char* buffer,
+             std::size_t length) override;
+  void truncate(std::uint64_t length) override;
+  void sync() override {}
+  int descriptor() const override { return fd_; }
+  bool isMapped() const override { return true; }
+  char* mapping(std::uint64_t offset, std::size_t length) const override;
+
+ private:
+  /**
+   * Name of the file, for error messages.
+   */
+  std::string filename_;
+
+  /**
+   * The file descriptor, open read-only.
+   */
+  int fd_;
+
+  /**
+   * Start of the mapping; NULL for an empty file.
+   */
+  char* base_;
+
+  /**
+   * Length of the mapping, the size of the file when it was opened.
+   */
+  std::uint64_t length_;
+};
+
+/**
+ * @brief Backend storing each block of the file, a page, compressed with
+ * compressBlock().
+ *
+ * The underlying file starts with a superblock, which locates the block map;
+ * the map gives the position and compressed length of every block, and the
+ * compressed blocks can be anywhere after the superblock in SECTOR-sized
+ * units.  A block that does not compress is stored as it is.  A block whose
+ * new contents no longer fit where it was goes elsewhere; the space it leaves
+ * is only reused once a map without the old position is on disk.
+ *
+ * The map is kept in memory and written, to a new place, on sync() and when
+ * the backend is destroyed, then the superblock is pointed at it.  Like the
+ * cached file header, blocks written since then are lost in a crash, so
+ * callers needing durability sync.  A write of part of a block reads, patches
+ * and rewrites the whole block; the block last used is kept decompressed for
+ * such writes and the header reads that precede them.
+ */
+class CompressedBackend : public StorageBackend {
+ public:
+  /**
+   * Identifies a compressed file; "BDBZ" in little endian.
+   */
+  static const std::uint32_t MAGIC = 0x5a424442;
+
+  /**
+   * Unit in which space in the underlying file is handed out.
+   */
+  static const std::size_t SECTOR = 512;
+
+  /**
+   * Largest block size a file may have.
+   */
+  static const std::size_t MAX_BLOCK_SIZE = 1 << 20;
+
+  /**
+   * Creates or opens the file.
+   *
+   * @param filename   Name of the file.
+   * @param create     Whether to create (and truncate) the file.
+   * @param blockSize  Size of the blocks compressed one by one, when creating;
+   *                   an existing file keeps the block size it was created
+   *                   with.
+   * @throws  IoException   If the file cannot be opened, or is not a
+   *                        compressed file.
+   */
+  CompressedBackend(const std::string& filename, bool create,
+                    std::size_t blockSize);
+
+  /**
+   * Writes the block map if it changed, then closes the file.
+   */
+  ~CompressedBackend() override;
+
+  /**
+   * Returns true if the named file exists and is in the format of this
+   * backend.
+   *
+   * @param filename  Name of the file.
+   */
+  static bool isCompressed(const std::string& filename);
+
+  void read(std::uint64_t offset, char* buffer, std::size_t length) override;
+  void write(std::uint64_t offset, const char* buffer,
+             std::size_t length) override;
+  void truncate(std::uint64_t length) override;
+  void sync() override;
+
+ private:
+  /**
+   * Where a block is in the underlying file.
+   */
+  struct Location {
+    /**
+     * Byte offset of the stored block.
+     */
+    std::uint64_t offset;
+
+    /**
+     * Number of bytes stored; 0 for a block never written, blockSize_ for one
+     * stored uncompressed.
+     */
+    std::uint32_t length;
+
+    /**
+     * Bytes reserved at <offset>, a multiple of SECTOR.
+     */
+    std::uint32_t capacity;
+  };
+
+  /**
+   * First bytes of the underlying file.
+   */
+  struct Superblock {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t block_size;
+    std::uint32_t map_checksum;
+    std::uint64_t blocks;
+    std::uint64_t map_offset;
+    std::uint64_t map_length;
+  };
+
+  /**
+   * Decompresses a block into <buffer>, which takes blockSize_ bytes.
+   */
+  void loadBlock(std::uint64_t block, char* buffer);
+
+  /**
+   * Compresses and stores a whole block.
+   */
+  void storeBlock(std::uint64_t block, const char* buffer);
+
+  /**
+   * Makes <block> the decompressed block kept in <cached_>.
+   */
+  void cacheBlock(std::uint64_t block);
+
+  /**
+   * Returns the offset of <length> free bytes, a multiple of SECTOR.
+   */
+  std::uint64_t allocate(std::uint64_t length);
+
+  /**
+   * Returns space to the free list.
+   */
+  void release(std::uint64_t offset, std::uint64_t length);
+
+  /**
+   * Writes the block map to a new place and the superblock pointing at it,
+   * then frees the space the previous map no longer holds.
+   */
+  void writeMap();
+
+  /**
+   * Name of the file, for error messages.
+   */
+  std::string filename_;
+
+  /**
+   * The underlying file.
+   */
+  PosixBackend raw_;
+
+  /**
+   * Size of a block.
+   */
+  std::size_t blockSize_;
+
+  /**
+   * Location of every block, by block number.
+   */
+  std::vector<Location> map_;
+
+  /**
+   * Where the map on disk is; its capacity is 0 if there is none.
+   */
+  Location mapLocation_;
+
+  /**
+   * Whether map_ differs from the map on disk.
+   */
+  bool mapDirty_;
+
+  /**
+   * Free space before end_: length by offset.
+   */
+  std::map<std::uint64_t, std::uint64_t> free_;
+
+  /**
+   * Space given up since the map was last written, as (offset, length); the
+   * map on disk may still point into it.
+   */
+  std::vector<std::pair<std::uint64_t, std::uint64_t> > pending_;
+
+  /**
+   * End of the space in use.
+   */
+  std::uint64_t end_;
+
+  /**
+   * Compression output.
+   */
+  std::vector<char> compressed_;
+
+  /**
+   * Number of the block in <cached_>, or UINT64_MAX for none.
+   */
+  std::uint64_t cachedBlock_;
+
+  /**
+   * The block last used, decompressed.
+   */
+  std::vector<char> cached_;
+};
+
+}
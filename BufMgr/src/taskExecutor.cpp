@@ -0,0 +1,241 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "taskExecutor.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+void Task::promise_type::Finish::await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+{
+  TaskExecutor* executor = handle.promise().executor;
+  std::exception_ptr error = handle.promise().error;
+  handle.destroy();
+  executor->finished(error);
+}
+
+Task::~Task()
+{
+  if (handle) {
+    handle.destroy();
+  }
+}
+
+TaskExecutor::TaskExecutor()
+	: live(0)
+{
+}
+
+TaskExecutor::~TaskExecutor()
+{
+  // only tasks never started are left; their coroutine is a Task's
+  for (std::coroutine_handle<> handle : ready) {
+    handle.destroy();
+  }
+}
+
+void TaskExecutor::spawn(Task task)
+{
+  std::coroutine_handle<Task::promise_type> handle = task.handle;
+  task.handle = NULL;
+  handle.promise().executor = this;
+  std::lock_guard<std::mutex> guard(latch);
+  live++;
+  ready.push_back(handle);
+  wakeup.notify_one();
+}
+
+void TaskExecutor::resume(std::coroutine_handle<> handle)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  ready.push_back(handle);
+  wakeup.notify_one();
+}
+
+void TaskExecutor::finished(std::exception_ptr failure)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  if (failure && !error) {
+    error = failure;
+  }
+  live--;
+  if (live == 0) {
+    wakeup.notify_all();
+  }
+}
+
+void TaskExecutor::drive()
+{
+  for (;;) {
+    std::coroutine_handle<> next;
+    {
+      std::unique_lock<std::mutex> guard(latch);
+      wakeup.wait(guard, [this] { return !ready.empty() || live == 0; });
+      if (ready.empty()) {
+        return;
+      }
+      next = ready.front();
+      ready.pop_front();
+    }
+    next.resume();
+  }
+}
+
+void TaskExecutor::run(const std::uint32_t threads)
+{
+  std::vector<std::thread> helpers;
+  for (std::uint32_t i = 1; i < threads; i++) {
+    helpers.emplace_back([this] { drive(); });
+  }
+  drive();
+  for (std::thread& helper : helpers) {
+    helper.join();
+  }
+  std::exception_ptr failure;
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    failure = error;
+    error = NULL;
+  }
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+}
+
+PageRead BufMgr::readPageAsync(File* file, const PageId pageNo)
+{
+  return PageRead(this, file, pageNo);
+}
+
+PageRead::PageRead(BufMgr* bufMgr, File* file, const PageId pageNo)
+	: bufMgr(bufMgr),
+	  file(file),
+	  pageNo(pageNo),
+	  frame(0),
+	  missed(false),
+	  shared(false),
+	  executor(NULL)
+{
+}
+
+bool PageRead::await_ready()
+{
+  // without an engine, or for a mapped file, there is nothing to wait for
+  if (bufMgr->ioEngine == NULL || file->isMapped()) {
+    try {
+      Page* page;
+      bufMgr->readPage(file, pageNo, page);
+      frame = static_cast<FrameId>(page - bufMgr->bufPool);
+    } catch (...) {
+      failure = std::current_exception();
+    }
+    return true;
+  }
+  if (bufMgr->tracer != NULL) {
+    bufMgr->tracer->record(TraceOp::READ, file->id(), pageNo);
+  }
+  return bufMgr->readHit(file, pageNo, frame, false);
+}
+
+bool PageRead::await_suspend(std::coroutine_handle<Task::promise_type> handle)
+{
+  task = handle;
+  executor = handle.promise().executor;
+  started = std::chrono::steady_clock::now();
+  for (;;) {
+    // a read of the page already under way resumes this task too, maybe
+    // before awaitLoad() returns
+    shared = true;
+    if (bufMgr->awaitLoad(file, pageNo, [this] { executor->resume(task); })) {
+      return true;
+    }
+    shared = false;
+    try {
+      bufMgr->allocBuf(frame, file);
+    } catch (...) {
+      failure = std::current_exception();
+      return false;
+    }
+    // an evicted page may still be in the second tier, which is read in place
+    bool demoted = false;
+    if (bufMgr->ssdCache != NULL) {
+      try {
+        demoted = bufMgr->ssdCache->take(file, pageNo,
+            bufMgr->frameArena + (std::size_t) frame * Page::SIZE);
+      } catch (const IoException&) {
+      }
+    }
+    if (demoted) {
+      if (bufMgr->publishFrame(file, pageNo, frame, false, false)) {
+        missed = true;
+        bufMgr->countMiss(started);
+        return false;
+      }
+    } else {
+      IoRequest request;
+      try {
+        request = file->readPageRequest(pageNo, bufMgr->bufPool[frame],
+            [this](std::exception_ptr error) { complete(error); });
+      } catch (...) {
+        bufMgr->releaseBuf(frame);
+        failure = std::current_exception();
+        return false;
+      }
+      // others asking for the page from here on wait for this read
+      if (bufMgr->publishFrame(file, pageNo, frame, true, false)) {
+        missed = true;
+        std::vector<IoRequest> batch;
+        batch.push_back(std::move(request));
+        // the read may complete, and the task be resumed, before submit()
+        // returns
+        bufMgr->ioEngine->submit(batch);
+        return true;
+      }
+    }
+    // another thread published the page first
+    if (bufMgr->readHit(file, pageNo, frame, false)) {
+      return false;
+    }
+  }
+}
+
+void PageRead::complete(std::exception_ptr error)
+{
+  bufMgr->finishLoad(frame, !error);
+  if (error) {
+    failure = error;
+  } else {
+    bufMgr->bufStats.diskreads.add();
+    bufMgr->countMiss(started);
+  }
+  executor->resume(task);
+}
+
+PageGuard PageRead::await_resume()
+{
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  // the read shared may have failed, or the page gone again since
+  if (shared && !bufMgr->readHit(file, pageNo, frame, false)) {
+    Page* page;
+    bufMgr->fetchPage(file, pageNo, page);
+    frame = static_cast<FrameId>(page - bufMgr->bufPool);
+  } else if (missed && bufMgr->readAheadPages > 0) {
+    // read ahead here rather than on the I/O thread, which must not submit
+    bufMgr->noteRead(file, pageNo);
+  }
+  return PageGuard(bufMgr, file, pageNo, frame, &bufMgr->bufPool[frame]);
+}
+
+}
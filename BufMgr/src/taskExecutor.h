@@ -0,0 +1,276 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+class TaskExecutor;
+
+/**
+* @brief A coroutine run by a TaskExecutor, such as a request handler that
+* reads pages with `co_await bufMgr->readPageAsync(file, pageNo)`
+*
+* A function returning Task is a coroutine; calling it creates the task
+* without running any of it, and TaskExecutor::spawn() hands it to an
+* executor.  An exception escaping the task ends it and is rethrown by
+* TaskExecutor::run().
+*/
+class Task
+{
+ public:
+	/**
+   * State of the coroutine, for the compiler
+	 */
+  struct promise_type
+  {
+    /**
+     * Ends a task: hands its exception, if any, to the executor and frees it.
+     */
+    struct Finish
+    {
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+      void await_resume() const noexcept {}
+    };
+
+    Task get_return_object()
+    {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    Finish final_suspend() const noexcept { return {}; }
+    void return_void() const {}
+    void unhandled_exception() { error = std::current_exception(); }
+
+    /**
+     * Executor running the task, set by spawn()
+     */
+    TaskExecutor* executor = NULL;
+
+    /**
+     * Exception that ended the task
+     */
+    std::exception_ptr error;
+  };
+
+  Task(Task&& other) : handle(other.handle) { other.handle = NULL; }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+	/**
+   * Frees a task that was never spawned.
+	 */
+  ~Task();
+
+ private:
+  friend class TaskExecutor;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+	/**
+   * The coroutine, until spawned
+	 */
+  std::coroutine_handle<promise_type> handle;
+};
+
+
+/**
+* @brief Runs Tasks on a few threads, resuming each when what it awaits is
+* ready
+*
+* Tasks ready to run wait in one queue.  A task suspended on a page read is
+* queued again by the I/O completion, so the threads calling run() only ever
+* run tasks and never wait for the disk while one is ready.
+*/
+class TaskExecutor
+{
+ public:
+  TaskExecutor();
+
+	/**
+   * Frees the tasks spawned and never started.  Tasks suspended on a read
+   * must have finished, by run() returning, before the executor goes.
+	 */
+  ~TaskExecutor();
+
+  TaskExecutor(const TaskExecutor&) = delete;
+  TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+	/**
+   * Queues a task to start.  Threadsafe, and may be called from a task.
+   *
+   * @param task  The task, which the executor takes over
+	 */
+  void spawn(Task task);
+
+	/**
+   * Runs tasks until every task spawned has finished, those spawned meanwhile
+   * included.  The calling thread runs tasks together with the others started
+   * here, which are joined before returning.
+   *
+   * @param threads  Number of threads running tasks, at least 1
+   * @throws  The first exception a task ended with, once all have finished
+	 */
+  void run(const std::uint32_t threads = 1);
+
+	/**
+   * Queues a suspended task to be resumed.  Threadsafe and does not block
+   * for long, so I/O completions may call it.
+   *
+   * @param handle  The task's coroutine
+	 */
+  void resume(std::coroutine_handle<> handle);
+
+ private:
+  friend struct Task::promise_type::Finish;
+
+	/**
+   * Counts a task as finished, keeping the first exception any ended with.
+	 */
+  void finished(std::exception_ptr error);
+
+	/**
+   * Loop of one thread of run(): resumes queued tasks until none is left to
+   * finish.
+	 */
+  void drive();
+
+	/**
+   * Coroutines ready to start or be resumed
+	 */
+  std::deque<std::coroutine_handle<> > ready;
+
+	/**
+   * Number of tasks spawned and not finished
+	 */
+  std::uint64_t live;
+
+	/**
+   * First exception a task ended with since run() last returned
+	 */
+  std::exception_ptr error;
+
+	/**
+   * Latch protecting all of the above
+	 */
+  std::mutex latch;
+
+	/**
+   * Signalled when a coroutine is queued or the last task finishes
+	 */
+  std::condition_variable wakeup;
+};
+
+
+/**
+* @brief Awaitable read of a page into the buffer pool, returned by
+* BufMgr::readPageAsync()
+*
+* Awaiting it pins the page as readPage() would and gives a PageGuard.  It
+* may only be awaited once, from a Task.
+*/
+class PageRead
+{
+ public:
+	/**
+   * Pins the page if it is in the pool, or reads it on the calling thread if
+   * the read cannot be asynchronous.
+   *
+   * @return  True if the read completed, so the task goes on without suspending
+	 */
+  bool await_ready();
+
+	/**
+   * Reserves a frame and submits the read of the page into it, or, if the
+   * page is being read already, waits for that read instead.  The task is
+   * resumed by its executor when the read completes.
+   *
+   * @param handle  The awaiting task
+   * @return  False if the read completed or failed without I/O, so the task
+   *          goes on at once
+	 */
+  bool await_suspend(std::coroutine_handle<Task::promise_type> handle);
+
+	/**
+   * @return  Guard holding the pin on the page
+   * @throws  What readPage() would have
+	 */
+  PageGuard await_resume();
+
+ private:
+  friend class BufMgr;
+
+  PageRead(BufMgr* bufMgr, File* file, const PageId pageNo);
+
+	/**
+   * Completion of the read submitted by await_suspend(), on an I/O thread
+	 */
+  void complete(std::exception_ptr failure);
+
+	/**
+   * Pool read through
+	 */
+  BufMgr* bufMgr;
+
+	/**
+   * File of the page
+	 */
+  File* file;
+
+	/**
+   * Page number in the file
+	 */
+  PageId pageNo;
+
+	/**
+   * Frame holding the page once pinned
+	 */
+  FrameId frame;
+
+	/**
+   * Whether the read went to the file, rather than hitting
+	 */
+  bool missed;
+
+	/**
+   * Whether the task waited for another's read of the page, and must pin it
+   * once resumed
+	 */
+  bool shared;
+
+	/**
+   * When the miss was seen
+	 */
+  std::chrono::steady_clock::time_point started;
+
+	/**
+   * Failure of the read
+	 */
+  std::exception_ptr failure;
+
+	/**
+   * The awaiting task, and the executor resuming it
+	 */
+  std::coroutine_handle<> task;
+  TaskExecutor* executor;
+};
+
+}
@@ -0,0 +1,199 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "traceRecorder.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+const std::size_t TraceRecorder::BUFFER_RECORDS;
+const std::uint32_t TraceRecorder::MAGIC;
+
+namespace {
+
+/**
+ * Writes all of <length> bytes at <offset>, retrying short writes.
+ */
+void writeFully(const std::string& path, const int fd, const char* buffer,
+                std::size_t length, std::uint64_t offset)
+{
+  while (length > 0) {
+    const ssize_t n = ::pwrite(fd, buffer, length, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException(path, "pwrite", errno);
+    }
+    buffer += n;
+    offset += n;
+    length -= n;
+  }
+}
+
+/**
+ * Reads all of <length> bytes at <offset>; a short file is an error.
+ */
+void readFully(const std::string& path, const int fd, char* buffer,
+               std::size_t length, std::uint64_t offset)
+{
+  while (length > 0) {
+    const ssize_t n = ::pread(fd, buffer, length, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException(path, "pread", errno);
+    }
+    if (n == 0) {
+      throw IoException(path, "pread", EIO);
+    }
+    buffer += n;
+    offset += n;
+    length -= n;
+  }
+}
+
+}
+
+TraceRecorder::TraceRecorder(const std::string& tracePath, const std::uint64_t capacity)
+  : path(tracePath), start(std::chrono::steady_clock::now()), lost(0)
+{
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw IoException(path, "open", errno);
+  }
+  header.magic = MAGIC;
+  header.reserved = 0;
+  header.capacity = std::max<std::uint64_t>(capacity, 1);
+  header.count = 0;
+  try {
+    writeFully(path, fd, reinterpret_cast<const char*>(&header), sizeof(header), 0);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  buffer.reserve(BUFFER_RECORDS);
+}
+
+TraceRecorder::~TraceRecorder()
+{
+  flush();
+  ::close(fd);
+}
+
+void TraceRecorder::record(const TraceOp op, const FileId file, const PageId page,
+                           const bool dirty)
+{
+  StoredRecord stored;
+  stored.file = file;
+  stored.page = page;
+  const std::uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  stored.stamp = nanos << 8 | std::uint64_t(op) << 1 | (dirty ? 1 : 0);
+
+  std::lock_guard<std::mutex> lock(latch);
+  buffer.push_back(stored);
+  if (buffer.size() >= BUFFER_RECORDS) {
+    write();
+  }
+}
+
+void TraceRecorder::flush()
+{
+  std::lock_guard<std::mutex> lock(latch);
+  write();
+}
+
+std::uint64_t TraceRecorder::dropped()
+{
+  std::lock_guard<std::mutex> lock(latch);
+  return lost;
+}
+
+void TraceRecorder::write()
+{
+  if (buffer.empty()) {
+    return;
+  }
+  // of more records than the ring holds only the newest are kept
+  const std::size_t keep = static_cast<std::size_t>(
+      std::min<std::uint64_t>(buffer.size(), header.capacity));
+  const StoredRecord* next = buffer.data() + buffer.size() - keep;
+  std::uint64_t count = header.count + buffer.size() - keep;
+  try {
+    for (std::size_t left = keep; left > 0;) {
+      // the ring may wrap in the middle of the buffer
+      const std::uint64_t slot = count % header.capacity;
+      const std::size_t n = static_cast<std::size_t>(
+          std::min<std::uint64_t>(left, header.capacity - slot));
+      writeFully(path, fd, reinterpret_cast<const char*>(next), n * sizeof(StoredRecord),
+                 sizeof(TraceHeader) + slot * sizeof(StoredRecord));
+      next += n;
+      count += n;
+      left -= n;
+    }
+    TraceHeader written = header;
+    written.count = count;
+    writeFully(path, fd, reinterpret_cast<const char*>(&written), sizeof(written), 0);
+    header.count = count;
+  } catch (const IoException&) {
+    // some slots may hold new records, but the header still names the old ones
+    lost += buffer.size();
+  }
+  buffer.clear();
+}
+
+std::vector<TraceRecord> TraceRecorder::read(const std::string& tracePath)
+{
+  const int fd = ::open(tracePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw IoException(tracePath, "open", errno);
+  }
+  std::vector<TraceRecord> records;
+  try {
+    TraceHeader header;
+    readFully(tracePath, fd, reinterpret_cast<char*>(&header), sizeof(header), 0);
+    if (header.magic != MAGIC || header.capacity == 0) {
+      throw IoException(tracePath, "read", EINVAL);
+    }
+    const std::uint64_t held = std::min(header.count, header.capacity);
+    std::vector<StoredRecord> ring(static_cast<std::size_t>(held));
+    readFully(tracePath, fd, reinterpret_cast<char*>(ring.data()),
+              ring.size() * sizeof(StoredRecord), sizeof(TraceHeader));
+    // once the ring has wrapped, the oldest record is in the next slot to fill
+    const std::uint64_t oldest = header.count > header.capacity
+        ? header.count % header.capacity : 0;
+    records.reserve(ring.size());
+    for (std::uint64_t i = 0; i < held; i++) {
+      const StoredRecord& stored = ring[static_cast<std::size_t>((oldest + i) % held)];
+      TraceRecord record;
+      record.nanos = stored.stamp >> 8;
+      record.file = stored.file;
+      record.page = stored.page;
+      record.op = static_cast<TraceOp>((stored.stamp >> 1) & 0x7f);
+      record.dirty = (stored.stamp & 1) != 0;
+      records.push_back(record);
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  return records;
+}
+
+}
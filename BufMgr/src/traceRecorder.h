@@ -0,0 +1,242 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+* @brief Buffer pool calls a TraceRecorder records
+*/
+enum class TraceOp : std::uint8_t {
+	/**
+   * BufMgr::readPage()
+	 */
+  READ = 0,
+
+	/**
+   * BufMgr::allocPage(); the page number is that of the new page
+	 */
+  ALLOC = 1,
+
+	/**
+   * BufMgr::unPinPage(), with its dirty flag
+	 */
+  UNPIN = 2,
+
+	/**
+   * BufMgr::disposePage()
+	 */
+  DISPOSE = 3
+};
+
+
+/**
+* @brief One recorded buffer pool call
+*/
+struct TraceRecord
+{
+	/**
+   * Nanoseconds since the recorder was created
+	 */
+  std::uint64_t nanos;
+
+	/**
+   * File::id() of the file the call was for
+	 */
+  FileId file;
+
+	/**
+   * Page the call was for
+	 */
+  PageId page;
+
+	/**
+   * The call
+	 */
+  TraceOp op;
+
+	/**
+   * Dirty flag of an UNPIN; false for the other calls
+	 */
+  bool dirty;
+};
+
+
+/**
+* @brief Ring buffer of buffer pool calls in a file, for replay with TraceReplay
+*
+* The trace file holds a header and room for a fixed number of 16-byte
+* records; once it is full, each new record replaces the oldest, so the file
+* always has the most recent calls and never grows.  Records gather in memory
+* and go to the file BUFFER_RECORDS at a time, and on flush().  A single latch
+* orders the records of all threads, which costs little next to the latched
+* page table lookup of the call being recorded.
+*
+* File identifiers are only meaningful within the process that recorded
+* them, so a trace tells files apart but not what they were.  Tracing is best
+* effort: the file is never synced, and records that cannot be written are
+* dropped and counted rather than failing the buffer pool call.
+*/
+class TraceRecorder
+{
+ public:
+	/**
+   * Records kept in memory before they are written
+	 */
+  static const std::size_t BUFFER_RECORDS = 4096;
+
+	/**
+   * Creates a trace file, replacing any file of that name.
+   *
+   * @param path      Name of the trace file
+   * @param capacity  Number of records the file keeps; at least one
+   * @throws  IoException If the file cannot be created
+	 */
+  TraceRecorder(const std::string& path, const std::uint64_t capacity);
+
+	/**
+   * Writes the records still in memory and closes the file.
+	 */
+  ~TraceRecorder();
+
+	/**
+   * Records a call.
+   *
+   * @param op      The call
+   * @param file    File::id() of its file
+   * @param page    Its page number
+   * @param dirty   Its dirty flag, for UNPIN
+	 */
+  void record(const TraceOp op, const FileId file, const PageId page,
+              const bool dirty = false);
+
+	/**
+   * Writes the records kept in memory to the file.
+	 */
+  void flush();
+
+	/**
+   * Returns the number of records that were lost because they could not be
+   * written.
+	 */
+  std::uint64_t dropped();
+
+	/**
+   * Reads the records in a trace file, oldest first.
+   *
+   * @param path  Name of the trace file
+   * @return  The records
+   * @throws  IoException If the file cannot be read or is not a trace file
+	 */
+  static std::vector<TraceRecord> read(const std::string& path);
+
+ private:
+	/**
+   * @brief Start of the trace file; the ring of records follows
+	 */
+  struct TraceHeader {
+    /**
+     * Always MAGIC
+     */
+    std::uint32_t magic;
+
+    /**
+     * Padding; zero
+     */
+    std::uint32_t reserved;
+
+    /**
+     * Number of records the ring holds
+     */
+    std::uint64_t capacity;
+
+    /**
+     * Number of records ever written; the next goes to slot count % capacity
+     */
+    std::uint64_t count;
+  };
+
+	/**
+   * @brief A record as stored in the file
+	 */
+  struct StoredRecord {
+    /**
+     * Nanoseconds, shifted left by 8, with the op in bits 1-7 and the dirty
+     * flag in bit 0
+     */
+    std::uint64_t stamp;
+
+    /**
+     * File identifier
+     */
+    FileId file;
+
+    /**
+     * Page number
+     */
+    PageId page;
+  };
+
+	/**
+   * Value of TraceHeader::magic
+	 */
+  static const std::uint32_t MAGIC = 0x54524342;
+
+	/**
+   * Writes the buffered records and the header.  Caller holds the latch.
+	 */
+  void write();
+
+	/**
+   * Name of the trace file
+	 */
+  std::string path;
+
+	/**
+   * Descriptor of the trace file
+	 */
+  int fd;
+
+	/**
+   * Time the records count from
+	 */
+  std::chrono::steady_clock::time_point start;
+
+	/**
+   * Protects all the fields below
+	 */
+  std::mutex latch;
+
+	/**
+   * Records not yet written
+	 */
+  std::vector<StoredRecord> buffer;
+
+	/**
+   * The file's header; count is the number of records in the file so far
+	 */
+  TraceHeader header;
+
+	/**
+   * Number of records lost
+	 */
+  std::uint64_t lost;
+};
+
+}
@@ -0,0 +1,142 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+
+#include "traceReplay.h"
+#include "exceptions/badgerdb_exception.h"
+
+namespace badgerdb {
+
+TraceReplay::TraceReplay(const std::vector<TraceRecord>& records,
+                         const std::string& prefix)
+  : trace(records), scratch(prefix)
+{
+}
+
+ReplayResult TraceReplay::run(const std::uint32_t frames,
+                              const BufMgrOptions& options) const
+{
+  typedef std::pair<FileId, PageId> Key;
+
+  // pages the trace finds in place rather than allocating
+  std::map<FileId, std::set<PageId> > existing;
+  std::set<Key> seen;
+  for (const TraceRecord& record : trace) {
+    std::set<PageId>& pages = existing[record.file];
+    if (seen.insert(Key(record.file, record.page)).second &&
+        record.op != TraceOp::ALLOC) {
+      pages.insert(record.page);
+    }
+  }
+
+  std::map<FileId, std::unique_ptr<File> > files;
+  std::map<Key, PageId> mapped;
+  for (std::map<FileId, std::set<PageId> >::const_iterator it = existing.begin();
+       it != existing.end(); ++it)
+  {
+    const std::string name = scratch + "." + std::to_string(it->first);
+    if (File::exists(name)) {
+      File::remove(name);
+    }
+    File* file = new File(File::create(name));
+    files[it->first].reset(file);
+    for (PageId page : it->second) {
+      Page empty;
+      mapped[Key(it->first, page)] = file->allocatePage(empty);
+    }
+  }
+
+  // the replay must not trace itself
+  BufMgrOptions replayOptions = options;
+  replayOptions.traceFile.clear();
+  std::unique_ptr<BufMgr> pool(new BufMgr(frames, replayOptions));
+  // pins are given back by frame, the latest first
+  std::map<Key, std::vector<Page*> > pins;
+  ReplayResult result;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (const TraceRecord& record : trace) {
+    const Key key(record.file, record.page);
+    File* file = files[record.file].get();
+    std::map<Key, PageId>::iterator page = mapped.find(key);
+    Page* frame;
+    try {
+      switch (record.op) {
+      case TraceOp::READ:
+        if (page == mapped.end()) {
+          result.skipped++;
+          continue;
+        }
+        pool->readPage(file, page->second, frame);
+        pins[key].push_back(frame);
+        break;
+      case TraceOp::ALLOC:
+        {
+          PageId pageNo;
+          pool->allocPage(file, pageNo, frame);
+          mapped[key] = pageNo;
+          pins[key].push_back(frame);
+        }
+        break;
+      case TraceOp::UNPIN:
+        if (page == mapped.end() || pins[key].empty()) {
+          result.skipped++;
+          continue;
+        }
+        pool->unPinPages(file, std::span<Page* const>(&pins[key].back(), 1), record.dirty);
+        pins[key].pop_back();
+        break;
+      case TraceOp::DISPOSE:
+        if (page == mapped.end()) {
+          result.skipped++;
+          continue;
+        }
+        pool->disposePage(file, page->second);
+        mapped.erase(page);
+        pins.erase(key);
+        break;
+      }
+    } catch (const BadgerDbException&) {
+      result.skipped++;
+      continue;
+    }
+    result.operations++;
+  }
+  result.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  result.stats = pool->getBufStats();
+
+  // pins the trace never gave back, then the pool and scratch files go
+  for (std::map<Key, std::vector<Page*> >::const_iterator it = pins.begin();
+       it != pins.end(); ++it)
+  {
+    pool->unPinPages(files[it->first.first].get(), it->second, false);
+  }
+  for (std::map<FileId, std::unique_ptr<File> >::iterator it = files.begin();
+       it != files.end(); ++it)
+  {
+    pool->flushFile(it->second.get());
+  }
+  pool.reset();
+  for (std::map<FileId, std::unique_ptr<File> >::iterator it = files.begin();
+       it != files.end(); ++it)
+  {
+    const std::string name = it->second->filename();
+    it->second.reset();
+    File::remove(name);
+  }
+  return result;
+}
+
+}
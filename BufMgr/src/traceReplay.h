@@ -0,0 +1,99 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "traceRecorder.h"
+
+namespace badgerdb {
+
+/**
+* @brief Outcome of replaying a trace, see TraceReplay::run()
+*/
+struct ReplayResult
+{
+	/**
+   * Statistics of the pool the trace ran against, counting only the replay
+	 */
+  BufStats stats;
+
+	/**
+   * Number of records replayed
+	 */
+  std::uint64_t operations;
+
+	/**
+   * Number of records that could not be replayed: unpins of pages pinned
+   * before the trace starts, calls that failed in the recorded run too, and
+   * reads the pool had no unpinned frame for
+	 */
+  std::uint64_t skipped;
+
+	/**
+   * Wall clock time the records took to replay
+	 */
+  double seconds;
+
+  ReplayResult() : operations(0), skipped(0), seconds(0) {}
+};
+
+
+/**
+* @brief Runs a trace recorded by TraceRecorder against a buffer pool
+*
+* Each file of the trace is modelled by a scratch file.  Pages the trace
+* touches before allocating them, if it does at all, are created in the
+* scratch file up front, so that reading them costs what it did; pages it
+* allocates are allocated during the replay, and the trace's page numbers
+* are mapped to whatever numbers the scratch file hands out.  Pages are
+* never changed, but unpinning one dirty makes the pool write it back all the
+* same, so the I/O counts are those of the recorded run with a pool of the
+* chosen size and policy.
+*/
+class TraceReplay
+{
+ public:
+	/**
+   * Prepares a replay.
+   *
+   * @param trace    Records to replay, oldest first
+   * @param scratch  Prefix of the names of the scratch files
+	 */
+  TraceReplay(const std::vector<TraceRecord>& trace, const std::string& scratch);
+
+	/**
+   * Replays the trace against a new pool, in scratch files created for the
+   * run and removed after it.
+   *
+   * @param frames   Number of frames of the pool
+   * @param options  Options of the pool
+   * @return  What the replay read, wrote and hit, and how long it took
+	 */
+  ReplayResult run(const std::uint32_t frames,
+                   const BufMgrOptions& options = BufMgrOptions()) const;
+
+ private:
+	/**
+   * Records to replay
+	 */
+  std::vector<TraceRecord> trace;
+
+	/**
+   * Prefix of the scratch file names
+	 */
+  std::string scratch;
+};
+
+}
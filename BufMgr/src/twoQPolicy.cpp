@@ -0,0 +1,149 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "twoQPolicy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+TwoQPolicy::TwoQPolicy(const std::uint32_t bufs)
+	: kin(std::max<std::size_t>(bufs / 4, 1)), kout(std::max<std::size_t>(bufs / 2, 1)),
+	  lists(bufs, LISTS), pages(bufs), unread(bufs, false), limit(bufs)
+{
+  for (FrameId i = 0; i < bufs; i++) {
+    lists.pushBack(FREE, i);
+  }
+}
+
+bool TwoQPolicy::evictFrom(const int list, const FrameClaim& claim, FrameId& frame)
+{
+  for (const FrameId candidate : lists.frames(list)) {
+    if (claim(candidate, false)) {
+      lists.erase(candidate);
+      if (list == A1IN) {
+        a1out.push(pages[candidate]);
+        if (a1out.size() > kout) {
+          a1out.popOldest();
+        }
+      }
+      frame = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TwoQPolicy::evict(const FrameClaim& claim, FrameId& frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  if (evictFrom(FREE, claim, frame)) {
+    return true;
+  }
+  // Reclaim from A1in while it is over its share, otherwise from Am
+  if (lists.size(A1IN) > kin || lists.size(AM) == 0) {
+    return evictFrom(A1IN, claim, frame) || evictFrom(AM, claim, frame);
+  }
+  return evictFrom(AM, claim, frame) || evictFrom(A1IN, claim, frame);
+}
+
+void TwoQPolicy::installed(const FrameId frame, const File* file, const PageId pageNo,
+                           const bool cold)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  pages[frame] = PageKey(file->id(), pageNo);
+  unread[frame] = cold;
+  if (cold) {
+    // read ahead: first in line for eviction until it is actually read
+    lists.pushFront(A1IN, frame);
+    return;
+  }
+  if (a1out.erase(pages[frame])) {
+    lists.pushBack(AM, frame);
+  } else {
+    lists.pushBack(A1IN, frame);
+  }
+}
+
+void TwoQPolicy::accessed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  touch(frame);
+}
+
+void TwoQPolicy::accessedAll(const std::vector<FrameId>& frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  for (FrameId frame : frames) {
+    touch(frame);
+  }
+}
+
+void TwoQPolicy::touch(const FrameId frame)
+{
+  if (unread[frame]) {
+    // the first reference to a read-ahead page only makes it a regular newcomer
+    unread[frame] = false;
+    if (lists.listOf(frame) == A1IN) {
+      lists.pushBack(A1IN, frame);
+    }
+    return;
+  }
+  if (lists.listOf(frame) == AM) {
+    lists.pushBack(AM, frame);
+  }
+}
+
+void TwoQPolicy::removed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  if (frame < limit) {
+    lists.pushBack(FREE, frame);
+  } else {
+    lists.erase(frame);
+  }
+}
+
+void TwoQPolicy::resize(const std::uint32_t frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  lists.resize(frames);
+  if (frames > pages.size()) {
+    pages.resize(frames);
+    unread.resize(frames, false);
+  }
+  for (FrameId i = frames; i < limit; i++) {
+    if (lists.listOf(i) == FREE) {
+      lists.erase(i);
+    }
+  }
+  for (FrameId i = limit; i < frames; i++) {
+    if (lists.listOf(i) == FrameLists::NONE) {
+      lists.pushBack(FREE, i);
+    }
+  }
+  limit = frames;
+  kin = std::max<std::size_t>(frames / 4, 1);
+  kout = std::max<std::size_t>(frames / 2, 1);
+  while (a1out.size() > kout) {
+    a1out.popOldest();
+  }
+}
+
+void TwoQPolicy::victimOrder(std::vector<FrameId>& frames) const
+{
+  std::lock_guard<std::mutex> guard(latch);
+  const int order[] = {FREE, A1IN, AM};
+  for (const int list : order) {
+    frames.insert(frames.end(), lists.frames(list).begin(), lists.frames(list).end());
+  }
+}
+
+}
@@ -0,0 +1,104 @@
+/**
+ * Nick Merfeld nmerfeld
+ * Uilliam Lawless ulawless
+ * Rehan Madhugiri madhugiri
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "replacementPolicy.h"
+
+namespace badgerdb {
+
+/**
+* @brief The full 2Q algorithm of Johnson and Shasha
+*
+* New pages enter a FIFO (A1in) and are not promoted by hits there, so a scan
+* only ever displaces other pages of A1in.  Pages evicted from A1in are
+* remembered in a ghost FIFO (A1out); a page read again while remembered is
+* placed in the LRU list of hot pages (Am).  All decisions are serialized by
+* one latch.
+*/
+class TwoQPolicy : public ReplacementPolicy
+{
+ public:
+	/**
+   * Constructor of TwoQPolicy class
+   *
+   * @param bufs   Number of frames in the buffer pool
+	 */
+  explicit TwoQPolicy(const std::uint32_t bufs);
+
+  bool evict(const FrameClaim& claim, FrameId& frame) override;
+  void installed(const FrameId frame, const File* file, const PageId pageNo,
+                 const bool cold) override;
+  void accessed(const FrameId frame) override;
+  void accessedAll(const std::vector<FrameId>& frames) override;
+  void removed(const FrameId frame) override;
+  void victimOrder(std::vector<FrameId>& frames) const override;
+  void resize(const std::uint32_t frames) override;
+
+ private:
+	/**
+   * Record a hit on a frame.  Caller holds the latch.
+	 */
+  void touch(const FrameId frame);
+
+	/**
+   * Ids of the frame lists
+	 */
+  enum { FREE, A1IN, AM, LISTS };
+
+	/**
+   * Offer the frames of one list to <claim>, oldest first.  Caller holds the
+   * latch.
+   *
+   * @return  True if a frame was claimed; it is then in no list.
+	 */
+  bool evictFrom(const int list, const FrameClaim& claim, FrameId& frame);
+
+	/**
+   * Protects all other members
+	 */
+  mutable std::mutex latch;
+
+	/**
+   * Target size of A1in and capacity of A1out
+	 */
+  std::size_t kin;
+  std::size_t kout;
+
+	/**
+   * Free, A1in and Am frames
+	 */
+  FrameLists lists;
+
+	/**
+   * Page held by each frame
+	 */
+  std::vector<PageKey> pages;
+
+	/**
+   * True for read-ahead frames not referenced since they were installed
+	 */
+  std::vector<bool> unread;
+
+	/**
+   * Pages recently evicted from A1in
+	 */
+  GhostList a1out;
+
+	/**
+   * Number of frames in the pool; frames above are not put in the free list
+	 */
+  std::uint32_t limit;
+};
+
+}
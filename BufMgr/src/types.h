@@ -10,6 +10,17 @@
 
 #pragma once
 
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Size of a page in bytes, see Page::SIZE.  Fixed when the library is built,
+ * e.g. with "make PAGE_SIZE=4096"; a power of two from 4KB to 1MB.
+ */
+#ifndef BADGERDB_PAGE_SIZE
+#define BADGERDB_PAGE_SIZE 8192
+#endif
+
 namespace badgerdb {
 
 /**
@@ -18,15 +29,33 @@ namespace badgerdb {
 typedef std::uint32_t PageId;
 
 /**
- * @brief Identifier for a slot in a page.
+ * @brief Offset or length of bytes within a page: 16 bits for pages of up to
+ * 64KB, 32 above.
+ */
+typedef std::conditional<(BADGERDB_PAGE_SIZE > 65536), std::uint32_t,
+                         std::uint16_t>::type PageOffset;
+
+/**
+ * @brief Identifier for a slot in a page, as wide as a PageOffset since the
+ * chain of unused slots is kept in the slots' offset fields.
  */
-typedef std::uint16_t SlotId;
+typedef PageOffset SlotId;
+
+/**
+ * @brief Log sequence number: position of a record in the write-ahead log.
+ */
+typedef std::uint64_t Lsn;
 
 /**
  * @brief Identifier for a frame in buffer pool.
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Identifier for an open file, shared by all File objects for it.
+ */
+typedef std::uint32_t FileId;
+
 /**
  * @brief Identifier for a record in a page.
  */